@@ -0,0 +1,268 @@
+#ifndef FFW_ASYNC_LOGGER_H
+#define FFW_ASYNC_LOGGER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+#ifndef FFW_HOST_BUILD
+#include <android/log.h>
+#else
+// 主机单元测试和基准没有liblog，只需要与android/log.h相同的优先级值
+enum {
+    ANDROID_LOG_VERBOSE = 2,
+    ANDROID_LOG_DEBUG,
+    ANDROID_LOG_INFO,
+    ANDROID_LOG_WARN,
+    ANDROID_LOG_ERROR,
+    ANDROID_LOG_FATAL
+};
+#endif
+
+#ifndef LOG_TAG
+#define LOG_TAG "FFmpegWrapper"
+#endif
+
+// 截断到len字节时不拆开多字节UTF-8字符：返回不超过len、以完整字符结尾的前缀长度。
+// 只检查最后一个字符，前面的非法序列原样保留
+inline size_t utf8BoundaryLength(const char* text, size_t len) {
+    size_t lead = len;
+    size_t continuation = 0;
+    while (lead > 0 && continuation < 3 && ((unsigned char)text[lead - 1] & 0xC0) == 0x80) {
+        lead--;
+        continuation++;
+    }
+    if (lead == 0) {
+        return len;
+    }
+    unsigned char c = (unsigned char)text[lead - 1];
+    size_t need = 1;
+    if ((c & 0xE0) == 0xC0) {
+        need = 2;
+    } else if ((c & 0xF0) == 0xE0) {
+        need = 3;
+    } else if ((c & 0xF8) == 0xF0) {
+        need = 4;
+    }
+    return continuation + 1 < need ? lead - 1 : len;
+}
+
+// ============================================================================
+// 异步日志 - 调用线程只格式化并写入无锁环形队列，后台线程输出到logcat（主机构建输出到stderr）
+// ============================================================================
+// 错误和致命日志不进队列，在调用线程同步输出：紧随其后的崩溃或abort不会把它留在队列里。
+// 因此一条错误日志可能先于更早写入、仍在队列中的INFO/WARN出现在logcat里
+// 编译期级别：低于FFW_LOG_LEVEL的调用连同参数求值一起被移除（Release构建默认去掉DEBUG）
+#define FFW_LOG_LEVEL_DEBUG 0
+#define FFW_LOG_LEVEL_INFO  1
+#define FFW_LOG_LEVEL_WARN  2
+#define FFW_LOG_LEVEL_ERROR 3
+#ifndef FFW_LOG_LEVEL
+#ifdef NDEBUG
+#define FFW_LOG_LEVEL FFW_LOG_LEVEL_INFO
+#else
+#define FFW_LOG_LEVEL FFW_LOG_LEVEL_DEBUG
+#endif
+#endif
+
+class AsyncLogger {
+public:
+    // 不析构：进程退出时其他静态对象的析构函数仍可能写日志
+    static AsyncLogger& getInstance() {
+        static AsyncLogger* instance = new AsyncLogger();
+        return *instance;
+    }
+    
+    void write(int priority, const char* fmt, ...) __attribute__((format(printf, 3, 4))) {
+        va_list args;
+        va_start(args, fmt);
+        if (priority >= ANDROID_LOG_ERROR) {
+            char text[kSyncTextSize];
+            formatText(text, sizeof(text), fmt, args);
+            va_end(args);
+            output(priority, text);
+            return;
+        }
+        
+        uint32_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        Slot* slot = nullptr;
+        for (;;) {
+            slot = &slots[pos & (kSlotCount - 1)];
+            uint32_t sequence = slot->sequence.load(std::memory_order_acquire);
+            int32_t diff = (int32_t)(sequence - pos);
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                va_end(args);
+                dropped.fetch_add(1, std::memory_order_relaxed);   // 队列已满，丢弃而不阻塞调用线程
+                return;
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        
+        slot->priority = priority;
+        formatText(slot->text, sizeof(slot->text), fmt, args);
+        va_end(args);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        
+        if (drainer_waiting.load(std::memory_order_acquire)) {
+            wake.notify_one();
+        }
+    }
+    
+    // 输出队列中剩余日志并停止后台线程（库卸载时调用）
+    void shutdown() {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        if (drainer.joinable()) {
+            drainer.join();
+        }
+    }
+    
+private:
+    static const uint32_t kSlotCount = 512;     // 必须是2的幂
+    static const size_t kSyncTextSize = 1024;   // 同步输出的缓冲区，不受队列槽位大小限制
+    
+    struct Slot {
+        std::atomic<uint32_t> sequence;
+        int priority;
+        char text[240];
+    };
+    
+    Slot slots[kSlotCount];
+    std::atomic<uint32_t> enqueue_pos;
+    uint32_t dequeue_pos;                       // 只由后台线程访问
+    std::atomic<uint32_t> dropped;
+    std::atomic<bool> drainer_waiting;
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    bool stopping;
+    std::thread drainer;
+    
+    AsyncLogger() : enqueue_pos(0), dequeue_pos(0), dropped(0), drainer_waiting(false), stopping(false) {
+        for (uint32_t i = 0; i < kSlotCount; i++) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        drainer = std::thread(&AsyncLogger::drainLoop, this);
+    }
+    
+    // 超长日志截断在完整的UTF-8字符处，避免logcat里出现半个汉字/emoji
+    static void formatText(char* text, size_t size, const char* fmt, va_list args) {
+        int len = vsnprintf(text, size, fmt, args);
+        if (len < 0) {
+            text[0] = '\0';
+        } else if ((size_t)len >= size) {
+            text[utf8BoundaryLength(text, size - 1)] = '\0';
+        }
+    }
+    
+    static void output(int priority, const char* text) {
+#ifdef __ANDROID__
+        __android_log_write(priority, LOG_TAG, text);
+#else
+        static const char kLevels[] = "??VDIWEF";
+        fprintf(stderr, "%c/%s: %s\n", kLevels[priority & 7], LOG_TAG, text);
+#endif
+    }
+    
+    bool drainOne() {
+        Slot* slot = &slots[dequeue_pos & (kSlotCount - 1)];
+        if (slot->sequence.load(std::memory_order_acquire) != dequeue_pos + 1) {
+            return false;
+        }
+        output(slot->priority, slot->text);
+        slot->sequence.store(dequeue_pos + kSlotCount, std::memory_order_release);
+        dequeue_pos++;
+        return true;
+    }
+    
+    void drainLoop() {
+        for (;;) {
+            while (drainOne()) {
+            }
+            uint32_t lost = dropped.exchange(0, std::memory_order_relaxed);
+            if (lost > 0) {
+                char text[64];
+                snprintf(text, sizeof(text), "⚠️ 日志队列已满，丢弃%u条", lost);
+                output(ANDROID_LOG_WARN, text);
+            }
+            
+            std::unique_lock<std::mutex> lock(wake_mutex);
+            if (stopping) {
+                lock.unlock();
+                while (drainOne()) {
+                }
+                return;
+            }
+            // 先声明等待再复查队列，避免与写入方的通知错过；超时兜底
+            drainer_waiting.store(true, std::memory_order_seq_cst);
+            Slot* next = &slots[dequeue_pos & (kSlotCount - 1)];
+            if (next->sequence.load(std::memory_order_acquire) != dequeue_pos + 1) {
+                wake.wait_for(lock, std::chrono::milliseconds(100));
+            }
+            drainer_waiting.store(false, std::memory_order_relaxed);
+        }
+    }
+};
+
+// 按调用点限频：间隔内被抑制的调用不做任何格式化，只有一次原子读和时钟读取
+class LogRateLimiter {
+public:
+    LogRateLimiter() : next_allowed_us(0) {}
+    
+    bool allow(int interval_ms) {
+        int64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        int64_t next = next_allowed_us.load(std::memory_order_relaxed);
+        return now >= next &&
+               next_allowed_us.compare_exchange_strong(next, now + (int64_t)interval_ms * 1000,
+                                                       std::memory_order_relaxed);
+    }
+    
+private:
+    std::atomic<int64_t> next_allowed_us;
+};
+
+#define FFW_LOG_RATE_LIMITED(log_macro, interval_ms, ...) do { \
+        static LogRateLimiter ffw_log_limiter; \
+        if (ffw_log_limiter.allow(interval_ms)) { \
+            log_macro(__VA_ARGS__); \
+        } \
+    } while (0)
+
+#if FFW_LOG_LEVEL <= FFW_LOG_LEVEL_DEBUG
+#define LOGD(...) AsyncLogger::getInstance().write(ANDROID_LOG_DEBUG, __VA_ARGS__)
+#define LOGD_EVERY(interval_ms, ...) FFW_LOG_RATE_LIMITED(LOGD, interval_ms, __VA_ARGS__)
+#else
+#define LOGD(...) ((void)0)
+#define LOGD_EVERY(interval_ms, ...) ((void)0)
+#endif
+#if FFW_LOG_LEVEL <= FFW_LOG_LEVEL_INFO
+#define LOGI(...) AsyncLogger::getInstance().write(ANDROID_LOG_INFO, __VA_ARGS__)
+#define LOGI_EVERY(interval_ms, ...) FFW_LOG_RATE_LIMITED(LOGI, interval_ms, __VA_ARGS__)
+#else
+#define LOGI(...) ((void)0)
+#define LOGI_EVERY(interval_ms, ...) ((void)0)
+#endif
+#if FFW_LOG_LEVEL <= FFW_LOG_LEVEL_WARN
+#define LOGW(...) AsyncLogger::getInstance().write(ANDROID_LOG_WARN, __VA_ARGS__)
+#define LOGW_EVERY(interval_ms, ...) FFW_LOG_RATE_LIMITED(LOGW, interval_ms, __VA_ARGS__)
+#else
+#define LOGW(...) ((void)0)
+#define LOGW_EVERY(interval_ms, ...) ((void)0)
+#endif
+#define LOGE(...) AsyncLogger::getInstance().write(ANDROID_LOG_ERROR, __VA_ARGS__)
+#define LOGE_EVERY(interval_ms, ...) FFW_LOG_RATE_LIMITED(LOGE, interval_ms, __VA_ARGS__)
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef FFW_AUDIO_SYNC_H
+#define FFW_AUDIO_SYNC_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+// ============================================================================
+// 低延迟音频输出的同步策略 - 跟随视频主时钟，不为音频增加视频延迟
+// ============================================================================
+// 落后视频时钟超过kMaxLagUs的音频包解码前直接丢弃；输出缓冲队列满时丢弃解码帧而不等待，
+// 所以音频最多超前视频kMaxQueuedBuffers帧。与OpenSL ES无关，主机测试用同步标记检查音画偏移
+
+// 播放器的PCM格式取自解码出的帧而不是容器参数：HE-AAC(SBR)解码输出的采样率是AudioSpecificConfig
+// 核心层的两倍，PS把单声道扩展为立体声，按容器参数创建播放器会放慢/加快播放，音画逐渐错开
+struct AudioOutputFormat {
+    int sample_rate;
+    int channels;           // 输出最多双声道（多声道取前两个）
+
+    bool operator==(const AudioOutputFormat& other) const {
+        return sample_rate == other.sample_rate && channels == other.channels;
+    }
+
+    bool operator!=(const AudioOutputFormat& other) const {
+        return !(*this == other);
+    }
+};
+
+inline AudioOutputFormat audioOutputFormat(int frame_sample_rate, int frame_channels) {
+    AudioOutputFormat format = {frame_sample_rate, std::min(2, std::max(1, frame_channels))};
+    return format;
+}
+
+class AudioSyncPolicy {
+public:
+    static const int kMaxQueuedBuffers = 4;             // 最多排队4个音频帧（AAC约4x21ms）
+    static const int64_t kMaxLagUs = 80000;             // 落后视频时钟超过80ms的音频直接丢弃
+    static const int64_t kNoTimestamp = INT64_MIN;      // 与AV_NOPTS_VALUE相同
+
+    AudioSyncPolicy() : queued_buffers(0), dropped_late(0), dropped_full(0) {}
+
+    // 包级检查：audio_us为包的源时间，video_clock_us为当前视频帧的源时间；任一未知时不丢弃
+    bool acceptPacket(int64_t audio_us, int64_t video_clock_us) {
+        if (audio_us != kNoTimestamp && video_clock_us != kNoTimestamp &&
+            audio_us < video_clock_us - kMaxLagUs) {
+            dropped_late++;
+            return false;
+        }
+        return true;
+    }
+
+    // 为一个解码帧占用一个输出缓冲；队列已满时计数并返回false
+    bool acquireBuffer() {
+        if (queued_buffers.load() >= kMaxQueuedBuffers) {
+            dropped_full++;
+            return false;
+        }
+        queued_buffers++;
+        return true;
+    }
+
+    // 入队失败时归还刚占用的缓冲
+    void cancelBuffer() {
+        queued_buffers--;
+    }
+
+    // 缓冲播放完毕（OpenSL ES回调线程）
+    void releaseBuffer() {
+        queued_buffers--;
+    }
+
+    // 播放器清空或重建后调用
+    void reset() {
+        queued_buffers.store(0);
+    }
+
+    int queued() const {
+        return queued_buffers.load();
+    }
+
+    int64_t droppedLate() const {
+        return dropped_late;
+    }
+
+    int64_t droppedFull() const {
+        return dropped_full;
+    }
+
+private:
+    std::atomic<int> queued_buffers;
+    int64_t dropped_late;
+    int64_t dropped_full;
+};
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef FFW_BOUNDED_QUEUE_H
+#define FFW_BOUNDED_QUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+// ============================================================================
+// 有界阻塞队列 - 连接录制流水线各阶段，容量固定以限制内存和延迟
+// ============================================================================
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity), closed(false) {}
+
+    // 阻塞写入，队列关闭后返回false（元素所有权仍归调用方）
+    bool push(const T& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_full.wait(lock, [this]() { return closed || items.size() < capacity; });
+        if (closed) {
+            return false;
+        }
+        items.push_back(item);
+        not_empty.notify_one();
+        return true;
+    }
+
+    // 非阻塞写入，队列满或已关闭时返回false
+    bool tryPush(const T& item) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (closed || items.size() >= capacity) {
+            return false;
+        }
+        items.push_back(item);
+        not_empty.notify_one();
+        return true;
+    }
+
+    // 阻塞读取，队列关闭且已取空时返回false
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_empty.wait(lock, [this]() { return closed || !items.empty(); });
+        if (items.empty()) {
+            return false;
+        }
+        item = items.front();
+        items.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    // 关闭队列：唤醒所有等待者，剩余元素仍可被pop取出
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+
+    void reopen() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = false;
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return items.size();
+    }
+
+private:
+    const size_t capacity;
+    bool closed;
+    std::deque<T> items;
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+};
+
+#endif
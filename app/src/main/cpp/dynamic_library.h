@@ -0,0 +1,46 @@
+#ifndef FFW_DYNAMIC_LIBRARY_H
+#define FFW_DYNAMIC_LIBRARY_H
+
+#include <chrono>
+#include <dlfcn.h>
+
+#include "async_logger.h"
+
+// ============================================================================
+// 运行时加载共享库 - dlopen后按函数表解析符号，任何一个缺失都视为加载失败
+// ============================================================================
+// 函数表用decltype(&::name)声明成员，只需要头文件里的声明，不产生链接期依赖
+
+// 解析单个符号到函数指针，缺失时记录日志
+template <typename Function>
+inline bool resolveDynamicSymbol(void* handle, const char* library, const char* name, Function& function) {
+    function = reinterpret_cast<Function>(dlsym(handle, name));
+    if (!function) {
+        LOGE("❌ %s缺少符号: %s", library, name);
+        return false;
+    }
+    return true;
+}
+
+// 打开library，由resolve_all(handle)解析全部符号并返回缺失个数；有缺失时关闭库、handle置空并返回false，
+// 已解析的函数表由调用方清空。调用方负责串行化
+template <typename ResolveAll>
+inline bool loadDynamicLibrary(const char* library, void*& handle, ResolveAll resolve_all) {
+    auto load_start = std::chrono::steady_clock::now();
+    handle = dlopen(library, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        LOGE("❌ dlopen %s失败: %s", library, dlerror());
+        return false;
+    }
+    if (resolve_all(handle) > 0) {
+        dlclose(handle);
+        handle = nullptr;
+        return false;
+    }
+    long long load_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - load_start).count();
+    LOGI("⏱️ %s已加载: dlopen+符号解析%lldms", library, load_ms);
+    return true;
+}
+
+#endif
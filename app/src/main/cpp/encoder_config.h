@@ -0,0 +1,133 @@
+#ifndef FFW_ENCODER_CONFIG_H
+#define FFW_ENCODER_CONFIG_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+// ============================================================================
+// 录制编码参数 - 默认值、校验和H.264 level选择，不依赖FFmpeg（帧率以double传入）
+// ============================================================================
+// 录制码率控制模式
+enum EncoderRateControl {
+    RATE_CONTROL_AUTO = 0,      // 按编码器选择（VBR）
+    RATE_CONTROL_CBR = 1,       // 恒定码率，适合带宽受限的上传
+    RATE_CONTROL_VBR = 2,       // 可变码率，码率上限为目标的1.5倍
+    RATE_CONTROL_CRF = 3        // 恒定质量，仅软件编码器支持
+};
+
+inline const char* rateControlName(int mode) {
+    switch (mode) {
+        case RATE_CONTROL_CBR: return "CBR";
+        case RATE_CONTROL_VBR: return "VBR";
+        case RATE_CONTROL_CRF: return "CRF";
+        default: return "AUTO";
+    }
+}
+
+// 录制编码参数 - 0/空字符串表示按分辨率和帧率自动选择
+struct EncoderConfig {
+    int64_t bitrate;            // 目标码率(bps)
+    int rate_control;           // EncoderRateControl
+    int crf;                    // CRF质量(0-51)，仅CRF模式使用
+    int gop_length;             // 关键帧间隔(帧)
+    bool intra_refresh;         // 周期帧内刷新代替IDR，消除关键帧码率峰值
+    int slices;                 // 每帧slice数，0表示编码器默认
+    std::string preset;         // x264预设，见isKnownEncoderPreset
+    
+    EncoderConfig() :
+        bitrate(0), rate_control(RATE_CONTROL_AUTO), crf(0), gop_length(0),
+        intra_refresh(false), slices(0) {}
+    
+    // 按分辨率填充未设置的字段（码率以30fps为基准按帧率缩放），frame_rate<=0按30fps
+    void fillDefaults(int width, int height, double frame_rate) {
+        double fps = frame_rate > 0 ? frame_rate : 30.0;
+        if (bitrate <= 0) {
+            int64_t pixels = (int64_t)width * height;
+            int64_t base;
+            if (pixels <= 640 * 480) {
+                base = 1500000;
+            } else if (pixels <= 1280 * 720) {
+                base = 3000000;
+            } else if (pixels <= 1920 * 1080) {
+                base = 6000000;
+            } else {
+                base = 12000000;
+            }
+            bitrate = (int64_t)(base * std::max(0.5, fps / 30.0));
+        }
+        if (rate_control == RATE_CONTROL_AUTO) {
+            rate_control = RATE_CONTROL_VBR;
+        }
+        if (crf <= 0) {
+            crf = 23;
+        }
+        if (gop_length <= 0) {
+            gop_length = std::max(1, (int)(fps + 0.5)); // 1秒一个I帧
+        }
+        if (preset.empty()) {
+            preset = "ultrafast";
+        }
+    }
+};
+
+// libx264接受的预设名称（preset为空表示自动）
+inline bool isKnownEncoderPreset(const std::string& preset) {
+    static const char* presets[] = {
+        "ultrafast", "superfast", "veryfast", "faster", "fast", "medium", "slow", "slower", "veryslow", "placebo",
+        nullptr
+    };
+    if (preset.empty()) {
+        return true;
+    }
+    for (int i = 0; presets[i] != nullptr; i++) {
+        if (preset == presets[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// JNI传入的配置：0表示自动，负数和越界值拒绝
+inline bool isValidEncoderConfig(const EncoderConfig& config) {
+    return config.bitrate >= 0 &&
+           config.rate_control >= RATE_CONTROL_AUTO && config.rate_control <= RATE_CONTROL_CRF &&
+           config.crf >= 0 && config.crf <= 51 &&
+           config.gop_length >= 0 && config.slices >= 0 &&
+           isKnownEncoderPreset(config.preset);
+}
+
+// 码率上限（VBV maxrate）：CBR即目标码率，VBR/CRF为目标的1.5倍
+inline int64_t encoderPeakBitrate(const EncoderConfig& config) {
+    return config.rate_control == RATE_CONTROL_CBR ? config.bitrate : config.bitrate * 3 / 2;
+}
+
+// 根据帧大小、宏块吞吐量和码率上限选择H.264 level（固定3.1无法覆盖1080p）
+struct H264Level {
+    int idc;                    // level_idc，写入AVCodecContext::level（libx264读取）
+    const char* name;           // h264_mediacodec私有选项"level"的取值
+};
+
+// H.264表A-1；MaxBR按Baseline/Main的VCL上限（1000bps单位），High允许1.25倍，按低的取保证都合规。
+// max_bitrate<=0表示不按码率选择
+inline H264Level selectH264Level(int width, int height, double frame_rate, int64_t max_bitrate) {
+    static const struct { H264Level level; int64_t max_fs; int64_t max_mbps; int64_t max_br_kbps; } levels[] = {
+        {{31, "3.1"}, 3600, 108000, 14000}, {{32, "3.2"}, 5120, 216000, 20000},
+        {{40, "4"}, 8192, 245760, 20000}, {{41, "4.1"}, 8192, 245760, 50000},
+        {{42, "4.2"}, 8704, 522240, 50000}, {{50, "5"}, 22080, 589824, 135000},
+        {{51, "5.1"}, 36864, 983040, 240000}, {{52, "5.2"}, 36864, 2073600, 240000}
+    };
+    size_t count = sizeof(levels) / sizeof(levels[0]);
+    int64_t frame_mbs = (int64_t)((width + 15) / 16) * ((height + 15) / 16);
+    double fps = frame_rate > 0 ? frame_rate : 30.0;
+    int64_t mbps = (int64_t)(frame_mbs * fps + 0.5);
+    for (size_t i = 0; i < count; i++) {
+        if (frame_mbs <= levels[i].max_fs && mbps <= levels[i].max_mbps &&
+            (max_bitrate <= 0 || max_bitrate <= levels[i].max_br_kbps * 1000)) {
+            return levels[i].level;
+        }
+    }
+    return levels[count - 1].level;
+}
+
+#endif
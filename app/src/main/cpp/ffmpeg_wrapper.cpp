@@ -3,19 +3,61 @@
 #include <android/log.h>
 #include <android/native_window.h>
 #include <android/native_window_jni.h>
+#include <SLES/OpenSLES.h>
+#include <SLES/OpenSLES_Android.h>
 #include <dlfcn.h>
 #include <mutex>
 #include <chrono>
 #include <thread>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sched.h>
+#include <pthread.h>
+#include <cmath>
 #include <cerrno>
 #include <cstring>
+#include <vector>
+#include <memory>
+#include <map>
+#include <algorithm>
+#include <deque>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cctype>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
 
 #define LOG_TAG "FFmpegWrapper"
-#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
-#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
-#define LOGW(...) __android_log_print(ANDROID_LOG_WARN, LOG_TAG, __VA_ARGS__)
+
+#include "async_logger.h"
+#include "audio_sync.h"
+#include "bounded_queue.h"
+#include "dynamic_library.h"
+#include "encoder_config.h"
+#include "letterbox.h"
+#include "media_header_parser.h"
+#include "parallel_scanner.h"
+#include "pipeline_tracer.h"
+#include "pixel_layout.h"
+#include "recording_index.h"
+#include "rtp_depacketizer.h"
+#include "rtp_reorder_window.h"
+#include "rtsp_message.h"
+#include "stream_watchdog.h"
+#include "surface_handover.h"
+#include "thread_policy.h"
+#include "transcode_plan.h"
 
 // 检查FFmpeg是否可用 - 默认启用，除非明确禁用
 #ifndef FFMPEG_FOUND
@@ -35,8 +77,241 @@ extern "C" {
 #include <libavutil/opt.h>
 #include <libavutil/dict.h>
 #include <libavutil/time.h>
+#include <libavutil/intreadwrite.h>
+#include <libavutil/base64.h>
+#include <libavutil/md5.h>
+}
+
+// ultra_low_latency.patch：RTP MARKER位结束的访问单元由解复用层逐包标记；未打补丁的库不会设置
+#ifndef AV_PKT_FLAG_FRAME_END
+#define AV_PKT_FLAG_FRAME_END 0x0020
+#endif
+
+// ============================================================================
+// FFmpeg延迟加载 - 不在链接期依赖libffmpeg.so，首次使用时dlopen并解析函数表
+// ============================================================================
+// 关闭时（-DFFMPEG_DYNAMIC_LOAD=0）直接链接调用。新增FFmpeg调用需同时加入下面的函数表和#define列表，
+// 遗漏时链接器会报出未定义符号（或重新产生对libffmpeg.so的链接依赖）
+#ifndef FFMPEG_DYNAMIC_LOAD
+#define FFMPEG_DYNAMIC_LOAD 1
+#endif
+
+#if FFMPEG_DYNAMIC_LOAD
+#define FFW_FFMPEG_FUNCTIONS(X) \
+    X(av_base64_decode) \
+    X(av_base64_encode) \
+    X(av_buffer_pool_get) \
+    X(av_buffer_pool_init) \
+    X(av_buffer_pool_uninit) \
+    X(av_buffer_realloc) \
+    X(av_buffer_unref) \
+    X(av_codec_get_id) \
+    X(av_codec_is_encoder) \
+    X(av_codec_iterate) \
+    X(av_dict_copy) \
+    X(av_dict_free) \
+    X(av_dict_set) \
+    X(av_find_best_stream) \
+    X(av_frame_alloc) \
+    X(av_frame_free) \
+    X(av_frame_get_buffer) \
+    X(av_frame_move_ref) \
+    X(av_frame_ref) \
+    X(av_frame_unref) \
+    X(av_freep) \
+    X(av_get_pix_fmt_name) \
+    X(av_get_sample_fmt_name) \
+    X(av_gettime_relative) \
+    X(av_guess_format) \
+    X(av_guess_frame_rate) \
+    X(av_guess_sample_aspect_ratio) \
+    X(av_image_copy_plane) \
+    X(av_interleaved_write_frame) \
+    X(av_malloc) \
+    X(av_md5_sum) \
+    X(av_mediacodec_default_init) \
+    X(av_mediacodec_release_buffer) \
+    X(av_opt_find) \
+    X(av_opt_set) \
+    X(av_opt_set_int) \
+    X(av_packet_alloc) \
+    X(av_packet_clone) \
+    X(av_packet_free) \
+    X(av_packet_move_ref) \
+    X(av_packet_rescale_ts) \
+    X(av_packet_unref) \
+    X(av_parser_close) \
+    X(av_parser_init) \
+    X(av_parser_parse2) \
+    X(av_pix_fmt_desc_get) \
+    X(av_read_frame) \
+    X(av_rescale) \
+    X(av_rescale_q) \
+    X(av_seek_frame) \
+    X(av_strerror) \
+    X(av_url_split) \
+    X(av_version_info) \
+    X(av_write_trailer) \
+    X(avcodec_alloc_context3) \
+    X(avcodec_find_decoder) \
+    X(avcodec_find_decoder_by_name) \
+    X(avcodec_find_encoder) \
+    X(avcodec_find_encoder_by_name) \
+    X(avcodec_flush_buffers) \
+    X(avcodec_free_context) \
+    X(avcodec_get_name) \
+    X(avcodec_open2) \
+    X(avcodec_parameters_alloc) \
+    X(avcodec_parameters_copy) \
+    X(avcodec_parameters_free) \
+    X(avcodec_parameters_from_context) \
+    X(avcodec_parameters_to_context) \
+    X(avcodec_receive_frame) \
+    X(avcodec_receive_packet) \
+    X(avcodec_send_frame) \
+    X(avcodec_send_packet) \
+    X(avformat_alloc_context) \
+    X(avformat_alloc_output_context2) \
+    X(avformat_close_input) \
+    X(avformat_find_stream_info) \
+    X(avformat_free_context) \
+    X(avformat_get_mov_audio_tags) \
+    X(avformat_get_mov_video_tags) \
+    X(avformat_network_deinit) \
+    X(avformat_network_init) \
+    X(avformat_new_stream) \
+    X(avformat_open_input) \
+    X(avformat_query_codec) \
+    X(avformat_write_header) \
+    X(avio_closep) \
+    X(avio_open) \
+    X(avio_seek) \
+    X(sws_freeContext) \
+    X(sws_getCachedContext) \
+    X(sws_getContext) \
+    X(sws_scale)
+
+struct FFmpegApi {
+#define FFW_DECLARE_FFMPEG_FUNCTION(name) decltype(&::name) name;
+    FFW_FFMPEG_FUNCTIONS(FFW_DECLARE_FFMPEG_FUNCTION)
+#undef FFW_DECLARE_FFMPEG_FUNCTION
+};
+static FFmpegApi g_ffmpeg_api;
+
+// 加载libffmpeg.so并解析全部函数，任何一个缺失都视为失败；调用方负责串行化
+static bool loadFFmpegLibrary(void*& handle) {
+    struct ResolveAll {
+        int operator()(void* library) const {
+            int missing = 0;
+#define FFW_RESOLVE_FFMPEG_FUNCTION(name) \
+            missing += resolveDynamicSymbol(library, "libffmpeg.so", #name, g_ffmpeg_api.name) ? 0 : 1;
+            FFW_FFMPEG_FUNCTIONS(FFW_RESOLVE_FFMPEG_FUNCTION)
+#undef FFW_RESOLVE_FFMPEG_FUNCTION
+            return missing;
+        }
+    };
+    if (!loadDynamicLibrary("libffmpeg.so", handle, ResolveAll())) {
+        memset(&g_ffmpeg_api, 0, sizeof(g_ffmpeg_api));
+        return false;
+    }
+    return true;
 }
 
+// 以下调用全部经由函数表
+#define av_base64_decode (g_ffmpeg_api.av_base64_decode)
+#define av_base64_encode (g_ffmpeg_api.av_base64_encode)
+#define av_buffer_pool_get (g_ffmpeg_api.av_buffer_pool_get)
+#define av_buffer_pool_init (g_ffmpeg_api.av_buffer_pool_init)
+#define av_buffer_pool_uninit (g_ffmpeg_api.av_buffer_pool_uninit)
+#define av_buffer_realloc (g_ffmpeg_api.av_buffer_realloc)
+#define av_buffer_unref (g_ffmpeg_api.av_buffer_unref)
+#define av_codec_get_id (g_ffmpeg_api.av_codec_get_id)
+#define av_codec_is_encoder (g_ffmpeg_api.av_codec_is_encoder)
+#define av_codec_iterate (g_ffmpeg_api.av_codec_iterate)
+#define av_dict_copy (g_ffmpeg_api.av_dict_copy)
+#define av_dict_free (g_ffmpeg_api.av_dict_free)
+#define av_dict_set (g_ffmpeg_api.av_dict_set)
+#define av_find_best_stream (g_ffmpeg_api.av_find_best_stream)
+#define av_frame_alloc (g_ffmpeg_api.av_frame_alloc)
+#define av_frame_free (g_ffmpeg_api.av_frame_free)
+#define av_frame_get_buffer (g_ffmpeg_api.av_frame_get_buffer)
+#define av_frame_move_ref (g_ffmpeg_api.av_frame_move_ref)
+#define av_frame_ref (g_ffmpeg_api.av_frame_ref)
+#define av_frame_unref (g_ffmpeg_api.av_frame_unref)
+#define av_freep (g_ffmpeg_api.av_freep)
+#define av_get_pix_fmt_name (g_ffmpeg_api.av_get_pix_fmt_name)
+#define av_get_sample_fmt_name (g_ffmpeg_api.av_get_sample_fmt_name)
+#define av_gettime_relative (g_ffmpeg_api.av_gettime_relative)
+#define av_guess_format (g_ffmpeg_api.av_guess_format)
+#define av_guess_frame_rate (g_ffmpeg_api.av_guess_frame_rate)
+#define av_guess_sample_aspect_ratio (g_ffmpeg_api.av_guess_sample_aspect_ratio)
+#define av_image_copy_plane (g_ffmpeg_api.av_image_copy_plane)
+#define av_interleaved_write_frame (g_ffmpeg_api.av_interleaved_write_frame)
+#define av_malloc (g_ffmpeg_api.av_malloc)
+#define av_md5_sum (g_ffmpeg_api.av_md5_sum)
+#define av_mediacodec_default_init (g_ffmpeg_api.av_mediacodec_default_init)
+#define av_mediacodec_release_buffer (g_ffmpeg_api.av_mediacodec_release_buffer)
+#define av_opt_find (g_ffmpeg_api.av_opt_find)
+#define av_opt_set (g_ffmpeg_api.av_opt_set)
+#define av_opt_set_int (g_ffmpeg_api.av_opt_set_int)
+#define av_packet_alloc (g_ffmpeg_api.av_packet_alloc)
+#define av_packet_clone (g_ffmpeg_api.av_packet_clone)
+#define av_packet_free (g_ffmpeg_api.av_packet_free)
+#define av_packet_move_ref (g_ffmpeg_api.av_packet_move_ref)
+#define av_packet_rescale_ts (g_ffmpeg_api.av_packet_rescale_ts)
+#define av_packet_unref (g_ffmpeg_api.av_packet_unref)
+#define av_parser_close (g_ffmpeg_api.av_parser_close)
+#define av_parser_init (g_ffmpeg_api.av_parser_init)
+#define av_parser_parse2 (g_ffmpeg_api.av_parser_parse2)
+#define av_pix_fmt_desc_get (g_ffmpeg_api.av_pix_fmt_desc_get)
+#define av_read_frame (g_ffmpeg_api.av_read_frame)
+#define av_rescale (g_ffmpeg_api.av_rescale)
+#define av_rescale_q (g_ffmpeg_api.av_rescale_q)
+#define av_seek_frame (g_ffmpeg_api.av_seek_frame)
+#define av_strerror (g_ffmpeg_api.av_strerror)
+#define av_url_split (g_ffmpeg_api.av_url_split)
+#define av_version_info (g_ffmpeg_api.av_version_info)
+#define av_write_trailer (g_ffmpeg_api.av_write_trailer)
+#define avcodec_alloc_context3 (g_ffmpeg_api.avcodec_alloc_context3)
+#define avcodec_find_decoder (g_ffmpeg_api.avcodec_find_decoder)
+#define avcodec_find_decoder_by_name (g_ffmpeg_api.avcodec_find_decoder_by_name)
+#define avcodec_find_encoder (g_ffmpeg_api.avcodec_find_encoder)
+#define avcodec_find_encoder_by_name (g_ffmpeg_api.avcodec_find_encoder_by_name)
+#define avcodec_flush_buffers (g_ffmpeg_api.avcodec_flush_buffers)
+#define avcodec_free_context (g_ffmpeg_api.avcodec_free_context)
+#define avcodec_get_name (g_ffmpeg_api.avcodec_get_name)
+#define avcodec_open2 (g_ffmpeg_api.avcodec_open2)
+#define avcodec_parameters_alloc (g_ffmpeg_api.avcodec_parameters_alloc)
+#define avcodec_parameters_copy (g_ffmpeg_api.avcodec_parameters_copy)
+#define avcodec_parameters_free (g_ffmpeg_api.avcodec_parameters_free)
+#define avcodec_parameters_from_context (g_ffmpeg_api.avcodec_parameters_from_context)
+#define avcodec_parameters_to_context (g_ffmpeg_api.avcodec_parameters_to_context)
+#define avcodec_receive_frame (g_ffmpeg_api.avcodec_receive_frame)
+#define avcodec_receive_packet (g_ffmpeg_api.avcodec_receive_packet)
+#define avcodec_send_frame (g_ffmpeg_api.avcodec_send_frame)
+#define avcodec_send_packet (g_ffmpeg_api.avcodec_send_packet)
+#define avformat_alloc_context (g_ffmpeg_api.avformat_alloc_context)
+#define avformat_alloc_output_context2 (g_ffmpeg_api.avformat_alloc_output_context2)
+#define avformat_close_input (g_ffmpeg_api.avformat_close_input)
+#define avformat_find_stream_info (g_ffmpeg_api.avformat_find_stream_info)
+#define avformat_free_context (g_ffmpeg_api.avformat_free_context)
+#define avformat_get_mov_audio_tags (g_ffmpeg_api.avformat_get_mov_audio_tags)
+#define avformat_get_mov_video_tags (g_ffmpeg_api.avformat_get_mov_video_tags)
+#define avformat_network_deinit (g_ffmpeg_api.avformat_network_deinit)
+#define avformat_network_init (g_ffmpeg_api.avformat_network_init)
+#define avformat_new_stream (g_ffmpeg_api.avformat_new_stream)
+#define avformat_open_input (g_ffmpeg_api.avformat_open_input)
+#define avformat_query_codec (g_ffmpeg_api.avformat_query_codec)
+#define avformat_write_header (g_ffmpeg_api.avformat_write_header)
+#define avio_closep (g_ffmpeg_api.avio_closep)
+#define avio_open (g_ffmpeg_api.avio_open)
+#define avio_seek (g_ffmpeg_api.avio_seek)
+#define sws_freeContext (g_ffmpeg_api.sws_freeContext)
+#define sws_getCachedContext (g_ffmpeg_api.sws_getCachedContext)
+#define sws_getContext (g_ffmpeg_api.sws_getContext)
+#define sws_scale (g_ffmpeg_api.sws_scale)
+#endif
+
 // 编译时配置检查
 static void logCompileTimeConfig() {
     LOGI("🔧 编译时配置: FFMPEG_FOUND=%d", FFMPEG_FOUND);
@@ -50,2688 +325,6671 @@ static void logCompileTimeConfig() {
 #endif
 
 // ============================================================================
-// 全局渲染状态控制 - 解决Surface生命周期同步问题
-// ============================================================================
-static std::atomic<bool> g_surface_valid(false);           // Surface是否有效
-static std::atomic<bool> g_rendering_paused(false);        // 渲染是否暂停
-static std::mutex g_surface_sync_mutex;                    // Surface同步锁
-static std::chrono::steady_clock::time_point g_last_surface_change; // 上次Surface变化时间
-
-// ============================================================================
-// 现代化MP4录制系统 - 高效RTSP转MP4录制
+// 预录环形缓冲区 - 告警触发时保存最近N秒的已编码数据包（时移录制）
 // ============================================================================
 #if FFMPEG_FOUND
-class ModernRecorder {
+class PacketRingBuffer {
 private:
-    // 核心FFmpeg组件
-    AVFormatContext* output_ctx;
-    AVStream* video_stream;
-    AVStream* audio_stream;
-    AVCodecContext* video_encoder_ctx;
-    AVCodecContext* audio_encoder_ctx;
-    
-    // 录制状态管理
-    std::string output_path;
-    std::atomic<bool> recording_active;
-    std::mutex record_mutex;
-    
-    // 帧计数和时间管理
-    int64_t video_frame_count;
-    int64_t audio_frame_count;
-    int64_t start_time_us;
-    AVRational video_time_base;
-    AVRational audio_time_base;
-    
-    // 录制模式配置
-    bool use_hardware_encoding;
-    bool copy_video_stream;     // 是否直接复制视频流（不重编码）
-    bool copy_audio_stream;     // 是否直接复制音频流（不重编码）
-    
-    // 性能统计
-    int64_t total_video_frames;
-    int64_t total_audio_frames;
-    int64_t bytes_written;
-    
+    // 数据包元信息（数据本体存放在arena中）
+    struct Slot {
+        uint64_t seq;
+        size_t offset;
+        int size;
+        int flags;
+        int64_t pts;
+        int64_t dts;
+        int64_t duration;
+    };
+
+    // 预分配存储 - 运行期间不再分配内存
+    std::vector<uint8_t> arena;
+    std::vector<Slot> slots;
+    std::mutex ring_mutex;
+
+    // 环形状态
+    int first_slot;          // 最旧数据包所在槽位
+    int slot_count;          // 当前数据包数量
+    size_t write_offset;     // arena下一个写入位置
+    uint64_t next_seq;       // 下一个数据包序号
+    bool awaiting_keyframe;  // 拒绝过数据包，之后的包引用了缺失的帧，直到下一个关键帧都不能入缓冲
+
+    // 容量限制
+    int64_t max_duration_ts; // 时长上限（流时间基准），<=0表示不限
+    AVRational time_base;
+
+    // 统计
+    int64_t evicted_gops;
+    int64_t rejected_packets;
+    int64_t overrun_packets;     // 读取方落后被覆盖而丢弃的数据包
+
 public:
-    ModernRecorder() : 
-        output_ctx(nullptr), video_stream(nullptr), audio_stream(nullptr),
-        video_encoder_ctx(nullptr), audio_encoder_ctx(nullptr),
-        recording_active(false), video_frame_count(0), audio_frame_count(0),
-        start_time_us(AV_NOPTS_VALUE), use_hardware_encoding(true),
-        copy_video_stream(true), copy_audio_stream(true),
-        total_video_frames(0), total_audio_frames(0), bytes_written(0) {
-        
-        video_time_base = {1, 90000};  // 默认90kHz时间基准
-        audio_time_base = {1, 48000};  // 默认48kHz时间基准
-    }
-    
-    ~ModernRecorder() {
-        cleanup();
+    PacketRingBuffer(size_t max_bytes, int max_duration_ms, AVRational stream_time_base) :
+        first_slot(0), slot_count(0), write_offset(0), next_seq(0), awaiting_keyframe(false),
+        max_duration_ts(0), time_base(stream_time_base),
+        evicted_gops(0), rejected_packets(0), overrun_packets(0) {
+
+        arena.resize(max_bytes);
+
+        // 按120fps估算槽位数量，至少256个
+        int estimated_packets = max_duration_ms > 0 ? max_duration_ms * 120 / 1000 : 0;
+        slots.resize(std::max(256, estimated_packets));
+
+        if (max_duration_ms > 0 && time_base.num > 0 && time_base.den > 0) {
+            max_duration_ts = av_rescale_q((int64_t)max_duration_ms * 1000, AVRational{1, 1000000}, time_base);
+        }
+
+        LOGI("🎞️ 预录缓冲区已分配: %.1fMB, %d个槽位, 时长上限%dms",
+             max_bytes / 1024.0 / 1024.0, (int)slots.size(), max_duration_ms);
     }
-    
-    // 准备录制 - 设置输出路径和基本参数
-    bool prepare(const char* path) {
-        std::lock_guard<std::mutex> lock(record_mutex);
-        
-        if (recording_active.load()) {
-            LOGE("🚫 录制器已激活，无法重新准备");
+
+    // 写入一个已编码视频包 - 复制到预分配arena，不做malloc
+    bool push(const AVPacket* pkt) {
+        if (!pkt || !pkt->data || pkt->size <= 0) {
             return false;
         }
-        
-        if (!path || strlen(path) == 0) {
-            LOGE("🚫 输出路径无效");
+
+        bool keyframe = (pkt->flags & AV_PKT_FLAG_KEY) != 0;
+        std::lock_guard<std::mutex> lock(ring_mutex);
+
+        if (awaiting_keyframe && !keyframe) {
+            rejected_packets++;
             return false;
         }
-        
-        output_path = std::string(path);
-        LOGI("📝 录制器准备就绪，输出路径: %s", output_path.c_str());
-        
-        // 重置计数器
-        video_frame_count = 0;
-        audio_frame_count = 0;
-        total_video_frames = 0;
-        total_audio_frames = 0;
-        bytes_written = 0;
-        start_time_us = AV_NOPTS_VALUE;
-        
-        return true;
-    }
-    
-    // 启动录制 - 初始化MP4输出格式
-    bool start(int width, int height, AVRational framerate) {
-        LOGI("🎬 启动MP4录制: %dx%d@%d/%dfps", width, height, framerate.num, framerate.den);
-        std::lock_guard<std::mutex> lock(record_mutex);
-        
-        if (recording_active.load()) {
-            LOGE("🚫 录制已激活");
+
+        // 单包超过arena一半时无法保证GOP完整，直接拒绝；后续P帧会以错误的参考帧解码，一并丢弃到下一个关键帧
+        if ((size_t)pkt->size > arena.size() / 2) {
+            rejected_packets++;
+            awaiting_keyframe = true;
             return false;
         }
-        
-        if (output_path.empty()) {
-            LOGE("🚫 输出路径未设置");
-            return false;
+        awaiting_keyframe = false;
+
+        // 为新数据包腾出空间：按整个GOP淘汰，保证缓冲区始终从关键帧开始
+        size_t offset = 0;
+        while (slot_count > 0 &&
+               (slot_count == (int)slots.size() || !findFreeRegion(pkt->size, offset))) {
+            evictOldestGop();
         }
-        
-        // 初始化MP4输出上下文
-        if (!initializeOutputContext()) {
-            LOGE("❌ 初始化输出上下文失败");
-            return false;
+
+        // 缓冲区为空时只能从关键帧开始
+        if (slot_count == 0) {
+            if (!keyframe) {
+                return false;
+            }
+            write_offset = 0;
+            offset = 0;
         }
-        
-        // 创建视频流
-        if (!createVideoStream(width, height, framerate)) {
-            LOGE("❌ 创建视频流失败");
-            cleanup();
+
+        memcpy(arena.data() + offset, pkt->data, pkt->size);
+
+        Slot& slot = slots[(first_slot + slot_count) % slots.size()];
+        slot.seq = next_seq++;
+        slot.offset = offset;
+        slot.size = pkt->size;
+        slot.flags = pkt->flags;
+        slot.pts = pkt->pts;
+        slot.dts = pkt->dts;
+        slot.duration = pkt->duration;
+        slot_count++;
+        write_offset = offset + pkt->size;
+
+        // 时长约束：淘汰最旧GOP后剩余部分仍覆盖完整时长时才淘汰
+        trimToDuration();
+        return true;
+    }
+
+    // 读取指定序号的数据包到scratch缓冲区；读者落后被覆盖时跳到下一个关键帧
+    bool read(uint64_t& cursor, AVPacket* out, std::vector<uint8_t>& scratch) {
+        std::lock_guard<std::mutex> lock(ring_mutex);
+
+        if (slot_count == 0) {
             return false;
         }
-        
-        // 打开输出文件并写入头部
-        if (!openOutputFile()) {
-            LOGE("❌ 打开输出文件失败");
-            cleanup();
+
+        uint64_t oldest_seq = slots[first_slot].seq;
+        if (cursor < oldest_seq) {
+            // 被覆盖的部分已不可恢复，从仍在缓冲区中的下一个关键帧重新开始，录制文件保持可解码
+            uint64_t resume = oldest_seq;
+            while (resume < oldest_seq + slot_count &&
+                   !(slots[(first_slot + (resume - oldest_seq)) % slots.size()].flags & AV_PKT_FLAG_KEY)) {
+                resume++;
+            }
+            overrun_packets += (int64_t)(resume - cursor);
+            LOGW_EVERY(1000, "⚠️ 预录读取落后被覆盖，丢弃%llu个数据包，从关键帧#%llu重新同步（累计丢弃%lld）",
+                       (unsigned long long)(resume - cursor), (unsigned long long)resume,
+                       (long long)overrun_packets);
+            cursor = resume;
+        }
+        if (cursor >= oldest_seq + slot_count) {
             return false;
         }
-        
-        recording_active.store(true);
-        start_time_us = std::chrono::duration_cast<std::chrono::microseconds>(
-            std::chrono::steady_clock::now().time_since_epoch()).count();
-        
-        LOGI("✅ MP4录制启动成功: %s", output_path.c_str());
+
+        const Slot& slot = slots[(first_slot + (cursor - oldest_seq)) % slots.size()];
+        if (scratch.size() < (size_t)slot.size + AV_INPUT_BUFFER_PADDING_SIZE) {
+            scratch.resize(slot.size + AV_INPUT_BUFFER_PADDING_SIZE);
+        }
+        memcpy(scratch.data(), arena.data() + slot.offset, slot.size);
+        memset(scratch.data() + slot.size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+
+        out->buf = nullptr;
+        out->data = scratch.data();
+        out->size = slot.size;
+        out->flags = slot.flags;
+        out->pts = slot.pts;
+        out->dts = slot.dts;
+        out->duration = slot.duration;
+        out->stream_index = 0;
+        out->pos = -1;
+
+        cursor++;
         return true;
     }
-    
-    // 写入视频帧到MP4文件
-    bool writeFrame(AVFrame* frame) {
-        if (!recording_active.load() || !frame) {
-            return false;
+
+    // 最旧数据包序号（总是关键帧），作为触发录制时的读取起点
+    uint64_t oldestSequence() {
+        std::lock_guard<std::mutex> lock(ring_mutex);
+        return slot_count > 0 ? slots[first_slot].seq : next_seq;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(ring_mutex);
+        first_slot = 0;
+        slot_count = 0;
+        write_offset = 0;
+        awaiting_keyframe = false;
+    }
+
+    std::string getStats() {
+        std::lock_guard<std::mutex> lock(ring_mutex);
+        int64_t span_ms = 0;
+        if (slot_count > 1) {
+            const Slot& oldest = slots[first_slot];
+            const Slot& newest = slots[(first_slot + slot_count - 1) % slots.size()];
+            int64_t span = packetTime(newest) - packetTime(oldest);
+            if (span > 0 && time_base.den > 0) {
+                span_ms = av_rescale_q(span, time_base, AVRational{1, 1000});
+            }
         }
-        
-        std::lock_guard<std::mutex> lock(record_mutex);
-        
-        if (!output_ctx || !video_stream) {
+        return "预录缓冲: " + std::to_string(slot_count) + "包/" + std::to_string(span_ms) + "ms, 淘汰GOP " +
+               std::to_string(evicted_gops) + ", 拒绝 " + std::to_string(rejected_packets) +
+               ", 读取落后丢弃 " + std::to_string(overrun_packets) + "\n";
+    }
+
+private:
+    static int64_t packetTime(const Slot& slot) {
+        return slot.dts != AV_NOPTS_VALUE ? slot.dts : slot.pts;
+    }
+
+    // 在arena中寻找能容纳size字节的连续空闲区域
+    bool findFreeRegion(int size, size_t& offset) {
+        size_t head = slots[first_slot].offset;
+        if (write_offset > head) {
+            // 未回绕：[write_offset, end) 或 [0, head)
+            if (write_offset + size <= arena.size()) {
+                offset = write_offset;
+                return true;
+            }
+            if ((size_t)size <= head) {
+                offset = 0;
+                return true;
+            }
             return false;
         }
-        
-        // 如果使用流复制模式，需要重新编码
-        if (copy_video_stream) {
-            return writeFrameWithCopy(frame);
-        } else {
-            return writeFrameWithReencode(frame);
+        // 已回绕：只有 [write_offset, head)
+        if (write_offset + size <= head) {
+            offset = write_offset;
+            return true;
+        }
+        return false;
+    }
+
+    // 淘汰最旧的整个GOP（直到下一个关键帧）
+    void evictOldestGop() {
+        do {
+            first_slot = (first_slot + 1) % slots.size();
+            slot_count--;
+        } while (slot_count > 0 && !(slots[first_slot].flags & AV_PKT_FLAG_KEY));
+
+        if (slot_count == 0) {
+            first_slot = 0;
+            write_offset = 0;
+        }
+        evicted_gops++;
+    }
+
+    void trimToDuration() {
+        if (max_duration_ts <= 0 || slot_count < 2) {
+            return;
+        }
+
+        const Slot& newest = slots[(first_slot + slot_count - 1) % slots.size()];
+        if (packetTime(newest) == AV_NOPTS_VALUE) {
+            return;
+        }
+
+        while (true) {
+            // 找到第二个GOP的起点
+            int next_key = -1;
+            for (int i = 1; i < slot_count; i++) {
+                if (slots[(first_slot + i) % slots.size()].flags & AV_PKT_FLAG_KEY) {
+                    next_key = i;
+                    break;
+                }
+            }
+            if (next_key < 0) {
+                return;
+            }
+
+            const Slot& key_slot = slots[(first_slot + next_key) % slots.size()];
+            if (packetTime(key_slot) == AV_NOPTS_VALUE ||
+                packetTime(newest) - packetTime(key_slot) < max_duration_ts) {
+                return;
+            }
+            evictOldestGop();
         }
     }
+};
+
+// 预录配置 - 在打开流之前设置，0表示禁用
+static size_t g_pre_event_max_bytes = 0;
+static int g_pre_event_max_duration_ms = 0;
+#endif
+
+// ============================================================================
+// 像素格式描述 - 每个流从解码器输出元数据解析一次，贯穿渲染和录制
+// ============================================================================
+#if FFMPEG_FOUND
+// MediaCodec ByteBuffer输出时FFmpeg已按MediaCodec颜色格式映射好frame->format
+// （SemiPlanar -> NV12, Planar -> YUV420P, P010 -> P010LE），不需要再根据数据内容猜测
+struct PixelFormatDescriptor {
+    AVPixelFormat source_format;    // 解码器输出的frame->format（用于判断是否需要重新解析）
+    AVPixelFormat layout;           // CPU可访问数据的实际内存布局，作为sws输入格式
+    bool hw_surface;                // MediaCodec Surface输出：只有data[3]缓冲引用，没有CPU数据
     
-    // 写入已编码的数据包（更高效的录制方式）
-    bool writePacket(AVPacket* packet) {
-        if (!recording_active.load() || !packet) {
+    PixelFormatDescriptor() :
+        source_format(AV_PIX_FMT_NONE), layout(AV_PIX_FMT_NONE), hw_surface(false) {}
+    
+    bool matches(const AVFrame* frame) const {
+        return frame && frame->format == source_format;
+    }
+    
+    bool hasCpuData() const {
+        return !hw_surface && layout != AV_PIX_FMT_NONE;
+    }
+};
+
+static PixelFormatDescriptor resolvePixelFormatDescriptor(const AVFrame* frame, const AVCodecContext* decoder) {
+    PixelFormatDescriptor desc;
+    if (!frame) {
+        return desc;
+    }
+    desc.source_format = (AVPixelFormat)frame->format;
+    
+    PixelLayoutInput in;
+    in.frame_format = frame->format;
+    in.has_hw_frames = frame->hw_frames_ctx != nullptr;
+    in.hw_sw_format = in.has_hw_frames ?
+        ((const AVHWFramesContext*)frame->hw_frames_ctx->data)->sw_format : AV_PIX_FMT_NONE;
+    in.has_decoder = decoder != nullptr;
+    in.decoder_sw_format = decoder ? decoder->sw_pix_fmt : AV_PIX_FMT_NONE;
+    
+    PixelLayoutFormats fmts;
+    fmts.none = AV_PIX_FMT_NONE;
+    fmts.mediacodec = AV_PIX_FMT_MEDIACODEC;
+    
+    struct KnownFormat {
+        bool operator()(int fmt) const { return av_pix_fmt_desc_get((AVPixelFormat)fmt) != nullptr; }
+    };
+    PixelLayout resolved = resolvePixelLayout(in, fmts, KnownFormat());
+    desc.layout = (AVPixelFormat)resolved.layout;
+    desc.hw_surface = resolved.hw_surface;
+    
+    LOGI("🎨 像素格式解析: 解码输出=%s, 数据布局=%s, Surface输出=%s",
+         av_get_pix_fmt_name(desc.source_format), av_get_pix_fmt_name(desc.layout),
+         desc.hw_surface ? "是" : "否");
+    return desc;
+}
+#endif
+
+// ============================================================================
+// 流水线线程 - 调度策略（thread_policy.h）按流设置，运行中的线程按版本号重新应用
+// ============================================================================
+#if FFMPEG_FOUND
+// 当前流的流水线策略，修改后版本号递增，运行中的线程在下一次循环时重新应用
+static std::mutex g_thread_policy_mutex;
+static ThreadPolicy g_pipeline_policy;
+static std::atomic<int> g_pipeline_policy_version(0);
+
+static ThreadPolicy getPipelinePolicy() {
+    std::lock_guard<std::mutex> lock(g_thread_policy_mutex);
+    return g_pipeline_policy;
+}
+
+// 流水线线程：循环执行step直到返回false或stop()；按策略版本重新应用调度设置，
+// 每5秒输出一次单步耗时的均值/标准差和CPU迁移次数，用于比较不同策略的抖动
+class PipelineThread {
+public:
+    typedef std::function<bool()> Step;
+    
+    PipelineThread() : running(false), worker_id(std::thread::id()) {}
+    
+    ~PipelineThread() {
+        stop();
+    }
+    
+    // start/stop可能同时来自Java的不同线程，worker只在worker_mutex下访问。
+    // 处理线程自身（step内的回调）调用时不取锁：另一线程可能正持锁等待它退出
+    bool start(const char* name, const Step& step) {
+        if (isWorkerThread()) {
             return false;
         }
-        
-        std::lock_guard<std::mutex> lock(record_mutex);
-        
-        if (!output_ctx || (!video_stream && !audio_stream)) {
+        std::lock_guard<std::mutex> lock(worker_mutex);
+        if (running.load()) {
             return false;
         }
-        
-        // 克隆数据包以避免修改原始数据
-        AVPacket* pkt = av_packet_clone(packet);
-        if (!pkt) {
-            return false;
+        if (worker.joinable()) {
+            worker.join();      // 上一次因step返回false自行结束
         }
-        
-        // 根据流类型设置正确的流索引和时间基准
-        if (packet->stream_index == 0 && video_stream) {
-            // 视频流
-            pkt->stream_index = video_stream->index;
-            av_packet_rescale_ts(pkt, video_time_base, video_stream->time_base);
-            total_video_frames++;
-        } else if (packet->stream_index == 1 && audio_stream) {
-            // 音频流
-            pkt->stream_index = audio_stream->index;
-            av_packet_rescale_ts(pkt, audio_time_base, audio_stream->time_base);
-            total_audio_frames++;
-        } else {
-            av_packet_free(&pkt);
-            return false;
+        thread_name = name;
+        running.store(true);
+        worker = std::thread(&PipelineThread::loop, this, step);
+        return true;
+    }
+    
+    void stop() {
+        markStopped();
+        if (isWorkerThread()) {
+            return;     // 线程返回后由下一次start/stop回收
         }
-        
-        // 写入交错数据包
-        int ret = av_interleaved_write_frame(output_ctx, pkt);
-        av_packet_free(&pkt);
-        
-        if (ret >= 0) {
-            bytes_written += packet->size;
-            
-            // 每1000帧输出一次统计
-            if ((total_video_frames + total_audio_frames) % 1000 == 0) {
-                LOGD("📊 录制统计: 视频%ld帧, 音频%ld帧, 总计%.1fMB", 
-                     (long)total_video_frames, (long)total_audio_frames, bytes_written / 1024.0 / 1024.0);
-            }
-            return true;
-        } else {
-            LOGE("❌ 写入数据包失败: %d", ret);
-            return false;
+        std::lock_guard<std::mutex> lock(worker_mutex);
+        if (worker.joinable()) {
+            worker.join();
         }
     }
     
-    // 停止录制并完成MP4文件
-    bool stop() {
-        LOGI("🛑 停止MP4录制");
-        std::lock_guard<std::mutex> lock(record_mutex);
-        
-        if (!recording_active.load()) {
-            LOGI("ℹ️ 录制器未激活，无需停止");
-            return true;
+    bool isRunning() const {
+        return running.load();
     }
     
-        recording_active.store(false);
-        
-        // 刷新编码器缓冲区
-        flushEncoders();
-        
-        // 写入MP4文件尾部
-        if (output_ctx) {
-            int ret = av_write_trailer(output_ctx);
-            if (ret < 0) {
-                LOGE("❌ 写入MP4尾部失败: %d", ret);
-            } else {
-                LOGI("✅ MP4尾部写入成功");
-            }
-        }
-        
-        // 输出最终统计
-        int64_t current_time_us = std::chrono::duration_cast<std::chrono::microseconds>(
-            std::chrono::steady_clock::now().time_since_epoch()).count();
-        int64_t duration_us = current_time_us - start_time_us;
-        double duration_sec = duration_us / 1000000.0;
-        double file_size_mb = bytes_written / 1024.0 / 1024.0;
-        
-        LOGI("📊 录制完成统计:");
-        LOGI("   📁 文件: %s", output_path.c_str());
-        LOGI("   ⏱️ 时长: %.2f秒", duration_sec);
-        LOGI("   🎬 视频帧: %ld帧 (%.1ffps)", (long)total_video_frames, total_video_frames / duration_sec);
-        LOGI("   🎵 音频帧: %ld帧", (long)total_audio_frames);
-        LOGI("   💾 文件大小: %.2fMB", file_size_mb);
-        
-        return true;
+    // 阻塞到线程退出（step返回false或stop()），Java侧据此得知处理线程已结束
+    void waitForExit() {
+        std::unique_lock<std::mutex> lock(exit_mutex);
+        exit_cv.wait(lock, [this]() { return !running.load(); });
     }
     
-    bool isActive() const {
-        return recording_active.load();
+private:
+    std::atomic<bool> running;
+    std::mutex worker_mutex;
+    std::thread worker;
+    std::atomic<std::thread::id> worker_id;    // 处理线程运行期间为其线程ID
+    std::string thread_name;
+    std::mutex exit_mutex;
+    std::condition_variable exit_cv;
+    
+    bool isWorkerThread() const {
+        return worker_id.load() == std::this_thread::get_id();
     }
     
-private:
-    // 初始化MP4输出上下文
-    bool initializeOutputContext() {
-        const AVOutputFormat* fmt = av_guess_format("mp4", output_path.c_str(), nullptr);
-                if (!fmt) {
-            LOGE("❌ 找不到MP4格式");
-                    return false;
-                }
-        
-        int ret = avformat_alloc_output_context2(&output_ctx, fmt, nullptr, output_path.c_str());
-        if (ret < 0) {
-            LOGE("❌ 创建输出上下文失败: %d", ret);
-            return false;
+    void markStopped() {
+        {
+            std::lock_guard<std::mutex> lock(exit_mutex);
+            running.store(false);
         }
-        
-        LOGI("✅ MP4输出上下文创建成功");
-        return true;
+        exit_cv.notify_all();
     }
     
-    // 调试：列出所有可用的H.264编码器
-    void listAvailableH264Encoders() {
-        LOGI("🔍 列出所有可用的H.264编码器:");
-        const AVCodec* codec = nullptr;
-        void* opaque = nullptr;
-        int count = 0;
-        
-        while ((codec = av_codec_iterate(&opaque))) {
-            if (codec->type == AVMEDIA_TYPE_VIDEO && 
-                codec->id == AV_CODEC_ID_H264 && 
-                av_codec_is_encoder(codec)) {
-                LOGI("  - %s: %s", codec->name, 
-                     codec->long_name ? codec->long_name : "无描述");
-                count++;
+    void loop(Step step) {
+        worker_id.store(std::this_thread::get_id());
+        int applied_version = -1;
+        int64_t window_start = av_gettime_relative();
+        StepJitterStats stats(sched_getcpu());
+        
+        while (running.load()) {
+            int version = g_pipeline_policy_version.load();
+            if (version != applied_version) {
+                applyThreadPolicy(thread_name.c_str(), getPipelinePolicy());
+                applied_version = version;
+            }
+            
+            int64_t step_start = av_gettime_relative();
+            if (!step()) {
+                LOGI("⏹️ %s: 处理结束", thread_name.c_str());
+                break;
+            }
+            int64_t now = av_gettime_relative();
+            stats.addStep((now - step_start) / 1000.0, sched_getcpu());
+            
+            if (now - window_start >= 5000000) {
+                LOGI("📊 %s: %d步, 平均%.2fms, 标准差%.2fms, CPU迁移%d次", thread_name.c_str(), stats.stepCount(),
+                     stats.meanMs(), stats.stddevMs(), stats.migrationCount());
+                window_start = now;
+                stats.resetWindow();
             }
         }
-        
-        if (count == 0) {
-            LOGE("❌ 没有找到任何H.264编码器!");
-        } else {
-            LOGI("✅ 找到 %d 个H.264编码器", count);
-        }
+        worker_id.store(std::thread::id());
+        markStopped();
     }
+};
+#endif
+
+// ============================================================================
+// 现代化MP4录制系统 - 高效RTSP转MP4录制
+// ============================================================================
+#if FFMPEG_FOUND
+// 录制输出参数 - 默认继承直播流的几何尺寸、帧率和颜色属性
+struct RecordingProfile {
+    int width;
+    int height;
+    AVPixelFormat pix_fmt;                  // 源帧像素格式（用于选择免转换的编码格式）
+    AVRational sample_aspect_ratio;
+    AVRational framerate;
+    AVRational time_base;                   // 源视频流时间基准（录制时间戳以此为准，{0,1}表示未知）
+    AVColorRange color_range;
+    AVColorSpace color_space;
+    AVColorPrimaries color_primaries;
+    AVColorTransferCharacteristic color_trc;
     
-    // MediaCodec兼容性检测和自动配置
-    bool autoConfigureMediaCodec(AVCodecContext* ctx, int width, int height) {
-        LOGI("🔧 自动配置MediaCodec参数");
-        
-        // 检查分辨率兼容性
-        if (width % 16 != 0 || height % 16 != 0) {
-            LOGW("⚠️ 分辨率不是16的倍数(%dx%d)，MediaCodec可能不支持", width, height);
-            // 调整到16的倍数
-            int aligned_width = (width + 15) & ~15;
-            int aligned_height = (height + 15) & ~15;
-            if (aligned_width != width || aligned_height != height) {
-                LOGI("🔧 调整分辨率: %dx%d -> %dx%d", width, height, aligned_width, aligned_height);
-                ctx->width = aligned_width;
-                ctx->height = aligned_height;
+    RecordingProfile() :
+        width(0), height(0), pix_fmt(AV_PIX_FMT_NONE),
+        sample_aspect_ratio(AVRational{0, 1}), framerate(AVRational{30, 1}),
+        time_base(AVRational{0, 1}), color_range(AVCOL_RANGE_UNSPECIFIED), color_space(AVCOL_SPC_UNSPECIFIED),
+        color_primaries(AVCOL_PRI_UNSPECIFIED), color_trc(AVCOL_TRC_UNSPECIFIED) {}
+};
+
+// 录制编码参数（encoder_config.h）按分辨率和帧率取默认值，帧率未知时按30fps
+static double encoderFrameRate(AVRational framerate) {
+    return framerate.num > 0 && framerate.den > 0 ? av_q2d(framerate) : 0.0;
+}
+
+// 写入码率控制/GOP参数，配置必须已经fillDefaults并校验
+static void applyEncoderConfig(AVCodecContext* ctx, const EncoderConfig& config, bool hardware) {
+    ctx->bit_rate = config.bitrate;
+    ctx->gop_size = config.gop_length;
+    ctx->max_b_frames = 0; // 无B帧，降低延迟
+    if (config.slices > 0) {
+        ctx->slices = config.slices;
+    }
+    // libx264没有"level"私有选项，只读取AVCodecContext::level；MediaCodec只读取私有选项
+    H264Level level = selectH264Level(ctx->width, ctx->height, encoderFrameRate(ctx->framerate),
+                                      encoderPeakBitrate(config));
+    ctx->level = level.idc;
+    if (hardware) {
+        av_opt_set(ctx->priv_data, "level", level.name, 0);
+    }
+    
+    switch (config.rate_control) {
+        case RATE_CONTROL_CBR:
+            ctx->rc_min_rate = config.bitrate;
+            ctx->rc_max_rate = encoderPeakBitrate(config);
+            ctx->rc_buffer_size = (int)(config.bitrate / 2); // 0.5秒VBV，限制延迟
+            av_opt_set(ctx->priv_data, hardware ? "bitrate_mode" : "nal-hrd", "cbr", 0);
+            break;
+        case RATE_CONTROL_CRF:
+            av_opt_set_int(ctx->priv_data, "crf", config.crf, 0);
+            ctx->rc_max_rate = encoderPeakBitrate(config);
+            ctx->rc_buffer_size = (int)config.bitrate;
+            break;
+        default:
+            ctx->rc_max_rate = encoderPeakBitrate(config);
+            ctx->rc_buffer_size = (int)config.bitrate;
+            if (hardware) {
+                av_opt_set(ctx->priv_data, "bitrate_mode", "vbr", 0);
             }
-        }
-        
-        // 检查码率设置
-        int64_t recommended_bitrate = width * height * 2; // 2 bits per pixel
-        if (ctx->bit_rate != recommended_bitrate) {
-            ctx->bit_rate = recommended_bitrate;
-            LOGI("🔧 调整码率: %ld bps", (long)ctx->bit_rate);
-        }
-        
-        // 设置兼容性最高的参数组合
-        av_opt_set(ctx->priv_data, "profile", "baseline", 0);
-        av_opt_set(ctx->priv_data, "level", "3.1", 0);
-        av_opt_set(ctx->priv_data, "bitrate_mode", "vbr", 0);
-        av_opt_set(ctx->priv_data, "color_format", "nv12", 0);
-        av_opt_set_int(ctx->priv_data, "quality", 70, 0);
-        av_opt_set_int(ctx->priv_data, "b_frames", 0, 0);
-        av_opt_set_int(ctx->priv_data, "g", 30, 0);
-        
-        // 设置Android优化参数
-        av_opt_set(ctx->priv_data, "preset", "ultrafast", 0);
-        av_opt_set_int(ctx->priv_data, "refs", 1, 0);
-        
-        LOGI("🔧 MediaCodec自动配置完成");
-        return true;
+            break;
     }
     
-    // 创建视频流
-    bool createVideoStream(int width, int height, AVRational framerate) {
-        // 调试：列出可用编码器
-        listAvailableH264Encoders();
-        // 选择编码器 - 优先硬件编码，但添加兼容性检查
-        const AVCodec* codec = nullptr;
-        if (use_hardware_encoding) {
-            codec = avcodec_find_encoder_by_name("h264_mediacodec");
-            if (codec) {
-                LOGI("✅ 找到硬件H.264编码器，将测试兼容性");
-                
-                // 检查分辨率是否被支持（一些设备对分辨率有限制）
-                if (width % 16 != 0 || height % 16 != 0) {
-                    LOGW("⚠️ 分辨率不是16的倍数(%dx%d)，可能影响硬件编码", width, height);
-                }
-                
-                // 检查是否是常见的分辨率
-                bool common_resolution = false;
-                if ((width == 1920 && height == 1080) ||
-                    (width == 1280 && height == 720) ||
-                    (width == 854 && height == 480) ||
-                    (width == 640 && height == 480)) {
-                    common_resolution = true;
-                }
-                
-                if (!common_resolution) {
-                    LOGW("⚠️ 非标准分辨率(%dx%d)，硬件编码可能不稳定", width, height);
-                }
-            } else {
-                LOGW("⚠️ 硬件编码器不可用，使用软件编码器");
-                use_hardware_encoding = false;
+    if (!hardware) {
+        av_opt_set(ctx->priv_data, "preset", config.preset.c_str(), 0);
+        av_opt_set(ctx->priv_data, "tune", "zerolatency", 0);
+    }
+    if (config.intra_refresh) {
+        av_opt_set_int(ctx->priv_data, "intra-refresh", 1, 0);
+    }
+}
+
+// ============================================================================
+// H.264编码器能力缓存 - 每个进程只枚举一次编码器，记录每个分辨率/格式组合正式打开的结果
+// ============================================================================
+// 不单独试开：试开一次再正式打开会让每个新分辨率的首次录制打开两次编码器，
+// MediaCodec每次要几十到上百毫秒，还多占一个稀缺的编解码会话。未知组合直接正式打开，失败后记入缓存换下一个
+// MediaCodec编码器的兼容性参数
+// 码率控制和GOP由EncoderConfig决定
+static void applyMediaCodecEncoderOptions(AVCodecContext* ctx) {
+    av_opt_set(ctx->priv_data, "profile", "baseline", 0);
+    av_opt_set(ctx->priv_data, "color_format", "nv12", 0);
+    av_opt_set_int(ctx->priv_data, "quality", 70, 0);
+    av_opt_set_int(ctx->priv_data, "b_frames", 0, 0);
+    av_opt_set_int(ctx->priv_data, "refs", 1, 0);
+}
+
+class EncoderCapabilityCache {
+public:
+    // 选择结果：编码器 + 已验证可打开的像素格式
+    struct Selection {
+        const AVCodec* codec;
+        AVPixelFormat pix_fmt;
+        bool hardware;
+        
+        Selection() : codec(nullptr), pix_fmt(AV_PIX_FMT_NONE), hardware(false) {}
+    };
+    
+    static EncoderCapabilityCache& getInstance() {
+        static EncoderCapabilityCache instance;
+        return instance;
+    }
+    
+    // 按优先级选择编码器：跳过已知打开失败的组合，未知组合交给调用方正式打开后markOpened/markFailed
+    bool select(bool prefer_hardware, int width, int height, AVPixelFormat source_fmt, Selection& out) {
+        ensureEnumerated();
+        
+        // 编码器列表枚举后不再修改，遍历不需要加锁
+        for (size_t i = 0; i < encoders.size(); i++) {
+            const EncoderInfo& info = encoders[i];
+            if (info.hardware && !prefer_hardware) {
+                continue;
             }
-        }
-        
-        if (!codec) {
-            // 使用与回退相同的智能编码器选择逻辑
-            LOGI("🔍 搜索兼容的软件编码器...");
-            const char* blacklisted_encoders[] = {
-                "h264_mediacodec", "h264_v4l2m2m", "h264_vaapi", 
-                "h264_nvenc", "h264_videotoolbox", nullptr
-            };
-            
-            const AVCodec* temp_codec = nullptr;
-            void* opaque = nullptr;
-            int candidate_count = 0;
             
-            while ((temp_codec = av_codec_iterate(&opaque))) {
-                if (temp_codec->type == AVMEDIA_TYPE_VIDEO && 
-                    temp_codec->id == AV_CODEC_ID_H264 && 
-                    av_codec_is_encoder(temp_codec)) {
-                    
-                    // 检查黑名单
-                    bool blacklisted = false;
-                    for (int i = 0; blacklisted_encoders[i] != nullptr; i++) {
-                        if (strcmp(temp_codec->name, blacklisted_encoders[i]) == 0) {
-                            blacklisted = true;
-                            break;
-                        }
-                    }
-                    
-                    if (!blacklisted) {
-                        codec = temp_codec;
-                        candidate_count++;
-                        LOGI("✅ 候选编码器 #%d: %s", candidate_count, codec->name);
-                        
-                        // 优先选择纯软件编码器
-                        if (strstr(codec->name, "libx264") != nullptr ||
-                            strcmp(codec->name, "h264") == 0) {
-                            LOGI("🎯 选择优先编码器: %s", codec->name);
-                            break;
-                        }
-                    }
-                }
+            // 源格式优先（免转换），其次按编码器验证过的格式顺序
+            std::vector<AVPixelFormat> candidates;
+            if (source_fmt != AV_PIX_FMT_NONE && !info.hardware) {
+                candidates.push_back(source_fmt);
             }
+            candidates.insert(candidates.end(), info.pix_fmts.begin(), info.pix_fmts.end());
             
-            // 如果没有H.264编码器，尝试MJPEG
-            if (!codec) {
-                LOGW("⚠️ 没有可用的H.264编码器，尝试MJPEG");
-                codec = avcodec_find_encoder(AV_CODEC_ID_MJPEG);
-                if (codec) {
-                    LOGI("✅ 使用MJPEG编码器: %s", codec->name);
+            for (size_t j = 0; j < candidates.size(); j++) {
+                if (!info.supportsFormat(candidates[j])) {
+                    continue;
                 }
-            }
-            
-                if (!codec) {
-                LOGE("❌ 找不到任何兼容的编码器");
-                    return false;
+                if (!knownFailed(info.codec, width, height, candidates[j])) {
+                    out.codec = info.codec;
+                    out.pix_fmt = candidates[j];
+                    out.hardware = info.hardware;
+                    return true;
                 }
-            LOGI("✅ 最终选择编码器: %s", codec->name);
             }
-        
-        // 创建视频流
-        video_stream = avformat_new_stream(output_ctx, codec);
-        if (!video_stream) {
-            LOGE("❌ 创建视频流失败");
-            return false;
         }
-        
-        // 创建编码器上下文
-        video_encoder_ctx = avcodec_alloc_context3(codec);
-        if (!video_encoder_ctx) {
-            LOGE("❌ 分配视频编码器上下文失败");
-            return false;
+        return false;
+    }
+    
+    // 编码器是否支持某个私有选项（用于校验EncoderConfig）
+    bool hasOption(const AVCodec* codec, const char* name) {
+        ensureEnumerated();
+        for (size_t i = 0; i < encoders.size(); i++) {
+            if (encoders[i].codec != codec) {
+                continue;
+            }
+            const std::vector<std::string>& options = encoders[i].options;
+            return std::find(options.begin(), options.end(), name) != options.end();
         }
-        
-        // 设置编码参数
-        video_encoder_ctx->width = width;
-        video_encoder_ctx->height = height;
-        video_encoder_ctx->time_base = av_inv_q(framerate);
-        video_encoder_ctx->framerate = framerate;
-        video_encoder_ctx->bit_rate = width * height * 2; // 动态码率
-        video_encoder_ctx->gop_size = framerate.num; // 1秒一个I帧
-        video_encoder_ctx->max_b_frames = 0; // 无B帧，降低延迟
-        
-        // 编码器优化设置
-        if (use_hardware_encoding) {
-                    // 使用自动配置系统 - 尝试不同格式解决绿色问题
-        video_encoder_ctx->pix_fmt = AV_PIX_FMT_NV12; // Android首选格式
-        
-        // 自动配置MediaCodec参数
-        autoConfigureMediaCodec(video_encoder_ctx, width, height);
-        
-        // 添加格式回退机制
-        LOGI("🎨 设置编码器格式: NV12 (如果出现绿色将自动切换)");
-        } else {
-            // 软件编码器设置
-            video_encoder_ctx->pix_fmt = AV_PIX_FMT_YUV420P;
-            av_opt_set(video_encoder_ctx->priv_data, "preset", "fast", 0);
-            av_opt_set(video_encoder_ctx->priv_data, "tune", "zerolatency", 0);
+        return false;
+    }
+    
+    // 正式打开成功，之后的录制不再记录日志
+    void markOpened(const AVCodec* codec, int width, int height, AVPixelFormat pix_fmt, int64_t open_us) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::string key = makeKey(codec, width, height, pix_fmt);
+        if (results.find(key) == results.end()) {
+            LOGD("🔍 编码器首次打开: %s %dx%d %s (%.1fms)", codec->name, width, height,
+                 av_get_pix_fmt_name(pix_fmt), open_us / 1000.0);
         }
-        
-        // 全局头部
-        if (output_ctx->oformat->flags & AVFMT_GLOBALHEADER) {
-            video_encoder_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+        results[key] = true;
+    }
+    
+    // 正式打开失败时记录，下次选择会跳过该组合
+    void markFailed(const AVCodec* codec, int width, int height, AVPixelFormat pix_fmt) {
+        std::lock_guard<std::mutex> lock(mutex);
+        results[makeKey(codec, width, height, pix_fmt)] = false;
+        LOGW("⚠️ 编码器能力缓存: %s %dx%d %s 标记为不可用", codec->name, width, height,
+             av_get_pix_fmt_name(pix_fmt));
+    }
+    
+private:
+    struct EncoderInfo {
+        const AVCodec* codec;
+        bool hardware;
+        std::vector<AVPixelFormat> pix_fmts;
+        std::vector<std::string> options;   // 支持的码率控制相关私有选项
+        
+        bool supportsFormat(AVPixelFormat fmt) const {
+            for (size_t i = 0; i < pix_fmts.size(); i++) {
+                if (pix_fmts[i] == fmt) return true;
+            }
+            return false;
         }
-        
-        // 打开编码器
-        int ret = avcodec_open2(video_encoder_ctx, codec, nullptr);
-        if (ret < 0) {
-            char error_buf[256];
-            av_strerror(ret, error_buf, sizeof(error_buf));
-            LOGE("❌ 打开视频编码器失败: ret=%d, error=%s", ret, error_buf);
-            
-            // 如果硬件编码器失败，尝试软件编码器
-            if (use_hardware_encoding) {
-                LOGW("🔄 MediaCodec硬件编码器失败，分析原因并回退");
-                
-                // 分析具体失败原因
-                if (ret == -22) {
-                    LOGW("   - 参数无效(EINVAL)：MediaCodec不支持当前参数组合");
-                } else if (ret == -542398533) {
-                    LOGW("   - 编码器不可用：设备不支持MediaCodec编码器");
-                } else if (ret == -61) {
-                    LOGW("   - 操作无效：MediaCodec配置冲突");
-                }
-                
-                LOGW("   - 原因分析：可能是颜色格式、码率模式或profile不兼容");
-                LOGW("   - 解决方案：回退到软件编码器（libx264）");
-                
-                avcodec_free_context(&video_encoder_ctx);
-                use_hardware_encoding = false;
-                
-                // 智能编码器选择 - 排除需要特殊权限的编码器
-                const char* blacklisted_encoders[] = {
-                    "h264_mediacodec",  // MediaCodec（已知失败）
-                    "h264_v4l2m2m",     // V4L2（权限问题）
-                    "h264_vaapi",       // VA-API（权限问题）
-                    "h264_nvenc",       // NVENC（权限问题）
-                    "h264_videotoolbox", // VideoToolbox（iOS专用）
-                    nullptr
-                };
-                
-                // 搜索所有可用编码器，但排除有问题的
-                LOGI("🔍 搜索兼容的软件编码器...");
-                const AVCodec* temp_codec = nullptr;
-                void* opaque = nullptr;
-                int candidate_count = 0;
-                
-                while ((temp_codec = av_codec_iterate(&opaque))) {
-                    if (temp_codec->type == AVMEDIA_TYPE_VIDEO && 
-                        temp_codec->id == AV_CODEC_ID_H264 && 
-                        av_codec_is_encoder(temp_codec)) {
-                        
-                        // 检查是否在黑名单中
-                        bool blacklisted = false;
-                        for (int i = 0; blacklisted_encoders[i] != nullptr; i++) {
-                            if (strcmp(temp_codec->name, blacklisted_encoders[i]) == 0) {
-                                blacklisted = true;
-                                LOGD("🚫 跳过黑名单编码器: %s", temp_codec->name);
-                                break;
-                            }
-                        }
-                        
-                        if (!blacklisted) {
-                            codec = temp_codec;
-                            candidate_count++;
-                            LOGI("✅ 候选编码器 #%d: %s", candidate_count, codec->name);
-                            
-                            // 优先选择libx264或纯软件编码器
-                            if (strstr(codec->name, "libx264") != nullptr ||
-                                strcmp(codec->name, "h264") == 0) {
-                                LOGI("🎯 选择优先编码器: %s", codec->name);
-                                break;
-            }
-                        }
-                    }
-                }
-                
-                if (candidate_count == 0) {
-                    LOGE("❌ 没有找到兼容的H.264编码器");
-                }
-                
-                // 如果H.264编码器都不可用，尝试MJPEG作为备选
-                if (!codec) {
-                    LOGW("⚠️ 没有可用的H.264编码器，尝试MJPEG备选方案");
-                    codec = avcodec_find_encoder(AV_CODEC_ID_MJPEG);
-                    if (codec) {
-                        LOGI("✅ 使用MJPEG编码器作为备选: %s", codec->name);
-                        // 需要修改输出格式
-                        // 但先尝试继续H.264流程
-                    } else {
-                        LOGE("❌ 连MJPEG编码器也找不到");
-                        return false;
-                    }
-                }
-                
-                // 重新创建编码器上下文
-                video_encoder_ctx = avcodec_alloc_context3(codec);
-                if (!video_encoder_ctx) {
-                    LOGE("❌ 分配软件编码器上下文失败");
-                    return false;
-                }
-                
-                // 重新设置软件编码器参数
-                video_encoder_ctx->width = width;
-                video_encoder_ctx->height = height;
-                video_encoder_ctx->time_base = av_inv_q(framerate);
-                video_encoder_ctx->framerate = framerate;
-                video_encoder_ctx->pix_fmt = AV_PIX_FMT_YUV420P;
-                video_encoder_ctx->bit_rate = width * height * 2;
-                video_encoder_ctx->gop_size = framerate.num;
-                video_encoder_ctx->max_b_frames = 0;
-                
-                // 全局头部
-                if (output_ctx->oformat->flags & AVFMT_GLOBALHEADER) {
-                    video_encoder_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    };
+    
+    std::mutex mutex;                               // 只保护results，不在打开编码器期间持有
+    std::once_flag enumerate_once;
+    std::vector<EncoderInfo> encoders;              // 按优先级排列，call_once内写入后只读
+    std::map<std::string, bool> results;            // "名称:宽x高:格式" -> 能否打开
+    
+    EncoderCapabilityCache() {}
+    
+    static std::string makeKey(const AVCodec* codec, int width, int height, AVPixelFormat pix_fmt) {
+        char key[128];
+        snprintf(key, sizeof(key), "%s:%dx%d:%d", codec->name, width, height, (int)pix_fmt);
+        return key;
+    }
+    
+    void ensureEnumerated() {
+        std::call_once(enumerate_once, [this]() {
+            enumerateEncoders();
+        });
+    }
+    
+    // 只枚举编码器和私有选项，不打开编码器
+    void enumerateEncoders() {
+        int64_t begin_us = av_gettime_relative();
+        
+        // 需要特殊权限或不适用于Android的编码器
+        static const char* blacklisted_encoders[] = {
+            "h264_v4l2m2m", "h264_vaapi", "h264_nvenc", "h264_videotoolbox", nullptr
+        };
+        
+        const AVCodec* hw_codec = avcodec_find_encoder_by_name("h264_mediacodec");
+        if (hw_codec) {
+            EncoderInfo info;
+            info.codec = hw_codec;
+            info.hardware = true;
+            info.pix_fmts.push_back(AV_PIX_FMT_NV12);
+            collectOptions(info);
+            encoders.push_back(info);
+        }
+        
+        std::vector<EncoderInfo> software;
+        const AVCodec* codec = nullptr;
+        void* opaque = nullptr;
+        while ((codec = av_codec_iterate(&opaque))) {
+            if (codec->type != AVMEDIA_TYPE_VIDEO || codec->id != AV_CODEC_ID_H264 ||
+                !av_codec_is_encoder(codec) || codec == hw_codec) {
+                continue;
+            }
+            bool blacklisted = false;
+            for (int i = 0; blacklisted_encoders[i] != nullptr; i++) {
+                if (strcmp(codec->name, blacklisted_encoders[i]) == 0) {
+                    blacklisted = true;
+                    break;
                 }
-                
-                // 软件编码器优化
-                av_opt_set(video_encoder_ctx->priv_data, "preset", "ultrafast", 0);
-                av_opt_set(video_encoder_ctx->priv_data, "tune", "zerolatency", 0);
-                av_opt_set(video_encoder_ctx->priv_data, "profile", "baseline", 0);
-                
-                // 重新尝试打开软件编码器
-                ret = avcodec_open2(video_encoder_ctx, codec, nullptr);
-        if (ret < 0) {
-                    LOGE("❌ 软件编码器也失败: %d", ret);
-            return false;
+            }
+            if (blacklisted) {
+                LOGD("🚫 跳过黑名单编码器: %s", codec->name);
+                continue;
+            }
+            software.push_back(describeSoftware(codec));
         }
         
-                LOGI("✅ 软件编码器初始化成功");
-            } else {
-                return false;
+        // 纯软件编码器（libx264）优先
+        for (size_t i = 0; i < software.size(); i++) {
+            if (strstr(software[i].codec->name, "libx264") != nullptr) {
+                std::swap(software[i], software[0]);
+                break;
             }
         }
+        encoders.insert(encoders.end(), software.begin(), software.end());
         
-        // 复制参数到流
-        ret = avcodec_parameters_from_context(video_stream->codecpar, video_encoder_ctx);
-        if (ret < 0) {
-            LOGE("❌ 复制视频编码器参数失败: %d", ret);
-            return false;
+        // 最后的备选：MJPEG
+        const AVCodec* mjpeg = avcodec_find_encoder(AV_CODEC_ID_MJPEG);
+        if (mjpeg) {
+            encoders.push_back(describeSoftware(mjpeg));
         }
         
-        video_stream->time_base = video_encoder_ctx->time_base;
-        video_time_base = video_encoder_ctx->time_base;
-        
-        LOGI("✅ 视频流创建成功: %dx%d@%dfps", width, height, framerate.num);
-        return true;
+        LOGI("✅ 编码器枚举完成: %d个编码器, 耗时%.1fms", (int)encoders.size(),
+             (av_gettime_relative() - begin_us) / 1000.0);
     }
     
-    // 打开输出文件并写入头部
-    bool openOutputFile() {
-        // 打开输出文件
-        if (!(output_ctx->oformat->flags & AVFMT_NOFILE)) {
-            int ret = avio_open(&output_ctx->pb, output_path.c_str(), AVIO_FLAG_WRITE);
-            if (ret < 0) {
-                LOGE("❌ 打开输出文件失败: %d", ret);
-                return false;
+    static EncoderInfo describeSoftware(const AVCodec* codec) {
+        EncoderInfo info;
+        info.codec = codec;
+        info.hardware = false;
+        if (codec->pix_fmts) {
+            for (const AVPixelFormat* fmt = codec->pix_fmts; *fmt != AV_PIX_FMT_NONE; fmt++) {
+                info.pix_fmts.push_back(*fmt);
             }
         }
-        
-        // 写入文件头
-        int ret = avformat_write_header(output_ctx, nullptr);
-        if (ret < 0) {
-            LOGE("❌ 写入MP4头部失败: %d", ret);
-            return false;
+        // 首选YUV420P（兼容性最好）
+        for (size_t i = 0; i < info.pix_fmts.size(); i++) {
+            if (info.pix_fmts[i] == AV_PIX_FMT_YUV420P || info.pix_fmts[i] == AV_PIX_FMT_YUVJ420P) {
+                std::swap(info.pix_fmts[i], info.pix_fmts[0]);
+                break;
+            }
         }
-        
-        LOGI("✅ 输出文件打开成功: %s", output_path.c_str());
-        return true;
+        collectOptions(info);
+        return info;
     }
     
-    // 刷新编码器缓冲区
-    void flushEncoders() {
-        // 刷新视频编码器
-        if (video_encoder_ctx) {
-            avcodec_send_frame(video_encoder_ctx, nullptr);
-            
-            AVPacket* pkt = av_packet_alloc();
-            if (pkt) {
-                int ret;
-                while ((ret = avcodec_receive_packet(video_encoder_ctx, pkt)) >= 0) {
-                    pkt->stream_index = video_stream->index;
-                    av_packet_rescale_ts(pkt, video_encoder_ctx->time_base, video_stream->time_base);
-                    av_interleaved_write_frame(output_ctx, pkt);
-                    av_packet_unref(pkt);
-                }
-                av_packet_free(&pkt);
+    static void collectOptions(EncoderInfo& info) {
+        static const char* known_options[] = {
+            "crf", "preset", "intra-refresh", "nal-hrd", "bitrate_mode", "level", nullptr
+        };
+        if (!info.codec->priv_class) {
+            return;
+        }
+        for (int i = 0; known_options[i] != nullptr; i++) {
+            if (av_opt_find((void*)&info.codec->priv_class, known_options[i], nullptr, 0, AV_OPT_SEARCH_FAKE_OBJ)) {
+                info.options.push_back(known_options[i]);
             }
         }
-        
-        // 刷新音频编码器
-        if (audio_encoder_ctx) {
-            avcodec_send_frame(audio_encoder_ctx, nullptr);
-            
-            AVPacket* pkt = av_packet_alloc();
-            if (pkt) {
-                int ret;
-                while ((ret = avcodec_receive_packet(audio_encoder_ctx, pkt)) >= 0) {
-                    pkt->stream_index = audio_stream->index;
-                    av_packet_rescale_ts(pkt, audio_encoder_ctx->time_base, audio_stream->time_base);
-                    av_interleaved_write_frame(output_ctx, pkt);
-                    av_packet_unref(pkt);
-                }
-                av_packet_free(&pkt);
     }
-        }
+    
+    bool knownFailed(const AVCodec* codec, int width, int height, AVPixelFormat pix_fmt) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::map<std::string, bool>::iterator it = results.find(makeKey(codec, width, height, pix_fmt));
+        return it != results.end() && !it->second;
     }
+};
+
+class ModernRecorder {
+private:
+    // 核心FFmpeg组件
+    AVFormatContext* output_ctx;
+    AVStream* video_stream;
+    AVStream* audio_stream;
+    AVCodecContext* video_encoder_ctx;
+    AVCodecContext* audio_encoder_ctx;
     
-    // 流复制模式（直接复制已编码的数据）
-    bool writeFrameWithCopy(AVFrame* frame) {
-        // 对于实时RTSP流，通常使用重编码模式更稳定
-        // 流复制需要输入流和输出流的编码参数完全一致
-        
-        static int copy_mode_log_count = 0;
-        if (copy_mode_log_count++ % 100 == 0) {
-            LOGD("🔄 使用重编码模式确保兼容性 (第%d次)", copy_mode_log_count);
-        }
+    // 录制状态管理
+    std::string output_path;
+    std::atomic<bool> recording_active;
+    std::mutex record_mutex;
+    
+    // 帧计数和时间管理
+    int64_t video_frame_count;
+    int64_t audio_frame_count;
+    int64_t start_time_us;
+    AVRational video_time_base;
+    AVRational audio_time_base;
+    
+    // 录制模式配置
+    bool use_hardware_encoding;
+    bool copy_video_stream;     // 是否直接复制视频流（不重编码）
+    bool copy_audio_stream;     // 是否直接复制音频流（不重编码）
+    bool stream_copy_mode;      // 预录/时移模式：直接写入已编码数据包
+    int64_t copy_ts_offset;     // 流复制模式的时间戳偏移（使文件从0开始）
+    bool blocking_input;        // 文件转码：流水线满时阻塞等待而不是丢帧
+    RecordingProfile profile;   // 当前录制输出参数
+    EncoderConfig encoder_config;           // 调用方设置的编码参数（未设置字段按分辨率自动选择）
+    
+    // 音视频同步：以第一帧视频的源时间为零点（视频主时钟）
+    AVCodecParameters* audio_source_par;    // 直通的源音频参数，nullptr表示无音频
+    int64_t video_origin_us;
+    int64_t last_video_pts;
+    
+    // 录制流水线：转换 -> 编码 -> 封装，各阶段独立线程
+    struct PendingFrame {
+        AVFrame* frame;
+        AVPixelFormat layout;               // 源帧数据布局（来自PixelFormatDescriptor）
+        int64_t pts;                        // 编码器时间基准下的时间戳
+    };
+    static const size_t CONVERT_QUEUE_SIZE = 4;  // 待转换帧，满时丢弃新帧，不阻塞播放线程
+    static const size_t ENCODE_QUEUE_SIZE = 4;   // 待编码帧
+    static const size_t MUX_QUEUE_SIZE = 64;     // 待封装数据包
+    BoundedQueue<PendingFrame> convert_queue;
+    BoundedQueue<AVFrame*> encode_queue;
+    BoundedQueue<AVPacket*> mux_queue;
+    std::thread convert_thread;
+    std::thread encode_thread;
+    std::thread mux_thread;
+    std::mutex mux_mutex;                        // 保护output_ctx写入（流水线与writePacket共用）
+    std::atomic<int64_t> dropped_frames;
+    std::atomic<int64_t> encoded_frames;
+    RecordingIndexWriter index_writer;           // 视频包定位索引（在mux_mutex下追加）
+    int encoder_threads;                         // 软件编码线程数，0=自动
+    bool has_thread_policy;                      // 只有直播录制器跟随流水线策略，转码工作单元保持默认调度
+    ThreadPolicy thread_policy;
+    
+    // 录制颜色转换上下文，只在转换线程中使用；每个录制器独立，并行转码的分段互不干扰
+    SwsContext* record_sws_ctx;
+    
+    // 性能统计：writePacket（record_mutex）和封装线程（mux_mutex）都会累加，用原子计数
+    std::atomic<int64_t> total_video_frames;
+    std::atomic<int64_t> total_audio_frames;
+    std::atomic<int64_t> bytes_written;
+    int64_t start_request_us;   // start()调用时刻，用于统计启动到首包的耗时
+    bool first_packet_written;
+    
+public:
+    ModernRecorder() : 
+        output_ctx(nullptr), video_stream(nullptr), audio_stream(nullptr),
+        video_encoder_ctx(nullptr), audio_encoder_ctx(nullptr),
+        recording_active(false), video_frame_count(0), audio_frame_count(0),
+        start_time_us(AV_NOPTS_VALUE), use_hardware_encoding(true),
+        copy_video_stream(true), copy_audio_stream(true),
+        stream_copy_mode(false), copy_ts_offset(AV_NOPTS_VALUE), blocking_input(false),
+        audio_source_par(nullptr), video_origin_us(AV_NOPTS_VALUE), last_video_pts(AV_NOPTS_VALUE),
+        convert_queue(CONVERT_QUEUE_SIZE), encode_queue(ENCODE_QUEUE_SIZE), mux_queue(MUX_QUEUE_SIZE),
+        dropped_frames(0), encoded_frames(0), encoder_threads(0), has_thread_policy(false), record_sws_ctx(nullptr),
+        total_video_frames(0), total_audio_frames(0), bytes_written(0),
+        start_request_us(0), first_packet_written(false) {
         
-        return writeFrameWithReencode(frame);
+        video_time_base = {1, 90000};  // 默认90kHz时间基准
+        audio_time_base = {1, 48000};  // 默认48kHz时间基准
+    }
+    
+    ~ModernRecorder() {
+        cleanup();
+        avcodec_parameters_free(&audio_source_par);
+        sws_freeContext(record_sws_ctx);
     }
     
-    // 重新编码模式（将解码帧重新编码为MP4）- 修复绿色问题
-    bool writeFrameWithReencode(AVFrame* frame) {
-        if (!video_encoder_ctx || !frame) {
+    // 准备录制 - 设置输出路径和基本参数
+    bool prepare(const char* path) {
+        std::lock_guard<std::mutex> lock(record_mutex);
+        
+        if (recording_active.load()) {
+            LOGE("🚫 录制器已激活，无法重新准备");
             return false;
         }
         
-        // 创建编码兼容的帧
-        AVFrame* encode_frame = av_frame_alloc();
-        if (!encode_frame) {
+        if (!path || strlen(path) == 0) {
+            LOGE("🚫 输出路径无效");
             return false;
         }
         
-        // 设置编码帧参数
-        encode_frame->format = video_encoder_ctx->pix_fmt;
-        encode_frame->width = video_encoder_ctx->width;
-        encode_frame->height = video_encoder_ctx->height;
-        encode_frame->pts = video_frame_count++;
+        output_path = std::string(path);
+        LOGI("📝 录制器准备就绪，输出路径: %s", output_path.c_str());
         
-        // 分配帧缓冲区
-        int ret = av_frame_get_buffer(encode_frame, 32);
-        if (ret < 0) {
-            av_frame_free(&encode_frame);
+        // 重置计数器
+        video_frame_count = 0;
+        audio_frame_count = 0;
+        total_video_frames = 0;
+        total_audio_frames = 0;
+        bytes_written = 0;
+        start_time_us = AV_NOPTS_VALUE;
+        
+        return true;
+    }
+    
+    // 设置直通的源音频流（AAC等MP4支持的编码直接复制），par为nullptr表示不录制音频
+    bool setAudioSource(const AVCodecParameters* par, AVRational time_base) {
+        std::lock_guard<std::mutex> lock(record_mutex);
+        avcodec_parameters_free(&audio_source_par);
+        if (!par) {
+            return true;
+        }
+        audio_source_par = avcodec_parameters_alloc();
+        if (!audio_source_par || avcodec_parameters_copy(audio_source_par, par) < 0) {
+            avcodec_parameters_free(&audio_source_par);
+            return false;
+        }
+        audio_time_base = time_base;
+        return true;
+    }
+    
+    // 设置编码参数，下次start()生效
+    bool setEncoderConfig(const EncoderConfig& config) {
+        std::lock_guard<std::mutex> lock(record_mutex);
+        if (recording_active.load()) {
+            LOGW("⚠️ 录制进行中，编码参数将在下次录制生效");
+        }
+        encoder_config = config;
+        return true;
+    }
+    
+    // 文件转码使用阻塞写入，直播录制保持满时丢帧，不阻塞播放线程
+    void setBlockingInput(bool blocking) {
+        std::lock_guard<std::mutex> lock(record_mutex);
+        blocking_input = blocking;
+    }
+    
+    // 是否优先选择硬件编码器（并行转码时MediaCodec会话数有限，改用软件编码器）
+    void setHardwareEncoding(bool enabled) {
+        std::lock_guard<std::mutex> lock(record_mutex);
+        use_hardware_encoding = enabled;
+    }
+    
+    // 流水线线程（转换/编码/封装）的调度策略，在start前设置；不使用实时调度，避免编码抢占解码/渲染
+    void setThreadPolicy(const ThreadPolicy& policy) {
+        std::lock_guard<std::mutex> lock(record_mutex);
+        thread_policy = policy;
+        thread_policy.realtime = false;
+        has_thread_policy = true;
+    }
+    
+    // 软件编码器线程数上限（并行转码按分段数均分CPU），0表示由编码器自动决定
+    void setEncoderThreads(int threads) {
+        std::lock_guard<std::mutex> lock(record_mutex);
+        encoder_threads = threads > 0 ? threads : 0;
+    }
+    
+    // 启动录制 - 初始化MP4输出格式
+    bool start(int width, int height, AVRational framerate) {
+        RecordingProfile fixed_profile;
+        fixed_profile.width = width;
+        fixed_profile.height = height;
+        fixed_profile.framerate = framerate;
+        return start(fixed_profile);
+    }
+    
+    // 启动录制 - 使用完整的输出参数（通常来自直播流）
+    bool start(const RecordingProfile& output_profile) {
+        int width = output_profile.width;
+        int height = output_profile.height;
+        AVRational framerate = output_profile.framerate;
+        LOGI("🎬 启动MP4录制: %dx%d@%d/%dfps, SAR=%d:%d, 源格式=%s", width, height,
+             framerate.num, framerate.den, output_profile.sample_aspect_ratio.num,
+             output_profile.sample_aspect_ratio.den, av_get_pix_fmt_name(output_profile.pix_fmt));
+        std::lock_guard<std::mutex> lock(record_mutex);
+        start_request_us = av_gettime_relative();
+        first_packet_written = false;
+        
+        if (recording_active.load()) {
+            LOGE("🚫 录制已激活");
             return false;
         }
         
-        // 修复绿色问题：使用直接数据复制而不是颜色转换
-        if (frame->format == 23 && encode_frame->format == AV_PIX_FMT_NV12) {
-            // 直接复制数据，避免不必要的颜色转换
-            bool copy_success = copyFrameData(frame, encode_frame);
-            if (!copy_success) {
-                LOGE("❌ 帧数据复制失败");
-                av_frame_free(&encode_frame);
-                return false;
-            }
-            LOGD("✅ 使用直接数据复制 (避免绿色问题)");
-        } else {
-            // 使用颜色空间转换
-            bool conversion_success = convertFrameWithSws(frame, encode_frame);
-            if (!conversion_success) {
-                LOGE("❌ 颜色空间转换失败");
-                av_frame_free(&encode_frame);
-                return false;
-            }
+        if (output_path.empty()) {
+            LOGE("🚫 输出路径未设置");
+            return false;
         }
         
-        // 发送帧到编码器
-        ret = avcodec_send_frame(video_encoder_ctx, encode_frame);
-        av_frame_free(&encode_frame);
+        if (width <= 0 || height <= 0 || framerate.num <= 0 || framerate.den <= 0) {
+            LOGE("🚫 录制参数无效: %dx%d@%d/%d", width, height, framerate.num, framerate.den);
+            return false;
+        }
+        profile = output_profile;
         
-        if (ret < 0) {
-            LOGE("❌ 发送帧到编码器失败: %d", ret);
+        // 初始化MP4输出上下文
+        if (!initializeOutputContext()) {
+            LOGE("❌ 初始化输出上下文失败");
             return false;
         }
         
-        // 接收编码后的数据包
-        AVPacket* pkt = av_packet_alloc();
-        if (!pkt) {
+        // 创建视频流
+        if (!createVideoStream(width, height, framerate)) {
+            LOGE("❌ 创建视频流失败");
+            cleanupLocked();
             return false;
         }
         
-        bool success = false;
-        while ((ret = avcodec_receive_packet(video_encoder_ctx, pkt)) >= 0) {
-            pkt->stream_index = video_stream->index;
-            av_packet_rescale_ts(pkt, video_encoder_ctx->time_base, video_stream->time_base);
-            
-            ret = av_interleaved_write_frame(output_ctx, pkt);
-            if (ret >= 0) {
-                success = true;
-                bytes_written += pkt->size;
-            }
-            av_packet_unref(pkt);
+        // 音频直通（失败不影响视频录制）
+        createAudioPassthroughStream();
+        video_origin_us = AV_NOPTS_VALUE;
+        last_video_pts = AV_NOPTS_VALUE;
+        
+        // 打开输出文件并写入头部
+        if (!openOutputFile()) {
+            LOGE("❌ 打开输出文件失败");
+            cleanupLocked();
+            return false;
         }
         
-        av_packet_free(&pkt);
-        return success;
+        startPipeline();
+        recording_active.store(true);
+        start_time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        
+        LOGI("✅ MP4录制启动成功: %s (初始化耗时%.1fms)", output_path.c_str(),
+             (av_gettime_relative() - start_request_us) / 1000.0);
+        return true;
     }
     
-    // 专业的颜色空间转换 - 录制专用，修复绿色问题
-    bool convertFrameWithSws(AVFrame* src, AVFrame* dst) {
-        static SwsContext* record_sws_ctx = nullptr;
-        static int cached_src_w = 0, cached_src_h = 0, cached_src_fmt = 0;
-        static int cached_dst_w = 0, cached_dst_h = 0, cached_dst_fmt = 0;
-        static std::mutex sws_record_mutex;
-        
-        std::lock_guard<std::mutex> lock(sws_record_mutex);
-        
-        // 录制专用格式检测 - 修复绿色问题
-        AVPixelFormat src_format;
-        AVPixelFormat dst_format = (AVPixelFormat)dst->format;
+    // 以流复制模式启动录制 - 用于预录缓冲区，直接写入已编码数据包，不重编码
+    bool startStreamCopy(const AVCodecParameters* codecpar, AVRational time_base) {
+        LOGI("🎬 启动流复制录制: %s %dx%d", avcodec_get_name(codecpar->codec_id),
+             codecpar->width, codecpar->height);
+        std::lock_guard<std::mutex> lock(record_mutex);
         
-        // 对于录制，使用兼容性最好的格式组合
-        if (src->format == 23) {
-            // MediaCodec格式23，根据数据布局选择合适的源格式
-            if (src->linesize[1] == src->linesize[0] && src->data[1] && !src->data[2]) {
-                // NV12/NV21格式，使用NV12作为源格式
-                src_format = AV_PIX_FMT_NV12;
-                LOGD("🎯 录制使用NV12格式 (兼容性最佳)");
-            } else if (src->linesize[1] == src->linesize[0]/2 && src->data[1] && src->data[2]) {
-                // YUV420P格式
-                src_format = AV_PIX_FMT_YUV420P;
-                LOGD("🎯 录制使用YUV420P格式");
-            } else {
-                // 默认使用NV12
-                src_format = AV_PIX_FMT_NV12;
-                LOGD("🎯 录制默认使用NV12格式");
-            }
-        } else {
-            src_format = (AVPixelFormat)src->format;
+        if (recording_active.load()) {
+            LOGE("🚫 录制已激活");
+            return false;
         }
         
-        LOGD("🎨 录制颜色转换: %dx%d %s -> %dx%d %s", 
-             src->width, src->height, av_get_pix_fmt_name(src_format),
-             dst->width, dst->height, av_get_pix_fmt_name(dst_format));
-        
-        // 检查是否需要重建SwsContext - 增加格式兼容性检查
-        if (!record_sws_ctx || 
-            cached_src_w != src->width || cached_src_h != src->height || cached_src_fmt != src_format ||
-            cached_dst_w != dst->width || cached_dst_h != dst->height || cached_dst_fmt != dst_format) {
-            
-            if (record_sws_ctx) {
-                sws_freeContext(record_sws_ctx);
-                record_sws_ctx = nullptr;
-            }
-            
-            // 尝试创建SwsContext，如果失败则尝试其他格式
-            record_sws_ctx = sws_getContext(
-                src->width, src->height, src_format,
-                dst->width, dst->height, dst_format,
-                SWS_BILINEAR, nullptr, nullptr, nullptr);
-            
-            if (!record_sws_ctx) {
-                LOGW("⚠️ 录制SwsContext创建失败: %s -> %s，尝试回退格式", 
-                     av_get_pix_fmt_name(src_format), av_get_pix_fmt_name(dst_format));
-                
-                // 回退策略：尝试YUV420P源格式
-                AVPixelFormat fallback_format = AV_PIX_FMT_YUV420P;
-                record_sws_ctx = sws_getContext(
-                    src->width, src->height, fallback_format,
-                    dst->width, dst->height, dst_format,
-                    SWS_BILINEAR, nullptr, nullptr, nullptr);
-                
-                if (record_sws_ctx) {
-                    src_format = fallback_format;
-                    LOGI("✅ 录制SwsContext回退成功: %s -> %s", 
-                         av_get_pix_fmt_name(src_format), av_get_pix_fmt_name(dst_format));
-                } else {
-                    LOGE("❌ 录制SwsContext回退也失败");
+        if (output_path.empty()) {
+            LOGE("🚫 输出路径未设置");
             return false;
-                }
-            } else {
-                LOGI("✅ 录制SwsContext创建成功: %s -> %s", 
-                     av_get_pix_fmt_name(src_format), av_get_pix_fmt_name(dst_format));
-            }
-            
-            cached_src_w = src->width;
-            cached_src_h = src->height;
-            cached_src_fmt = src_format;
-            cached_dst_w = dst->width;
-            cached_dst_h = dst->height;
-            cached_dst_fmt = dst_format;
         }
         
-        // 执行颜色空间转换 - 增加数据验证
-        // 验证源数据指针
-        if (!src->data[0]) {
-            LOGE("❌ 录制源数据指针无效: data[0]=%p", src->data[0]);
+        if (!initializeOutputContext()) {
+            LOGE("❌ 初始化输出上下文失败");
             return false;
         }
         
-        // 验证目标数据指针
-        if (!dst->data[0]) {
-            LOGE("❌ 录制目标数据指针无效: data[0]=%p", dst->data[0]);
+        video_stream = avformat_new_stream(output_ctx, nullptr);
+        if (!video_stream) {
+            LOGE("❌ 创建视频流失败");
+            cleanupLocked();
             return false;
         }
         
-        // 验证数据尺寸
-        if (src->linesize[0] <= 0 || dst->linesize[0] <= 0) {
-            LOGE("❌ 录制数据步长无效: src=%d, dst=%d", src->linesize[0], dst->linesize[0]);
+        int ret = avcodec_parameters_copy(video_stream->codecpar, codecpar);
+        if (ret < 0) {
+            LOGE("❌ 复制视频流参数失败: %d", ret);
+            cleanupLocked();
             return false;
         }
+        video_stream->codecpar->codec_tag = 0; // 让MP4封装器选择合适的tag
+        video_stream->time_base = time_base;
+        video_time_base = time_base;
         
-        int ret = sws_scale(record_sws_ctx, src->data, src->linesize, 0, src->height,
-                           dst->data, dst->linesize);
+        // 设置了音频源时一并直通（时间零点取第一个视频包）
+        createAudioPassthroughStream();
+        video_origin_us = AV_NOPTS_VALUE;
         
-        if (ret > 0) {
-            LOGD("✅ 录制颜色转换成功: %d行", ret);
-            return true;
-        } else {
-            LOGE("❌ 录制sws_scale失败: ret=%d", ret);
-            LOGE("   源格式: %s, 尺寸: %dx%d, linesize: [%d,%d,%d]", 
-                 av_get_pix_fmt_name((AVPixelFormat)cached_src_fmt),
-                 src->width, src->height, src->linesize[0], src->linesize[1], src->linesize[2]);
-            LOGE("   目标格式: %s, 尺寸: %dx%d, linesize: [%d,%d,%d]", 
-                 av_get_pix_fmt_name((AVPixelFormat)cached_dst_fmt),
-                 dst->width, dst->height, dst->linesize[0], dst->linesize[1], dst->linesize[2]);
+        if (!openOutputFile()) {
+            LOGE("❌ 打开输出文件失败");
+            cleanupLocked();
             return false;
         }
+        
+        stream_copy_mode = true;
+        copy_ts_offset = AV_NOPTS_VALUE;
+        recording_active.store(true);
+        start_time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        
+        LOGI("✅ 流复制录制启动成功: %s", output_path.c_str());
+        return true;
     }
     
-    // 智能检测输入格式 - 增强UV顺序检测
-    AVPixelFormat detectInputFormat(AVFrame* frame) {
-        if (frame->format != 23) {
-            return (AVPixelFormat)frame->format;
-        }
-        
-        // MediaCodec格式23的智能检测
-        if (frame->linesize[1] == frame->linesize[0] && frame->data[1] && !frame->data[2]) {
-            // 检测UV数据的特征来判断是NV12还是NV21
-            return detectNV12vsNV21(frame);
-        } else if (frame->linesize[1] == frame->linesize[0]/2 && frame->data[1] && frame->data[2]) {
-            return AV_PIX_FMT_YUV420P;
-        } else if (frame->data[1] && !frame->data[2]) {
-            return detectNV12vsNV21(frame);
-        } else {
-            return AV_PIX_FMT_YUV420P; // 回退
-        }
+    bool isStreamCopy() const {
+        return stream_copy_mode;
     }
     
-    // 检测NV12 vs NV21格式
-    AVPixelFormat detectNV12vsNV21(AVFrame* frame) {
-        if (!frame->data[1] || frame->width < 16 || frame->height < 16) {
-            return AV_PIX_FMT_NV12; // 默认
+    // 写入视频帧到MP4文件 - format为播放器按流解析好的像素格式描述
+    bool writeFrame(AVFrame* frame, const PixelFormatDescriptor& format) {
+        if (!recording_active.load() || !frame) {
+            return false;
         }
         
-        // 分析UV数据的统计特征
-        uint8_t* uv_data = frame->data[1];
-        int uv_stride = frame->linesize[1];
-        
-        // 采样几个点来检测UV分布
-        int u_sum = 0, v_sum = 0;
-        int sample_count = 0;
-        
-        for (int y = 0; y < frame->height/4 && y < 8; y++) {
-            for (int x = 0; x < frame->width/4 && x < 16; x += 2) {
-                int offset = y * uv_stride + x * 2;
-                if (offset + 1 < uv_stride * frame->height/2) {
-                    u_sum += uv_data[offset];
-                    v_sum += uv_data[offset + 1];
-                    sample_count++;
-                }
+        // 只引用帧数据并入队，转换/编码/封装在流水线线程中完成
+        PendingFrame pending;
+        bool blocking;
+        {
+            std::lock_guard<std::mutex> lock(record_mutex);
+            
+            if (!output_ctx || !video_stream || stream_copy_mode) {
+                return false;
             }
-        }
-        
-        if (sample_count > 0) {
-            int u_avg = u_sum / sample_count;
-            int v_avg = v_sum / sample_count;
             
-            LOGD("🔍 UV检测: U_avg=%d, V_avg=%d, samples=%d", u_avg, v_avg, sample_count);
+            if (!format.hasCpuData()) {
+                LOGW_EVERY(5000, "⚠️ 解码帧没有CPU可访问数据(%s)，无法重编码录制",
+                           av_get_pix_fmt_name(format.source_format));
+                return false;
+            }
             
-            // 如果V分量明显偏绿色（>140），可能是NV21格式
-            if (v_avg > 140 && u_avg < 120) {
-                LOGI("🎯 检测到NV21格式 (V偏高: %d)", v_avg);
-                return AV_PIX_FMT_NV21;
+            pending.frame = av_frame_alloc();
+            pending.layout = format.layout;
+            pending.pts = nextVideoPts(frame);
+            if (!pending.frame || av_frame_ref(pending.frame, frame) < 0) {
+                av_frame_free(&pending.frame);
+                return false;
             }
+            blocking = blocking_input;
         }
         
-        // 默认使用NV12
-        LOGI("🎯 使用NV12格式 (默认)");
-        return AV_PIX_FMT_NV12;
+        // 入队不持有record_mutex：阻塞模式下队列满时会等待，持锁等待会挡住其他线程的stop()；
+        // stop()关闭队列后阻塞中的push立即返回false
+        bool queued = blocking ? convert_queue.push(pending) : convert_queue.tryPush(pending);
+        if (!queued) {
+            av_frame_free(&pending.frame);
+            int64_t dropped = ++dropped_frames;
+            LOGW_EVERY(1000, "⚠️ 录制流水线繁忙，丢弃帧 (累计%ld帧)", (long)dropped);
+            return false;
+        }
+        return true;
     }
     
-    // 智能帧格式转换辅助函数 - 支持多种颜色格式
-    void convertFrame(AVFrame* src, AVFrame* dst) {
-        if (!src || !dst || !src->data[0]) {
-            LOGE("❌ convertFrame: 无效的输入参数");
-            return;
+    // 写入已编码的数据包（更高效的录制方式）
+    bool writePacket(AVPacket* packet) {
+        if (!recording_active.load() || !packet) {
+            return false;
         }
         
-        int src_width = src->width;
-        int src_height = src->height;
-        int dst_width = dst->width;
-        int dst_height = dst->height;
+        std::lock_guard<std::mutex> lock(record_mutex);
         
-        LOGD("🔄 颜色转换: %dx%d (格式%d) -> %dx%d (格式%d)", 
-             src_width, src_height, src->format, dst_width, dst_height, dst->format);
-        
-        // 检测目标格式并进行相应转换
-        if (dst->format == AV_PIX_FMT_NV12) {
-            // 转换到NV12格式
-            convertToNV12(src, dst);
-        } else if (dst->format == AV_PIX_FMT_YUV420P) {
-            // 转换到YUV420P格式
-            convertToYUV420P(src, dst);
-        } else {
-            LOGE("❌ 不支持的目标格式: %d", dst->format);
-            // 回退到基本转换
-            convertToYUV420P(src, dst);
+        if (!output_ctx || (!video_stream && !audio_stream)) {
+            return false;
         }
-    }
-    
-private:
-    // 转换到NV12格式 (Y + UV交错)
-    void convertToNV12(AVFrame* src, AVFrame* dst) {
-        int src_width = src->width;
-        int src_height = src->height;
-        int dst_width = dst->width;
-        int dst_height = dst->height;
         
-        // 1. 转换Y分量
-        for (int y = 0; y < dst_height; y++) {
-            int src_y = y * src_height / dst_height;
-            uint8_t* src_row = src->data[0] + src_y * src->linesize[0];
-            uint8_t* dst_row = dst->data[0] + y * dst->linesize[0];
-            
-            for (int x = 0; x < dst_width; x++) {
-                int src_x = x * src_width / dst_width;
-                dst_row[x] = src_row[src_x];
-            }
+        // 克隆数据包以避免修改原始数据
+        AVPacket* pkt = av_packet_clone(packet);
+        if (!pkt) {
+            return false;
         }
         
-        // 2. 转换UV分量 (NV12格式：UV交错存储在data[1])
-        int uv_dst_width = dst_width / 2;
-        int uv_dst_height = dst_height / 2;
-            
-        if (src->data[1] && src->data[2]) {
-            // 源是YUV420P格式，需要将U和V交错存储
-            for (int y = 0; y < uv_dst_height; y++) {
-                int src_y = y * (src_height / 2) / uv_dst_height;
-                
-                uint8_t* src_u_row = src->data[1] + src_y * src->linesize[1];
-                uint8_t* src_v_row = src->data[2] + src_y * src->linesize[2];
-                uint8_t* dst_uv_row = dst->data[1] + y * dst->linesize[1];
-                
-                for (int x = 0; x < uv_dst_width; x++) {
-                    int src_x = x * (src_width / 2) / uv_dst_width;
-                    dst_uv_row[x * 2] = src_u_row[src_x];     // U分量
-                    dst_uv_row[x * 2 + 1] = src_v_row[src_x]; // V分量
+        // 根据流类型设置正确的流索引和时间基准
+        if (packet->stream_index == 0 && video_stream) {
+            // 视频流
+            pkt->stream_index = video_stream->index;
+            if (stream_copy_mode) {
+                // 流复制模式：以第一个数据包为零点
+                if (copy_ts_offset == AV_NOPTS_VALUE) {
+                    copy_ts_offset = pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts;
+                    if (copy_ts_offset != AV_NOPTS_VALUE) {
+                        video_origin_us = av_rescale_q(copy_ts_offset, video_time_base, AV_TIME_BASE_Q);
+                    }
                 }
-            }
-        } else if (src->data[1]) {
-            // 源可能已经是NV12/NV21格式，直接复制UV数据
-            for (int y = 0; y < uv_dst_height; y++) {
-                int src_y = y * (src_height / 2) / uv_dst_height;
-                uint8_t* src_uv_row = src->data[1] + src_y * src->linesize[1];
-                uint8_t* dst_uv_row = dst->data[1] + y * dst->linesize[1];
-                
-                for (int x = 0; x < uv_dst_width; x++) {
-                    int src_x = x * (src_width / 2) / uv_dst_width;
-                    dst_uv_row[x * 2] = src_uv_row[src_x * 2];
-                    dst_uv_row[x * 2 + 1] = src_uv_row[src_x * 2 + 1];
-    }
-            }
-        } else {
-            // 生成默认的色度值 (128 = 中性灰色)
-            LOGW("⚠️ 源帧缺少色度信息，使用默认值");
-            for (int y = 0; y < uv_dst_height; y++) {
-                uint8_t* dst_uv_row = dst->data[1] + y * dst->linesize[1];
-                for (int x = 0; x < uv_dst_width; x++) {
-                    dst_uv_row[x * 2] = 128;     // U = 128
-                    dst_uv_row[x * 2 + 1] = 128; // V = 128
+                if (copy_ts_offset != AV_NOPTS_VALUE) {
+                    if (pkt->pts != AV_NOPTS_VALUE) pkt->pts -= copy_ts_offset;
+                    if (pkt->dts != AV_NOPTS_VALUE) pkt->dts -= copy_ts_offset;
                 }
             }
-        }
-        
-        LOGD("✅ NV12转换完成: Y=%d bytes, UV=%d bytes", 
-             dst->linesize[0] * dst_height, dst->linesize[1] * uv_dst_height);
-    }
-    
-        // 转换到YUV420P格式 (Y + U + V分离)
-    void convertToYUV420P(AVFrame* src, AVFrame* dst) {
-        int src_width = src->width;
-        int src_height = src->height;
-        int dst_width = dst->width;
-        int dst_height = dst->height;
-        
-        // 1. 转换Y分量
-        for (int y = 0; y < dst_height; y++) {
-            int src_y = y * src_height / dst_height;
-            uint8_t* src_row = src->data[0] + src_y * src->linesize[0];
-            uint8_t* dst_row = dst->data[0] + y * dst->linesize[0];
-            
-            for (int x = 0; x < dst_width; x++) {
-                int src_x = x * src_width / dst_width;
-                dst_row[x] = src_row[src_x];
-            }
-        }
-        
-        // 2. 转换UV分量
-        int uv_dst_width = dst_width / 2;
-        int uv_dst_height = dst_height / 2;
-        
-        if (src->data[1] && src->data[2]) {
-            // 源是YUV420P格式，直接复制
-            for (int y = 0; y < uv_dst_height; y++) {
-                int src_y = y * (src_height / 2) / uv_dst_height;
-                
-                uint8_t* src_u_row = src->data[1] + src_y * src->linesize[1];
-                uint8_t* src_v_row = src->data[2] + src_y * src->linesize[2];
-                uint8_t* dst_u_row = dst->data[1] + y * dst->linesize[1];
-                uint8_t* dst_v_row = dst->data[2] + y * dst->linesize[2];
-                
-                for (int x = 0; x < uv_dst_width; x++) {
-                    int src_x = x * (src_width / 2) / uv_dst_width;
-                    dst_u_row[x] = src_u_row[src_x];
-                    dst_v_row[x] = src_v_row[src_x];
-                }
+            av_packet_rescale_ts(pkt, video_time_base, video_stream->time_base);
+            total_video_frames++;
+        } else if (packet->stream_index == 1 && audio_stream) {
+            // 音频流：以视频首帧为零点，视频开始前的音频丢弃
+            if (video_origin_us == AV_NOPTS_VALUE || pkt->pts == AV_NOPTS_VALUE) {
+                av_packet_free(&pkt);
+                return false;
             }
-        } else if (src->data[1]) {
-            // 源是NV12/NV21格式，需要分离UV
-            for (int y = 0; y < uv_dst_height; y++) {
-                int src_y = y * (src_height / 2) / uv_dst_height;
-                uint8_t* src_uv_row = src->data[1] + src_y * src->linesize[1];
-                uint8_t* dst_u_row = dst->data[1] + y * dst->linesize[1];
-                uint8_t* dst_v_row = dst->data[2] + y * dst->linesize[2];
-                
-                for (int x = 0; x < uv_dst_width; x++) {
-                    int src_x = x * (src_width / 2) / uv_dst_width;
-                    dst_u_row[x] = src_uv_row[src_x * 2];     // U分量
-                    dst_v_row[x] = src_uv_row[src_x * 2 + 1]; // V分量
-                }
+            int64_t origin = av_rescale_q(video_origin_us, AV_TIME_BASE_Q, audio_time_base);
+            pkt->pts -= origin;
+            if (pkt->dts != AV_NOPTS_VALUE) pkt->dts -= origin;
+            if (pkt->pts < 0) {
+                av_packet_free(&pkt);
+                return false;
             }
+            pkt->stream_index = audio_stream->index;
+            av_packet_rescale_ts(pkt, audio_time_base, audio_stream->time_base);
+            total_audio_frames++;
         } else {
-            // 生成默认的色度值
-            LOGW("⚠️ 源帧缺少色度信息，使用默认值");
-            memset(dst->data[1], 128, dst->linesize[1] * uv_dst_height);
-            memset(dst->data[2], 128, dst->linesize[2] * uv_dst_height);
-        }
-        
-        LOGD("✅ YUV420P转换完成");
-    }
-    
-    // 直接数据复制 - 修复绿色问题的关键函数
-    bool copyFrameData(AVFrame* src, AVFrame* dst) {
-        if (!src || !dst || !src->data[0] || !dst->data[0]) {
-            LOGE("❌ 无效的帧指针");
+            av_packet_free(&pkt);
             return false;
         }
         
-        // 1. 复制Y分量
-        int y_height = std::min(src->height, dst->height);
-        int y_width = std::min(src->linesize[0], dst->linesize[0]);
-        
-        for (int y = 0; y < y_height; y++) {
-            memcpy(dst->data[0] + y * dst->linesize[0],
-                   src->data[0] + y * src->linesize[0],
-                   y_width);
+        // 写入交错数据包，视频包同时追加定位索引
+        TRACE_SCOPE("mux_write");
+        std::lock_guard<std::mutex> mux_lock(mux_mutex);
+        bool is_video = video_stream && pkt->stream_index == video_stream->index;
+        if (is_video) {
+            index_writer.stage(pkt->pts, pkt->dts, pkt->size, (pkt->flags & AV_PKT_FLAG_KEY) != 0, AV_NOPTS_VALUE);
         }
+        int ret = av_interleaved_write_frame(output_ctx, pkt);
+        if (ret >= 0 && is_video) {
+            index_writer.commit();
+        }
+        av_packet_free(&pkt);
         
-        // 2. 复制UV分量
-        if (src->data[1] && dst->data[1]) {
-            int uv_height = std::min(src->height / 2, dst->height / 2);
-            int uv_width = std::min(src->linesize[1], dst->linesize[1]);
-            
-            for (int y = 0; y < uv_height; y++) {
-                memcpy(dst->data[1] + y * dst->linesize[1],
-                       src->data[1] + y * src->linesize[1],
-                       uv_width);
-            }
+        if (ret >= 0) {
+            bytes_written += packet->size;
             
-            LOGD("✅ 直接数据复制完成: Y=%dx%d, UV=%dx%d", 
-                 y_width, y_height, uv_width, uv_height);
+            LOGD_EVERY(10000, "📊 录制统计: 视频%ld帧, 音频%ld帧, 总计%.1fMB", 
+                       (long)total_video_frames.load(), (long)total_audio_frames.load(),
+                       bytes_written.load() / 1024.0 / 1024.0);
+            return true;
         } else {
-            LOGW("⚠️ 源或目标缺少UV数据");
+            LOGE("❌ 写入数据包失败: %d", ret);
             return false;
         }
-        
-        return true;
     }
-
-public:
-    
-
     
-    // 清理所有资源
-    void cleanup() {
+    // 停止录制并完成MP4文件
+    bool stop() {
+        LOGI("🛑 停止MP4录制");
         std::lock_guard<std::mutex> lock(record_mutex);
         
-        LOGI("🧹 清理录制器资源");
+        if (!recording_active.load()) {
+            LOGI("ℹ️ 录制器未激活，无需停止");
+            return true;
+    }
+    
         recording_active.store(false);
         
-        // 关闭视频编码器
-        if (video_encoder_ctx) {
-            avcodec_free_context(&video_encoder_ctx);
-            video_encoder_ctx = nullptr;
-        }
-        
-        // 关闭音频编码器
-        if (audio_encoder_ctx) {
-            avcodec_free_context(&audio_encoder_ctx);
-            audio_encoder_ctx = nullptr;
-        }
+        // 排空流水线（编码线程负责冲刷视频编码器），再刷新音频编码器
+        stopPipeline();
+        flushEncoders();
         
-        // 关闭输出上下文
+        // 写入MP4文件尾部
         if (output_ctx) {
-            // 关闭输出文件
-            if (!(output_ctx->oformat->flags & AVFMT_NOFILE) && output_ctx->pb) {
-                avio_closep(&output_ctx->pb);
+            int ret = av_write_trailer(output_ctx);
+            if (ret < 0) {
+                LOGE("❌ 写入MP4尾部失败: %d", ret);
+            } else {
+                LOGI("✅ MP4尾部写入成功");
             }
-            avformat_free_context(output_ctx);
-            output_ctx = nullptr;
         }
+        index_writer.finish();
         
-        // 重置流指针
-        video_stream = nullptr;
-        audio_stream = nullptr;
+        // 输出最终统计
+        int64_t current_time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        int64_t duration_us = current_time_us - start_time_us;
+        double duration_sec = duration_us / 1000000.0;
+        double file_size_mb = bytes_written.load() / 1024.0 / 1024.0;
         
-        // 重置统计数据
-        video_frame_count = 0;
-        audio_frame_count = 0;
-        total_video_frames = 0;
-        total_audio_frames = 0;
-        bytes_written = 0;
-        start_time_us = AV_NOPTS_VALUE;
+        LOGI("📊 录制完成统计:");
+        LOGI("   📁 文件: %s", output_path.c_str());
+        LOGI("   ⏱️ 时长: %.2f秒", duration_sec);
+        LOGI("   🎬 视频帧: %ld帧 (%.1ffps)", (long)total_video_frames.load(), total_video_frames.load() / duration_sec);
+        LOGI("   🎵 音频帧: %ld帧", (long)total_audio_frames.load());
+        LOGI("   💾 文件大小: %.2fMB", file_size_mb);
+        if (!stream_copy_mode) {
+            LOGI("   ⚙️ 流水线: 编码%ld帧 (%.1ffps), 丢弃%ld帧", (long)encoded_frames.load(),
+                 duration_sec > 0 ? encoded_frames.load() / duration_sec : 0.0, (long)dropped_frames.load());
+        }
         
-        LOGI("✅ 录制器资源清理完成");
+        return true;
     }
-};
-
-// 全局录制器实例
-static ModernRecorder* g_recorder = nullptr;
-static std::mutex g_recorder_mutex;
-#endif
-
-// ============================================================================
-// 超低延迟播放核心模块 - 独立封装，不允许外部修改
-// ============================================================================
-#if FFMPEG_FOUND
-class UltraLowLatencyPlayer {
-private:
-    // 核心播放状态
-    AVFormatContext* input_ctx;
-    AVCodecContext* decoder_ctx;
-    AVFrame* decode_frame;
-    int video_stream_index;
-    
-    // 延迟控制参数
-    static const int MAX_FRAME_BUFFER = 1;      // 最大帧缓冲：1帧
-    static const int EMERGENCY_DROP_THRESHOLD = 2; // 紧急丢帧阈值
-    static const int MAX_DECODE_TIME_MS = 33;   // 最大解码时间：33ms(30fps)
     
-    // 性能监控
-    std::chrono::steady_clock::time_point last_frame_time;
-    int consecutive_slow_frames;
-    int total_dropped_frames;
-    
-    // 缓冲区控制
-    int pending_frames_count;
-    std::chrono::steady_clock::time_point last_drop_time;
-    
-    // 硬件解码状态
-    bool hardware_decode_available;
-    
-    // 录制专用帧缓存
-    AVFrame* record_frame;
-    std::mutex record_frame_mutex;
-    std::chrono::steady_clock::time_point last_record_frame_time;
-    
-public:
-    UltraLowLatencyPlayer() : 
-        input_ctx(nullptr), decoder_ctx(nullptr), 
-        decode_frame(nullptr), video_stream_index(-1),
-        consecutive_slow_frames(0), total_dropped_frames(0),
-        pending_frames_count(0), hardware_decode_available(false),
-        record_frame(nullptr) {
-        
-        last_frame_time = std::chrono::steady_clock::now();
-        last_drop_time = std::chrono::steady_clock::now();
-        last_record_frame_time = std::chrono::steady_clock::now();
+    bool isActive() const {
+        return recording_active.load();
     }
     
-    ~UltraLowLatencyPlayer() {
-        cleanup();
+private:
+    // 初始化MP4输出上下文
+    bool initializeOutputContext() {
+        const AVOutputFormat* fmt = av_guess_format("mp4", output_path.c_str(), nullptr);
+                if (!fmt) {
+            LOGE("❌ 找不到MP4格式");
+                    return false;
+                }
+        
+        int ret = avformat_alloc_output_context2(&output_ctx, fmt, nullptr, output_path.c_str());
+        if (ret < 0) {
+            LOGE("❌ 创建输出上下文失败: %d", ret);
+            return false;
+        }
+        
+        LOGI("✅ MP4输出上下文创建成功");
+        return true;
     }
     
-    // 初始化播放器 - 超低延迟配置
-    bool initialize(const char* rtsp_url) {
-        LOGI("🚀 初始化超低延迟播放器: %s", rtsp_url);
+    // MediaCodec兼容性检测和自动配置
+    bool autoConfigureMediaCodec(AVCodecContext* ctx, int width, int height) {
+        LOGI("🔧 自动配置MediaCodec参数");
         
-        // 创建输入上下文
-        input_ctx = avformat_alloc_context();
-        if (!input_ctx) {
-            LOGE("❌ 分配输入上下文失败");
-            return false;
+        // 检查分辨率兼容性
+        if (width % 16 != 0 || height % 16 != 0) {
+            LOGW("⚠️ 分辨率不是16的倍数(%dx%d)，MediaCodec可能不支持", width, height);
+            // 调整到16的倍数
+            int aligned_width = (width + 15) & ~15;
+            int aligned_height = (height + 15) & ~15;
+            if (aligned_width != width || aligned_height != height) {
+                LOGI("🔧 调整分辨率: %dx%d -> %dx%d", width, height, aligned_width, aligned_height);
+                ctx->width = aligned_width;
+                ctx->height = aligned_height;
+            }
         }
         
-        // 激进的超低延迟配置
-        AVDictionary *options = nullptr;
-        av_dict_set(&options, "rtsp_transport", "tcp", 0);
-        av_dict_set(&options, "stimeout", "1000000", 0);        // 1秒超时
-        av_dict_set(&options, "max_delay", "0", 0);             // 零延迟（激进）
-        av_dict_set(&options, "buffer_size", "32768", 0);       // 32KB最小缓冲
-        av_dict_set(&options, "fflags", "nobuffer+flush_packets+discardcorrupt", 0);
-        av_dict_set(&options, "flags", "low_delay", 0);
-        av_dict_set(&options, "probesize", "4096", 0);          // 4KB探测
-        av_dict_set(&options, "analyzeduration", "10000", 0);   // 10ms分析
-        av_dict_set(&options, "reorder_queue_size", "0", 0);    // 禁用重排序
+        // 设置兼容性最高的参数组合
+        applyMediaCodecEncoderOptions(ctx);
         
-        int ret = avformat_open_input(&input_ctx, rtsp_url, nullptr, &options);
-        av_dict_free(&options);
+        LOGI("🔧 MediaCodec自动配置完成");
+        return true;
+    }
+    
+    // 创建视频流 - 编码器选择查能力缓存，编码器只枚举一次，每次录制只打开一次
+    bool createVideoStream(int width, int height, AVRational framerate) {
+        EncoderCapabilityCache& caps = EncoderCapabilityCache::getInstance();
+        EncoderCapabilityCache::Selection selection;
+        int ret = -1;
         
+        // 每次录制只打开一次编码器；打开失败的组合记入缓存后换下一个，组合有限所以循环必然结束
+        while (ret < 0) {
+            if (!caps.select(use_hardware_encoding, width, height, profile.pix_fmt, selection)) {
+                LOGE("❌ 找不到任何兼容的编码器");
+                return false;
+            }
+            use_hardware_encoding = selection.hardware;
+            LOGI("✅ 选择编码器: %s (%s, %s)", selection.codec->name,
+                 selection.hardware ? "硬件" : "软件", av_get_pix_fmt_name(selection.pix_fmt));
+            
+            video_encoder_ctx = avcodec_alloc_context3(selection.codec);
+            if (!video_encoder_ctx) {
+                LOGE("❌ 分配视频编码器上下文失败");
+                return false;
+            }
+            
+            // 设置编码参数
+            video_encoder_ctx->width = width;
+            video_encoder_ctx->height = height;
+            // 使用源流时间基准，保留真实帧间隔以便与直通音频对齐
+            bool has_source_tb = profile.time_base.num > 0 && profile.time_base.den > 0;
+            video_encoder_ctx->time_base = has_source_tb ? profile.time_base : av_inv_q(framerate);
+            video_encoder_ctx->framerate = framerate;
+            video_encoder_ctx->pix_fmt = selection.pix_fmt;
+            applyProfileToEncoder(video_encoder_ctx);
+            
+            // 编码器优化设置
+            if (selection.hardware) {
+                autoConfigureMediaCodec(video_encoder_ctx, width, height);
+            }
+            EncoderConfig config = resolveEncoderConfig(selection.codec, width, height, framerate);
+            applyEncoderConfig(video_encoder_ctx, config, selection.hardware);
+            
+            // 软件编码器启用帧级多线程：编码已与播放线程解耦，多出的几帧编码延迟只影响录制
+            if (!selection.hardware &&
+                (selection.codec->capabilities & (AV_CODEC_CAP_FRAME_THREADS | AV_CODEC_CAP_OTHER_THREADS))) {
+                video_encoder_ctx->thread_count = encoder_threads;
+                video_encoder_ctx->thread_type = FF_THREAD_FRAME;
+            }
+            
+            // 全局头部
+            if (output_ctx->oformat->flags & AVFMT_GLOBALHEADER) {
+                video_encoder_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+            }
+            
+            int64_t open_begin_us = av_gettime_relative();
+            ret = avcodec_open2(video_encoder_ctx, selection.codec, nullptr);
+            if (ret >= 0) {
+                caps.markOpened(selection.codec, width, height, selection.pix_fmt,
+                                av_gettime_relative() - open_begin_us);
+            } else {
+                char error_buf[256];
+                av_strerror(ret, error_buf, sizeof(error_buf));
+                LOGE("❌ 打开视频编码器失败: %s ret=%d, error=%s", selection.codec->name, ret, error_buf);
+                caps.markFailed(selection.codec, width, height, selection.pix_fmt);
+                avcodec_free_context(&video_encoder_ctx);
+            }
+        }
         if (ret < 0) {
-            LOGE("❌ 打开RTSP流失败: %d", ret);
-            cleanup();
             return false;
         }
         
-        // 快速获取流信息
-        ret = avformat_find_stream_info(input_ctx, nullptr);
+        // 创建视频流
+        video_stream = avformat_new_stream(output_ctx, nullptr);
+        if (!video_stream) {
+            LOGE("❌ 创建视频流失败");
+            return false;
+        }
+        
+        // 复制参数到流
+        ret = avcodec_parameters_from_context(video_stream->codecpar, video_encoder_ctx);
         if (ret < 0) {
-            LOGE("❌ 获取流信息失败: %d", ret);
-            cleanup();
+            LOGE("❌ 复制视频编码器参数失败: %d", ret);
             return false;
         }
         
-        // 查找视频流
-        video_stream_index = -1;
-        for (unsigned int i = 0; i < input_ctx->nb_streams; i++) {
-            if (input_ctx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-                video_stream_index = i;
-                break;
-            }
+        video_stream->time_base = video_encoder_ctx->time_base;
+        video_stream->sample_aspect_ratio = video_encoder_ctx->sample_aspect_ratio;
+        video_time_base = video_encoder_ctx->time_base;
+        
+        LOGI("✅ 视频流创建成功: %dx%d@%d/%dfps, 编码格式=%s", video_encoder_ctx->width, video_encoder_ctx->height,
+             framerate.num, framerate.den, av_get_pix_fmt_name(video_encoder_ctx->pix_fmt));
+        return true;
+    }
+    
+    // 填充默认值并按编码器能力校验，不支持的选项降级并记录日志
+    EncoderConfig resolveEncoderConfig(const AVCodec* codec, int width, int height, AVRational framerate) {
+        EncoderCapabilityCache& caps = EncoderCapabilityCache::getInstance();
+        EncoderConfig config = encoder_config;
+        config.fillDefaults(width, height, encoderFrameRate(framerate));
+        
+        if (config.rate_control == RATE_CONTROL_CRF && !caps.hasOption(codec, "crf")) {
+            LOGW("⚠️ %s不支持CRF，改用VBR %ldbps", codec->name, (long)config.bitrate);
+            config.rate_control = RATE_CONTROL_VBR;
+        }
+        if (config.intra_refresh && !caps.hasOption(codec, "intra-refresh")) {
+            LOGW("⚠️ %s不支持intra-refresh，使用周期IDR", codec->name);
+            config.intra_refresh = false;
+        }
+        if (config.crf > 51) {
+            config.crf = 51;
+        }
+        if (config.slices > 32) {
+            config.slices = 32;
+        }
+        if (config.gop_length > 10 * std::max(1, framerate.num / std::max(1, framerate.den))) {
+            LOGW("⚠️ GOP %d帧过长，录制文件起播和拖动将变慢", config.gop_length);
         }
         
-        if (video_stream_index == -1) {
-            LOGE("❌ 未找到视频流");
-            cleanup();
+        LOGI("🎛️ 编码配置: %s %s %ldbps CRF=%d GOP=%d intra-refresh=%s slices=%d preset=%s level=%s",
+             codec->name, rateControlName(config.rate_control), (long)config.bitrate, config.crf,
+             config.gop_length, config.intra_refresh ? "是" : "否", config.slices,
+             caps.hasOption(codec, "preset") ? config.preset.c_str() : "-",
+             selectH264Level(width, height, encoderFrameRate(framerate), encoderPeakBitrate(config)).name);
+        return config;
+    }
+    
+    // 创建音频直通流 - 不解码不编码，直接复制源音频数据包
+    bool createAudioPassthroughStream() {
+        if (!audio_source_par) {
             return false;
         }
-        
-        // 初始化解码器
-        if (!initializeDecoder()) {
-            cleanup();
+        if (avformat_query_codec(output_ctx->oformat, audio_source_par->codec_id, FF_COMPLIANCE_NORMAL) != 1) {
+            LOGW("⚠️ MP4不支持音频编码%s，录制不含音频", avcodec_get_name(audio_source_par->codec_id));
             return false;
         }
         
-        // 应用激进的低延迟设置
-        input_ctx->flags |= AVFMT_FLAG_NOBUFFER;
-        input_ctx->flags |= AVFMT_FLAG_FLUSH_PACKETS;
-        input_ctx->max_delay = 0;  // 零延迟
-        
-        // 分配解码帧
-        decode_frame = av_frame_alloc();
-        if (!decode_frame) {
-            LOGE("❌ 分配解码帧失败");
-            cleanup();
+        audio_stream = avformat_new_stream(output_ctx, nullptr);
+        if (!audio_stream || avcodec_parameters_copy(audio_stream->codecpar, audio_source_par) < 0) {
+            LOGE("❌ 创建音频流失败");
             return false;
         }
-        
-        LOGI("✅ 超低延迟播放器初始化成功");
+        audio_stream->codecpar->codec_tag = 0;
+        audio_stream->time_base = audio_time_base;
+        LOGI("✅ 音频直通流: %s %dHz %d声道", avcodec_get_name(audio_source_par->codec_id),
+             audio_source_par->sample_rate, audio_source_par->ch_layout.nb_channels);
         return true;
     }
     
-    // 处理一帧 - 核心播放逻辑
-    bool processFrame() {
-        if (!input_ctx || !decoder_ctx || !decode_frame) {
-            static int init_check_count = 0;
-            if (init_check_count++ % 10 == 0) {
-                LOGE("❌ 播放器组件未初始化: input_ctx=%p, decoder_ctx=%p, decode_frame=%p", 
-                     input_ctx, decoder_ctx, decode_frame);
+    // 将源流的宽高比和颜色属性写入编码器，避免录制文件颜色/比例失真
+    void applyProfileToEncoder(AVCodecContext* ctx) {
+        if (profile.sample_aspect_ratio.num > 0 && profile.sample_aspect_ratio.den > 0) {
+            ctx->sample_aspect_ratio = profile.sample_aspect_ratio;
+        }
+        ctx->color_range = profile.color_range;
+        ctx->colorspace = profile.color_space;
+        ctx->color_primaries = profile.color_primaries;
+        ctx->color_trc = profile.color_trc;
+    }
+    
+    // 打开输出文件并写入头部
+    bool openOutputFile() {
+        // 打开输出文件
+        if (!(output_ctx->oformat->flags & AVFMT_NOFILE)) {
+            int ret = avio_open(&output_ctx->pb, output_path.c_str(), AVIO_FLAG_WRITE);
+            if (ret < 0) {
+                LOGE("❌ 打开输出文件失败: %d", ret);
+                return false;
             }
-            return false;
         }
         
-        auto frame_start = std::chrono::steady_clock::now();
-        
-        // 读取数据包
-        AVPacket *pkt = av_packet_alloc();
-        if (!pkt) {
-            LOGE("❌ 分配数据包失败");
+        // 写入文件头
+        int ret = avformat_write_header(output_ctx, nullptr);
+        if (ret < 0) {
+            LOGE("❌ 写入MP4头部失败: %d", ret);
             return false;
         }
         
-        int ret = av_read_frame(input_ctx, pkt);
-        if (ret < 0) {
-            av_packet_free(&pkt);
-            if (ret == AVERROR(EAGAIN)) {
-                return true; // 暂时没有数据，继续尝试
-            }
+        // 封装器可能在写头部时调整时间基准，索引使用调整后的值
+        if (video_stream) {
+            index_writer.open(output_path, video_stream->time_base.num, video_stream->time_base.den);
+        }
+        
+        LOGI("✅ 输出文件打开成功: %s", output_path.c_str());
+        return true;
+    }
+    
+    // 刷新编码器缓冲区（视频编码器由流水线编码线程在输入结束时冲刷）
+    void flushEncoders() {
+        // 刷新音频编码器
+        if (audio_encoder_ctx) {
+            avcodec_send_frame(audio_encoder_ctx, nullptr);
             
-            // 详细的错误分析
-            static int read_error_count = 0;
-            if (read_error_count++ % 5 == 0) {
-                char error_buf[256];
-                av_strerror(ret, error_buf, sizeof(error_buf));
-                LOGE("❌ 读取帧失败 (第%d次): ret=%d, error=%s", read_error_count, ret, error_buf);
-                
-                if (ret == AVERROR_EOF) {
-                    LOGE("   - 流已结束 (EOF)");
-                } else if (ret == AVERROR(ECONNRESET)) {
-                    LOGE("   - 网络连接重置");
-                } else if (ret == AVERROR(ETIMEDOUT)) {
-                    LOGE("   - 网络超时");
+            AVPacket* pkt = av_packet_alloc();
+            if (pkt) {
+                int ret;
+                while ((ret = avcodec_receive_packet(audio_encoder_ctx, pkt)) >= 0) {
+                    pkt->stream_index = audio_stream->index;
+                    av_packet_rescale_ts(pkt, audio_encoder_ctx->time_base, audio_stream->time_base);
+                    std::lock_guard<std::mutex> mux_lock(mux_mutex);
+                    av_interleaved_write_frame(output_ctx, pkt);
+                    av_packet_unref(pkt);
                 }
+                av_packet_free(&pkt);
+    }
+        }
+    }
+    
+    // 由源时间戳计算编码时间戳，保证单调递增；源帧没有时间戳时按标称帧率递推
+    int64_t nextVideoPts(const AVFrame* frame) {
+        AVRational enc_tb = video_encoder_ctx->time_base;
+        int64_t src_pts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+        int64_t pts;
+        
+        if (src_pts != AV_NOPTS_VALUE && profile.time_base.num > 0 && profile.time_base.den > 0) {
+            int64_t src_us = av_rescale_q(src_pts, profile.time_base, AV_TIME_BASE_Q);
+            if (video_origin_us == AV_NOPTS_VALUE) {
+                video_origin_us = src_us;
             }
-            
-            return false;
+            pts = av_rescale_q(src_us - video_origin_us, AV_TIME_BASE_Q, enc_tb);
+        } else if (last_video_pts != AV_NOPTS_VALUE) {
+            pts = last_video_pts + std::max<int64_t>(1, av_rescale_q(1, av_inv_q(video_encoder_ctx->framerate), enc_tb));
+        } else {
+            pts = 0;
         }
         
-        // 记录第一次成功读取数据包
-        static bool first_packet_read = false;
-        if (!first_packet_read) {
-            LOGI("✅ 第一次成功读取数据包: stream_index=%d, size=%d, pts=%ld", 
-                 pkt->stream_index, pkt->size, (long)pkt->pts);
-            first_packet_read = true;
+        if (last_video_pts != AV_NOPTS_VALUE && pts <= last_video_pts) {
+            pts = last_video_pts + 1;
         }
-        
-        // 只处理视频帧
-        if (pkt->stream_index != video_stream_index) {
-            av_packet_free(&pkt);
-            return true;
+        last_video_pts = pts;
+        return pts;
+    }
+    
+    // 启动流水线线程（调用方已持有record_mutex）
+    void startPipeline() {
+        convert_queue.reopen();
+        encode_queue.reopen();
+        mux_queue.reopen();
+        dropped_frames.store(0);
+        encoded_frames.store(0);
+        convert_thread = std::thread(&ModernRecorder::convertLoop, this);
+        encode_thread = std::thread(&ModernRecorder::encodeLoop, this);
+        mux_thread = std::thread(&ModernRecorder::muxLoop, this);
+        LOGI("🧵 录制流水线已启动: 转换 -> 编码 -> 封装");
+    }
+    
+    // 关闭输入并按阶段顺序等待排空，每个阶段退出前关闭下游队列
+    void stopPipeline() {
+        convert_queue.close();
+        if (convert_thread.joinable()) {
+            convert_thread.join();
         }
-        
-        // 临时禁用数据包录制以避免死锁
-        // TODO: 需要重新设计录制架构来避免锁冲突
-        
-        // 发送到解码器
-        ret = avcodec_send_packet(decoder_ctx, pkt);
-        
-        // 记录第一次发送数据包的结果
-        static bool first_send_logged = false;
-        if (!first_send_logged) {
-            if (ret >= 0) {
-                LOGI("✅ 第一次发送数据包成功: ret=%d", ret);
-            } else {
-                char error_buf[256];
-                av_strerror(ret, error_buf, sizeof(error_buf));
-                LOGE("❌ 第一次发送数据包失败: ret=%d, error=%s", ret, error_buf);
-            }
-            first_send_logged = true;
+        if (encode_thread.joinable()) {
+            encode_thread.join();
         }
-        
-        av_packet_free(&pkt);
-        
-        if (ret < 0 && ret != AVERROR(EAGAIN)) {
-            static int send_error_count = 0;
-            if (send_error_count++ % 5 == 0) {
-                char error_buf[256];
-                av_strerror(ret, error_buf, sizeof(error_buf));
-                LOGE("❌ 发送数据包失败 (第%d次): ret=%d, error=%s", send_error_count, ret, error_buf);
-            }
-            return false;
+        if (mux_thread.joinable()) {
+            mux_thread.join();
         }
-        
-        // 接收解码帧 - 智能帧管理
-        bool frame_received = false;
-        int frames_received_this_call = 0;
-        bool has_valid_frame = false;
-        
-        // 接收第一个可用帧
-        ret = avcodec_receive_frame(decoder_ctx, decode_frame);
-        
-        // 记录第一次接收帧的尝试
-        static bool first_receive_logged = false;
-        if (!first_receive_logged) {
-            if (ret == AVERROR(EAGAIN)) {
-                LOGI("ℹ️ 第一次接收帧: 需要更多数据包 (EAGAIN)");
-            } else if (ret >= 0) {
-                LOGI("✅ 第一次接收帧成功: ret=%d", ret);
-            } else {
-                char error_buf[256];
-                av_strerror(ret, error_buf, sizeof(error_buf));
-                LOGE("❌ 第一次接收帧失败: ret=%d, error=%s", ret, error_buf);
-            }
-            first_receive_logged = true;
-        }
-        
-        if (ret == AVERROR(EAGAIN)) {
-            // 没有帧可接收，这是正常的
-        } else if (ret < 0) {
-            static int receive_error_count = 0;
-            if (receive_error_count++ % 5 == 0) {
-                char error_buf[256];
-                av_strerror(ret, error_buf, sizeof(error_buf));
-                LOGE("❌ 接收帧失败 (第%d次): ret=%d, error=%s", receive_error_count, ret, error_buf);
-            }
-            return false;
+    }
+    
+    // 转换阶段：尺寸和格式一致时直接引用，否则缩放/颜色转换
+    // 未设置策略时只命名线程，不改变继承来的调度
+    void applyRecorderThreadPolicy(const char* name) {
+        if (has_thread_policy) {
+            applyThreadPolicy(name, thread_policy);
         } else {
-            // 成功接收到第一帧
-            frames_received_this_call++;
-            frame_received = true;
-            
-            // 检查帧是否有效
-            if (decode_frame->width > 0 && decode_frame->height > 0 && 
-                (decode_frame->data[0] || decode_frame->data[1] || decode_frame->data[3])) {
-                has_valid_frame = true;
-                
-                // 记录第一次成功接收帧
-                static bool first_frame_received = false;
-                if (!first_frame_received) {
-                    LOGI("✅ 第一次成功接收解码帧: %dx%d, format=%d, data[0]=%p", 
-                         decode_frame->width, decode_frame->height, decode_frame->format, decode_frame->data[0]);
-                    first_frame_received = true;
-                }
-            }
-            
-            // 继续接收剩余帧以清空缓冲区，但不覆盖有效帧
-            AVFrame* temp_frame = av_frame_alloc();
-            if (temp_frame) {
-                while (true) {
-                    ret = avcodec_receive_frame(decoder_ctx, temp_frame);
-                    if (ret == AVERROR(EAGAIN) || ret < 0) {
-                        break; // 没有更多帧或出错
-                    }
-                    
-                    frames_received_this_call++;
-                    total_dropped_frames++;
-                    
-                            // 每丢弃50帧输出一次日志（减少日志频率）
-        if (total_dropped_frames % 50 == 0) {
-            LOGD("🗑️ 丢弃旧帧以保持超低延迟 (累计丢弃: %d)", total_dropped_frames);
+            pthread_setname_np(pthread_self(), name);
         }
+    }
+    
+    void convertLoop() {
+        applyRecorderThreadPolicy("rec-convert");
+        PendingFrame pending;
+        while (convert_queue.pop(pending)) {
+            AVFrame* frame = pending.frame;
+            AVFrame* encode_frame = av_frame_alloc();
+            bool ok = encode_frame != nullptr;
+            
+            if (ok && frame->width == video_encoder_ctx->width &&
+                frame->height == video_encoder_ctx->height &&
+                frame->format == pending.layout &&
+                pending.layout == video_encoder_ctx->pix_fmt) {
+                // 快速路径：不缩放不转换
+                ok = av_frame_ref(encode_frame, frame) >= 0;
+                if (ok) {
+                    encode_frame->pict_type = AV_PICTURE_TYPE_NONE;
                 }
-                av_frame_free(&temp_frame);
+            } else if (ok) {
+                ok = prepareConvertedFrame(frame, pending.layout, encode_frame);
             }
-        }
-        
-        // 性能统计（减少日志输出）
-        if (frame_received) {
-            static int frame_count = 0;
-            frame_count++;
-            // 只在关键节点输出日志
-            if (frame_count <= 3 || frame_count % 100 == 0) {
-                LOGD("🎯 processFrame #%d: 接收%d帧, 有效帧=%s, 尺寸=%dx%d", 
-                     frame_count, frames_received_this_call, has_valid_frame ? "是" : "否",
-                     decode_frame->width, decode_frame->height);
+            if (ok) {
+                encode_frame->pts = pending.pts;
+                video_frame_count++;
             }
+            av_frame_free(&frame);
             
-            // 更新录制帧 - 仅在有有效帧时更新
-            if (has_valid_frame) {
-                updateRecordFrame();
-            }
-        }
-        
-        // 检查解码性能
-        auto frame_end = std::chrono::steady_clock::now();
-        auto decode_time = std::chrono::duration_cast<std::chrono::milliseconds>(
-            frame_end - frame_start).count();
-        
-        if (decode_time > MAX_DECODE_TIME_MS) {
-            consecutive_slow_frames++;
-            if (consecutive_slow_frames > 3) {
-                LOGW("⚠️ 连续慢解码，考虑降低质量或跳帧");
+            if (!ok || !encode_queue.push(encode_frame)) {
+                av_frame_free(&encode_frame);
             }
-        } else {
-            consecutive_slow_frames = 0;
-        }
-        
-        // 更新时间戳
-        last_frame_time = frame_end;
-        
-        // 性能监控和统计
-        static bool first_process_result_logged = false;
-        static int total_processed_frames = 0;
-        
-        if (!first_process_result_logged) {
-            LOGI("📊 第一次processFrame完成: frame_received=%s, frames_received=%d, decode_time=%lldms", 
-                 frame_received ? "true" : "false", frames_received_this_call, decode_time);
-            first_process_result_logged = true;
         }
-        
-        // 每处理100帧输出一次性能统计
-        if (frame_received) {
-            total_processed_frames++;
-            if (total_processed_frames % 100 == 0) {
-                float drop_rate = (float)total_dropped_frames / total_processed_frames * 100;
-                LOGI("📊 播放统计: 已处理%d帧, 丢弃%d帧(%.1f%%), 慢解码%d次", 
-                     total_processed_frames, total_dropped_frames, drop_rate, consecutive_slow_frames);
+        encode_queue.close();
+    }
+    
+    // 编码阶段：送帧并取出所有可用数据包，输入结束时冲刷编码器
+    void encodeLoop() {
+        applyRecorderThreadPolicy("rec-encode");
+        AVPacket* pkt = av_packet_alloc();
+        AVFrame* frame = nullptr;
+        while (encode_queue.pop(frame)) {
+            TRACE_SCOPE("encode");
+            int ret = avcodec_send_frame(video_encoder_ctx, frame);
+            av_frame_free(&frame);
+            if (ret < 0) {
+                LOGE("❌ 发送帧到编码器失败: %d", ret);
+                continue;
             }
+            encoded_frames++;
+            drainEncoder(pkt);
         }
         
-        // 关键修复：即使没有接收到帧，只要成功读取了数据包就返回true
-        // 这对于需要多个数据包才能产生帧的编码格式（如HEVC）是正常的
-        return true;
+        avcodec_send_frame(video_encoder_ctx, nullptr);
+        drainEncoder(pkt);
+        av_packet_free(&pkt);
+        mux_queue.close();
     }
     
-    // 获取当前解码帧 - 只有在真正有有效帧时才返回
-    AVFrame* getCurrentFrame() {
-        // 性能优化：减少调试日志
-        static int call_count = 0;
-        call_count++;
-        
-        // 检查decode_frame是否存在
-        if (!decode_frame) {
-            return nullptr;
-        }
-        
-        // 检查基本尺寸
-        if (decode_frame->width <= 0 || decode_frame->height <= 0) {
-            return nullptr;
+    void drainEncoder(AVPacket* pkt) {
+        if (!pkt) {
+            return;
         }
-        
-        // 对于MediaCodec硬件解码（format=23）
-        if (decode_frame->format == 23) {
-            bool has_data = decode_frame->data[0] || decode_frame->data[1] || decode_frame->data[3];
+        while (avcodec_receive_packet(video_encoder_ctx, pkt) >= 0) {
+            pkt->stream_index = video_stream->index;
+            av_packet_rescale_ts(pkt, video_encoder_ctx->time_base, video_stream->time_base);
             
-            // 只在关键时刻输出日志
-            static bool first_mediacodec_logged = false;
-            if (!first_mediacodec_logged && has_data) {
-                LOGI("🔍 MediaCodec帧验证成功: %dx%d, format=%d", 
-                     decode_frame->width, decode_frame->height, decode_frame->format);
-                first_mediacodec_logged = true;
+            AVPacket* out = av_packet_alloc();
+            if (!out) {
+                av_packet_unref(pkt);
+                continue;
             }
-            
-            return has_data ? decode_frame : nullptr;
-        } else {
-            // 普通格式，必须有data[0]
-            bool has_data = decode_frame->data[0] != nullptr;
-            
-            // 只在第一次成功时输出日志
-            static bool first_software_logged = false;
-            if (!first_software_logged && has_data) {
-                LOGI("🔍 软件解码帧验证成功: %dx%d, format=%d", 
-                     decode_frame->width, decode_frame->height, decode_frame->format);
-                first_software_logged = true;
+            av_packet_move_ref(out, pkt);
+            if (!mux_queue.push(out)) {
+                av_packet_free(&out);
             }
-            
-            return has_data ? decode_frame : nullptr;
         }
     }
     
-    // 获取录制专用帧 - 确保录制时有稳定的帧数据
-    AVFrame* getRecordFrame() {
-        std::lock_guard<std::mutex> lock(record_frame_mutex);
-        
-        if (record_frame) {
-            auto now = std::chrono::steady_clock::now();
-            auto frame_age = std::chrono::duration_cast<std::chrono::seconds>(
-                now - last_record_frame_time).count();
-            
-            if (frame_age > 3) {
-                av_frame_unref(record_frame);
-                av_frame_free(&record_frame);
-                record_frame = nullptr;
+    // 封装阶段：写入MP4
+    void muxLoop() {
+        applyRecorderThreadPolicy("rec-mux");
+        AVPacket* pkt = nullptr;
+        while (mux_queue.pop(pkt)) {
+            TRACE_SCOPE("mux_write");
+            int size = pkt->size;
+            std::lock_guard<std::mutex> mux_lock(mux_mutex);
+            index_writer.stage(pkt->pts, pkt->dts, pkt->size, (pkt->flags & AV_PKT_FLAG_KEY) != 0, AV_NOPTS_VALUE);
+            int ret = av_interleaved_write_frame(output_ctx, pkt);
+            av_packet_free(&pkt);
+            if (ret < 0) {
+                LOGE("❌ 写入视频数据包失败: %d", ret);
+                continue;
+            }
+            index_writer.commit();
+            bytes_written += size;
+            total_video_frames++;
+            if (!first_packet_written) {
+                first_packet_written = true;
+                LOGI("⏱️ 录制启动到首个编码包耗时: %.1fms",
+                     (av_gettime_relative() - start_request_us) / 1000.0);
             }
         }
-        
-        return record_frame;
     }
     
-    void updateRecordFrame() {
-        std::lock_guard<std::mutex> lock(record_frame_mutex);
-        
-        AVFrame* current = getCurrentFrame();
-        if (!current) {
-            return;
-        }
+    // 慢速路径：分配编码帧并执行缩放/颜色转换
+    bool prepareConvertedFrame(AVFrame* frame, AVPixelFormat layout, AVFrame* encode_frame) {
+        // 设置编码帧参数
+        encode_frame->format = video_encoder_ctx->pix_fmt;
+        encode_frame->width = video_encoder_ctx->width;
+        encode_frame->height = video_encoder_ctx->height;
         
-        if (!record_frame) {
-            record_frame = av_frame_alloc();
-            if (!record_frame) {
-                return;
-            }
-        } else {
-            av_frame_unref(record_frame);
+        // 分配帧缓冲区
+        int ret = av_frame_get_buffer(encode_frame, 32);
+        if (ret < 0) {
+            return false;
         }
         
-        if (av_frame_ref(record_frame, current) >= 0) {
-            last_record_frame_time = std::chrono::steady_clock::now();
-        } else {
-            av_frame_free(&record_frame);
-            record_frame = nullptr;
+        if (!convertFrameWithSws(frame, layout, encode_frame)) {
+            LOGE("❌ 颜色空间转换失败");
+            return false;
         }
+        return true;
     }
     
-    // 是否使用硬件解码
-    bool isHardwareDecoding() const {
-        return hardware_decode_available;
-    }
-    
-    // 获取性能统计
-    void getStats(int& dropped_frames, int& slow_frames) {
-        dropped_frames = total_dropped_frames;
-        slow_frames = consecutive_slow_frames;
-    }
-    
-    void flushBuffers() {
-        if (decoder_ctx) {
-            avcodec_flush_buffers(decoder_ctx);
+    // 专业的颜色空间转换 - 录制专用，修复绿色问题
+    bool convertFrameWithSws(AVFrame* src, AVPixelFormat src_format, AVFrame* dst) {
+        // 源格式来自流级别的像素格式描述，不再逐帧猜测
+        AVPixelFormat dst_format = (AVPixelFormat)dst->format;
+        
+        LOGD("🎨 录制颜色转换: %dx%d %s -> %dx%d %s", 
+             src->width, src->height, av_get_pix_fmt_name(src_format),
+             dst->width, dst->height, av_get_pix_fmt_name(dst_format));
+        
+        // 尺寸或格式不变时复用原上下文，变化时重建
+        SwsContext* previous = record_sws_ctx;
+        record_sws_ctx = sws_getCachedContext(record_sws_ctx,
+            src->width, src->height, src_format,
+            dst->width, dst->height, dst_format,
+            SWS_BILINEAR, nullptr, nullptr, nullptr);
+        if (!record_sws_ctx) {
+            LOGE("❌ 录制SwsContext创建失败: %s -> %s",
+                 av_get_pix_fmt_name(src_format), av_get_pix_fmt_name(dst_format));
+            return false;
         }
-        pending_frames_count = 0;
-        consecutive_slow_frames = 0;
-    }
-    
-    // 清理资源
-    void cleanup() {
-        // 清理录制帧
-        {
-            std::lock_guard<std::mutex> lock(record_frame_mutex);
-            if (record_frame) {
-                av_frame_free(&record_frame);
-                record_frame = nullptr;
-            }
+        if (record_sws_ctx != previous) {
+            LOGI("✅ 录制SwsContext创建成功: %s -> %s",
+                 av_get_pix_fmt_name(src_format), av_get_pix_fmt_name(dst_format));
         }
         
-        if (decode_frame) {
-            av_frame_free(&decode_frame);
-            decode_frame = nullptr;
+        // 执行颜色空间转换 - 增加数据验证
+        // 验证源数据指针
+        if (!src->data[0]) {
+            LOGE("❌ 录制源数据指针无效: data[0]=%p", src->data[0]);
+            return false;
         }
         
-        if (decoder_ctx) {
-            avcodec_free_context(&decoder_ctx);
-            decoder_ctx = nullptr;
+        // 验证目标数据指针
+        if (!dst->data[0]) {
+            LOGE("❌ 录制目标数据指针无效: data[0]=%p", dst->data[0]);
+            return false;
         }
         
-        if (input_ctx) {
-            avformat_close_input(&input_ctx);
-            input_ctx = nullptr;
+        // 验证数据尺寸
+        if (src->linesize[0] <= 0 || dst->linesize[0] <= 0) {
+            LOGE("❌ 录制数据步长无效: src=%d, dst=%d", src->linesize[0], dst->linesize[0]);
+            return false;
         }
         
-        video_stream_index = -1;
-        hardware_decode_available = false;
+        TRACE_SCOPE("record_convert");
+        int ret = sws_scale(record_sws_ctx, src->data, src->linesize, 0, src->height,
+                           dst->data, dst->linesize);
+        
+        if (ret > 0) {
+            LOGD("✅ 录制颜色转换成功: %d行", ret);
+            return true;
+        } else {
+            LOGE("❌ 录制sws_scale失败: ret=%d", ret);
+            LOGE("   源格式: %s, 尺寸: %dx%d, linesize: [%d,%d,%d]", 
+                 av_get_pix_fmt_name(src_format),
+                 src->width, src->height, src->linesize[0], src->linesize[1], src->linesize[2]);
+            LOGE("   目标格式: %s, 尺寸: %dx%d, linesize: [%d,%d,%d]", 
+                 av_get_pix_fmt_name(dst_format),
+                 dst->width, dst->height, dst->linesize[0], dst->linesize[1], dst->linesize[2]);
+            return false;
+        }
     }
     
-private:
-    // 初始化解码器
-    bool initializeDecoder() {
-        AVStream* video_stream = input_ctx->streams[video_stream_index];
-        AVCodecID codec_id = video_stream->codecpar->codec_id;
-        
-        const AVCodec *decoder = nullptr;
+    // 智能帧格式转换辅助函数 - 支持多种颜色格式
+    void convertFrame(AVFrame* src, AVFrame* dst) {
+        if (!src || !dst || !src->data[0]) {
+            LOGE("❌ convertFrame: 无效的输入参数");
+            return;
+        }
         
-        // 尝试硬件解码器
-        if (codec_id == AV_CODEC_ID_H264) {
-            decoder = avcodec_find_decoder_by_name("h264_mediacodec");
-            if (decoder) {
-                hardware_decode_available = true;
-                LOGI("✅ 使用H.264硬件解码器");
-            }
-        } else if (codec_id == AV_CODEC_ID_HEVC) {
-            decoder = avcodec_find_decoder_by_name("hevc_mediacodec");
-            if (decoder) {
-                hardware_decode_available = true;
-                LOGI("✅ 使用HEVC硬件解码器");
-            }
-        }
-        
-        // 回退到软件解码器
-        if (!decoder) {
-            decoder = avcodec_find_decoder(codec_id);
-            if (decoder) {
-                hardware_decode_available = false;
-                LOGI("✅ 使用软件解码器: %s", decoder->name);
-            } else {
-                LOGE("❌ 未找到解码器");
-                return false;
-            }
-        }
-        
-        // 分配解码器上下文
-        decoder_ctx = avcodec_alloc_context3(decoder);
-        if (!decoder_ctx) {
-            LOGE("❌ 分配解码器上下文失败");
-            return false;
-        }
-        
-        // 复制参数
-        int ret = avcodec_parameters_to_context(decoder_ctx, video_stream->codecpar);
-        if (ret < 0) {
-            LOGE("❌ 复制解码器参数失败: %d", ret);
-            return false;
-        }
-        
-        // 超低延迟配置
-        decoder_ctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
-        decoder_ctx->flags2 |= AV_CODEC_FLAG2_FAST;
-        decoder_ctx->thread_count = 1;              // 单线程避免重排序
-        decoder_ctx->thread_type = FF_THREAD_SLICE;
-        decoder_ctx->delay = 0;                     // 零延迟
-        decoder_ctx->has_b_frames = 0;              // 禁用B帧
-        decoder_ctx->max_b_frames = 0;
-        decoder_ctx->strict_std_compliance = FF_COMPLIANCE_UNOFFICIAL;
+        int src_width = src->width;
+        int src_height = src->height;
+        int dst_width = dst->width;
+        int dst_height = dst->height;
         
-        // 软件解码器额外优化
-        if (!hardware_decode_available) {
-            decoder_ctx->skip_frame = AVDISCARD_NONREF;
-            decoder_ctx->skip_idct = AVDISCARD_BIDIR;
-            decoder_ctx->skip_loop_filter = AVDISCARD_BIDIR;
-        }
+        LOGD("🔄 颜色转换: %dx%d (格式%d) -> %dx%d (格式%d)", 
+             src_width, src_height, src->format, dst_width, dst_height, dst->format);
         
-        // 对于硬件解码器，尝试设置Surface输出
-        AVDictionary* opts = nullptr;
-        if (hardware_decode_available) {
-            // 设置MediaCodec为Surface模式（如果有Surface可用）
-            // 注意：这里我们先尝试buffer模式，稍后可以添加surface模式支持
-            LOGI("🔧 配置MediaCodec硬件解码器");
+        // 检测目标格式并进行相应转换
+        if (dst->format == AV_PIX_FMT_NV12) {
+            // 转换到NV12格式
+            convertToNV12(src, dst);
+        } else if (dst->format == AV_PIX_FMT_YUV420P) {
+            // 转换到YUV420P格式
+            convertToYUV420P(src, dst);
+        } else {
+            LOGE("❌ 不支持的目标格式: %d", dst->format);
+            // 回退到基本转换
+            convertToYUV420P(src, dst);
         }
+    }
+    
+private:
+    // 转换到NV12格式 (Y + UV交错)
+    void convertToNV12(AVFrame* src, AVFrame* dst) {
+        int src_width = src->width;
+        int src_height = src->height;
+        int dst_width = dst->width;
+        int dst_height = dst->height;
         
-        // 打开解码器
-        ret = avcodec_open2(decoder_ctx, decoder, &opts);
-        if (opts) {
-            av_dict_free(&opts);
+        // 1. 转换Y分量
+        for (int y = 0; y < dst_height; y++) {
+            int src_y = y * src_height / dst_height;
+            uint8_t* src_row = src->data[0] + src_y * src->linesize[0];
+            uint8_t* dst_row = dst->data[0] + y * dst->linesize[0];
+            
+            for (int x = 0; x < dst_width; x++) {
+                int src_x = x * src_width / dst_width;
+                dst_row[x] = src_row[src_x];
+            }
         }
         
-        if (ret < 0) {
-            char error_buf[256];
-            av_strerror(ret, error_buf, sizeof(error_buf));
-            LOGE("❌ 打开解码器失败: ret=%d, error=%s", ret, error_buf);
+        // 2. 转换UV分量 (NV12格式：UV交错存储在data[1])
+        int uv_dst_width = dst_width / 2;
+        int uv_dst_height = dst_height / 2;
             
-            // 如果硬件解码器失败，尝试软件解码器
-            if (hardware_decode_available) {
-                LOGW("🔄 硬件解码器失败，尝试软件解码器");
-                avcodec_free_context(&decoder_ctx);
+        if (src->data[1] && src->data[2]) {
+            // 源是YUV420P格式，需要将U和V交错存储
+            for (int y = 0; y < uv_dst_height; y++) {
+                int src_y = y * (src_height / 2) / uv_dst_height;
                 
-                // 获取软件解码器
-                decoder = avcodec_find_decoder(codec_id);
-                if (!decoder) {
-                    LOGE("❌ 未找到软件解码器");
-                    return false;
-                }
+                uint8_t* src_u_row = src->data[1] + src_y * src->linesize[1];
+                uint8_t* src_v_row = src->data[2] + src_y * src->linesize[2];
+                uint8_t* dst_uv_row = dst->data[1] + y * dst->linesize[1];
                 
-                // 重新分配解码器上下文
-                decoder_ctx = avcodec_alloc_context3(decoder);
-                if (!decoder_ctx) {
-                    LOGE("❌ 重新分配解码器上下文失败");
-                    return false;
+                for (int x = 0; x < uv_dst_width; x++) {
+                    int src_x = x * (src_width / 2) / uv_dst_width;
+                    dst_uv_row[x * 2] = src_u_row[src_x];     // U分量
+                    dst_uv_row[x * 2 + 1] = src_v_row[src_x]; // V分量
                 }
+            }
+        } else if (src->data[1]) {
+            // 源可能已经是NV12/NV21格式，直接复制UV数据
+            for (int y = 0; y < uv_dst_height; y++) {
+                int src_y = y * (src_height / 2) / uv_dst_height;
+                uint8_t* src_uv_row = src->data[1] + src_y * src->linesize[1];
+                uint8_t* dst_uv_row = dst->data[1] + y * dst->linesize[1];
                 
-                // 重新复制参数
-                ret = avcodec_parameters_to_context(decoder_ctx, video_stream->codecpar);
-                if (ret < 0) {
-                    LOGE("❌ 重新复制解码器参数失败: %d", ret);
-                    return false;
+                for (int x = 0; x < uv_dst_width; x++) {
+                    int src_x = x * (src_width / 2) / uv_dst_width;
+                    dst_uv_row[x * 2] = src_uv_row[src_x * 2];
+                    dst_uv_row[x * 2 + 1] = src_uv_row[src_x * 2 + 1];
+    }
+            }
+        } else {
+            // 生成默认的色度值 (128 = 中性灰色)
+            LOGW("⚠️ 源帧缺少色度信息，使用默认值");
+            for (int y = 0; y < uv_dst_height; y++) {
+                uint8_t* dst_uv_row = dst->data[1] + y * dst->linesize[1];
+                for (int x = 0; x < uv_dst_width; x++) {
+                    dst_uv_row[x * 2] = 128;     // U = 128
+                    dst_uv_row[x * 2 + 1] = 128; // V = 128
                 }
+            }
+        }
+        
+        LOGD("✅ NV12转换完成: Y=%d bytes, UV=%d bytes", 
+             dst->linesize[0] * dst_height, dst->linesize[1] * uv_dst_height);
+    }
+    
+        // 转换到YUV420P格式 (Y + U + V分离)
+    void convertToYUV420P(AVFrame* src, AVFrame* dst) {
+        int src_width = src->width;
+        int src_height = src->height;
+        int dst_width = dst->width;
+        int dst_height = dst->height;
+        
+        // 1. 转换Y分量
+        for (int y = 0; y < dst_height; y++) {
+            int src_y = y * src_height / dst_height;
+            uint8_t* src_row = src->data[0] + src_y * src->linesize[0];
+            uint8_t* dst_row = dst->data[0] + y * dst->linesize[0];
+            
+            for (int x = 0; x < dst_width; x++) {
+                int src_x = x * src_width / dst_width;
+                dst_row[x] = src_row[src_x];
+            }
+        }
+        
+        // 2. 转换UV分量
+        int uv_dst_width = dst_width / 2;
+        int uv_dst_height = dst_height / 2;
+        
+        if (src->data[1] && src->data[2]) {
+            // 源是YUV420P格式，直接复制
+            for (int y = 0; y < uv_dst_height; y++) {
+                int src_y = y * (src_height / 2) / uv_dst_height;
                 
-                // 软件解码器配置
-                decoder_ctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
-                decoder_ctx->flags2 |= AV_CODEC_FLAG2_FAST;
-                decoder_ctx->thread_count = 1;
-                decoder_ctx->thread_type = FF_THREAD_SLICE;
-                decoder_ctx->delay = 0;
-                decoder_ctx->has_b_frames = 0;
-                decoder_ctx->max_b_frames = 0;
-                decoder_ctx->strict_std_compliance = FF_COMPLIANCE_UNOFFICIAL;
-                decoder_ctx->skip_frame = AVDISCARD_NONREF;
-                decoder_ctx->skip_idct = AVDISCARD_BIDIR;
-                decoder_ctx->skip_loop_filter = AVDISCARD_BIDIR;
+                uint8_t* src_u_row = src->data[1] + src_y * src->linesize[1];
+                uint8_t* src_v_row = src->data[2] + src_y * src->linesize[2];
+                uint8_t* dst_u_row = dst->data[1] + y * dst->linesize[1];
+                uint8_t* dst_v_row = dst->data[2] + y * dst->linesize[2];
                 
-                // 尝试打开软件解码器
-                ret = avcodec_open2(decoder_ctx, decoder, nullptr);
-                if (ret < 0) {
-                    av_strerror(ret, error_buf, sizeof(error_buf));
-                    LOGE("❌ 软件解码器也失败: ret=%d, error=%s", ret, error_buf);
-                    return false;
+                for (int x = 0; x < uv_dst_width; x++) {
+                    int src_x = x * (src_width / 2) / uv_dst_width;
+                    dst_u_row[x] = src_u_row[src_x];
+                    dst_v_row[x] = src_v_row[src_x];
                 }
+            }
+        } else if (src->data[1]) {
+            // 源是NV12/NV21格式，需要分离UV
+            for (int y = 0; y < uv_dst_height; y++) {
+                int src_y = y * (src_height / 2) / uv_dst_height;
+                uint8_t* src_uv_row = src->data[1] + src_y * src->linesize[1];
+                uint8_t* dst_u_row = dst->data[1] + y * dst->linesize[1];
+                uint8_t* dst_v_row = dst->data[2] + y * dst->linesize[2];
                 
-                hardware_decode_available = false;
-                LOGI("✅ 使用软件解码器: %s", decoder->name);
-            } else {
-                return false;
+                for (int x = 0; x < uv_dst_width; x++) {
+                    int src_x = x * (src_width / 2) / uv_dst_width;
+                    dst_u_row[x] = src_uv_row[src_x * 2];     // U分量
+                    dst_v_row[x] = src_uv_row[src_x * 2 + 1]; // V分量
+                }
             }
+        } else {
+            // 生成默认的色度值
+            LOGW("⚠️ 源帧缺少色度信息，使用默认值");
+            memset(dst->data[1], 128, dst->linesize[1] * uv_dst_height);
+            memset(dst->data[2], 128, dst->linesize[2] * uv_dst_height);
         }
         
-        LOGI("✅ 解码器初始化成功 (硬件解码: %s)", hardware_decode_available ? "是" : "否");
-        return true;
+        LOGD("✅ YUV420P转换完成");
     }
-};
 
-// 全局播放器实例
-static UltraLowLatencyPlayer* g_player = nullptr;
-static std::mutex g_player_mutex;
-#endif
+public:
+    
 
-// ============================================================================
-// 渲染核心模块 - 独立封装
-// ============================================================================
-class UltraLowLatencyRenderer {
+    
+    // 清理所有资源
+    void cleanup() {
+        std::lock_guard<std::mutex> lock(record_mutex);
+        cleanupLocked();
+    }
+    
 private:
-    ANativeWindow* native_window;
-    SwsContext* sws_ctx;
-    std::mutex render_mutex;
+    // 清理资源（调用方已持有record_mutex）
+    void cleanupLocked() {
+        LOGI("🧹 清理录制器资源");
+        recording_active.store(false);
+        stopPipeline();
+        
+        // 关闭视频编码器
+        if (video_encoder_ctx) {
+            avcodec_free_context(&video_encoder_ctx);
+            video_encoder_ctx = nullptr;
+        }
+        
+        // 关闭音频编码器
+        if (audio_encoder_ctx) {
+            avcodec_free_context(&audio_encoder_ctx);
+            audio_encoder_ctx = nullptr;
+        }
+        
+        // 关闭输出上下文
+        if (output_ctx) {
+            // 关闭输出文件
+            if (!(output_ctx->oformat->flags & AVFMT_NOFILE) && output_ctx->pb) {
+                avio_closep(&output_ctx->pb);
+            }
+            avformat_free_context(output_ctx);
+            output_ctx = nullptr;
+        }
+        
+        // 重置流指针
+        video_stream = nullptr;
+        audio_stream = nullptr;
+        index_writer.finish();
+        
+        // 重置统计数据
+        video_frame_count = 0;
+        audio_frame_count = 0;
+        total_video_frames = 0;
+        total_audio_frames = 0;
+        bytes_written = 0;
+        start_time_us = AV_NOPTS_VALUE;
+        stream_copy_mode = false;
+        copy_ts_offset = AV_NOPTS_VALUE;
+        
+        LOGI("✅ 录制器资源清理完成");
+    }
+};
+
+// 全局录制器实例
+static ModernRecorder* g_recorder = nullptr;
+static std::mutex g_recorder_mutex;
+
+// 预录触发后的读取状态（受g_recorder_mutex保护）
+static std::shared_ptr<PacketRingBuffer> g_event_ring;
+static uint64_t g_event_cursor = 0;
+static std::vector<uint8_t> g_event_scratch;
+static AVPacket* g_event_packet = nullptr;
+
+// 将预录缓冲区中尚未写入的数据包交给录制器（调用方已持有g_recorder_mutex）
+static int drainPreEventRingLocked() {
+    if (!g_event_ring || !g_recorder || !g_event_packet) {
+        return 0;
+    }
+    
+    int written = 0;
+    while (g_event_ring->read(g_event_cursor, g_event_packet, g_event_scratch)) {
+        if (g_recorder->writePacket(g_event_packet)) {
+            written++;
+        }
+        // 数据属于scratch缓冲区，不需要unref
+        g_event_packet->data = nullptr;
+        g_event_packet->size = 0;
+    }
+    return written;
+}
+
+static void releasePreEventReaderLocked() {
+    g_event_ring.reset();
+    g_event_cursor = 0;
+    if (g_event_packet) {
+        g_event_packet->data = nullptr;
+        g_event_packet->size = 0;
+        av_packet_free(&g_event_packet);
+    }
+}
+#endif
+
+// ============================================================================
+// 读超时看门狗（stream_watchdog.h） - 通过AVIOInterruptCB和读包前检查限制建立连接、首帧和视频卡顿
+// ============================================================================
+// FFmpeg在网络等待循环中约每100ms调用一次interrupt_callback，返回非0即以AVERROR_EXIT退出。
+// 关闭流时先abort()，阻塞中的读包随即返回，不会一直占住g_player_mutex。
+#if FFMPEG_FOUND
+struct StreamDeadlines {
+    int connect_ms;         // 建立会话（含探测流信息/等待首个关键帧），每次传输尝试单独计时
+    int first_frame_ms;     // 建立后读到第一个视频包
+    int read_stall_ms;      // 之后相邻两个视频包的最大间隔（音频包不算）
+    
+    StreamDeadlines() : connect_ms(8000), first_frame_ms(5000), read_stall_ms(2000) {}
+};
+
+// 下次openRtspStream时生效，0表示不限时
+static std::mutex g_stream_deadlines_mutex;
+static StreamDeadlines g_stream_deadlines;
+
+static StreamDeadlines getStreamDeadlines() {
+    std::lock_guard<std::mutex> lock(g_stream_deadlines_mutex);
+    return g_stream_deadlines;
+}
+
+static AVIOInterruptCB watchdogInterruptCallback(StreamWatchdog* watchdog) {
+    AVIOInterruptCB cb = {StreamWatchdog::interruptCheck, watchdog};
+    return cb;
+}
+
+// 当前流的看门狗；关闭流时不经过g_player_mutex直接中止
+static std::mutex g_stream_watchdog_mutex;
+static std::shared_ptr<StreamWatchdog> g_stream_watchdog;
+
+static void publishStreamWatchdog(const std::shared_ptr<StreamWatchdog>& watchdog) {
+    std::lock_guard<std::mutex> lock(g_stream_watchdog_mutex);
+    g_stream_watchdog = watchdog;
+}
+
+static void abortCurrentStream() {
+    std::lock_guard<std::mutex> lock(g_stream_watchdog_mutex);
+    if (g_stream_watchdog) {
+        g_stream_watchdog->abort();
+    }
+}
+#endif
+
+// ============================================================================
+// RTP直通快速路径 - 自行解包RTP（H.264/HEVC），整帧零拷贝送入解码器
+// ============================================================================
+// libavformat的RTSP会话状态不对外公开，无法只借用其信令而自己读取RTP，因此这里带一个
+// 最小的RTSP客户端（DESCRIBE/SETUP/PLAY/TEARDOWN，Basic/Digest认证，TCP交织或UDP单播/组播）。
+// URL拆分、Base64、MD5仍使用FFmpeg；打不开（非H.264/HEVC、DONL等）时由播放器回退到libavformat。
+#if FFMPEG_FOUND
+static std::atomic<bool> g_rtp_direct_enabled(false);
+
+// RTP传输方式：UDP没有重传和队头阻塞，丢包只影响当前帧；建立失败时播放器回退到TCP
+enum RtpTransport {
+    RTP_TRANSPORT_TCP = 0,
+    RTP_TRANSPORT_UDP = 1,
+    RTP_TRANSPORT_UDP_MULTICAST = 2
+};
+
+struct RtpTransportConfig {
+    int transport;              // RtpTransport
+    int reorder_packets;        // UDP重排窗口最多暂存的包数，0表示到达即交付
+    int reorder_ms;             // 缺包时最多等待的时间
+    int recv_buffer_bytes;      // UDP套接字接收缓冲区（SO_RCVBUF）
+    
+    RtpTransportConfig() : transport(RTP_TRANSPORT_TCP), reorder_packets(8), reorder_ms(20),
+        recv_buffer_bytes(1024 * 1024) {}
+};
+
+// 下次openRtspStream时生效
+static std::mutex g_rtp_transport_mutex;
+static RtpTransportConfig g_rtp_transport;
+
+static RtpTransportConfig getRtpTransportConfig() {
+    std::lock_guard<std::mutex> lock(g_rtp_transport_mutex);
+    return g_rtp_transport;
+}
+
+static const char* rtpTransportName(int transport) {
+    switch (transport) {
+        case RTP_TRANSPORT_UDP: return "UDP";
+        case RTP_TRANSPORT_UDP_MULTICAST: return "UDP组播";
+        default: return "TCP";
+    }
+}
+
+// RTSP认证所需的摘要和编码，设备上用FFmpeg的实现
+struct FFmpegRtspHash {
+    static std::string md5Hex(const std::string& s) {
+        uint8_t digest[16];
+        av_md5_sum(digest, reinterpret_cast<const uint8_t*>(s.data()), s.size());
+        char hex[33];
+        for (int i = 0; i < 16; i++) {
+            snprintf(hex + i * 2, 3, "%02x", digest[i]);
+        }
+        return std::string(hex, 32);
+    }
+
+    static std::string base64(const std::string& s) {
+        std::vector<char> encoded(AV_BASE64_SIZE(s.size()));
+        av_base64_encode(encoded.data(), (int)encoded.size(), reinterpret_cast<const uint8_t*>(s.data()), (int)s.size());
+        return std::string(encoded.data());
+    }
+};
+
+typedef BasicRtspAuth<FFmpegRtspHash> RtspAuth;
+
+class RtpDirectSource {
+private:
+    static const size_t AU_CAPACITY = 2 * 1024 * 1024;     // 访问单元缓冲区初始大小，超出时按需扩大
+    static const size_t AU_MAX_CAPACITY = 32 * 1024 * 1024; // 扩大的上限，超出的帧整帧丢弃并报错
+    static const size_t RX_CAPACITY = 128 * 1024;          // 接收缓冲区（交织帧最大4+65535字节）
+    static const int CONNECT_TIMEOUT_MS = 3000;
+    static const int IDLE_TIMEOUT_MS = 1000;               // 无数据多久返回一次ETIMEDOUT
+    static const int POLL_SLICE_MS = 20;                   // 阻塞等待的粒度，每片检查一次中断回调
+    static const int FIRST_KEYFRAME_TIMEOUT_MS = 6000;     // 等待首个关键帧以探测分辨率
+    static const int FIRST_DATAGRAM_TIMEOUT_MS = 2000;     // UDP在此时间内收不到数据视为被NAT/防火墙拦截
+    static const size_t DATAGRAM_CAPACITY = 65536;
+
+    struct ReadyAu {
+        AVPacket* pkt;
+        std::chrono::steady_clock::time_point completed;
+    };
+
+    int sock;                                       // RTSP控制连接（TCP模式下也承载RTP）
+    AVIOInterruptCB interrupt_cb;                   // 与libavformat路径共用同一个看门狗
+    std::vector<uint8_t> rx_buf;
+    size_t rx_begin;
+    size_t rx_end;
+
+    // UDP传输
+    RtpTransportConfig transport;
+    int rtp_sock;
+    int rtcp_sock;
+    int client_port;
+    struct sockaddr_in server_addr;                 // UDP数据报的合法来源（组播时端口为0表示不校验）
+    std::vector<uint8_t> datagram;
+    std::chrono::steady_clock::time_point last_datagram;
+
+    // RTSP会话
+    std::string request_url;
+    std::string base_url;
+    std::string control_url;
+    std::string session_id;
+    RtspAuth authenticator;
+    int cseq;
+    bool playing;
+    int keepalive_interval_s;
+    std::chrono::steady_clock::time_point last_keepalive;
+
+    // 媒体参数（来自SDP）
+    AVCodecID codec_id;
+    int payload_type;
+    int clock_rate;
+    int rtp_channel;
+    std::vector<uint8_t> extradata;                 // Annex-B格式的参数集
+
+    // 访问单元组装：解包在rtp_depacketizer.h，本类提供AVBufferPool存储（Sink接口）
+    friend class RtpDepacketizer<RtpDirectSource>;
+    RtpDepacketizer<RtpDirectSource> depacketizer;
+    RtpReorderWindow<RtpDepacketizer<RtpDirectSource> > reorder_window;    // UDP：按序号重排后交给depacketizer
+    AVBufferPool* au_pool;
+    size_t au_capacity;
+    AVBufferRef* au_buf;
+    size_t au_size;
+    std::deque<ReadyAu> ready;
+
+    // 统计（解包相关的在depacketizer.stats()，重排相关的在reorder_window.stats()）
+    int stat_resyncs;
+    double stat_handoff_us;                         // 收到marker包到交给播放器的耗时（累计）
+    int stat_foreign;                               // 来源不是协商的服务器地址/端口的数据报
+
+public:
+    RtpDirectSource(const RtpTransportConfig& config, const AVIOInterruptCB& interrupt) :
+        sock(-1), interrupt_cb(interrupt), rx_buf(RX_CAPACITY), rx_begin(0), rx_end(0),
+        transport(config), rtp_sock(-1), rtcp_sock(-1), client_port(0),
+        cseq(0), playing(false), keepalive_interval_s(30),
+        codec_id(AV_CODEC_ID_NONE), payload_type(-1), clock_rate(90000), rtp_channel(0),
+        depacketizer(*this), reorder_window(depacketizer), au_pool(nullptr), au_capacity(AU_CAPACITY), au_buf(nullptr), au_size(0),
+        stat_resyncs(0), stat_handoff_us(0.0), stat_foreign(0) {
+        memset(&server_addr, 0, sizeof(server_addr));
+    }
+
+    ~RtpDirectSource() {
+        close();
+    }
+
+    // 建立会话并等到首个关键帧；成功时创建只含一路视频流的AVFormatContext供播放器/录制器读取参数
+    bool open(const char* url, AVFormatContext** out_ctx) {
+        char proto[16], auth[256], host[256], path[1024];
+        int port = -1;
+        av_url_split(proto, sizeof(proto), auth, sizeof(auth), host, sizeof(host),
+                     &port, path, sizeof(path), url);
+        if (strcmp(proto, "rtsp") != 0 || !host[0]) {
+            LOGW("⚠️ RTP直通仅支持rtsp://地址");
+            return false;
+        }
+        if (port < 0) {
+            port = 554;
+        }
+        if (auth[0]) {
+            std::string credentials = urlDecode(auth);
+            size_t colon = credentials.find(':');
+            authenticator.setCredentials(credentials.substr(0, colon),
+                                         colon == std::string::npos ? "" : credentials.substr(colon + 1));
+        }
+        std::string host_part = strchr(host, ':') ? "[" + std::string(host) + "]" : std::string(host);
+        request_url = "rtsp://" + host_part + ":" + std::to_string(port) + path;
+
+        if (!connectTo(host, port)) {
+            return false;
+        }
+
+        RtspResponse resp;
+        if (!sendRequest("DESCRIBE", request_url, "Accept: application/sdp\r\n", resp) || resp.status != 200) {
+            LOGW("⚠️ RTP直通DESCRIBE失败: status=%d", resp.status);
+            return false;
+        }
+        base_url = resp.headers.count("content-base") ? resp.headers["content-base"] :
+                   resp.headers.count("content-location") ? resp.headers["content-location"] : request_url;
+        if (!parseSdp(resp.body)) {
+            return false;
+        }
+        depacketizer.configure(codec_id == AV_CODEC_ID_H264 ? RtpDepacketizer<RtpDirectSource>::CODEC_H264 :
+                               RtpDepacketizer<RtpDirectSource>::CODEC_HEVC, payload_type);
+        reorder_window.configure(payload_type, transport.reorder_packets, transport.reorder_ms);
+
+        if (!setupTransport()) {
+            return false;
+        }
+
+        if (!sendRequest("PLAY", base_url, "Range: npt=0.000-\r\n", resp) || resp.status != 200) {
+            LOGW("⚠️ RTP直通PLAY失败: status=%d", resp.status);
+            return false;
+        }
+        playing = true;
+        last_keepalive = std::chrono::steady_clock::now();
+        last_datagram = last_keepalive;
+
+        au_pool = av_buffer_pool_init(au_capacity + AV_INPUT_BUFFER_PADDING_SIZE, nullptr);
+        if (!au_pool) {
+            return false;
+        }
+
+        int width = 0, height = 0;
+        if (!waitFirstKeyframe(width, height)) {
+            LOGW("⚠️ RTP直通未等到关键帧");
+            return false;
+        }
+
+        AVFormatContext* ctx = avformat_alloc_context();
+        AVStream* st = ctx ? avformat_new_stream(ctx, nullptr) : nullptr;
+        if (!st) {
+            if (ctx) {
+                avformat_free_context(ctx);
+            }
+            return false;
+        }
+        st->time_base = {1, clock_rate};
+        st->codecpar->codec_type = AVMEDIA_TYPE_VIDEO;
+        st->codecpar->codec_id = codec_id;
+        st->codecpar->width = width;
+        st->codecpar->height = height;
+        if (!extradata.empty()) {
+            st->codecpar->extradata = static_cast<uint8_t*>(av_malloc(extradata.size() + AV_INPUT_BUFFER_PADDING_SIZE));
+            if (st->codecpar->extradata) {
+                memcpy(st->codecpar->extradata, extradata.data(), extradata.size());
+                memset(st->codecpar->extradata + extradata.size(), 0, AV_INPUT_BUFFER_PADDING_SIZE);
+                st->codecpar->extradata_size = (int)extradata.size();
+            }
+        }
+        *out_ctx = ctx;
+
+        LOGI("✅ RTP直通已建立: %s %dx%d, PT=%d, %s, 保活%ds", avcodec_get_name(codec_id),
+             width, height, payload_type, rtpTransportName(transport.transport), keepalive_interval_s);
+        return true;
+    }
+
+    // 读取一个完整访问单元；缓冲区所有权随pkt->buf转移，send_packet只增加引用不复制
+    // 装了中断回调时空闲超时不返回，读包期限完全由看门狗决定（与libavformat路径一致）
+    int readAccessUnit(AVPacket* pkt) {
+        int ret = readNextAccessUnit(pkt);
+        while (ret == AVERROR(ETIMEDOUT) && interrupt_cb.callback) {
+            ret = readNextAccessUnit(pkt);
+        }
+        return ret;
+    }
+
+    void close() {
+        if (sock >= 0) {
+            if (playing) {
+                sendRequestNoWait("TEARDOWN", base_url);
+            }
+            ::close(sock);
+            sock = -1;
+        }
+        if (rtp_sock >= 0) {
+            ::close(rtp_sock);      // 关闭即退出组播组
+            rtp_sock = -1;
+        }
+        if (rtcp_sock >= 0) {
+            ::close(rtcp_sock);
+            rtcp_sock = -1;
+        }
+        playing = false;
+        reorder_window.clear();
+        for (size_t i = 0; i < ready.size(); i++) {
+            av_packet_free(&ready[i].pkt);
+        }
+        ready.clear();
+        av_buffer_unref(&au_buf);
+        if (au_pool) {
+            av_buffer_pool_uninit(&au_pool);
+        }
+    }
+
+private:
+    static std::string urlDecode(const std::string& s) {
+        std::string out;
+        for (size_t i = 0; i < s.size(); i++) {
+            if (s[i] == '%' && i + 2 < s.size()) {
+                out += (char)strtol(s.substr(i + 1, 2).c_str(), nullptr, 16);
+                i += 2;
+            } else {
+                out += s[i];
+            }
+        }
+        return out;
+    }
+
+    bool connectTo(const char* host, int port) {
+        struct addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        struct addrinfo* res = nullptr;
+        std::string port_str = std::to_string(port);
+        if (getaddrinfo(host, port_str.c_str(), &hints, &res) != 0 || !res) {
+            LOGW("⚠️ RTP直通无法解析主机: %s", host);
+            return false;
+        }
+
+        for (struct addrinfo* ai = res; ai && sock < 0; ai = ai->ai_next) {
+            int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd < 0) {
+                continue;
+            }
+            // 非阻塞connect + poll实现连接超时
+            int flags = fcntl(fd, F_GETFL, 0);
+            fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+            int ret = connect(fd, ai->ai_addr, ai->ai_addrlen);
+            if (ret < 0 && errno == EINPROGRESS) {
+                ret = waitFd(fd, POLLOUT, CONNECT_TIMEOUT_MS) > 0 ? 0 : -1;
+                if (ret == 0) {
+                    int err = 0;
+                    socklen_t err_len = sizeof(err);
+                    getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &err_len);
+                    ret = err == 0 ? 0 : -1;
+                }
+            }
+            if (ret == 0) {
+                fcntl(fd, F_SETFL, flags);
+                sock = fd;
+            } else {
+                ::close(fd);
+            }
+        }
+        freeaddrinfo(res);
+        if (sock < 0) {
+            LOGW("⚠️ RTP直通连接失败: %s:%d", host, port);
+            return false;
+        }
+
+        int one = 1;
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        // 接收前已用waitFd等待，这里只是兜底；发送超时防止对端不读时卡住
+        struct timeval tv;
+        tv.tv_sec = 1;
+        tv.tv_usec = 0;
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        return true;
+    }
+
+    // 按所选传输方式SETUP，并解析会话ID、保活间隔和服务器返回的传输参数
+    bool setupTransport() {
+        std::string request;
+        if (transport.transport != RTP_TRANSPORT_TCP && !loadServerAddress()) {
+            return false;
+        }
+        if (transport.transport == RTP_TRANSPORT_UDP) {
+            if (!bindUnicastPorts()) {
+                return false;
+            }
+            request = "Transport: RTP/AVP;unicast;client_port=" + std::to_string(client_port) + "-" +
+                      std::to_string(client_port + 1) + "\r\n";
+        } else if (transport.transport == RTP_TRANSPORT_UDP_MULTICAST) {
+            request = "Transport: RTP/AVP;multicast\r\n";
+        } else {
+            request = "Transport: RTP/AVP/TCP;unicast;interleaved=0-1\r\n";
+        }
+
+        RtspResponse resp;
+        if (!sendRequest("SETUP", control_url, request, resp) || resp.status != 200 || !resp.headers.count("session")) {
+            LOGW("⚠️ RTP直通SETUP(%s)失败: status=%d", rtpTransportName(transport.transport), resp.status);
+            return false;
+        }
+        std::string session = resp.headers["session"];
+        session_id = rtspTrim(session.substr(0, session.find(';')));
+        size_t timeout_pos = session.find("timeout=");
+        if (timeout_pos != std::string::npos) {
+            int timeout_s = atoi(session.c_str() + timeout_pos + 8);
+            if (timeout_s > 2) {
+                keepalive_interval_s = timeout_s / 2;
+            }
+        }
+
+        const std::string& reply = resp.headers["transport"];
+        if (transport.transport == RTP_TRANSPORT_TCP) {
+            size_t interleaved_pos = reply.find("interleaved=");
+            if (interleaved_pos != std::string::npos) {
+                rtp_channel = atoi(reply.c_str() + interleaved_pos + 12);
+            }
+            return true;
+        }
+        if (reply.find("/TCP") != std::string::npos) {
+            LOGW("⚠️ 服务器把UDP请求改成了TCP: %s", reply.c_str());
+            return false;
+        }
+        // 只接受来自服务器（或SETUP响应中source指定的发送端）的数据报
+        std::string source = transportParam(reply, "source");
+        if (!source.empty() && inet_pton(AF_INET, source.c_str(), &server_addr.sin_addr) != 1) {
+            LOGW("⚠️ RTP直通无效的source地址: %s", source.c_str());
+            return false;
+        }
+        if (transport.transport == RTP_TRANSPORT_UDP) {
+            int server_rtp_port = atoi(transportParam(reply, "server_port").c_str());
+            server_addr.sin_port = htons((uint16_t)std::max(0, server_rtp_port));
+            sendPunchPackets(server_rtp_port);
+            return true;
+        }
+        return joinMulticast(transportParam(reply, "destination"), atoi(transportParam(reply, "port").c_str()));
+    }
+
+    bool loadServerAddress() {
+        struct sockaddr_storage peer;
+        socklen_t peer_len = sizeof(peer);
+        if (getpeername(sock, reinterpret_cast<struct sockaddr*>(&peer), &peer_len) < 0 || peer.ss_family != AF_INET) {
+            LOGW("⚠️ RTP直通UDP仅支持IPv4服务器");
+            return false;
+        }
+        memcpy(&server_addr, &peer, sizeof(server_addr));
+        server_addr.sin_port = 0;
+        return true;
+    }
+
+    bool isExpectedSource(const struct sockaddr_in& from) const {
+        return from.sin_family == AF_INET && from.sin_addr.s_addr == server_addr.sin_addr.s_addr &&
+               (server_addr.sin_port == 0 || from.sin_port == server_addr.sin_port);
+    }
+
+    static std::string transportParam(const std::string& transport_header, const char* name) {
+        std::string key = std::string(name) + "=";
+        size_t pos = transport_header.find(key);
+        while (pos != std::string::npos && pos > 0 && transport_header[pos - 1] != ';') {
+            pos = transport_header.find(key, pos + 1);
+        }
+        if (pos == std::string::npos) {
+            return "";
+        }
+        pos += key.size();
+        return transport_header.substr(pos, transport_header.find(';', pos) - pos);
+    }
+
+    void configureUdpSocket(int fd) {
+        int size = transport.recv_buffer_bytes;
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+        int actual = 0;
+        socklen_t len = sizeof(actual);
+        getsockopt(fd, SOL_SOCKET, SO_RCVBUF, &actual, &len);
+        LOGI("📡 UDP接收缓冲区: 请求%dKB, 实际%dKB", size / 1024, actual / 1024);   // 内核会翻倍并受rmem_max限制
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        datagram.resize(DATAGRAM_CAPACITY);
+    }
+
+    static int bindUdp(uint32_t address, int port, bool reuse) {
+        int fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        if (reuse) {
+            int one = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        }
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = address;
+        addr.sin_port = htons((uint16_t)port);
+        if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    // RTP用偶数端口、RTCP用紧邻的奇数端口（RFC 3550）
+    bool bindUnicastPorts() {
+        for (int attempt = 0; attempt < 16 && rtp_sock < 0; attempt++) {
+            int rtp = bindUdp(htonl(INADDR_ANY), 0, false);
+            if (rtp < 0) {
+                break;
+            }
+            struct sockaddr_in local;
+            socklen_t local_len = sizeof(local);
+            getsockname(rtp, reinterpret_cast<struct sockaddr*>(&local), &local_len);
+            int port = ntohs(local.sin_port);
+            int rtcp = port % 2 == 0 ? bindUdp(htonl(INADDR_ANY), port + 1, false) : -1;
+            if (rtcp >= 0) {
+                rtp_sock = rtp;
+                rtcp_sock = rtcp;
+                client_port = port;
+            } else {
+                ::close(rtp);
+            }
+        }
+        if (rtp_sock < 0) {
+            LOGW("⚠️ RTP直通无法绑定UDP端口对");
+            return false;
+        }
+        configureUdpSocket(rtp_sock);
+        return true;
+    }
+
+    // 向服务器RTP/RTCP端口各发一个包，打开NAT和防火墙的回程映射
+    void sendPunchPackets(int server_rtp_port) {
+        if (server_rtp_port <= 0) {
+            return;
+        }
+        uint8_t rtp_punch[12] = {0x80, (uint8_t)payload_type};
+        uint8_t rtcp_punch[8] = {0x80, 201, 0, 1};      // 不含报告块的空RR
+        struct sockaddr_in dest = server_addr;
+        dest.sin_port = htons((uint16_t)server_rtp_port);
+        sendto(rtp_sock, rtp_punch, sizeof(rtp_punch), 0, reinterpret_cast<struct sockaddr*>(&dest), sizeof(dest));
+        dest.sin_port = htons((uint16_t)(server_rtp_port + 1));
+        sendto(rtcp_sock, rtcp_punch, sizeof(rtcp_punch), 0, reinterpret_cast<struct sockaddr*>(&dest), sizeof(dest));
+    }
+
+    // Android上应用需持有WifiManager.MulticastLock，否则WLAN驱动会过滤组播
+    bool joinMulticast(const std::string& group, int port) {
+        struct ip_mreq mreq;
+        memset(&mreq, 0, sizeof(mreq));
+        if (port <= 0 || inet_pton(AF_INET, group.c_str(), &mreq.imr_multiaddr) != 1 ||
+            !IN_MULTICAST(ntohl(mreq.imr_multiaddr.s_addr))) {
+            LOGW("⚠️ RTP直通组播地址无效: %s:%d", group.c_str(), port);
+            return false;
+        }
+        rtp_sock = bindUdp(htonl(INADDR_ANY), port, true);
+        if (rtp_sock < 0) {
+            LOGW("⚠️ RTP直通无法绑定组播端口%d", port);
+            return false;
+        }
+        mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+        if (setsockopt(rtp_sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+            LOGW("⚠️ 加入组播组%s失败: %s", group.c_str(), strerror(errno));
+            return false;
+        }
+        configureUdpSocket(rtp_sock);
+        LOGI("📡 已加入组播组 %s:%d", group.c_str(), port);
+        return true;
+    }
+
+    // IDLE_TIMEOUT_MS内没有数据时返回AVERROR(ETIMEDOUT)
+    int readNextAccessUnit(AVPacket* pkt) {
+        while (ready.empty()) {
+            sendKeepAliveIfDue();
+
+            int ret = transport.transport == RTP_TRANSPORT_TCP ? readInterleaved() : readDatagrams();
+            if (ret < 0) {
+                return ret;
+            }
+        }
+
+        ReadyAu au = ready.front();
+        ready.pop_front();
+        av_packet_move_ref(pkt, au.pkt);
+        av_packet_free(&au.pkt);
+
+        stat_handoff_us += std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - au.completed).count();
+        logStats();
+        return 0;
+    }
+
+    // TCP交织：每次处理一个交织帧或一条RTSP响应
+    int readInterleaved() {
+        int ret = fill(1);
+        if (ret < 0) {
+            return ret;
+        }
+        uint8_t lead = rx_buf[rx_begin];
+        if (lead == '$') {
+            if ((ret = fill(4)) < 0) {
+                return ret;
+            }
+            int channel = rx_buf[rx_begin + 1];
+            size_t len = AV_RB16(&rx_buf[rx_begin + 2]);
+            if ((ret = fill(4 + len)) < 0) {
+                return ret;
+            }
+            if (channel == rtp_channel) {
+                depacketizer.handlePacket(&rx_buf[rx_begin + 4], len);
+            }
+            rx_begin += 4 + len;
+        } else if (lead == 'R') {
+            // 保活请求的响应与数据交织返回，直接跳过
+            RtspResponse resp;
+            if (!readResponse(resp)) {
+                return AVERROR(EIO);
+            }
+        } else {
+            rx_begin++;
+            stat_resyncs++;
+        }
+        return 0;
+    }
+
+    // UDP：收取已到达的数据报放入重排窗口，再交付可以交付的部分；IDLE_TIMEOUT_MS无数据返回超时
+    int readDatagrams() {
+        if (interrupt_cb.callback && interrupt_cb.callback(interrupt_cb.opaque)) {
+            return AVERROR_EXIT;
+        }
+        int wait_ms = POLL_SLICE_MS;
+        int64_t held_wait_us = reorder_window.waitUs(av_gettime_relative());
+        if (held_wait_us >= 0) {
+            wait_ms = std::min(wait_ms, (int)((held_wait_us + 999) / 1000));
+        }
+        struct pollfd fds[2];
+        fds[0].fd = rtp_sock;
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        fds[1].fd = sock;
+        fds[1].events = POLLIN;
+        fds[1].revents = 0;
+        int n = poll(fds, 2, wait_ms);
+        if (n < 0) {
+            return errno == EINTR ? 0 : AVERROR(errno);
+        }
+        if (fds[1].revents) {
+            // 控制连接上只有保活响应；连接断开说明会话已结束
+            RtspResponse resp;
+            if (!readResponse(resp)) {
+                return AVERROR_EOF;
+            }
+        }
+        if (fds[0].revents & POLLIN) {
+            last_datagram = std::chrono::steady_clock::now();
+            while (true) {
+                struct sockaddr_in from;
+                socklen_t from_len = sizeof(from);
+                ssize_t r = recvfrom(rtp_sock, datagram.data(), datagram.size(), 0,
+                                     reinterpret_cast<struct sockaddr*>(&from), &from_len);
+                if (r <= 0) {
+                    break;
+                }
+                if (!isExpectedSource(from)) {
+                    stat_foreign++;
+                    continue;
+                }
+                reorder_window.hold(datagram.data(), (size_t)r, av_gettime_relative());
+            }
+        }
+        reorder_window.release(false, av_gettime_relative());
+        int idle_ms = IDLE_TIMEOUT_MS;
+        if (reorder_window.empty() && std::chrono::steady_clock::now() - last_datagram >= std::chrono::milliseconds(idle_ms)) {
+            last_datagram = std::chrono::steady_clock::now();
+            return AVERROR(ETIMEDOUT);
+        }
+        return 0;
+    }
+
+    // 按POLL_SLICE_MS分片等待，期间中断回调返回非0时立即以AVERROR_EXIT结束；
+    // 返回1表示就绪，0表示timeout_ms内未就绪
+    int waitFd(int fd, short events, int timeout_ms) {
+        int slice_ms = POLL_SLICE_MS;
+        int waited = 0;
+        while (true) {
+            if (interrupt_cb.callback && interrupt_cb.callback(interrupt_cb.opaque)) {
+                return AVERROR_EXIT;
+            }
+            struct pollfd pfd;
+            pfd.fd = fd;
+            pfd.events = events;
+            pfd.revents = 0;
+            int slice = std::min(slice_ms, timeout_ms - waited);
+            int n = poll(&pfd, 1, slice);
+            if (n > 0) {
+                return 1;
+            }
+            if (n < 0 && errno != EINTR) {
+                return AVERROR(errno);
+            }
+            waited += slice;
+            if (waited >= timeout_ms) {
+                return 0;
+            }
+        }
+    }
+
+    // 保证缓冲区中至少有n字节未读数据
+    int fill(size_t n) {
+        while (rx_end - rx_begin < n) {
+            if (rx_begin == rx_end) {
+                rx_begin = rx_end = 0;
+            } else if (rx_buf.size() - rx_begin < n || rx_end == rx_buf.size()) {
+                memmove(rx_buf.data(), rx_buf.data() + rx_begin, rx_end - rx_begin);
+                rx_end -= rx_begin;
+                rx_begin = 0;
+            }
+            int ready_ret = waitFd(sock, POLLIN, IDLE_TIMEOUT_MS);
+            if (ready_ret < 0) {
+                return ready_ret;
+            }
+            if (ready_ret == 0) {
+                return AVERROR(ETIMEDOUT);
+            }
+            ssize_t r = recv(sock, rx_buf.data() + rx_end, rx_buf.size() - rx_end, 0);
+            if (r > 0) {
+                rx_end += (size_t)r;
+            } else if (r == 0) {
+                return AVERROR_EOF;
+            } else if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return AVERROR(ETIMEDOUT);
+            } else {
+                return AVERROR(errno);
+            }
+        }
+        return 0;
+    }
+
+    bool sendAll(const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t r = send(sock, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (r < 0 && errno == EINTR) {
+                continue;
+            }
+            if (r <= 0) {
+                return false;
+            }
+            sent += (size_t)r;
+        }
+        return true;
+    }
+
+    std::string buildRequest(const std::string& method, const std::string& uri, const std::string& extra_headers) {
+        std::string req = method + " " + uri + " RTSP/1.0\r\n";
+        req += "CSeq: " + std::to_string(++cseq) + "\r\n";
+        req += "User-Agent: CompileFfmpeg\r\n";
+        if (!session_id.empty()) {
+            req += "Session: " + session_id + "\r\n";
+        }
+        std::string authorization = authenticator.header(method, uri);
+        if (!authorization.empty()) {
+            req += "Authorization: " + authorization + "\r\n";
+        }
+        return req + extra_headers + "\r\n";
+    }
+
+    bool sendRequest(const std::string& method, const std::string& uri, const std::string& extra_headers,
+                     RtspResponse& resp) {
+        resp.status = 0;
+        for (int attempt = 0; attempt < 2; attempt++) {
+            if (!sendAll(buildRequest(method, uri, extra_headers)) || !readResponse(resp)) {
+                return false;
+            }
+            // 首次401时按服务器质询重发一次
+            if (resp.status == 401 && attempt == 0 && authenticator.hasCredentials() &&
+                authenticator.parseChallenge(resp.headers["www-authenticate"])) {
+                continue;
+            }
+            return true;
+        }
+        return true;
+    }
+
+    void sendRequestNoWait(const std::string& method, const std::string& uri) {
+        sendAll(buildRequest(method, uri, ""));
+    }
+
+    void sendKeepAliveIfDue() {
+        auto now = std::chrono::steady_clock::now();
+        if (std::chrono::duration_cast<std::chrono::seconds>(now - last_keepalive).count() >= keepalive_interval_s) {
+            last_keepalive = now;
+            sendRequestNoWait("GET_PARAMETER", base_url);
+        }
+    }
+
+    bool readResponse(RtspResponse& resp) {
+        size_t header_len = 0;
+        while (true) {
+            if (fill(1) < 0) {
+                return false;
+            }
+            // 握手期间服务器可能已开始发送交织数据
+            if (rx_buf[rx_begin] == '$') {
+                if (fill(4) < 0) {
+                    return false;
+                }
+                size_t len = AV_RB16(&rx_buf[rx_begin + 2]);
+                if (fill(4 + len) < 0) {
+                    return false;
+                }
+                rx_begin += 4 + len;
+                continue;
+            }
+            header_len = rtspHeaderLength(rx_buf.data() + rx_begin, rx_end - rx_begin);
+            if (header_len > 0) {
+                break;
+            }
+            if (rx_end - rx_begin >= RX_CAPACITY / 2 || fill(rx_end - rx_begin + 1) < 0) {
+                return false;
+            }
+        }
+
+        std::string header(reinterpret_cast<const char*>(rx_buf.data() + rx_begin), header_len);
+        size_t content_length = 0;
+        if (!parseRtspResponseHeader(header, RX_CAPACITY / 2, resp, content_length)) {
+            LOGW("⚠️ RTP直通收到无效的RTSP响应");
+            return false;
+        }
+        if (fill(header_len + content_length) < 0) {
+            return false;
+        }
+        resp.body.assign(reinterpret_cast<const char*>(rx_buf.data() + rx_begin + header_len), content_length);
+        rx_begin += header_len + content_length;
+        return true;
+    }
+
+    void appendParameterSets(const std::string& base64_list) {
+        size_t start = 0;
+        while (start < base64_list.size()) {
+            size_t comma = base64_list.find(',', start);
+            std::string item = rtspTrim(base64_list.substr(start, comma == std::string::npos ? std::string::npos : comma - start));
+            start = comma == std::string::npos ? base64_list.size() : comma + 1;
+            if (item.empty()) {
+                continue;
+            }
+            std::vector<uint8_t> nal(item.size());
+            int len = av_base64_decode(nal.data(), item.c_str(), (int)nal.size());
+            if (len > 0) {
+                static const uint8_t start_code[4] = {0, 0, 0, 1};
+                extradata.insert(extradata.end(), start_code, start_code + 4);
+                extradata.insert(extradata.end(), nal.begin(), nal.begin() + len);
+            }
+        }
+    }
+
+    // 只取第一路视频（解析在rtsp_message.h）：编码、负载类型、参数集和control地址
+    bool parseSdp(const std::string& sdp) {
+        SdpVideoTrack track;
+        if (!parseSdpVideo(sdp, track)) {
+            return false;
+        }
+        codec_id = track.codec == SDP_CODEC_HEVC ? AV_CODEC_ID_HEVC : AV_CODEC_ID_H264;
+        payload_type = track.payload_type;
+        if (track.clock_rate > 0) {
+            clock_rate = track.clock_rate;
+        }
+        for (size_t i = 0; i < track.parameter_sets.size(); i++) {
+            appendParameterSets(track.parameter_sets[i]);
+        }
+        control_url = resolveRtspControl(base_url, track.control);
+        return true;
+    }
+
+    bool waitFirstKeyframe(int& width, int& height) {
+        int timeout_ms = FIRST_KEYFRAME_TIMEOUT_MS;
+        int datagram_timeout_ms = FIRST_DATAGRAM_TIMEOUT_MS;
+        auto start = std::chrono::steady_clock::now();
+        auto deadline = start + std::chrono::milliseconds(timeout_ms);
+        AVPacket* pkt = av_packet_alloc();
+        if (!pkt) {
+            return false;
+        }
+        bool found = false;
+        while (!found && std::chrono::steady_clock::now() < deadline) {
+            int ret = readNextAccessUnit(pkt);
+            if (ret == AVERROR(ETIMEDOUT)) {
+                // UDP一直没有数据时尽早放弃，让播放器回退到TCP
+                if (transport.transport != RTP_TRANSPORT_TCP && depacketizer.stats().received == 0 &&
+                    reorder_window.stats().late == 0 &&
+                    std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(datagram_timeout_ms)) {
+                    LOGW("⚠️ RTP直通%s %dms内未收到数据", rtpTransportName(transport.transport), datagram_timeout_ms);
+                    break;
+                }
+                continue;
+            }
+            if (ret < 0) {
+                break;
+            }
+            // 关键帧之前的帧解码器无法使用，直接丢弃
+            if (pkt->flags & AV_PKT_FLAG_KEY) {
+                found = true;
+                probeDimensions(pkt, width, height);
+                ReadyAu au;
+                au.pkt = av_packet_alloc();
+                if (!au.pkt) {
+                    found = false;
+                    break;
+                }
+                av_packet_move_ref(au.pkt, pkt);
+                au.completed = std::chrono::steady_clock::now();
+                ready.push_front(au);
+            }
+            av_packet_unref(pkt);
+        }
+        av_packet_free(&pkt);
+        return found;
+    }
+
+    // 用FFmpeg解析器从参数集+首个关键帧得到分辨率（MediaCodec配置需要）
+    void probeDimensions(const AVPacket* pkt, int& width, int& height) {
+        AVCodecParserContext* parser = av_parser_init(codec_id);
+        AVCodecContext* avctx = avcodec_alloc_context3(nullptr);
+        if (parser && avctx) {
+            parser->flags |= PARSER_FLAG_COMPLETE_FRAMES;
+            std::vector<uint8_t> probe(extradata);
+            probe.insert(probe.end(), pkt->data, pkt->data + pkt->size);
+            probe.resize(probe.size() + AV_INPUT_BUFFER_PADDING_SIZE, 0);
+            uint8_t* out = nullptr;
+            int out_size = 0;
+            av_parser_parse2(parser, avctx, &out, &out_size, probe.data(),
+                             (int)(probe.size() - AV_INPUT_BUFFER_PADDING_SIZE),
+                             AV_NOPTS_VALUE, AV_NOPTS_VALUE, 0);
+            width = parser->width;
+            height = parser->height;
+        }
+        if (parser) {
+            av_parser_close(parser);
+        }
+        avcodec_free_context(&avctx);
+    }
+
+    bool reserve(size_t bytes) {
+        if (!au_buf) {
+            au_buf = av_buffer_pool_get(au_pool);
+            au_size = 0;
+        }
+        if (!au_buf) {
+            return false;
+        }
+        return au_size + bytes <= au_capacity || growAccessUnit(au_size + bytes);
+    }
+
+    // 当前帧复制到更大的缓冲区，并换成更大的池，之后的大关键帧不再重新分配
+    bool growAccessUnit(size_t needed) {
+        size_t max_capacity = AU_MAX_CAPACITY;
+        size_t capacity = au_capacity;
+        while (capacity < needed && capacity < max_capacity) {
+            capacity *= 2;
+        }
+        capacity = std::min(capacity, max_capacity);
+        if (capacity < needed) {
+            static LogRateLimiter oversize_limiter;
+            if (oversize_limiter.allow(5000)) {
+                LOGE("❌ RTP直通访问单元超过%zuMB上限，整帧丢弃", AU_MAX_CAPACITY / (1024 * 1024));
+            }
+            return false;
+        }
+        AVBufferPool* pool = av_buffer_pool_init(capacity + AV_INPUT_BUFFER_PADDING_SIZE, nullptr);
+        if (!pool || av_buffer_realloc(&au_buf, capacity + AV_INPUT_BUFFER_PADDING_SIZE) < 0) {
+            if (pool) {
+                av_buffer_pool_uninit(&pool);
+            }
+            LOGE("❌ RTP直通访问单元缓冲区扩大到%zuKB失败", capacity / 1024);
+            return false;
+        }
+        av_buffer_pool_uninit(&au_pool);        // 已借出的缓冲区释放后旧池才真正销毁
+        au_pool = pool;
+        LOGW("⚠️ RTP直通访问单元超过%zuKB，缓冲区扩大到%zuKB", au_capacity / 1024, capacity / 1024);
+        au_capacity = capacity;
+        return true;
+    }
+
+    // RtpDepacketizer的Sink接口
+    bool appendAccessUnit(const uint8_t* data, size_t len) {
+        if (!reserve(len)) {
+            return false;
+        }
+        memcpy(au_buf->data + au_size, data, len);
+        au_size += len;
+        return true;
+    }
+
+    void discardAccessUnit() {
+        av_buffer_unref(&au_buf);
+        au_size = 0;
+    }
+
+    bool completeAccessUnit(int64_t pts, bool key, bool by_marker) {
+        if (!au_buf || au_size == 0) {
+            return false;
+        }
+        ReadyAu au;
+        au.pkt = av_packet_alloc();
+        if (!au.pkt) {
+            discardAccessUnit();
+            return false;
+        }
+        memset(au_buf->data + au_size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+        au.pkt->buf = au_buf;
+        au.pkt->data = au_buf->data;
+        au.pkt->size = (int)au_size;
+        au.pkt->pts = pts;
+        au.pkt->dts = pts;              // 低延迟流无B帧，解码顺序即显示顺序
+        au.pkt->stream_index = 0;
+        au.pkt->flags = (key ? AV_PKT_FLAG_KEY : 0) | (by_marker ? AV_PKT_FLAG_FRAME_END : 0);
+        au.completed = std::chrono::steady_clock::now();
+        au_buf = nullptr;
+        au_size = 0;
+        ready.push_back(au);
+        return true;
+    }
+
+    void logStats() {
+        static LogRateLimiter stats_limiter;
+        const RtpDepacketizer<RtpDirectSource>::Stats& depacket = depacketizer.stats();
+        const RtpReorderWindow<RtpDepacketizer<RtpDirectSource> >::Stats& reorder = reorder_window.stats();
+        if (depacket.aus > 0 && stats_limiter.allow(5000)) {
+            double loss_percent = 100.0 * depacket.lost_packets / std::max(1, depacket.received + depacket.lost_packets);
+            LOGI("📡 RTP直通(%s): %d帧, 平均%lldKB, 丢包%d(%.2f%%), 乱序纠正%d, 迟到/重复%d, 非法来源%d, "
+                 "丢弃帧%d, 重同步%d, marker→交付%.1fus",
+                 rtpTransportName(transport.transport), depacket.aus, (long long)(depacket.bytes / depacket.aus / 1024),
+                 depacket.lost_packets, loss_percent, reorder.reordered, reorder.late, stat_foreign, depacket.dropped_aus,
+                 stat_resyncs, stat_handoff_us / depacket.aus);
+        }
+    }
+};
+#endif
+
+// ============================================================================
+// 最新解码帧 - 截图和帧导出的取帧点，与播放器生命周期和g_player_mutex解耦
+// ============================================================================
+// processRtspFrame持有g_player_mutex跨越av_read_frame，阻塞读包时可长达读超时；
+// 截图/帧导出只经过这里的小锁，临界区内只有av_frame_ref
+#if FFMPEG_FOUND
+class LatestFrame {
+public:
+    static LatestFrame& getInstance() {
+        static LatestFrame instance;
+        return instance;
+    }
+    
+    // 解码线程调用：引用新帧，序号递增
+    void update(AVFrame* src, const PixelFormatDescriptor& desc) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!frame && !(frame = av_frame_alloc())) {
+            return;
+        }
+        av_frame_unref(frame);
+        if (av_frame_ref(frame, src) < 0) {
+            return;
+        }
+        format = desc;
+        serial++;
+    }
+    
+    // 引用最新帧，转换和编码由调用方在锁外完成
+    bool ref(AVFrame* dst, PixelFormatDescriptor& desc, uint64_t* serial_out = nullptr) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!frame || !frame->buf[0] || av_frame_ref(dst, frame) < 0) {
+            return false;
+        }
+        desc = format;
+        if (serial_out) {
+            *serial_out = serial;
+        }
+        return true;
+    }
+    
+    // 流关闭时释放帧引用；序号不清零，帧导出靠它判断是否有新帧
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        av_frame_free(&frame);
+    }
+    
+private:
+    std::mutex mutex;
+    AVFrame* frame;
+    PixelFormatDescriptor format;
+    uint64_t serial;
+    
+    LatestFrame() : frame(nullptr), serial(0) {}
+};
+#endif
+
+// ============================================================================
+// 超低延迟播放核心模块 - 独立封装，不允许外部修改
+// ============================================================================
+#if FFMPEG_FOUND
+class UltraLowLatencyPlayer {
+private:
+    // 核心播放状态
+    AVFormatContext* input_ctx;
+    AVCodecContext* decoder_ctx;
+    AVFrame* decode_frame;
+    int video_stream_index;
+    
+    // 延迟控制参数
+    static const int MAX_FRAME_BUFFER = 1;      // 最大帧缓冲：1帧
+    static const int EMERGENCY_DROP_THRESHOLD = 2; // 紧急丢帧阈值
+    static const int MAX_DECODE_TIME_MS = 33;   // 最大解码时间：33ms(30fps)
+    
+    // 性能监控
+    std::chrono::steady_clock::time_point last_frame_time;
+    int consecutive_slow_frames;
+    int total_dropped_frames;
+    
+    // 缓冲区控制
+    int pending_frames_count;
+    std::chrono::steady_clock::time_point last_drop_time;
+    
+    // 硬件解码状态
+    bool hardware_decode_available;
+    
+    // 预录环形缓冲区（录制器触发后与播放器共享）
+    std::shared_ptr<PacketRingBuffer> pre_event_ring;
+    
+    // 解码输出的像素格式描述（解码器输出格式变化时才重新解析）
+    PixelFormatDescriptor pixel_format;
+    
+    // 音频：只解复用，数据包交给录制器直通和音频输出，播放器不解码音频
+    static const size_t MAX_PENDING_AUDIO = 32;
+    int audio_stream_index;
+    std::vector<AVPacket*> pending_audio;
+    bool new_frame_available;           // 本次processFrame是否解码出新的视频帧
+    int64_t video_clock_us;             // 最新视频帧的源时间（视频主时钟）
+    
+    // 帧边界统计（按本路流统计，多路播放器互不影响）
+    int video_packet_count;
+    int marker_frame_count;             // 带AV_PKT_FLAG_FRAME_END的视频包数
+    bool packet_awaiting_frame;         // 已送解码、尚未出帧的最早数据包
+    std::chrono::steady_clock::time_point packet_read_time;
+    double read_to_frame_ms;            // 读包→出帧延迟（指数平均）
+    
+    // RTP直通快速路径（启用且建立成功时代替av_read_frame，input_ctx只承载流参数）
+    std::unique_ptr<RtpDirectSource> rtp_direct;
+    int rtp_transport;                  // 实际建立的RTP传输方式
+    
+    // 读超时看门狗（作为interrupt_callback装到input_ctx/RTP直通上）
+    std::shared_ptr<StreamWatchdog> watchdog;
+    StreamDeadlines deadlines;
+    
+public:
+    UltraLowLatencyPlayer() : 
+        input_ctx(nullptr), decoder_ctx(nullptr), 
+        decode_frame(nullptr), video_stream_index(-1),
+        consecutive_slow_frames(0), total_dropped_frames(0),
+        pending_frames_count(0), hardware_decode_available(false),
+        audio_stream_index(-1), new_frame_available(false),
+        video_clock_us(AV_NOPTS_VALUE), video_packet_count(0), marker_frame_count(0),
+        packet_awaiting_frame(false), read_to_frame_ms(0.0), rtp_transport(RTP_TRANSPORT_TCP),
+        watchdog(std::make_shared<StreamWatchdog>()) {
+        
+        last_frame_time = std::chrono::steady_clock::now();
+        last_drop_time = std::chrono::steady_clock::now();
+    }
+    
+    ~UltraLowLatencyPlayer() {
+        cleanup();
+    }
+    
+    // 初始化播放器 - 超低延迟配置
+    bool initialize(const char* rtsp_url) {
+        LOGI("🚀 初始化超低延迟播放器: %s", rtsp_url);
+        
+        deadlines = getStreamDeadlines();
+        RtpTransportConfig transport = getRtpTransportConfig();
+        if (!openSource(rtsp_url, transport)) {
+            if (transport.transport == RTP_TRANSPORT_TCP || watchdog->isAborted()) {
+                return false;
+            }
+            LOGW("⚠️ %s传输建立失败，回退到TCP", rtpTransportName(transport.transport));
+            transport.transport = RTP_TRANSPORT_TCP;
+            if (!openSource(rtsp_url, transport)) {
+                return false;
+            }
+        }
+        rtp_transport = transport.transport;
+        watchdog->beginPlayback(deadlines.first_frame_ms, deadlines.read_stall_ms);
+        
+        // 查找视频流
+        video_stream_index = -1;
+        for (unsigned int i = 0; i < input_ctx->nb_streams; i++) {
+            if (input_ctx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+                video_stream_index = i;
+                break;
+            }
+        }
+        
+        if (video_stream_index == -1) {
+            LOGE("❌ 未找到视频流");
+            cleanup();
+            return false;
+        }
+        
+        // 查找与视频相关的音频流（可选）
+        audio_stream_index = av_find_best_stream(input_ctx, AVMEDIA_TYPE_AUDIO, -1, video_stream_index, nullptr, 0);
+        if (audio_stream_index >= 0) {
+            AVCodecParameters* apar = input_ctx->streams[audio_stream_index]->codecpar;
+            LOGI("🎵 找到音频流 #%d: %s %dHz %d声道", audio_stream_index, avcodec_get_name(apar->codec_id),
+                 apar->sample_rate, apar->ch_layout.nb_channels);
+        } else {
+            audio_stream_index = -1;
+        }
+        
+        // 初始化解码器
+        if (!initializeDecoder()) {
+            cleanup();
+            return false;
+        }
+        
+        // 应用激进的低延迟设置
+        input_ctx->flags |= AVFMT_FLAG_NOBUFFER;
+        input_ctx->flags |= AVFMT_FLAG_FLUSH_PACKETS;
+        // TCP不会乱序，零延迟；UDP保留重排窗口（RTSP解复用器按max_delay等待乱序包）
+        input_ctx->max_delay = rtp_transport == RTP_TRANSPORT_TCP ? 0 : transport.reorder_ms * 1000;
+        
+        // 分配解码帧
+        decode_frame = av_frame_alloc();
+        if (!decode_frame) {
+            LOGE("❌ 分配解码帧失败");
+            cleanup();
+            return false;
+        }
+        
+        // 预录缓冲区
+        configurePreEventRing(g_pre_event_max_bytes, g_pre_event_max_duration_ms);
+        
+        LOGI("✅ 超低延迟播放器初始化成功");
+        return true;
+    }
+    
+    // 按给定传输方式打开：启用时优先RTP直通，失败再走libavformat
+    // 每次尝试单独计connect_ms期限；关闭流中止后不再尝试
+    bool openSource(const char* rtsp_url, const RtpTransportConfig& transport) {
+        if (g_rtp_direct_enabled.load()) {
+            watchdog->arm(StreamWatchdog::PHASE_CONNECT, deadlines.connect_ms);
+            std::unique_ptr<RtpDirectSource> direct(new RtpDirectSource(transport, watchdogInterruptCallback(watchdog.get())));
+            if (direct->open(rtsp_url, &input_ctx)) {
+                rtp_direct = std::move(direct);
+                return true;
+            }
+            if (watchdog->isAborted()) {
+                return false;
+            }
+            LOGW("⚠️ RTP直通(%s)不可用%s，回退到libavformat", rtpTransportName(transport.transport),
+                 watchdog->hasExpired() ? "（建立超时）" : "");
+        }
+        watchdog->arm(StreamWatchdog::PHASE_CONNECT, deadlines.connect_ms);
+        return openDemuxer(rtsp_url, transport);
+    }
+    
+    // libavformat解复用路径
+    bool openDemuxer(const char* rtsp_url, const RtpTransportConfig& transport) {
+        // 创建输入上下文
+        input_ctx = avformat_alloc_context();
+        if (!input_ctx) {
+            LOGE("❌ 分配输入上下文失败");
+            return false;
+        }
+        
+        // 阻塞期限由看门狗控制（FFmpeg 6.1的RTSP已没有stimeout选项）
+        input_ctx->interrupt_callback = watchdogInterruptCallback(watchdog.get());
+        
+        // 激进的超低延迟配置
+        AVDictionary *options = nullptr;
+        if (transport.transport == RTP_TRANSPORT_TCP) {
+            av_dict_set(&options, "rtsp_transport", "tcp", 0);
+            av_dict_set(&options, "max_delay", "0", 0);             // 零延迟（激进）
+            av_dict_set(&options, "buffer_size", "32768", 0);       // 32KB最小缓冲
+            av_dict_set(&options, "reorder_queue_size", "0", 0);    // 禁用重排序
+        } else {
+            // 单播用udp+tcp：SETUP失败或收不到数据时libavformat自行切到TCP；组播失败由调用方回退
+            av_dict_set(&options, "rtsp_transport",
+                        transport.transport == RTP_TRANSPORT_UDP ? "udp+tcp" : "udp_multicast", 0);
+            av_dict_set(&options, "max_delay", std::to_string(transport.reorder_ms * 1000).c_str(), 0);
+            av_dict_set(&options, "buffer_size", std::to_string(transport.recv_buffer_bytes).c_str(), 0);
+            av_dict_set(&options, "reorder_queue_size", std::to_string(transport.reorder_packets).c_str(), 0);
+        }
+        av_dict_set(&options, "fflags", "nobuffer+flush_packets+discardcorrupt", 0);
+        av_dict_set(&options, "flags", "low_delay", 0);
+        av_dict_set(&options, "probesize", "4096", 0);          // 4KB探测
+        av_dict_set(&options, "analyzeduration", "10000", 0);   // 10ms分析
+        
+        int ret = avformat_open_input(&input_ctx, rtsp_url, nullptr, &options);
+        av_dict_free(&options);
+        
+        if (ret < 0) {
+            LOGE("❌ 打开RTSP流失败: %d%s", ret, watchdog->hasExpired() ? "（建立超时）" : "");
+            cleanup();
+            return false;
+        }
+        
+        // 快速获取流信息
+        ret = avformat_find_stream_info(input_ctx, nullptr);
+        if (ret < 0) {
+            LOGE("❌ 获取流信息失败: %d", ret);
+            cleanup();
+            return false;
+        }
+        return true;
+    }
+    
+    // 处理一帧 - 核心播放逻辑
+    bool processFrame() {
+        if (!input_ctx || !decoder_ctx || !decode_frame) {
+            LOGE_EVERY(1000, "❌ 播放器组件未初始化: input_ctx=%p, decoder_ctx=%p, decode_frame=%p", 
+                       input_ctx, decoder_ctx, decode_frame);
+            return false;
+        }
+        
+        auto frame_start = std::chrono::steady_clock::now();
+        new_frame_available = false;
+        
+        // 读取数据包
+        AVPacket *pkt = av_packet_alloc();
+        if (!pkt) {
+            LOGE("❌ 分配数据包失败");
+            return false;
+        }
+        
+        int ret;
+        {
+            TRACE_SCOPE("packet_read");
+            // 期限只由视频包推进，音频持续到达时读包不会阻塞，需在这里检查
+            if (watchdog->poll()) {
+                ret = AVERROR_EXIT;
+            } else {
+                ret = rtp_direct ? rtp_direct->readAccessUnit(pkt) : av_read_frame(input_ctx, pkt);
+            }
+        }
+        if (ret < 0) {
+            av_packet_free(&pkt);
+            if (ret == AVERROR(EAGAIN)) {
+                return true; // 暂时没有数据，继续尝试
+            }
+            
+            if (ret == AVERROR_EXIT) {
+                if (watchdog->isAborted()) {
+                    LOGI("🛑 读包已中止（流正在关闭）");
+                } else {
+                    LOGE("⏱️ %s超时（%dms无视频包），判定流已卡死", StreamWatchdog::phaseName(watchdog->expiredPhase()),
+                         watchdog->expiredPhase() == StreamWatchdog::PHASE_FIRST_FRAME ?
+                         deadlines.first_frame_ms : deadlines.read_stall_ms);
+                }
+                return false;
+            }
+            
+            // 详细的错误分析
+            static LogRateLimiter read_error_limiter;
+            if (read_error_limiter.allow(1000)) {
+                char error_buf[256];
+                av_strerror(ret, error_buf, sizeof(error_buf));
+                LOGE("❌ 读取帧失败: ret=%d, error=%s", ret, error_buf);
+                
+                if (ret == AVERROR_EOF) {
+                    LOGE("   - 流已结束 (EOF)");
+                } else if (ret == AVERROR(ECONNRESET)) {
+                    LOGE("   - 网络连接重置");
+                } else if (ret == AVERROR(ETIMEDOUT)) {
+                    LOGE("   - 网络超时");
+                }
+            }
+            
+            return false;
+        }
+        
+        // 记录第一次成功读取数据包
+        static bool first_packet_read = false;
+        if (!first_packet_read) {
+            LOGI("✅ 第一次成功读取数据包: stream_index=%d, size=%d, pts=%ld", 
+                 pkt->stream_index, pkt->size, (long)pkt->pts);
+            first_packet_read = true;
+        }
+        
+        // 音频数据包暂存，由调用方在播放器锁外转交录制器/音频输出
+        if (pkt->stream_index == audio_stream_index && audio_stream_index >= 0) {
+            if (pending_audio.size() >= MAX_PENDING_AUDIO) {
+                av_packet_free(&pending_audio.front());
+                pending_audio.erase(pending_audio.begin());
+            }
+            pending_audio.push_back(pkt);
+            return true;
+        }
+        
+        // 只处理视频帧
+        if (pkt->stream_index != video_stream_index) {
+            av_packet_free(&pkt);
+            return true;
+        }
+        
+        // 写入预录缓冲区（仅复制数据，录制器在播放器锁之外读取）
+        if (pre_event_ring) {
+            pre_event_ring->push(pkt);
+        }
+        
+        // 打过补丁的库在RTP MARKER处即输出完整访问单元，读到即送解码，不等下一帧起始码
+        video_packet_count++;
+        watchdog->onVideoPacket();
+        if (pkt->flags & AV_PKT_FLAG_FRAME_END) {
+            marker_frame_count++;
+        }
+        if (!packet_awaiting_frame) {
+            packet_awaiting_frame = true;
+            packet_read_time = std::chrono::steady_clock::now();
+        }
+        
+        // 发送到解码器
+        {
+            TRACE_SCOPE("decode_send");
+            ret = avcodec_send_packet(decoder_ctx, pkt);
+        }
+        
+        // 记录第一次发送数据包的结果
+        static bool first_send_logged = false;
+        if (!first_send_logged) {
+            if (ret >= 0) {
+                LOGI("✅ 第一次发送数据包成功: ret=%d", ret);
+            } else {
+                char error_buf[256];
+                av_strerror(ret, error_buf, sizeof(error_buf));
+                LOGE("❌ 第一次发送数据包失败: ret=%d, error=%s", ret, error_buf);
+            }
+            first_send_logged = true;
+        }
+        
+        av_packet_free(&pkt);
+        
+        if (ret < 0 && ret != AVERROR(EAGAIN)) {
+            static LogRateLimiter send_error_limiter;
+            if (send_error_limiter.allow(1000)) {
+                char error_buf[256];
+                av_strerror(ret, error_buf, sizeof(error_buf));
+                LOGE("❌ 发送数据包失败: ret=%d, error=%s", ret, error_buf);
+            }
+            return false;
+        }
+        
+        // 接收解码帧 - 智能帧管理
+        bool frame_received = false;
+        int frames_received_this_call = 0;
+        bool has_valid_frame = false;
+        
+        // 接收第一个可用帧
+        {
+            TRACE_SCOPE("decode_receive");
+            ret = avcodec_receive_frame(decoder_ctx, decode_frame);
+        }
+        
+        // 记录第一次接收帧的尝试
+        static bool first_receive_logged = false;
+        if (!first_receive_logged) {
+            if (ret == AVERROR(EAGAIN)) {
+                LOGI("ℹ️ 第一次接收帧: 需要更多数据包 (EAGAIN)");
+            } else if (ret >= 0) {
+                LOGI("✅ 第一次接收帧成功: ret=%d", ret);
+            } else {
+                char error_buf[256];
+                av_strerror(ret, error_buf, sizeof(error_buf));
+                LOGE("❌ 第一次接收帧失败: ret=%d, error=%s", ret, error_buf);
+            }
+            first_receive_logged = true;
+        }
+        
+        if (ret == AVERROR(EAGAIN)) {
+            // 没有帧可接收，这是正常的
+        } else if (ret < 0) {
+            static LogRateLimiter receive_error_limiter;
+            if (receive_error_limiter.allow(1000)) {
+                char error_buf[256];
+                av_strerror(ret, error_buf, sizeof(error_buf));
+                LOGE("❌ 接收帧失败: ret=%d, error=%s", ret, error_buf);
+            }
+            return false;
+        } else {
+            // 成功接收到第一帧
+            frames_received_this_call++;
+            frame_received = true;
+            
+            // 检查帧是否有效
+            if (decode_frame->width > 0 && decode_frame->height > 0 && 
+                (decode_frame->data[0] || decode_frame->data[1] || decode_frame->data[3])) {
+                has_valid_frame = true;
+                
+                if (!pixel_format.matches(decode_frame)) {
+                    pixel_format = resolvePixelFormatDescriptor(decode_frame, decoder_ctx);
+                }
+                new_frame_available = true;
+                if (packet_awaiting_frame) {
+                    double latency_ms = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - packet_read_time).count();
+                    read_to_frame_ms = read_to_frame_ms > 0.0 ?
+                        read_to_frame_ms * 0.9 + latency_ms * 0.1 : latency_ms;
+                    packet_awaiting_frame = false;
+                }
+                int64_t frame_pts = decode_frame->best_effort_timestamp != AV_NOPTS_VALUE ?
+                    decode_frame->best_effort_timestamp : decode_frame->pts;
+                if (frame_pts != AV_NOPTS_VALUE) {
+                    video_clock_us = av_rescale_q(frame_pts, input_ctx->streams[video_stream_index]->time_base,
+                                                  AV_TIME_BASE_Q);
+                }
+                
+                // 记录第一次成功接收帧
+                static bool first_frame_received = false;
+                if (!first_frame_received) {
+                    LOGI("✅ 第一次成功接收解码帧: %dx%d, format=%d, data[0]=%p", 
+                         decode_frame->width, decode_frame->height, decode_frame->format, decode_frame->data[0]);
+                    first_frame_received = true;
+                }
+            }
+            
+            // 继续接收剩余帧以清空缓冲区，但不覆盖有效帧
+            AVFrame* temp_frame = av_frame_alloc();
+            if (temp_frame) {
+                while (true) {
+                    {
+                        TRACE_SCOPE("decode_receive");
+                        ret = avcodec_receive_frame(decoder_ctx, temp_frame);
+                    }
+                    if (ret == AVERROR(EAGAIN) || ret < 0) {
+                        break; // 没有更多帧或出错
+                    }
+                    
+                    frames_received_this_call++;
+                    total_dropped_frames++;
+                    LOGD_EVERY(1000, "🗑️ 丢弃旧帧以保持超低延迟 (累计丢弃: %d)", total_dropped_frames);
+                }
+                av_frame_free(&temp_frame);
+            }
+        }
+        
+        // 性能统计（减少日志输出）
+        if (frame_received) {
+            LOGD_EVERY(5000, "🎯 processFrame: 接收%d帧, 有效帧=%s, 尺寸=%dx%d", 
+                       frames_received_this_call, has_valid_frame ? "是" : "否",
+                       decode_frame->width, decode_frame->height);
+            
+            // 更新录制帧 - 仅在有有效帧时更新
+            if (has_valid_frame) {
+                updateRecordFrame();
+            }
+        }
+        
+        // 检查解码性能
+        auto frame_end = std::chrono::steady_clock::now();
+        auto decode_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+            frame_end - frame_start).count();
+        
+        if (decode_time > MAX_DECODE_TIME_MS) {
+            consecutive_slow_frames++;
+            if (consecutive_slow_frames > 3) {
+                LOGW("⚠️ 连续慢解码，考虑降低质量或跳帧");
+            }
+        } else {
+            consecutive_slow_frames = 0;
+        }
+        
+        // 更新时间戳
+        last_frame_time = frame_end;
+        
+        // 性能监控和统计
+        static bool first_process_result_logged = false;
+        static int total_processed_frames = 0;
+        
+        if (!first_process_result_logged) {
+            LOGI("📊 第一次processFrame完成: frame_received=%s, frames_received=%d, decode_time=%lldms", 
+                 frame_received ? "true" : "false", frames_received_this_call, decode_time);
+            first_process_result_logged = true;
+        }
+        
+        // 每5秒输出一次性能统计
+        if (frame_received) {
+            total_processed_frames++;
+            LOGI_EVERY(5000, "📊 播放统计: 已处理%d帧, 丢弃%d帧(%.1f%%), 慢解码%d次, MARKER组帧%d/%d包, 读包→出帧%.1fms", 
+                       total_processed_frames, total_dropped_frames,
+                       (float)total_dropped_frames / total_processed_frames * 100, consecutive_slow_frames,
+                       marker_frame_count, video_packet_count, read_to_frame_ms);
+        }
+        
+        // 关键修复：即使没有接收到帧，只要成功读取了数据包就返回true
+        // 这对于需要多个数据包才能产生帧的编码格式（如HEVC）是正常的
+        return true;
+    }
+    
+    // 获取当前解码帧 - 只有在真正有有效帧时才返回
+    AVFrame* getCurrentFrame() {
+        // 检查decode_frame是否存在
+        if (!decode_frame) {
+            return nullptr;
+        }
+        
+        // 检查基本尺寸
+        if (decode_frame->width <= 0 || decode_frame->height <= 0) {
+            return nullptr;
+        }
+        
+        // MediaCodec Surface输出只有data[3]缓冲引用
+        if (pixel_format.hw_surface) {
+            bool has_data = decode_frame->data[3] != nullptr;
+            
+            // 只在关键时刻输出日志
+            static bool first_mediacodec_logged = false;
+            if (!first_mediacodec_logged && has_data) {
+                LOGI("🔍 MediaCodec帧验证成功: %dx%d, format=%d", 
+                     decode_frame->width, decode_frame->height, decode_frame->format);
+                first_mediacodec_logged = true;
+            }
+            
+            return has_data ? decode_frame : nullptr;
+        } else {
+            // 普通格式，必须有data[0]
+            bool has_data = decode_frame->data[0] != nullptr;
+            
+            // 只在第一次成功时输出日志
+            static bool first_software_logged = false;
+            if (!first_software_logged && has_data) {
+                LOGI("🔍 软件解码帧验证成功: %dx%d, format=%d", 
+                     decode_frame->width, decode_frame->height, decode_frame->format);
+                first_software_logged = true;
+            }
+            
+            return has_data ? decode_frame : nullptr;
+        }
+    }
+    
+    // 发布最新帧供截图和帧导出使用
+    void updateRecordFrame() {
+        AVFrame* current = getCurrentFrame();
+        if (!current) {
+            return;
+        }
+        LatestFrame::getInstance().update(current, pixel_format.matches(current) ?
+                                          pixel_format : resolvePixelFormatDescriptor(current, decoder_ctx));
+    }
+    
+    // 配置预录缓冲区，max_bytes为0时禁用
+    void configurePreEventRing(size_t max_bytes, int max_duration_ms) {
+        if (max_bytes == 0 || video_stream_index < 0) {
+            pre_event_ring.reset();
+            return;
+        }
+        AVRational time_base = input_ctx->streams[video_stream_index]->time_base;
+        pre_event_ring = std::make_shared<PacketRingBuffer>(max_bytes, max_duration_ms, time_base);
+    }
+    
+    std::shared_ptr<PacketRingBuffer> getPreEventRing() const {
+        return pre_event_ring;
+    }
+    
+    // 获取直播流的录制参数：尺寸、宽高比、帧率、颜色属性
+    bool getStreamProfile(RecordingProfile& out) {
+        if (!input_ctx || video_stream_index < 0) {
+            return false;
+        }
+        AVStream* stream = input_ctx->streams[video_stream_index];
+        AVCodecParameters* par = stream->codecpar;
+        
+        // 优先使用实际解码帧的参数（RTSP的codecpar可能在首帧前不完整）
+        bool has_frame = decode_frame && decode_frame->width > 0 && decode_frame->height > 0;
+        out.width = has_frame ? decode_frame->width : (decoder_ctx ? decoder_ctx->width : par->width);
+        out.height = has_frame ? decode_frame->height : (decoder_ctx ? decoder_ctx->height : par->height);
+        out.pix_fmt = has_frame && pixel_format.hasCpuData() ? pixel_format.layout : AV_PIX_FMT_NONE;
+        out.sample_aspect_ratio = av_guess_sample_aspect_ratio(input_ctx, stream, has_frame ? decode_frame : nullptr);
+        out.color_range = has_frame ? decode_frame->color_range : par->color_range;
+        out.color_space = has_frame ? decode_frame->colorspace : par->color_space;
+        out.color_primaries = has_frame ? decode_frame->color_primaries : par->color_primaries;
+        out.color_trc = has_frame ? decode_frame->color_trc : par->color_trc;
+        
+        // 帧率：RTSP流的avg_frame_rate常常缺失，使用av_guess_frame_rate并限制到合理范围
+        AVRational fps = av_guess_frame_rate(input_ctx, stream, nullptr);
+        if (fps.num <= 0 || fps.den <= 0 || av_q2d(fps) < 1.0 || av_q2d(fps) > 120.0) {
+            fps = AVRational{30, 1};
+        }
+        out.framerate = fps;
+        out.time_base = stream->time_base;
+        
+        return out.width > 0 && out.height > 0;
+    }
+    
+    // 本次processFrame是否产生了新的视频帧（读到音频包时不重复渲染/录制上一帧）
+    bool hasNewFrame() const {
+        return new_frame_available;
+    }
+    
+    int64_t getVideoClockUs() const {
+        return video_clock_us;
+    }
+    
+    // 取出暂存的音频数据包，所有权转移给调用方
+    void takeAudioPackets(std::vector<AVPacket*>& out) {
+        out.swap(pending_audio);
+        pending_audio.clear();
+    }
+    
+    // 复制音频流参数，没有音频流时返回false
+    bool copyAudioStreamParameters(AVCodecParameters* par, AVRational& time_base) {
+        if (!input_ctx || audio_stream_index < 0 || !par) {
+            return false;
+        }
+        AVStream* stream = input_ctx->streams[audio_stream_index];
+        if (avcodec_parameters_copy(par, stream->codecpar) < 0) {
+            return false;
+        }
+        time_base = stream->time_base;
+        return true;
+    }
+    
+    // 当前流的像素格式描述（在g_player_mutex内复制给渲染器和录制器）
+    PixelFormatDescriptor getPixelFormatDescriptor() const {
+        return pixel_format;
+    }
+    
+    // 复制视频流参数，供流复制录制使用
+    bool copyVideoStreamParameters(AVCodecParameters* dst, AVRational& time_base) const {
+        if (!input_ctx || video_stream_index < 0 || !dst) {
+            return false;
+        }
+        AVStream* stream = input_ctx->streams[video_stream_index];
+        time_base = stream->time_base;
+        return avcodec_parameters_copy(dst, stream->codecpar) >= 0;
+    }
+    
+    // 是否使用硬件解码
+    bool isHardwareDecoding() const {
+        return hardware_decode_available;
+    }
+    
+    bool isRtpDirect() const {
+        return rtp_direct != nullptr;
+    }
+    
+    int getRtpTransport() const {
+        return rtp_transport;
+    }
+    
+    std::shared_ptr<StreamWatchdog> getWatchdog() const {
+        return watchdog;
+    }
+    
+    // 获取性能统计
+    void getStats(int& dropped_frames, int& slow_frames) {
+        dropped_frames = total_dropped_frames;
+        slow_frames = consecutive_slow_frames;
+    }
+    
+    void flushBuffers() {
+        if (decoder_ctx) {
+            avcodec_flush_buffers(decoder_ctx);
+        }
+        pending_frames_count = 0;
+        consecutive_slow_frames = 0;
+        packet_awaiting_frame = false;
+    }
+    
+    // 清理资源
+    void cleanup() {
+        LatestFrame::getInstance().clear();
+        
+        if (decode_frame) {
+            av_frame_free(&decode_frame);
+            decode_frame = nullptr;
+        }
+        
+        if (decoder_ctx) {
+            avcodec_free_context(&decoder_ctx);
+            decoder_ctx = nullptr;
+        }
+        
+        if (input_ctx) {
+            if (rtp_direct) {
+                avformat_free_context(input_ctx);   // 直通路径只分配了上下文和流
+            } else {
+                avformat_close_input(&input_ctx);
+            }
+            input_ctx = nullptr;
+        }
+        rtp_direct.reset();
+        
+        video_stream_index = -1;
+        hardware_decode_available = false;
+        pre_event_ring.reset();
+        pixel_format = PixelFormatDescriptor();
+        
+        for (size_t i = 0; i < pending_audio.size(); i++) {
+            av_packet_free(&pending_audio[i]);
+        }
+        pending_audio.clear();
+        audio_stream_index = -1;
+        video_clock_us = AV_NOPTS_VALUE;
+    }
+    
+private:
+    // 初始化解码器
+    bool initializeDecoder() {
+        AVStream* video_stream = input_ctx->streams[video_stream_index];
+        AVCodecID codec_id = video_stream->codecpar->codec_id;
+        
+        const AVCodec *decoder = nullptr;
+        
+        // 尝试硬件解码器
+        if (codec_id == AV_CODEC_ID_H264) {
+            decoder = avcodec_find_decoder_by_name("h264_mediacodec");
+            if (decoder) {
+                hardware_decode_available = true;
+                LOGI("✅ 使用H.264硬件解码器");
+            }
+        } else if (codec_id == AV_CODEC_ID_HEVC) {
+            decoder = avcodec_find_decoder_by_name("hevc_mediacodec");
+            if (decoder) {
+                hardware_decode_available = true;
+                LOGI("✅ 使用HEVC硬件解码器");
+            }
+        }
+        
+        // 回退到软件解码器
+        if (!decoder) {
+            decoder = avcodec_find_decoder(codec_id);
+            if (decoder) {
+                hardware_decode_available = false;
+                LOGI("✅ 使用软件解码器: %s", decoder->name);
+            } else {
+                LOGE("❌ 未找到解码器");
+                return false;
+            }
+        }
+        
+        // 分配解码器上下文
+        decoder_ctx = avcodec_alloc_context3(decoder);
+        if (!decoder_ctx) {
+            LOGE("❌ 分配解码器上下文失败");
+            return false;
+        }
+        
+        // 复制参数
+        int ret = avcodec_parameters_to_context(decoder_ctx, video_stream->codecpar);
+        if (ret < 0) {
+            LOGE("❌ 复制解码器参数失败: %d", ret);
+            return false;
+        }
+        
+        // 超低延迟配置
+        decoder_ctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
+        decoder_ctx->flags2 |= AV_CODEC_FLAG2_FAST;
+        decoder_ctx->thread_count = 1;              // 单线程避免重排序
+        decoder_ctx->thread_type = FF_THREAD_SLICE;
+        decoder_ctx->delay = 0;                     // 零延迟
+        decoder_ctx->has_b_frames = 0;              // 禁用B帧
+        decoder_ctx->max_b_frames = 0;
+        decoder_ctx->strict_std_compliance = FF_COMPLIANCE_UNOFFICIAL;
+        
+        // 软件解码器额外优化
+        if (!hardware_decode_available) {
+            decoder_ctx->skip_frame = AVDISCARD_NONREF;
+            decoder_ctx->skip_idct = AVDISCARD_BIDIR;
+            decoder_ctx->skip_loop_filter = AVDISCARD_BIDIR;
+        }
+        
+        // 对于硬件解码器，尝试设置Surface输出
+        AVDictionary* opts = nullptr;
+        if (hardware_decode_available) {
+            // 设置MediaCodec为Surface模式（如果有Surface可用）
+            // 注意：这里我们先尝试buffer模式，稍后可以添加surface模式支持
+            LOGI("🔧 配置MediaCodec硬件解码器");
+        }
+        
+        // 打开解码器
+        ret = avcodec_open2(decoder_ctx, decoder, &opts);
+        if (opts) {
+            av_dict_free(&opts);
+        }
+        
+        if (ret < 0) {
+            char error_buf[256];
+            av_strerror(ret, error_buf, sizeof(error_buf));
+            LOGE("❌ 打开解码器失败: ret=%d, error=%s", ret, error_buf);
+            
+            // 如果硬件解码器失败，尝试软件解码器
+            if (hardware_decode_available) {
+                LOGW("🔄 硬件解码器失败，尝试软件解码器");
+                avcodec_free_context(&decoder_ctx);
+                
+                // 获取软件解码器
+                decoder = avcodec_find_decoder(codec_id);
+                if (!decoder) {
+                    LOGE("❌ 未找到软件解码器");
+                    return false;
+                }
+                
+                // 重新分配解码器上下文
+                decoder_ctx = avcodec_alloc_context3(decoder);
+                if (!decoder_ctx) {
+                    LOGE("❌ 重新分配解码器上下文失败");
+                    return false;
+                }
+                
+                // 重新复制参数
+                ret = avcodec_parameters_to_context(decoder_ctx, video_stream->codecpar);
+                if (ret < 0) {
+                    LOGE("❌ 重新复制解码器参数失败: %d", ret);
+                    return false;
+                }
+                
+                // 软件解码器配置
+                decoder_ctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
+                decoder_ctx->flags2 |= AV_CODEC_FLAG2_FAST;
+                decoder_ctx->thread_count = 1;
+                decoder_ctx->thread_type = FF_THREAD_SLICE;
+                decoder_ctx->delay = 0;
+                decoder_ctx->has_b_frames = 0;
+                decoder_ctx->max_b_frames = 0;
+                decoder_ctx->strict_std_compliance = FF_COMPLIANCE_UNOFFICIAL;
+                decoder_ctx->skip_frame = AVDISCARD_NONREF;
+                decoder_ctx->skip_idct = AVDISCARD_BIDIR;
+                decoder_ctx->skip_loop_filter = AVDISCARD_BIDIR;
+                
+                // 尝试打开软件解码器
+                ret = avcodec_open2(decoder_ctx, decoder, nullptr);
+                if (ret < 0) {
+                    av_strerror(ret, error_buf, sizeof(error_buf));
+                    LOGE("❌ 软件解码器也失败: ret=%d, error=%s", ret, error_buf);
+                    return false;
+                }
+                
+                hardware_decode_available = false;
+                LOGI("✅ 使用软件解码器: %s", decoder->name);
+            } else {
+                return false;
+            }
+        }
+        
+        LOGI("✅ 解码器初始化成功 (硬件解码: %s)", hardware_decode_available ? "是" : "否");
+        return true;
+    }
+};
+
+// 全局播放器实例
+static UltraLowLatencyPlayer* g_player = nullptr;
+static std::mutex g_player_mutex;
+
+// 原生RTSP处理线程（替代Java线程池循环调用processRtspFrame）
+static PipelineThread g_rtsp_pipeline;
+#endif
+
+// ============================================================================
+// 渲染核心模块 - 独立封装
+// ============================================================================
+// Surface交接（surface_handover.h），设备上释放的是ANativeWindow引用
+struct NativeWindowOps {
+    static void release(ANativeWindow* window) {
+        ANativeWindow_release(window);
+    }
+};
+typedef BasicSurfaceHandover<ANativeWindow, NativeWindowOps> SurfaceHandover;
+
+class UltraLowLatencyRenderer {
+private:
+    ANativeWindow* native_window;
+    SwsContext* sws_ctx;
+    std::mutex render_mutex;
+    
+    // 渲染控制
+    std::chrono::steady_clock::time_point last_render_time;
+    static const int MIN_RENDER_INTERVAL_MS = 16; // 最大60fps
+    
+    // 缓存的SwsContext参数
+    int cached_src_width, cached_src_height;
+    AVPixelFormat cached_src_format;
+    int cached_out_width, cached_out_height;
+    
+    // 输出尺寸跟随Surface实际尺寸（surfaceChanged上报），缩放和颜色转换在一次sws_scale中完成
+    int geometry_width, geometry_height;    // 当前Surface缓冲区几何，0表示尚未设置
+    LetterboxRect content_rect;             // 保持宽高比后画面在缓冲区中的位置，其余区域为黑边
+    
+public:
+    UltraLowLatencyRenderer() : 
+        native_window(nullptr), sws_ctx(nullptr),
+        cached_src_width(0), cached_src_height(0), 
+        cached_src_format(AV_PIX_FMT_NONE),
+        cached_out_width(0), cached_out_height(0),
+        geometry_width(0), geometry_height(0), content_rect() {
+        
+        last_render_time = std::chrono::steady_clock::now();
+    }
+    
+    ~UltraLowLatencyRenderer() {
+        cleanup();
+    }
+    
+    // 渲染帧 - format为播放器按流解析好的像素格式描述；帧开始时接管UI线程发布的新窗口
+    bool renderFrame(AVFrame* frame, const PixelFormatDescriptor& format) {
+        if (!frame) {
+            return false;
+        }
+        
+        std::lock_guard<std::mutex> lock(render_mutex);
+        SurfaceHandover& handover = SurfaceHandover::getInstance();
+        if (handover.beginFrame(native_window)) {
+            onWindowChanged();
+        }
+        bool rendered = native_window && renderToWindow(frame, format);
+        handover.endFrame();
+        return rendered;
+    }
+    
+    void cleanup() {
+        std::lock_guard<std::mutex> lock(render_mutex);
+        
+        if (sws_ctx) {
+            sws_freeContext(sws_ctx);
+            sws_ctx = nullptr;
+        }
+        
+        if (native_window) {
+            ANativeWindow_release(native_window);
+            native_window = nullptr;
+        }
+        
+        cached_src_width = 0;
+    }
+    
+private:
+    // 新窗口（或窗口被清除）：缓冲区几何和SwsContext在下一次渲染时按新窗口重建
+    void onWindowChanged() {
+        if (sws_ctx) {
+            sws_freeContext(sws_ctx);
+            sws_ctx = nullptr;
+        }
+        cached_src_width = 0;
+        cached_src_height = 0;
+        cached_src_format = AV_PIX_FMT_NONE;
+        geometry_width = 0;
+        geometry_height = 0;
+        LOGI(native_window ? "✅ 渲染器已切换到新Surface" : "🧹 渲染器Surface已清理，暂停渲染");
+    }
+    
+    bool renderToWindow(AVFrame* frame, const PixelFormatDescriptor& format) {
+        // 帧率控制
+        auto now = std::chrono::steady_clock::now();
+        auto time_since_last = std::chrono::duration_cast<std::chrono::milliseconds>(
+            now - last_render_time).count();
+        
+        if (time_since_last < MIN_RENDER_INTERVAL_MS) {
+            return true; // 跳过渲染，保持帧率稳定
+        }
+        
+        // 记录第一次渲染尝试
+        static bool first_render_logged = false;
+        if (!first_render_logged) {
+            LOGI("🎬 第一次渲染尝试: format=%d, data[0]=%p, data[3]=%p, width=%d, height=%d", 
+                 frame->format, frame->data[0], frame->data[3], frame->width, frame->height);
+            first_render_logged = true;
+        }
+        
+        // MediaCodec Surface输出：释放缓冲区即由解码器直接渲染到Surface
+        if (format.hw_surface) {
+            TRACE_SCOPE("window_post");
+            int ret = av_mediacodec_release_buffer((AVMediaCodecBuffer*)frame->data[3], 1);
+            if (ret < 0) {
+                LOGE_EVERY(1000, "❌ MediaCodec缓冲区释放失败: %d", ret);
+                return false;
+            }
+            last_render_time = now;
+            return true;
+        }
+        
+        if (!format.hasCpuData()) {
+            return false;
+        }
+        
+        // 软件渲染路径 - 处理所有CPU可访问的格式（包括MediaCodec ByteBuffer输出）
+        return renderFrameSoftware(frame, format.layout);
+    }
+    
+    // 软件渲染实现，调用方保证native_window有效且在本帧内不会被释放
+    bool renderFrameSoftware(AVFrame* frame, AVPixelFormat input_format) {
+        // 按Surface尺寸输出，尺寸未知时退回新窗口的默认尺寸，再退回流尺寸
+        int out_width = 0;
+        int out_height = 0;
+        SurfaceHandover::getInstance().viewSize(out_width, out_height);
+        if (out_width <= 0 || out_height <= 0) {
+            out_width = ANativeWindow_getWidth(native_window);
+            out_height = ANativeWindow_getHeight(native_window);
+        }
+        if (out_width <= 0 || out_height <= 0) {
+            out_width = frame->width;
+            out_height = frame->height;
+        }
+        if (geometry_width != out_width || geometry_height != out_height) {
+            int ret = ANativeWindow_setBuffersGeometry(native_window, 
+                out_width, out_height, WINDOW_FORMAT_RGBA_8888);
+            if (ret != 0) {
+                LOGE_EVERY(1000, "❌ 设置Surface缓冲区失败: %d", ret);
+                return false;
+            }
+            geometry_width = out_width;
+            geometry_height = out_height;
+        }
+        
+        // 更新SwsContext
+        if (!updateSwsContext(frame, input_format, out_width, out_height)) {
+            return false;
+        }
+        
+        ANativeWindow_Buffer buffer;
+        int ret;
+        {
+            TRACE_SCOPE("window_lock");
+            ret = ANativeWindow_lock(native_window, &buffer, nullptr);
+        }
+        if (ret != 0) {
+            LOGE_EVERY(1000, "❌ 锁定Surface失败: %d", ret);
+            return false;
+        }
+        
+        // 几何变化后的第一个缓冲区可能仍是旧尺寸，跳过这一帧。
+        // ANativeWindow没有只解锁不提交的接口，先涂黑，避免把未写入的缓冲区内容显示出来
+        if (buffer.width != out_width || buffer.height != out_height) {
+            clearBuffer(buffer);
+            ANativeWindow_unlockAndPost(native_window);
+            return false;
+        }
+        
+        uint8_t* bits = (uint8_t*)buffer.bits;
+        clearLetterbox(bits, (size_t)buffer.stride * 4, out_width, out_height, content_rect);
+        
+        uint8_t* dst_data[4] = {bits + ((size_t)content_rect.y * buffer.stride + content_rect.x) * 4,
+                                nullptr, nullptr, nullptr};
+        int dst_linesize[4] = {buffer.stride * 4, 0, 0, 0};
+        
+        {
+            TRACE_SCOPE("convert");
+            ret = sws_scale(sws_ctx, frame->data, frame->linesize, 0, frame->height,
+                           dst_data, dst_linesize);
+        }
+        if (ret <= 0) {
+            clearBuffer(buffer);
+        }
+        
+        // 解锁并显示
+        {
+            TRACE_SCOPE("window_post");
+            ANativeWindow_unlockAndPost(native_window);
+        }
+        
+        if (ret > 0) {
+            last_render_time = std::chrono::steady_clock::now();
+            return true;
+        } else {
+            LOGE_EVERY(1000, "❌ 颜色空间转换失败: %d", ret);
+            return false;
+        }
+    }
+    
+    // 整个缓冲区涂黑（按缓冲区自身的尺寸和步长）
+    static void clearBuffer(const ANativeWindow_Buffer& buffer) {
+        if (!buffer.bits || buffer.width <= 0 || buffer.height <= 0) {
+            return;
+        }
+        size_t row_bytes = (size_t)buffer.stride * 4;
+        for (int y = 0; y < buffer.height; y++) {
+            memset((uint8_t*)buffer.bits + (size_t)y * row_bytes, 0, (size_t)buffer.width * 4);
+        }
+    }
+    
+    // 更新SwsContext：源帧直接缩放到输出区域内保持宽高比的最大矩形
+    bool updateSwsContext(AVFrame* frame, AVPixelFormat input_format, int out_width, int out_height) {
+        // 严格的输入验证
+        if (!frame || frame->width <= 0 || frame->height <= 0) {
+            LOGE_EVERY(1000, "❌ 无效的帧参数: frame=%p, width=%d, height=%d", 
+                           frame, frame ? frame->width : 0, frame ? frame->height : 0);
+            return false;
+        }
+        
+        // 检查像素格式是否有效
+        if (input_format == AV_PIX_FMT_NONE || input_format < 0) {
+            LOGE_EVERY(1000, "❌ 无效的像素格式: %d", input_format);
+            return false;
+        }
+        
+        // 检查尺寸是否合理
+        if (frame->width > 4096 || frame->height > 4096) {
+            LOGE_EVERY(1000, "❌ 帧尺寸过大: %dx%d", frame->width, frame->height);
+            return false;
+        }
+        
+        // 检查是否需要重建SwsContext
+        if (sws_ctx && 
+            cached_src_width == frame->width && 
+            cached_src_height == frame->height &&
+            cached_src_format == input_format &&
+            cached_out_width == out_width &&
+            cached_out_height == out_height) {
+            return true; // 无需重建
+        }
+        
+        // 显示宽高比考虑SAR（非方形像素）
+        LetterboxRect rect = fitLetterbox(frame->width, frame->height, frame->sample_aspect_ratio.num,
+                                          frame->sample_aspect_ratio.den, out_width, out_height);
+        int dst_width = rect.width;
+        int dst_height = rect.height;
+        
+        // 释放旧的SwsContext
+        if (sws_ctx) {
+            sws_freeContext(sws_ctx);
+            sws_ctx = nullptr;
+        }
+        
+        // 创建新的SwsContext - 添加错误检查
+        LOGD("🔄 创建SwsContext: %dx%d %s->RGBA %dx%d", 
+             frame->width, frame->height, av_get_pix_fmt_name(input_format), dst_width, dst_height);
+        
+        sws_ctx = sws_getContext(
+            frame->width, frame->height, input_format,
+            dst_width, dst_height, AV_PIX_FMT_RGBA,
+            SWS_BILINEAR, nullptr, nullptr, nullptr);
+        
+        if (!sws_ctx) {
+            LOGE("❌ 创建SwsContext失败: %dx%d %s->RGBA", 
+                 frame->width, frame->height, av_get_pix_fmt_name(input_format));
+            return false;
+        }
+        
+        // 更新缓存参数
+        cached_src_width = frame->width;
+        cached_src_height = frame->height;
+        cached_src_format = input_format;
+        cached_out_width = out_width;
+        cached_out_height = out_height;
+        content_rect = rect;
+        
+        LOGI("✅ SwsContext创建成功: %dx%d %s->RGBA %dx%d (输出%dx%d)", 
+             frame->width, frame->height, av_get_pix_fmt_name(input_format),
+             dst_width, dst_height, out_width, out_height);
+        
+        return true;
+    }
+};
+
+// 全局渲染器实例
+static UltraLowLatencyRenderer* g_renderer = nullptr;
+static std::mutex g_renderer_mutex;
+
+// ============================================================================
+// 低延迟音频输出 - OpenSL ES缓冲队列，跟随视频主时钟，不为音频增加视频延迟
+// ============================================================================
+#if FFMPEG_FOUND
+class LowLatencyAudioOutput {
+private:
+    static const int NUM_BUFFERS = AudioSyncPolicy::kMaxQueuedBuffers;
+    
+    AVCodecContext* decoder;
+    AVFrame* frame;
+    AVRational time_base;
+    
+    SLObjectItf engine_obj;
+    SLEngineItf engine;
+    SLObjectItf mix_obj;
+    SLObjectItf player_obj;
+    SLPlayItf play;
+    SLAndroidSimpleBufferQueueItf queue;
+    
+    std::vector<int16_t> buffers[NUM_BUFFERS];          // 缓冲队列按FIFO回调，按序轮换复用
+    int next_buffer;
+    AudioOutputFormat output_format;                    // 当前播放器的格式，sample_rate为0表示尚未创建
+    AudioOutputFormat failed_format;                    // 最近一次创建播放器失败的格式
+    AudioSyncPolicy sync;
+    
+public:
+    LowLatencyAudioOutput() :
+        decoder(nullptr), frame(nullptr), time_base(AVRational{1, 1}),
+        engine_obj(nullptr), engine(nullptr), mix_obj(nullptr), player_obj(nullptr),
+        play(nullptr), queue(nullptr), next_buffer(0) {
+        output_format.sample_rate = 0;
+        output_format.channels = 0;
+        failed_format = output_format;
+    }
+    
+    ~LowLatencyAudioOutput() {
+        close();
+    }
+    
+    // 只打开解码器和OpenSL ES引擎；播放器在第一个解码帧到达时按帧的采样率/声道创建
+    bool open(const AVCodecParameters* par, AVRational stream_time_base) {
+        close();
+        time_base = stream_time_base;
+        failed_format.sample_rate = 0;
+        failed_format.channels = 0;
+        
+        const AVCodec* codec = avcodec_find_decoder(par->codec_id);
+        if (!codec) {
+            LOGE("❌ 找不到音频解码器: %s", avcodec_get_name(par->codec_id));
+            return false;
+        }
+        decoder = avcodec_alloc_context3(codec);
+        frame = av_frame_alloc();
+        if (!decoder || !frame || avcodec_parameters_to_context(decoder, par) < 0 ||
+            avcodec_open2(decoder, codec, nullptr) < 0) {
+            LOGE("❌ 打开音频解码器失败: %s", codec->name);
+            close();
+            return false;
+        }
+        if (!openEngine()) {
+            close();
+            return false;
+        }
+        
+        LOGI("✅ 低延迟音频输出: %s 容器参数%dHz %d声道, 最大排队%d帧", codec->name, par->sample_rate,
+             par->ch_layout.nb_channels, NUM_BUFFERS);
+        return true;
+    }
+    
+    // 解码并排队一个音频包；video_clock_us为当前视频帧的源时间
+    void submit(const AVPacket* pkt, int64_t video_clock_us) {
+        if (!decoder || !engine) {
+            return;
+        }
+        
+        int64_t audio_us = pkt->pts != AV_NOPTS_VALUE ? av_rescale_q(pkt->pts, time_base, AV_TIME_BASE_Q)
+                                                      : AudioSyncPolicy::kNoTimestamp;
+        if (!sync.acceptPacket(audio_us, video_clock_us)) {
+            LOGD_EVERY(1000, "🎵 丢弃落后音频: 落后视频%.1fms (累计%ld)",
+                       (video_clock_us - audio_us) / 1000.0, (long)sync.droppedLate());
+            return;
+        }
+        
+        if (avcodec_send_packet(decoder, pkt) < 0) {
+            return;
+        }
+        while (avcodec_receive_frame(decoder, frame) >= 0) {
+            AudioOutputFormat format = audioOutputFormat(frame->sample_rate, frame->ch_layout.nb_channels);
+            if (format != output_format) {
+                // 同一格式创建失败过就不再逐帧重试
+                if (format == failed_format || !openPlayer(format)) {
+                    failed_format = format;
+                    continue;
+                }
+            }
+            if (!sync.acquireBuffer()) {
+                // 输出队列已满：丢弃而不是等待，音频不积累延迟
+                LOGD_EVERY(1000, "🎵 音频队列已满，丢弃一帧 (累计%ld)", (long)sync.droppedFull());
+                continue;
+            }
+            std::vector<int16_t>& buffer = buffers[next_buffer];
+            if (!convertToS16(frame, buffer)) {
+                sync.cancelBuffer();
+                continue;
+            }
+            SLresult result = (*queue)->Enqueue(queue, buffer.data(), (SLuint32)(buffer.size() * sizeof(int16_t)));
+            if (result == SL_RESULT_SUCCESS) {
+                next_buffer = (next_buffer + 1) % NUM_BUFFERS;
+            } else {
+                sync.cancelBuffer();
+            }
+        }
+    }
+    
+    void close() {
+        closePlayer();
+        if (mix_obj) {
+            (*mix_obj)->Destroy(mix_obj);
+        }
+        if (engine_obj) {
+            (*engine_obj)->Destroy(engine_obj);
+        }
+        mix_obj = nullptr;
+        engine_obj = nullptr;
+        engine = nullptr;
+        
+        if (decoder) {
+            avcodec_free_context(&decoder);
+        }
+        if (frame) {
+            av_frame_free(&frame);
+        }
+    }
+    
+private:
+    static void onBufferDone(SLAndroidSimpleBufferQueueItf /* queue */, void* context) {
+        LowLatencyAudioOutput* self = static_cast<LowLatencyAudioOutput*>(context);
+        self->sync.releaseBuffer();
+    }
+    
+    bool openEngine() {
+        if (slCreateEngine(&engine_obj, 0, nullptr, 0, nullptr, nullptr) != SL_RESULT_SUCCESS ||
+            (*engine_obj)->Realize(engine_obj, SL_BOOLEAN_FALSE) != SL_RESULT_SUCCESS ||
+            (*engine_obj)->GetInterface(engine_obj, SL_IID_ENGINE, &engine) != SL_RESULT_SUCCESS) {
+            LOGE("❌ 创建OpenSL ES引擎失败");
+            engine = nullptr;
+            return false;
+        }
+        if ((*engine)->CreateOutputMix(engine, &mix_obj, 0, nullptr, nullptr) != SL_RESULT_SUCCESS ||
+            (*mix_obj)->Realize(mix_obj, SL_BOOLEAN_FALSE) != SL_RESULT_SUCCESS) {
+            LOGE("❌ 创建OpenSL ES输出混音器失败");
+            engine = nullptr;
+            return false;
+        }
+        return true;
+    }
+    
+    // 销毁播放器，已排队的缓冲随之作废
+    void closePlayer() {
+        if (play) {
+            (*play)->SetPlayState(play, SL_PLAYSTATE_STOPPED);
+        }
+        if (queue) {
+            (*queue)->Clear(queue);
+        }
+        if (player_obj) {
+            (*player_obj)->Destroy(player_obj);
+        }
+        player_obj = nullptr;
+        play = nullptr;
+        queue = nullptr;
+        output_format.sample_rate = 0;
+        output_format.channels = 0;
+        sync.reset();
+        next_buffer = 0;
+    }
+    
+    // 按解码帧的格式（重新）创建播放器：首帧时创建，流中途采样率/声道变化时重建
+    bool openPlayer(const AudioOutputFormat& format) {
+        closePlayer();
+        if (format.sample_rate <= 0) {
+            return false;
+        }
+        
+        SLDataLocator_AndroidSimpleBufferQueue loc_queue = {SL_DATALOCATOR_ANDROIDSIMPLEBUFFERQUEUE, NUM_BUFFERS};
+        SLDataFormat_PCM format_pcm = {
+            SL_DATAFORMAT_PCM, (SLuint32)format.channels, (SLuint32)format.sample_rate * 1000,
+            SL_PCMSAMPLEFORMAT_FIXED_16, SL_PCMSAMPLEFORMAT_FIXED_16,
+            (SLuint32)(format.channels == 2 ? (SL_SPEAKER_FRONT_LEFT | SL_SPEAKER_FRONT_RIGHT) : SL_SPEAKER_FRONT_CENTER),
+            SL_BYTEORDER_LITTLEENDIAN
+        };
+        SLDataSource source = {&loc_queue, &format_pcm};
+        SLDataLocator_OutputMix loc_mix = {SL_DATALOCATOR_OUTPUTMIX, mix_obj};
+        SLDataSink sink = {&loc_mix, nullptr};
+        
+        const SLInterfaceID ids[] = {SL_IID_ANDROIDSIMPLEBUFFERQUEUE};
+        const SLboolean required[] = {SL_BOOLEAN_TRUE};
+        if ((*engine)->CreateAudioPlayer(engine, &player_obj, &source, &sink, 1, ids, required) != SL_RESULT_SUCCESS ||
+            (*player_obj)->Realize(player_obj, SL_BOOLEAN_FALSE) != SL_RESULT_SUCCESS ||
+            (*player_obj)->GetInterface(player_obj, SL_IID_PLAY, &play) != SL_RESULT_SUCCESS ||
+            (*player_obj)->GetInterface(player_obj, SL_IID_ANDROIDSIMPLEBUFFERQUEUE, &queue) != SL_RESULT_SUCCESS) {
+            LOGE("❌ 创建OpenSL ES播放器失败: %dHz %d声道", format.sample_rate, format.channels);
+            closePlayer();
+            return false;
+        }
+        
+        (*queue)->RegisterCallback(queue, onBufferDone, this);
+        (*play)->SetPlayState(play, SL_PLAYSTATE_PLAYING);
+        output_format = format;
+        LOGI("🎵 音频播放器: 解码输出%dHz %d声道", format.sample_rate, format.channels);
+        return true;
+    }
+    
+    // 转换为交错S16（AAC解码输出为FLTP）
+    bool convertToS16(const AVFrame* src, std::vector<int16_t>& out) {
+        int samples = src->nb_samples;
+        int src_channels = src->ch_layout.nb_channels;
+        int channels = output_format.channels;
+        if (samples <= 0 || src_channels <= 0) {
+            return false;
+        }
+        out.resize((size_t)samples * channels);
+        
+        for (int ch = 0; ch < channels; ch++) {
+            int src_ch = std::min(ch, src_channels - 1);
+            for (int i = 0; i < samples; i++) {
+                int16_t value;
+                switch (src->format) {
+                    case AV_SAMPLE_FMT_FLTP: {
+                        float v = ((const float*)src->extended_data[src_ch])[i];
+                        value = (int16_t)std::max(-32768.0f, std::min(32767.0f, v * 32767.0f));
+                        break;
+                    }
+                    case AV_SAMPLE_FMT_FLT: {
+                        float v = ((const float*)src->extended_data[0])[i * src_channels + src_ch];
+                        value = (int16_t)std::max(-32768.0f, std::min(32767.0f, v * 32767.0f));
+                        break;
+                    }
+                    case AV_SAMPLE_FMT_S16P:
+                        value = ((const int16_t*)src->extended_data[src_ch])[i];
+                        break;
+                    case AV_SAMPLE_FMT_S16:
+                        value = ((const int16_t*)src->extended_data[0])[i * src_channels + src_ch];
+                        break;
+                    default:
+                        LOGE("❌ 不支持的音频采样格式: %s", av_get_sample_fmt_name((AVSampleFormat)src->format));
+                        return false;
+                }
+                out[(size_t)i * channels + ch] = value;
+            }
+        }
+        return true;
+    }
+};
+
+// 全局音频输出（默认关闭，由setAudioPlaybackEnabled开启）
+static LowLatencyAudioOutput* g_audio_output = nullptr;
+static std::mutex g_audio_mutex;
+static std::atomic<bool> g_audio_playback_enabled(false);
+#endif
+
+// ============================================================================
+// 截图 - 播放线程只引用最新帧，颜色转换和JPEG/PNG编码在后台线程完成
+// ============================================================================
+#if FFMPEG_FOUND
+static JavaVM* g_java_vm = nullptr;     // JNI_OnLoad中保存，供后台线程回调Java
+static std::chrono::steady_clock::time_point g_library_load_time;   // 冷启动计时起点
+static std::atomic<bool> g_first_frame_reported(false);
+
+enum SnapshotFormat {
+    SNAPSHOT_FORMAT_JPEG = 0,
+    SNAPSHOT_FORMAT_PNG = 1
+};
+
+class SnapshotWorker {
+public:
+    struct Job {
+        AVFrame* frame;                 // 最新解码帧的引用
+        PixelFormatDescriptor format;
+        std::string path;
+        int image_format;
+        int quality;                    // 1-100，JPEG质量；PNG忽略
+        jobject callback;               // 全局引用，可为nullptr
+        int64_t request_us;
+    };
+    
+    static SnapshotWorker& getInstance() {
+        static SnapshotWorker instance;
+        return instance;
+    }
+    
+    // 入队后立即返回；已有截图在处理时拒绝新的请求，避免堆积
+    bool submit(Job* job) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!worker.joinable()) {
+            jobs.reopen();
+            worker = std::thread(&SnapshotWorker::workerLoop, this);
+        }
+        return jobs.tryPush(job);
+    }
+    
+    void shutdown() {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.close();
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    
+private:
+    static const size_t kMaxPendingJobs = 2;
+    
+    std::mutex mutex;
+    std::thread worker;
+    BoundedQueue<Job*> jobs;
+    
+    SnapshotWorker() : jobs(kMaxPendingJobs) {}
+    
+    void workerLoop() {
+        JNIEnv* env = nullptr;
+        if (g_java_vm && g_java_vm->AttachCurrentThread(&env, nullptr) != JNI_OK) {
+            env = nullptr;
+        }
+        
+        Job* job = nullptr;
+        while (jobs.pop(job)) {
+            bool ok = encodeToFile(job);
+            int64_t elapsed_ms = (av_gettime_relative() - job->request_us) / 1000;
+            LOGI("📸 截图%s: %s (%dx%d, 请求到落盘%lldms)", ok ? "完成" : "失败", job->path.c_str(),
+                 job->frame->width, job->frame->height, (long long)elapsed_ms);
+            
+            if (env && job->callback) {
+                jclass callback_class = env->GetObjectClass(job->callback);
+                jmethodID on_snapshot = env->GetMethodID(callback_class, "onSnapshot", "(Ljava/lang/String;ZJ)V");
+                if (on_snapshot) {
+                    jstring jpath = env->NewStringUTF(job->path.c_str());
+                    env->CallVoidMethod(job->callback, on_snapshot, jpath, (jboolean)(ok ? JNI_TRUE : JNI_FALSE),
+                                        (jlong)elapsed_ms);
+                    env->DeleteLocalRef(jpath);
+                }
+                if (env->ExceptionCheck()) {
+                    env->ExceptionDescribe();
+                    env->ExceptionClear();
+                }
+                env->DeleteLocalRef(callback_class);
+                env->DeleteGlobalRef(job->callback);
+            }
+            av_frame_free(&job->frame);
+            delete job;
+        }
+        
+        if (env) {
+            g_java_vm->DetachCurrentThread();
+        }
+    }
+    
+    bool encodeToFile(Job* job) {
+        bool png = job->image_format == SNAPSHOT_FORMAT_PNG;
+        const AVCodec* codec = avcodec_find_encoder(png ? AV_CODEC_ID_PNG : AV_CODEC_ID_MJPEG);
+        if (!codec || !job->format.hasCpuData()) {
+            LOGE("❌ 截图: %s", codec ? "当前帧没有CPU可访问数据（MediaCodec Surface输出）" : "缺少图像编码器");
+            return false;
+        }
+        
+        AVPixelFormat dst_format = png ? AV_PIX_FMT_RGB24 : AV_PIX_FMT_YUVJ420P;
+        AVFrame* image = av_frame_alloc();
+        AVCodecContext* ctx = avcodec_alloc_context3(codec);
+        AVPacket* pkt = av_packet_alloc();
+        bool ok = image && ctx && pkt;
+        
+        if (ok) {
+            image->format = dst_format;
+            image->width = job->frame->width;
+            image->height = job->frame->height;
+            ok = av_frame_get_buffer(image, 32) >= 0;
+        }
+        if (ok) {
+            SwsContext* sws = sws_getContext(job->frame->width, job->frame->height, job->format.layout,
+                                             image->width, image->height, dst_format,
+                                             SWS_BILINEAR, nullptr, nullptr, nullptr);
+            ok = sws && sws_scale(sws, job->frame->data, job->frame->linesize, 0, job->frame->height,
+                                  image->data, image->linesize) > 0;
+            sws_freeContext(sws);
+        }
+        if (ok) {
+            ctx->width = image->width;
+            ctx->height = image->height;
+            ctx->pix_fmt = dst_format;
+            ctx->time_base = AVRational{1, 25};
+            if (png) {
+                ctx->compression_level = 3;     // 速度优先，截图不追求极限压缩率
+            } else {
+                // 质量1-100映射到qscale 31-2
+                int quality = std::max(1, std::min(job->quality, 100));
+                int qscale = 2 + (100 - quality) * 29 / 99;
+                ctx->flags |= AV_CODEC_FLAG_QSCALE;
+                ctx->global_quality = FF_QP2LAMBDA * qscale;
+                image->quality = ctx->global_quality;
+            }
+            ok = avcodec_open2(ctx, codec, nullptr) >= 0 &&
+                 avcodec_send_frame(ctx, image) >= 0 &&
+                 avcodec_receive_packet(ctx, pkt) >= 0;
+        }
+        if (ok) {
+            FILE* file = fopen(job->path.c_str(), "wb");
+            ok = file && fwrite(pkt->data, 1, pkt->size, file) == (size_t)pkt->size;
+            if (file) {
+                ok = fclose(file) == 0 && ok;
+            }
+        }
+        
+        av_packet_free(&pkt);
+        avcodec_free_context(&ctx);
+        av_frame_free(&image);
+        return ok;
+    }
+};
+#endif
+
+// ============================================================================
+// 帧导出 - 最新解码帧复制到固定的native缓冲池，以direct ByteBuffer交给Java分析
+// ============================================================================
+#if FFMPEG_FOUND
+// FrameBuffer Java类缓存（JNI_OnLoad中初始化）
+static jclass g_frame_buffer_class = nullptr;
+static jmethodID g_frame_buffer_ctor = nullptr;
+static jfieldID g_frame_buffer_slot = nullptr;
+static jfieldID g_frame_buffer_pts = nullptr;
+static jfieldID g_frame_buffer_sequence = nullptr;
+
+enum FrameExportFormat {
+    FRAME_EXPORT_I420 = 0,
+    FRAME_EXPORT_NV12 = 1,
+    FRAME_EXPORT_NV21 = 2
+};
+
+// 每个槽位的内存和对应的Java对象（含各平面的direct ByteBuffer）只在分辨率/格式变化时重建，
+// 每帧只做一次native平面复制，Java侧不分配对象也不复制
+class FrameExportPool {
+public:
+    static const int kSlotCount = 3;
+    
+    static FrameExportPool& getInstance() {
+        static FrameExportPool instance;
+        return instance;
+    }
+    
+    // 返回FrameBuffer局部引用；没有新帧或所有槽位都被Java持有时返回nullptr
+    jobject acquire(JNIEnv* env, AVFrame* frame, const PixelFormatDescriptor& desc, uint64_t serial) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (serial == last_serial || !desc.hasCpuData() || !g_frame_buffer_class) {
+            return nullptr;
+        }
+        
+        Slot* slot = nullptr;
+        int slot_index = -1;
+        for (int i = 0; i < kSlotCount; i++) {
+            if (!slots[i].in_use) {
+                slot = &slots[i];
+                slot_index = i;
+                break;
+            }
+        }
+        if (!slot) {
+            exhausted_count++;
+            return nullptr;
+        }
+        
+        int format = exportFormatFor(desc.layout);
+        if (!ensureSlot(env, slot_index, frame->width, frame->height, format)) {
+            return nullptr;
+        }
+        int64_t copy_start_us = av_gettime_relative();
+        if (!copyFrame(frame, desc, *slot)) {
+            return nullptr;
+        }
+        window_copy_us += av_gettime_relative() - copy_start_us;
+        
+        int64_t pts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+        env->SetLongField(slot->java_buffer, g_frame_buffer_pts, (jlong)pts);
+        env->SetLongField(slot->java_buffer, g_frame_buffer_sequence, (jlong)serial);
+        slot->in_use = true;
+        last_serial = serial;
+        reportThroughput();
+        return env->NewLocalRef(slot->java_buffer);
+    }
+    
+    void release(JNIEnv* env, jobject frame_buffer) {
+        jint slot_index = env->GetIntField(frame_buffer, g_frame_buffer_slot);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (slot_index >= 0 && slot_index < kSlotCount &&
+            env->IsSameObject(frame_buffer, slots[slot_index].java_buffer)) {
+            slots[slot_index].in_use = false;
+        }
+    }
+    
+    // 流关闭时释放内存；仍被Java持有的槽位保留，直到Java调用release后下次重置
+    void reset(JNIEnv* env) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int i = 0; i < kSlotCount; i++) {
+            if (!slots[i].in_use) {
+                freeSlot(env, slots[i]);
+            }
+        }
+        sws_freeContext(sws_ctx);
+        sws_ctx = nullptr;
+        last_serial = 0;
+    }
+    
+private:
+    struct Slot {
+        uint8_t* data;
+        int width;
+        int height;
+        int format;
+        jobject java_buffer;    // 全局引用
+        bool in_use;
+        
+        Slot() : data(nullptr), width(0), height(0), format(-1), java_buffer(nullptr), in_use(false) {}
+    };
+    
+    std::mutex mutex;
+    Slot slots[kSlotCount];
+    SwsContext* sws_ctx;
+    uint64_t last_serial;
+    int64_t window_start_us;
+    int64_t window_copy_us;
+    int window_frames;
+    int exhausted_count;
+    
+    FrameExportPool() :
+        sws_ctx(nullptr), last_serial(0), window_start_us(0), window_copy_us(0), window_frames(0), exhausted_count(0) {}
+    
+    static int exportFormatFor(AVPixelFormat layout) {
+        switch (layout) {
+            case AV_PIX_FMT_YUV420P:
+            case AV_PIX_FMT_YUVJ420P:
+                return FRAME_EXPORT_I420;
+            case AV_PIX_FMT_NV21:
+                return FRAME_EXPORT_NV21;
+            default:
+                return FRAME_EXPORT_NV12;   // NV12直接复制，其他布局经sws转换为NV12
+        }
+    }
+    
+    static int chromaWidth(int width) { return (width + 1) / 2; }
+    static int chromaHeight(int height) { return (height + 1) / 2; }
+    
+    void freeSlot(JNIEnv* env, Slot& slot) {
+        if (slot.java_buffer) {
+            env->DeleteGlobalRef(slot.java_buffer);
+            slot.java_buffer = nullptr;
+        }
+        av_freep(&slot.data);
+        slot.width = slot.height = 0;
+        slot.format = -1;
+    }
+    
+    bool ensureSlot(JNIEnv* env, int slot_index, int width, int height, int format) {
+        Slot& slot = slots[slot_index];
+        if (slot.java_buffer && slot.width == width && slot.height == height && slot.format == format) {
+            return true;
+        }
+        freeSlot(env, slot);
+        
+        size_t luma_size = (size_t)width * height;
+        size_t chroma_size = (size_t)chromaWidth(width) * chromaHeight(height);
+        slot.data = (uint8_t*)av_malloc(luma_size + chroma_size * 2);
+        if (!slot.data) {
+            return false;
+        }
+        
+        int plane_count = format == FRAME_EXPORT_I420 ? 3 : 2;
+        jclass byte_buffer_class = env->FindClass("java/nio/ByteBuffer");
+        jobjectArray planes = env->NewObjectArray(plane_count, byte_buffer_class, nullptr);
+        env->DeleteLocalRef(byte_buffer_class);
+        jintArray strides = env->NewIntArray(plane_count);
+        if (!planes || !strides) {
+            av_freep(&slot.data);
+            return false;
+        }
+        jint stride_values[3] = {width, 0, 0};
+        if (format == FRAME_EXPORT_I420) {
+            stride_values[1] = stride_values[2] = chromaWidth(width);
+            jobject u = env->NewDirectByteBuffer(slot.data + luma_size, (jlong)chroma_size);
+            jobject v = env->NewDirectByteBuffer(slot.data + luma_size + chroma_size, (jlong)chroma_size);
+            env->SetObjectArrayElement(planes, 1, u);
+            env->SetObjectArrayElement(planes, 2, v);
+            env->DeleteLocalRef(u);
+            env->DeleteLocalRef(v);
+        } else {
+            stride_values[1] = chromaWidth(width) * 2;
+            jobject uv = env->NewDirectByteBuffer(slot.data + luma_size, (jlong)(chroma_size * 2));
+            env->SetObjectArrayElement(planes, 1, uv);
+            env->DeleteLocalRef(uv);
+        }
+        jobject y = env->NewDirectByteBuffer(slot.data, (jlong)luma_size);
+        env->SetObjectArrayElement(planes, 0, y);
+        env->DeleteLocalRef(y);
+        env->SetIntArrayRegion(strides, 0, plane_count, stride_values);
+        
+        jobject buffer = env->NewObject(g_frame_buffer_class, g_frame_buffer_ctor, (jint)slot_index,
+                                        (jint)width, (jint)height, (jint)format, planes, strides);
+        env->DeleteLocalRef(planes);
+        env->DeleteLocalRef(strides);
+        if (!buffer) {
+            av_freep(&slot.data);
+            return false;
+        }
+        slot.java_buffer = env->NewGlobalRef(buffer);
+        env->DeleteLocalRef(buffer);
+        slot.width = width;
+        slot.height = height;
+        slot.format = format;
+        
+        LOGI("🧩 帧导出槽位%d: %dx%d %s", slot_index, width, height,
+             format == FRAME_EXPORT_I420 ? "I420" : (format == FRAME_EXPORT_NV21 ? "NV21" : "NV12"));
+        return true;
+    }
+    
+    // 每帧复制一次，而不是把解码器帧的引用交给Java：Java持有期间解码器的缓冲区回不到帧池，
+    // 平面还带着解码器的行对齐填充。复制的代价（frame_export_benchmark，主机单核实测）：
+    // I420/NV12直接复制1080p约0.5ms/帧、720p约0.2ms/帧，交付上限在1000fps以上；
+    // 其他布局经sws转换为NV12，1080p YUV422P约3.7ms/帧。吞吐日志同时输出平均复制耗时
+    bool copyFrame(const AVFrame* frame, const PixelFormatDescriptor& desc, Slot& slot) {
+        int width = slot.width;
+        int height = slot.height;
+        uint8_t* y = slot.data;
+        uint8_t* chroma = slot.data + (size_t)width * height;
+        int chroma_w = chromaWidth(width);
+        int chroma_h = chromaHeight(height);
+        
+        switch (desc.layout) {
+            case AV_PIX_FMT_YUV420P:
+            case AV_PIX_FMT_YUVJ420P:
+                av_image_copy_plane(y, width, frame->data[0], frame->linesize[0], width, height);
+                av_image_copy_plane(chroma, chroma_w, frame->data[1], frame->linesize[1], chroma_w, chroma_h);
+                av_image_copy_plane(chroma + (size_t)chroma_w * chroma_h, chroma_w,
+                                    frame->data[2], frame->linesize[2], chroma_w, chroma_h);
+                return true;
+            case AV_PIX_FMT_NV12:
+            case AV_PIX_FMT_NV21:
+                av_image_copy_plane(y, width, frame->data[0], frame->linesize[0], width, height);
+                av_image_copy_plane(chroma, chroma_w * 2, frame->data[1], frame->linesize[1], chroma_w * 2, chroma_h);
+                return true;
+            default: {
+                sws_ctx = sws_getCachedContext(sws_ctx, width, height, desc.layout, width, height, AV_PIX_FMT_NV12,
+                                               SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
+                if (!sws_ctx) {
+                    return false;
+                }
+                uint8_t* dst_data[4] = {y, chroma, nullptr, nullptr};
+                int dst_linesize[4] = {width, chroma_w * 2, 0, 0};
+                return sws_scale(sws_ctx, frame->data, frame->linesize, 0, height, dst_data, dst_linesize) > 0;
+            }
+        }
+    }
+    
+    // 每5秒输出一次交付给Java消费者的帧率和平均复制耗时
+    void reportThroughput() {
+        int64_t now = av_gettime_relative();
+        if (window_frames == 0) {
+            window_start_us = now;
+        }
+        window_frames++;
+        int64_t elapsed = now - window_start_us;
+        if (elapsed >= 5000000) {
+            LOGI("📊 帧导出: %.1f fps, 复制%.2fms/帧 (槽位耗尽%d次)", window_frames * 1000000.0 / elapsed,
+                 window_copy_us / 1000.0 / window_frames, exhausted_count);
+            window_frames = 0;
+            window_copy_us = 0;
+            exhausted_count = 0;
+        }
+    }
+};
+#endif
+
+
+// FFmpeg管理类
+class FFmpegManager {
+private:
+    static FFmpegManager* instance;
+    static std::mutex mutex_;
+    std::atomic<bool> initialized;
+    std::mutex init_mutex;     // 首次初始化可能同时来自预热线程与UI线程
+    bool load_failed;          // dlopen失败后不再反复重试
+    void* ffmpeg_handle;
+
+    FFmpegManager() : initialized(false), load_failed(false), ffmpeg_handle(nullptr) {}
+
+public:
+    static FFmpegManager* getInstance() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (instance == nullptr) {
+            instance = new FFmpegManager();
+        }
+        return instance;
+    }
+
+    bool initializeFFmpeg() {
+        if (initialized.load(std::memory_order_acquire)) {
+            return true;
+        }
+
+#if FFMPEG_FOUND
+        std::lock_guard<std::mutex> lock(init_mutex);
+        if (initialized.load(std::memory_order_relaxed)) {
+            return true;
+        }
+        if (load_failed) {
+            return false;
+        }
+        LOGI("Initializing FFmpeg...");
+
+#if FFMPEG_DYNAMIC_LOAD
+        // 首次使用时才加载libffmpeg.so，冷启动不再承担其重定位开销
+        if (!loadFFmpegLibrary(ffmpeg_handle)) {
+            load_failed = true;
+            return false;
+        }
+#endif
+        logCompileTimeConfig();
+
+        // 初始化FFmpeg网络模块
+        avformat_network_init();
+
+        // 注册所有编解码器和格式
+        // 注意：在新版本FFmpeg中，这些函数已经被弃用，因为注册是自动的
+        // av_register_all(); // 已弃用
+        // avcodec_register_all(); // 已弃用
+
+        initialized.store(true, std::memory_order_release);
+        LOGI("✅ FFmpeg initialized successfully");
+        return true;
+#else
+        LOGE("❌ FFmpeg not compiled");
+        return false;
+#endif
+    }
+
+    void cleanupFFmpeg() {
+        if (!initialized) {
+            return;
+        }
+
+#if FFMPEG_FOUND
+        LOGI("Cleaning up FFmpeg...");
+        avformat_network_deinit();
+        // 不dlclose：工作线程或静态对象可能仍持有函数表中的指针
+        initialized = false;
+        LOGI("✅ FFmpeg cleanup completed");
+#endif
+    }
+
+    bool isInitialized() const {
+        return initialized;
+    }
+
+    std::string getVersion() {
+#if FFMPEG_FOUND
+        if (!initialized) {
+            return "FFmpeg not initialized";
+        }
+        return std::string("FFmpeg ") + av_version_info();
+#else
+        return "FFmpeg not available";
+#endif
+    }
+};
+
+// 静态成员定义
+FFmpegManager* FFmpegManager::instance = nullptr;
+std::mutex FFmpegManager::mutex_;
+
+// 全局变量 - 移到条件编译块外，确保总是可用
+static bool hardware_decode_enabled = true;
+static bool hardware_decode_available = false;
+static bool rtsp_connected = false;
+static bool rtsp_recording = false;
+static int processed_frame_count = 0;
+static long total_decode_time = 0;
+static int video_stream_index = -1;
+
+// Surface和渲染相关变量
+static ANativeWindow* native_window = nullptr;
+static ANativeWindow_Buffer window_buffer;
+static bool surface_locked = false;  // 跟踪Surface锁定状态
+static bool surface_valid = false;   // 跟踪Surface有效性
+static bool surface_ready = false;   // 跟踪Surface是否准备好渲染
+static std::mutex surface_mutex;     // Surface访问保护
+static std::mutex frame_processing_mutex; // 帧处理保护
+
+// 简化的Surface管理 - 不绑定Activity生命周期
+static std::atomic<bool> surface_being_recreated(false); // Surface正在重建
+static std::condition_variable surface_cv; // Surface状态变化通知
+
+
+#if FFMPEG_FOUND
+// FFmpeg相关的全局变量 - 只有在FFmpeg可用时才声明
+static AVFormatContext* rtsp_input_ctx = nullptr;
+static AVFormatContext* rtsp_output_ctx = nullptr;
+static AVCodecContext* decoder_ctx = nullptr;
+static SwsContext* sws_ctx = nullptr;
+static AVFrame* frame = nullptr;
+static AVFrame* frame_rgba = nullptr;
+static AVRational video_stream_timebase = {1, 1000000}; // 默认微秒时间基准
+#endif
+
+// FFmpeg初始化和清理函数
+static bool initializeFFmpegInternal() {
+    return FFmpegManager::getInstance()->initializeFFmpeg();
+}
+
+// 清理路径只检查不加载：库未加载时函数表为空，也不可能有需要释放的FFmpeg对象
+static bool isFFmpegLoaded() {
+    return FFmpegManager::getInstance()->isInitialized();
+}
+
+// 渲染帧到Surface的辅助函数
+#if FFMPEG_FOUND
+static void renderFrameToSurface(AVFrame* frame, const PixelFormatDescriptor& format) {
+    // 线程安全的Surface有效性检查
+    std::lock_guard<std::mutex> lock(surface_mutex);
+
+    // 检查Surface是否正在重建
+    if (surface_being_recreated.load()) {
+        LOGD_EVERY(1000, "🔄 Surface正在重建，跳过渲染");
+        return;
+    }
+
+    if (!native_window || !frame || !surface_valid || !surface_ready) {
+        LOGW_EVERY(1000, "⚠️ Surface无效或帧为空: native_window=%p, frame=%p, surface_valid=%s, surface_ready=%s",
+                   native_window, frame, surface_valid ? "true" : "false", surface_ready ? "true" : "false");
+        return;
+    }
+
+    // 双重检查Surface有效性
+    if (surface_locked) {
+        LOGW_EVERY(1000, "⚠️ Surface已被锁定，跳过渲染");
+        return;
+    }
+
+    // 基本帧数据验证
+    if (frame->width <= 0 || frame->height <= 0 || frame->format < 0) {
+        LOGE_EVERY(1000, "❌ 无效帧尺寸或格式: size=%dx%d, format=%d",
+                   frame->width, frame->height, frame->format);
+        return;
+    }
+
+    LOGD_EVERY(1000, "🎨 进入渲染函数: %dx%d, format=%d, data[0]=%p",
+               frame->width, frame->height, frame->format, frame->data[0]);
+
+    // 对于硬件解码，data[0]可能为空，这是正常的
+    if (!hardware_decode_available && !frame->data[0]) {
+        LOGE("❌ 软件解码帧缺少数据: data[0]=%p", frame->data[0]);
+        return;
+    }
+
+    LOGD_EVERY(1000, "🎬 渲染帧: %dx%d, format=%d, data[0]=%p, data[1]=%p, data[3]=%p",
+               frame->width, frame->height, frame->format,
+               frame->data[0], frame->data[1], frame->data[3]);
+
+    // MediaCodec Surface输出 - 释放缓冲区即直接渲染到Surface
+    if (format.hw_surface) {
+        int ret = av_mediacodec_release_buffer((AVMediaCodecBuffer*)frame->data[3], 1);
+        if (ret < 0) {
+            LOGE("❌ MediaCodec缓冲区释放失败: %d", ret);
+        }
+        return;
+    }
+    if (!format.hasCpuData()) {
+        return;
+    }
+
+    // 只在第一次或尺寸变化时设置缓冲区几何
+    static int last_width = 0, last_height = 0;
+    if (last_width != frame->width || last_height != frame->height) {
+        int ret = ANativeWindow_setBuffersGeometry(native_window, frame->width, frame->height, WINDOW_FORMAT_RGBA_8888);
+        if (ret != 0) {
+            LOGE("❌ 设置Surface缓冲区几何失败: %d", ret);
+            return;
+        }
+        last_width = frame->width;
+        last_height = frame->height;
+        LOGI("✅ 设置Surface缓冲区: %dx%d", frame->width, frame->height);
+    }
+
+    // 像素格式来自流级别的描述，不再根据linesize/data指针猜测
+    AVPixelFormat input_format = format.layout;
+
+    // 线程安全的SwsContext管理
+    static SwsContext* cached_sws_ctx = nullptr;
+    static int cached_width = 0, cached_height = 0;
+    static AVPixelFormat cached_format = AV_PIX_FMT_NONE;
+    static std::mutex sws_mutex;
+
+    SwsContext* current_sws_ctx = nullptr;
+
+    // 线程安全地获取SwsContext - 添加Surface状态检查
+    {
+        std::lock_guard<std::mutex> sws_lock(sws_mutex);
+
+        // 检查Surface状态，防止在Surface重建期间操作SwsContext
+        if (surface_being_recreated.load() || !surface_valid) {
+            LOGD_EVERY(1000, "🛑 Surface重建中或无效，跳过SwsContext操作");
+            return;
+        }
+
+        // 更新SwsContext（如果需要）
+        if (!cached_sws_ctx || cached_width != frame->width || cached_height != frame->height || cached_format != input_format) {
+
+            // 释放旧的SwsContext
+            if (cached_sws_ctx) {
+                sws_freeContext(cached_sws_ctx);
+                cached_sws_ctx = nullptr;
+            }
+
+            cached_sws_ctx = sws_getContext(
+                    frame->width, frame->height, input_format,
+                    frame->width, frame->height, AV_PIX_FMT_RGBA,
+                    SWS_BILINEAR, nullptr, nullptr, nullptr);
+
+            if (!cached_sws_ctx) {
+                LOGE("❌ SwsContext创建失败: %s->RGBA", av_get_pix_fmt_name(input_format));
+                return;
+            }
+            cached_format = input_format;
+            LOGD("🔄 SwsContext创建成功: %dx%d, %s->RGBA",
+                 frame->width, frame->height, av_get_pix_fmt_name(input_format));
+
+            cached_width = frame->width;
+            cached_height = frame->height;
+        }
+
+        current_sws_ctx = cached_sws_ctx;
+    }
+
+    // 检查SwsContext是否有效
+    if (!current_sws_ctx) {
+        LOGE("❌ SwsContext无效，跳过渲染");
+        return;
+    }
+
+    // 再次检查Surface状态（SwsContext获取后可能Surface已变化）
+    if (!surface_valid || !native_window) {
+        LOGW("⚠️ Surface在SwsContext获取后变为无效，跳过渲染");
+        return;
+    }
+
+    // 超低延迟渲染：激进的跳帧策略
+    static auto last_render_time = std::chrono::steady_clock::now();
+    auto current_time = std::chrono::steady_clock::now();
+    auto time_since_last = std::chrono::duration_cast<std::chrono::milliseconds>(
+            current_time - last_render_time).count();
+
+    // 超智能跳帧策略：基于实际性能动态调整
+    static int consecutive_slow_renders = 0;
+    static int consecutive_fast_renders = 0;
+    static int adaptive_threshold = 30; // 动态调整的跳帧阈值
+    static auto last_threshold_update = std::chrono::steady_clock::now();
+
+    // 性能检测和阈值调整
+    if (time_since_last > 50) {
+        // 渲染很慢
+        consecutive_slow_renders++;
+        consecutive_fast_renders = 0;
+
+        if (consecutive_slow_renders > 3) {
+            adaptive_threshold = std::max(15, adaptive_threshold - 2); // 降低阈值，允许更频繁渲染
+        }
+    } else if (time_since_last < 20) {
+        // 渲染很快
+        consecutive_fast_renders++;
+        consecutive_slow_renders = 0;
+
+        if (consecutive_fast_renders > 5) {
+            adaptive_threshold = std::min(35, adaptive_threshold + 1); // 提高阈值，减少不必要渲染
+        }
+    } else {
+        // 渲染正常
+        consecutive_slow_renders = 0;
+        consecutive_fast_renders = 0;
+    }
+
+    // 定期重置阈值（避免长期偏移）
+    auto now = std::chrono::steady_clock::now();
+    if (std::chrono::duration_cast<std::chrono::seconds>(now - last_threshold_update).count() > 10) {
+        adaptive_threshold = 30; // 重置为默认值
+        last_threshold_update = now;
+    }
+
+    // 应用智能跳帧策略
+    if (time_since_last < adaptive_threshold) {
+        LOGD_EVERY(2000, "🧠 智能跳帧: %lldms < %dms (慢渲染:%d, 快渲染:%d)",
+                   (long long)time_since_last, adaptive_threshold, consecutive_slow_renders, consecutive_fast_renders);
+        return;
+    }
+
+    // 最终Surface安全检查
+    if (surface_locked || !surface_valid || !native_window) {
+        LOGW_EVERY(1000, "⚠️ 最终检查失败: locked=%s, valid=%s, window=%p",
+                   surface_locked ? "true" : "false",
+                   surface_valid ? "true" : "false",
+                   native_window);
+        return;
+    }
+
+    // 尝试非阻塞锁定
+    ANativeWindow_Buffer buffer;
+    int lock_ret = ANativeWindow_lock(native_window, &buffer, nullptr);
+    if (lock_ret != 0) {
+        LOGW_EVERY(1000, "⚠️ ANativeWindow_lock失败: %d，可能Surface已销毁", lock_ret);
+        // Surface可能已经无效，标记为无效
+        surface_valid = false;
+        return;
+    }
+
+    // 成功锁定，标记状态
+    surface_locked = true;
+
+    // 计算目标参数
+    int dst_stride = buffer.stride * 4;
+    uint8_t* dst_data[4] = {(uint8_t*)buffer.bits, nullptr, nullptr, nullptr};
+    int dst_linesize[4] = {dst_stride, 0, 0, 0};
+
+    // 最后一次检查：确保所有指针有效且Surface未被重建
+    if (!current_sws_ctx || !frame->data[0] || !dst_data[0] || !surface_valid || surface_being_recreated.load()) {
+        LOGE("❌ sws_scale前检查失败: sws_ctx=%p, frame_data=%p, dst_data=%p, surface_valid=%s, recreating=%s",
+             current_sws_ctx, frame->data[0], dst_data[0], surface_valid ? "true" : "false",
+             surface_being_recreated.load() ? "true" : "false");
+        ANativeWindow_unlockAndPost(native_window);
+        surface_locked = false;
+        return;
+    }
+
+    // 直接转换到window buffer - 使用线程安全的SwsContext
+    // 再次检查Surface状态，这是最后的保护
+    if (surface_being_recreated.load()) {
+        LOGE("❌ sws_scale执行前Surface被重建，中止");
+        ANativeWindow_unlockAndPost(native_window);
+        surface_locked = false;
+        return;
+    }
+
+    int ret = sws_scale(current_sws_ctx, frame->data, frame->linesize, 0, frame->height,
+                        dst_data, dst_linesize);
+
+    if (ret > 0) {
+        // 成功转换，直接显示
+        if (ANativeWindow_unlockAndPost(native_window) == 0) {
+            surface_locked = false;  // 标记Surface已解锁
+            last_render_time = current_time;
+
+            // 计算实际渲染帧率（每30帧输出一次）
+            static int render_count = 0;
+            static auto fps_start_time = current_time;
+
+            render_count++;
+            if (render_count % 30 == 0) {
+                auto total_time = std::chrono::duration_cast<std::chrono::microseconds>(
+                        current_time - fps_start_time).count();
+
+                if (total_time > 0) {
+                    float render_fps = 30000000.0f / total_time; // fps
+                    LOGD("🎨 实际渲染FPS: %.1f", render_fps);
+                }
+                fps_start_time = current_time;
+            }
+        } else {
+            surface_locked = false;  // 即使失败也要标记解锁
+            LOGE("❌ ANativeWindow_unlockAndPost失败");
+        }
+    } else {
+        // 转换失败，解锁buffer
+        ANativeWindow_unlockAndPost(native_window);
+        surface_locked = false;  // 标记Surface已解锁
+
+        LOGE_EVERY(1000, "❌ 颜色空间转换失败: %d (格式:%s)", ret, av_get_pix_fmt_name(input_format));
+    }
+}
+#endif
+
+static void cleanupFFmpegInternal() {
+    FFmpegManager::getInstance()->cleanupFFmpeg();
+
+#if FFMPEG_FOUND
+    // 清理RTSP相关资源
+    if (rtsp_input_ctx) {
+        avformat_close_input(&rtsp_input_ctx);
+        rtsp_input_ctx = nullptr;
+    }
+
+    if (rtsp_output_ctx) {
+        if (!(rtsp_output_ctx->oformat->flags & AVFMT_NOFILE)) {
+            avio_closep(&rtsp_output_ctx->pb);
+        }
+        avformat_free_context(rtsp_output_ctx);
+        rtsp_output_ctx = nullptr;
+    }
+
+    if (decoder_ctx) {
+        avcodec_free_context(&decoder_ctx);
+        decoder_ctx = nullptr;
+    }
+
+    if (sws_ctx) {
+        sws_freeContext(sws_ctx);
+        sws_ctx = nullptr;
+    }
+
+    if (frame) {
+        av_frame_free(&frame);
+        frame = nullptr;
+    }
+
+    if (frame_rgba) {
+        av_frame_free(&frame_rgba);
+        frame_rgba = nullptr;
+    }
+#endif
+
+    // 清理native window
+    {
+        std::lock_guard<std::mutex> lock(surface_mutex);
+        surface_valid = false;
+        surface_locked = false;
+        if (native_window) {
+            ANativeWindow_release(native_window);
+            native_window = nullptr;
+        }
+    }
+
+    // 重置状态 - 这些变量现在总是可用
+    rtsp_connected = false;
+    rtsp_recording = false;
+    processed_frame_count = 0;
+    total_decode_time = 0;
+    video_stream_index = -1;
+}
+
+// ============================================================================
+// 媒体信息快速探测 - 内存映射后只解析容器头部，不解码；按路径+mtime+大小缓存
+// ============================================================================
+#if FFMPEG_FOUND
+// 只读内存映射。MADV_RANDOM避免为只访问头部的探测预读整个文件
+class MappedFile {
+public:
+    MappedFile() : data(nullptr), length(0) {}
+    ~MappedFile() {
+        if (data) {
+            munmap(data, length);
+        }
+    }
+    
+    bool open(const char* path, size_t file_size) {
+        if (file_size == 0) {
+            return false;
+        }
+        int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        void* mapped = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            return false;
+        }
+        madvise(mapped, file_size, MADV_RANDOM);
+        data = mapped;
+        length = file_size;
+        return true;
+    }
     
-    // 渲染控制
-    std::chrono::steady_clock::time_point last_render_time;
-    static const int MIN_RENDER_INTERVAL_MS = 16; // 最大60fps
+    const uint8_t* bytes() const { return static_cast<const uint8_t*>(data); }
+    size_t size() const { return length; }
     
-    // 缓存的SwsContext参数
-    int cached_src_width, cached_src_height;
-    AVPixelFormat cached_src_format;
-    int cached_dst_width, cached_dst_height;
+private:
+    void* data;
+    size_t length;
     
-public:
-    UltraLowLatencyRenderer() : 
-        native_window(nullptr), sws_ctx(nullptr),
-        cached_src_width(0), cached_src_height(0), 
-        cached_src_format(AV_PIX_FMT_NONE),
-        cached_dst_width(0), cached_dst_height(0) {
-        
-        last_render_time = std::chrono::steady_clock::now();
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+};
+
+// 设备上的MOV样本描述标签表查FFmpeg，与完整探测得到的名称一致
+struct FFmpegMovTags {
+    static const char* videoCodec(uint32_t fourcc) {
+        return lookup(avformat_get_mov_video_tags(), fourcc);
     }
     
-    ~UltraLowLatencyRenderer() {
-        cleanup();
+    static const char* audioCodec(uint32_t fourcc) {
+        return lookup(avformat_get_mov_audio_tags(), fourcc);
     }
     
-    // 设置渲染目标 - 增强稳定性版本
-    bool setSurface(ANativeWindow* window) {
-        std::lock_guard<std::mutex> lock(render_mutex);
-        std::lock_guard<std::mutex> sync_lock(g_surface_sync_mutex);
-        
-        // 暂停渲染，确保线程安全
-        g_rendering_paused = true;
-        g_surface_valid = false;
-        
-        // 等待当前渲染完成（最多等待33ms，确保超低延迟）
-        std::this_thread::sleep_for(std::chrono::milliseconds(20));
-        
-        // 安全释放旧资源
-        if (native_window) {
-            ANativeWindow_release(native_window);
-            native_window = nullptr;
-        }
-        
-        // 强制重建SwsContext，避免状态不一致
-        if (sws_ctx) {
-            sws_freeContext(sws_ctx);
-            sws_ctx = nullptr;
-            cached_src_width = 0;
-            cached_src_height = 0;
-            cached_src_format = AV_PIX_FMT_NONE;
-        }
-        
-        // 设置新Surface
-        native_window = window;
-        g_last_surface_change = std::chrono::steady_clock::now();
-        
-        if (native_window) {
-            g_surface_valid = true;
-            g_rendering_paused = false;
-            LOGI("✅ 渲染器Surface设置成功，恢复渲染");
-            return true;
-        } else {
-            LOGI("🧹 渲染器Surface已清理，保持暂停状态");
-            return true;
+    static const char* lookup(const AVCodecTag* table, uint32_t fourcc) {
+        const AVCodecTag* tables[] = {table, nullptr};
+        AVCodecID id = av_codec_get_id(tables, fourcc);
+        return id != AV_CODEC_ID_NONE ? avcodec_get_name(id) : nullptr;
+    }
+};
+
+typedef BasicMp4HeaderParser<FFmpegMovTags> Mp4HeaderParser;
+
+// 完整探测：头部解析不适用时（其他容器、分片MP4、网络地址）才走这条路径
+static bool probeMediaInfoFull(const char* path, MediaInfo& info, std::string& error) {
+    AVFormatContext* fmt_ctx = nullptr;
+    if (avformat_open_input(&fmt_ctx, path, nullptr, nullptr) < 0) {
+        error = "Failed to open file";
+        return false;
+    }
+    if (avformat_find_stream_info(fmt_ctx, nullptr) < 0) {
+        avformat_close_input(&fmt_ctx);
+        error = "Failed to get stream info";
+        return false;
+    }
+    
+    info.container = fmt_ctx->iformat ? fmt_ctx->iformat->name : "";
+    info.duration_ms = fmt_ctx->duration > 0 ? fmt_ctx->duration / 1000 : 0;
+    info.bit_rate = fmt_ctx->bit_rate;
+    info.stream_count = fmt_ctx->nb_streams;
+    info.header_only = false;
+    for (unsigned int i = 0; i < fmt_ctx->nb_streams; i++) {
+        AVStream* stream = fmt_ctx->streams[i];
+        AVCodecParameters* codecpar = stream->codecpar;
+        if (codecpar->codec_type == AVMEDIA_TYPE_VIDEO && info.video_codec.empty()) {
+            info.video_codec = avcodec_get_name(codecpar->codec_id);
+            info.width = codecpar->width;
+            info.height = codecpar->height;
+            if (stream->avg_frame_rate.num > 0 && stream->avg_frame_rate.den > 0) {
+                info.frame_rate = av_q2d(stream->avg_frame_rate);
+            }
+        } else if (codecpar->codec_type == AVMEDIA_TYPE_AUDIO && info.audio_codec.empty()) {
+            info.audio_codec = avcodec_get_name(codecpar->codec_id);
+            info.sample_rate = codecpar->sample_rate;
+            info.channels = codecpar->ch_layout.nb_channels;
         }
     }
+    avformat_close_input(&fmt_ctx);
+    return true;
+}
+
+// 探测结果缓存：文件的mtime或大小变化即失效，超过容量按插入顺序淘汰
+class MediaInfoCache {
+public:
+    static MediaInfoCache& getInstance() {
+        static MediaInfoCache instance;
+        return instance;
+    }
     
-    // 渲染帧 - 核心渲染逻辑（增强稳定性）
-    bool renderFrame(AVFrame* frame) {
-        // 第一层检查：基本参数有效性
-        if (!frame || !native_window) {
+    bool lookup(const std::string& path, const struct stat& st, MediaInfo& out) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::map<std::string, Entry>::const_iterator it = entries.find(path);
+        if (it == entries.end() || !it->second.matches(st)) {
             return false;
         }
-        
-        // 第二层检查：Surface状态同步
-        if (!g_surface_valid || g_rendering_paused) {
-            return false; // 快速返回，保持超低延迟
-        }
-        
-        std::lock_guard<std::mutex> lock(render_mutex);
-        
-        // 第三层检查：再次验证资源有效性（防止竞态条件）
-        if (!native_window || !g_surface_valid) {
-            return false;
+        out = it->second.info;
+        return true;
+    }
+    
+    void store(const std::string& path, const struct stat& st, const MediaInfo& info) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry& entry = entries[path];
+        if (entry.size < 0) {
+            order.push_back(path);
         }
+        entry.mtime_sec = st.st_mtim.tv_sec;
+        entry.mtime_nsec = st.st_mtim.tv_nsec;
+        entry.size = st.st_size;
+        entry.info = info;
         
-        // 帧率控制
-        auto now = std::chrono::steady_clock::now();
-        auto time_since_last = std::chrono::duration_cast<std::chrono::milliseconds>(
-            now - last_render_time).count();
-        
-        if (time_since_last < MIN_RENDER_INTERVAL_MS) {
-            return true; // 跳过渲染，保持帧率稳定
+        while (order.size() > kMaxEntries) {
+            entries.erase(order.front());
+            order.pop_front();
         }
+    }
+    
+private:
+    static const size_t kMaxEntries = 1024;
+    
+    struct Entry {
+        int64_t mtime_sec;
+        long mtime_nsec;
+        int64_t size;
+        MediaInfo info;
         
-        // 记录第一次渲染尝试
-        static bool first_render_logged = false;
-        if (!first_render_logged) {
-            LOGI("🎬 第一次渲染尝试: format=%d, data[0]=%p, data[3]=%p, width=%d, height=%d", 
-                 frame->format, frame->data[0], frame->data[3], frame->width, frame->height);
-            first_render_logged = true;
-        }
+        Entry() : mtime_sec(0), mtime_nsec(0), size(-1) {}
         
-        // 检查是否是硬件解码帧 - MediaCodec buffer模式
-        if (frame->format == 23) {
-            // MediaCodec硬件解码输出，需要转换为可渲染格式
-            // 减少日志输出以提升性能
-            
-            // 对于MediaCodec buffer模式，我们需要软件渲染路径
-            // 但首先要正确处理MediaCodec buffer
-            if (frame->data[3] != nullptr) {
-                // 释放MediaCodec buffer（如果需要）
-                // 注意：不要立即释放，因为我们还需要数据
-                LOGD("📦 MediaCodec buffer模式，准备软件渲染");
-            }
+        bool matches(const struct stat& st) const {
+            return size == (int64_t)st.st_size && mtime_sec == (int64_t)st.st_mtim.tv_sec &&
+                   mtime_nsec == st.st_mtim.tv_nsec;
         }
-        
-        // 软件渲染路径 - 处理所有格式（包括MediaCodec buffer）
-        return renderFrameSoftware(frame);
+    };
+    
+    std::mutex mutex;
+    std::map<std::string, Entry> entries;
+    std::deque<std::string> order;
+    
+    MediaInfoCache() {}
+};
+
+// 头部优先探测：缓存 -> mmap解析MP4/Matroska头部 -> 完整探测
+static bool probeMediaInfo(const char* path, MediaInfo& info, std::string& error) {
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+        // 非本地文件（URL、管道等）无法映射也无法缓存
+        return probeMediaInfoFull(path, info, error);
     }
     
-    void cleanup() {
-        std::lock_guard<std::mutex> lock(render_mutex);
-        
-        if (sws_ctx) {
-            sws_freeContext(sws_ctx);
-            sws_ctx = nullptr;
+    MediaInfoCache& cache = MediaInfoCache::getInstance();
+    if (cache.lookup(path, st, info)) {
+        return true;
+    }
+    
+    auto start_time = std::chrono::steady_clock::now();
+    bool parsed = false;
+    MappedFile file;
+    if (file.open(path, (size_t)st.st_size)) {
+        MediaInfo header_info;
+        if (Mp4HeaderParser::isCandidate(file.bytes(), file.size())) {
+            parsed = Mp4HeaderParser::parse(file.bytes(), file.size(), header_info);
+        } else if (MatroskaHeaderParser::isCandidate(file.bytes(), file.size())) {
+            parsed = MatroskaHeaderParser::parse(file.bytes(), file.size(), header_info);
         }
-        
-        if (native_window) {
-            ANativeWindow_release(native_window);
-            native_window = nullptr;
+        if (parsed) {
+            header_info.header_only = true;
+            info = header_info;
         }
-        
-        cached_src_width = 0;
     }
     
-private:
-    // 软件渲染实现（增强稳定性）
-    bool renderFrameSoftware(AVFrame* frame) {
-        // 关键安全检查：确保渲染资源有效
-        if (!native_window || !g_surface_valid || g_rendering_paused) {
-            LOGW("⚠️ 渲染资源无效，跳过此帧: native_window=%p, valid=%d, paused=%d", 
-                 native_window, (int)g_surface_valid, (int)g_rendering_paused);
+    if (!parsed && !probeMediaInfoFull(path, info, error)) {
+        return false;
+    }
+    
+    auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_time).count();
+    LOGD("📄 媒体信息探测(%s): %s, %lldus", parsed ? "头部" : "完整", path, (long long)elapsed_us);
+    
+    cache.store(path, st, info);
+    return true;
+}
+
+// 批量探测（parallel_scanner.h）的单文件探测，在工作线程中执行
+static bool probeScannedFile(const std::string& path, MediaInfo& info) {
+    std::string error;
+    return probeMediaInfo(path.c_str(), info, error);
+}
+
+typedef ParallelScanner<MediaInfo> MediaInfoScanner;
+
+// Java VideoInfo类及构造函数，JNI_OnLoad中缓存（工作线程无法通过FindClass找到应用类）
+static jclass g_video_info_class = nullptr;
+static jmethodID g_video_info_ctor = nullptr;
+
+static jobject newJavaVideoInfo(JNIEnv* env, const char* path, const MediaInfo& info) {
+    if (!g_video_info_class || !g_video_info_ctor) {
+        return nullptr;
+    }
+    jstring jpath = env->NewStringUTF(path);
+    // 头部解析已转义未知编解码器名称；完整探测的名称来自FFmpeg，这里统一再保证一次是合法的modified UTF-8
+    jstring jcontainer = env->NewStringUTF(printableCodecName(info.container).c_str());
+    jstring jvideo = env->NewStringUTF(printableCodecName(info.video_codec).c_str());
+    jstring jaudio = env->NewStringUTF(printableCodecName(info.audio_codec).c_str());
+    jobject result = env->NewObject(g_video_info_class, g_video_info_ctor,
+                                    jpath, jcontainer, (jlong)info.duration_ms, (jlong)info.bit_rate,
+                                    (jint)info.width, (jint)info.height, (jdouble)info.frame_rate,
+                                    jvideo, jaudio, (jint)info.sample_rate, (jint)info.channels,
+                                    (jint)info.stream_count, (jboolean)(info.header_only ? JNI_TRUE : JNI_FALSE));
+    env->DeleteLocalRef(jpath);
+    env->DeleteLocalRef(jcontainer);
+    env->DeleteLocalRef(jvideo);
+    env->DeleteLocalRef(jaudio);
+    return result;
+}
+#endif
+
+// ============================================================================
+// 文件转码引擎 - 能流复制就不重编码，否则 解码 -> 缩放 -> 编码，复用录制流水线
+// ============================================================================
+#if FFMPEG_FOUND
+class StreamingTranscoder {
+public:
+    // 进度回调：返回false表示取消
+    typedef std::function<bool(int64_t processed_ms, int64_t duration_ms)> ProgressCallback;
+    
+    StreamingTranscoder() :
+        input_ctx(nullptr), decoder_ctx(nullptr), packet(nullptr), frame(nullptr),
+        video_index(-1), audio_index(-1), target_width(0), target_height(0),
+        recorder_started(false), video_written(false), cancelled(false), segment_mode(false),
+        segment_start(INT64_MIN), segment_filter(INT64_MIN, INT64_MAX), external_cancel(nullptr),
+        hardware_encoding(true), thread_budget(0), processed_ms(0), first_frame_pts(AV_NOPTS_VALUE) {}
+    
+    ~StreamingTranscoder() {
+        cleanup();
+    }
+    
+    // 分段模式（并行转码的工作单元）：只重编码pts在[start_pts, end_pts)内的视频，不含音频。
+    // start_pts为INT64_MIN表示从头开始，end_pts为INT64_MAX表示到结尾
+    void setSegment(int64_t start_pts, int64_t end_pts) {
+        segment_mode = true;
+        segment_start = start_pts;
+        segment_filter = SegmentFrameFilter(start_pts, end_pts);
+    }
+    
+    void setCancelFlag(const std::atomic<bool>* flag) {
+        external_cancel = flag;
+    }
+    
+    void setHardwareEncoding(bool enabled) {
+        hardware_encoding = enabled;
+    }
+    
+    // 解码/编码各自的线程数上限，0表示自动（单链路转码独占CPU）
+    void setThreadBudget(int threads) {
+        thread_budget = threads > 0 ? threads : 0;
+    }
+    
+    // 已处理的媒体时长（分段模式下相对分段起点），可在其他线程读取
+    int64_t processedMs() const {
+        return processed_ms.load();
+    }
+    
+    // 第一个写入帧的源时间戳（源视频流时间基准），用于拼接分段
+    int64_t firstFramePts() const {
+        return first_frame_pts;
+    }
+    
+    // 不缩放且MP4可以直接封装源视频编码时走流复制
+    static bool canStreamCopy(const AVCodecParameters* par, int width, int height) {
+        const AVOutputFormat* mp4 = av_guess_format("mp4", nullptr, nullptr);
+        return keepsSourceSize(width, height, par->width, par->height) && mp4 && avformat_query_codec(mp4, par->codec_id, FF_COMPLIANCE_NORMAL) == 1 &&
+               (par->codec_id == AV_CODEC_ID_H264 || par->codec_id == AV_CODEC_ID_HEVC);
+    }
+    
+    // width/height为0表示保持源尺寸
+    bool run(const char* input, const char* output, int width, int height, const ProgressCallback& progress) {
+        on_progress = progress;
+        target_width = width;
+        target_height = height;
+        int64_t start_us = av_gettime_relative();
+        
+        if (!openInput(input)) {
             return false;
         }
+        if (segment_mode) {
+            audio_index = -1;   // 分段只含视频，音频在拼接时从源文件直通
+        }
         
-        // 检查Surface变化时间，避免过于频繁的重建
-        auto now = std::chrono::steady_clock::now();
-        auto surface_age = std::chrono::duration_cast<std::chrono::milliseconds>(
-            now - g_last_surface_change).count();
-        if (surface_age < 50) { // Surface创建后50ms内暂缓渲染，确保稳定
+        recorder.reset(new ModernRecorder());
+        if (!recorder->prepare(output)) {
             return false;
         }
-        
-        // 设置缓冲区格式（每次Surface变化后重新设置）
-        static bool format_set = false;
-        if (!format_set || surface_age < 100) {
-            int ret = ANativeWindow_setBuffersGeometry(native_window, 
-                frame->width, frame->height, WINDOW_FORMAT_RGBA_8888);
-            if (ret != 0) {
-                LOGE("❌ 设置Surface缓冲区失败: %d", ret);
-                return false;
-            }
-            format_set = true;
+        recorder->setHardwareEncoding(hardware_encoding);
+        recorder->setEncoderThreads(thread_budget);
+        if (audio_index >= 0) {
+            AVStream* audio = input_ctx->streams[audio_index];
+            recorder->setAudioSource(audio->codecpar, audio->time_base);
         }
         
-        // 检测输入格式
-        AVPixelFormat input_format = detectPixelFormat(frame);
-        
-        // 更新SwsContext
-        if (!updateSwsContext(frame, input_format)) {
-            return false;
-        }
+        bool copy = !segment_mode && canStreamCopy(input_ctx->streams[video_index]->codecpar,
+                                                   target_width, target_height);
+        LOGI("🎞️ 转码开始: %s -> %s (%s)", input, output, copy ? "流复制" : "重编码");
+        bool ok = copy ? remux() : transcode();
         
-        // 锁定Surface前再次检查有效性
-        if (!g_surface_valid || !native_window) {
-            LOGW("⚠️ Surface在锁定前变为无效");
-            return false;
+        if (recorder_started) {
+            recorder->stop();
         }
+        recorder.reset();   // 关闭输出文件
         
-        ANativeWindow_Buffer buffer;
-        int ret = ANativeWindow_lock(native_window, &buffer, nullptr);
-        if (ret != 0) {
-            LOGE("❌ 锁定Surface失败: %d", ret);
+        if (!ok || isCancelled()) {
+            LOGW("⚠️ 转码%s，删除不完整的输出文件", isCancelled() ? "已取消" : "失败");
+            unlink(output);
+            unlink((std::string(output) + ".idx").c_str());
             return false;
         }
         
-        // 执行颜色空间转换前的最后检查
-        if (!sws_ctx || !g_surface_valid) {
-            ANativeWindow_unlockAndPost(native_window); // 确保解锁
-            LOGW("⚠️ SwsContext或Surface在转换前失效");
+        // 吞吐量按实时倍数统计：媒体时长 / 实际耗时
+        int64_t elapsed_us = av_gettime_relative() - start_us;
+        int64_t media_us = input_ctx->duration > 0 ? input_ctx->duration : 0;
+        LOGI("✅ 转码完成: 媒体时长%.1fs, 耗时%.1fs (%.1fx实时)", media_us / 1000000.0, elapsed_us / 1000000.0,
+             realtimeMultiple(media_us, elapsed_us));
+        return true;
+    }
+    
+private:
+    AVFormatContext* input_ctx;
+    AVCodecContext* decoder_ctx;
+    AVPacket* packet;
+    AVFrame* frame;
+    int video_index;
+    int audio_index;
+    int target_width;
+    int target_height;
+    std::unique_ptr<ModernRecorder> recorder;
+    bool recorder_started;
+    bool video_written;                     // 第一个视频帧/包写入后音频才有时间零点
+    PixelFormatDescriptor pixel_format;
+    std::vector<AVPacket*> pending_audio;   // 时间零点确定前读到的音频
+    ProgressCallback on_progress;
+    bool cancelled;
+    TranscodeProgressThrottle progress_throttle;
+    bool segment_mode;
+    int64_t segment_start;
+    SegmentFrameFilter segment_filter;     // 非分段模式下不限范围
+    const std::atomic<bool>* external_cancel;
+    bool hardware_encoding;
+    int thread_budget;
+    std::atomic<int64_t> processed_ms;
+    int64_t first_frame_pts;
+    
+    bool isCancelled() const {
+        return cancelled || (external_cancel && external_cancel->load());
+    }
+    
+    bool openInput(const char* input) {
+        int ret = avformat_open_input(&input_ctx, input, nullptr, nullptr);
+        if (ret < 0 || avformat_find_stream_info(input_ctx, nullptr) < 0) {
+            LOGE("❌ 无法打开输入文件: %s (%d)", input, ret);
             return false;
         }
-        
-        uint8_t* dst_data[4] = {(uint8_t*)buffer.bits, nullptr, nullptr, nullptr};
-        int dst_linesize[4] = {buffer.stride * 4, 0, 0, 0};
-        
-        ret = sws_scale(sws_ctx, frame->data, frame->linesize, 0, frame->height,
-                       dst_data, dst_linesize);
-        
-        // 解锁并显示
-        ANativeWindow_unlockAndPost(native_window);
-        
-        if (ret > 0) {
-            last_render_time = std::chrono::steady_clock::now();
-            return true;
-        } else {
-            LOGE("❌ 颜色空间转换失败: %d", ret);
+        video_index = av_find_best_stream(input_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+        audio_index = av_find_best_stream(input_ctx, AVMEDIA_TYPE_AUDIO, -1, video_index, nullptr, 0);
+        if (video_index < 0) {
+            LOGE("❌ 输入文件没有视频流");
             return false;
         }
+        packet = av_packet_alloc();
+        frame = av_frame_alloc();
+        return packet && frame;
     }
     
-    // 智能检测像素格式
-    AVPixelFormat detectPixelFormat(AVFrame* frame) {
-        if (frame->format != 23) {
-            return (AVPixelFormat)frame->format;
+    bool remux() {
+        AVStream* video = input_ctx->streams[video_index];
+        if (!recorder->startStreamCopy(video->codecpar, video->time_base)) {
+            return false;
         }
+        recorder_started = true;
         
-        // MediaCodec格式检测
-        if (frame->linesize[1] == frame->linesize[0] && frame->data[1] && !frame->data[2]) {
-            return AV_PIX_FMT_NV12;
-        } else if (frame->linesize[1] == frame->linesize[0]/2 && frame->data[1] && frame->data[2]) {
-            return AV_PIX_FMT_YUV420P;
-        } else {
-            return AV_PIX_FMT_NV21; // Android默认
+        while (!isCancelled() && av_read_frame(input_ctx, packet) >= 0) {
+            if (packet->stream_index == video_index) {
+                reportProgress(packet);
+                packet->stream_index = 0;
+                if (recorder->writePacket(packet) && !video_written) {
+                    video_written = true;
+                    flushPendingAudio();
+                }
+            } else if (packet->stream_index == audio_index) {
+                packet->stream_index = 1;
+                writeAudio(packet);
+            }
+            av_packet_unref(packet);
         }
+        return true;
     }
     
-    // 更新SwsContext
-    bool updateSwsContext(AVFrame* frame, AVPixelFormat input_format) {
-        // 严格的输入验证
-        if (!frame || frame->width <= 0 || frame->height <= 0) {
-            LOGE("❌ 无效的帧参数: frame=%p, width=%d, height=%d", 
-                 frame, frame ? frame->width : 0, frame ? frame->height : 0);
+    bool transcode() {
+        if (!openDecoder()) {
             return false;
         }
+        // 文件转码不能丢帧：流水线满时阻塞读取，内存占用由队列容量决定
+        recorder->setBlockingInput(true);
         
-        // 检查像素格式是否有效
-        if (input_format == AV_PIX_FMT_NONE || input_format < 0) {
-            LOGE("❌ 无效的像素格式: %d", input_format);
+        // 分段从起点之前最近的关键帧开始解码
+        if (segment_mode && segment_start != INT64_MIN &&
+            av_seek_frame(input_ctx, video_index, segment_start, AVSEEK_FLAG_BACKWARD) < 0) {
+            LOGE("❌ 分段定位失败: pts=%lld", (long long)segment_start);
             return false;
         }
         
-        // 检查尺寸是否合理
-        if (frame->width > 4096 || frame->height > 4096) {
-            LOGE("❌ 帧尺寸过大: %dx%d", frame->width, frame->height);
-            return false;
+        // 分段的终点是下一分段的起始关键帧，但要一直送包到解码输出越过终点（见SegmentFrameFilter）
+        int ret = 0;
+        while (!isCancelled() && !segment_filter.finished() && (ret = av_read_frame(input_ctx, packet)) >= 0) {
+            if (packet->stream_index == video_index) {
+                reportProgress(packet);
+                if (!decodePacket(packet)) {
+                    av_packet_unref(packet);
+                    return false;
+                }
+            } else if (packet->stream_index == audio_index) {
+                packet->stream_index = 1;
+                writeAudio(packet);
+            }
+            av_packet_unref(packet);
         }
-        
-        int dst_width = frame->width;
-        int dst_height = frame->height;
-        
-        // 检查是否需要重建SwsContext
-        if (sws_ctx && 
-            cached_src_width == frame->width && 
-            cached_src_height == frame->height &&
-            cached_src_format == input_format &&
-            cached_dst_width == dst_width &&
-            cached_dst_height == dst_height) {
-            return true; // 无需重建
+        if (isCancelled()) {
+            return true;
         }
-        
-        // 释放旧的SwsContext
-        if (sws_ctx) {
-            sws_freeContext(sws_ctx);
-            sws_ctx = nullptr;
+        // 冲刷解码器中剩余的帧
+        return decodePacket(nullptr) && recorder_started;
+    }
+    
+    bool openDecoder() {
+        AVCodecParameters* par = input_ctx->streams[video_index]->codecpar;
+        const AVCodec* codec = avcodec_find_decoder(par->codec_id);
+        if (!codec) {
+            LOGE("❌ 找不到解码器: %s", avcodec_get_name(par->codec_id));
+            return false;
         }
-        
-        // 创建新的SwsContext - 添加错误检查
-        LOGD("🔄 创建SwsContext: %dx%d %s->RGBA", 
-             frame->width, frame->height, av_get_pix_fmt_name(input_format));
-        
-        sws_ctx = sws_getContext(
-            frame->width, frame->height, input_format,
-            dst_width, dst_height, AV_PIX_FMT_RGBA,
-            SWS_BILINEAR, nullptr, nullptr, nullptr);
-        
-        if (!sws_ctx) {
-            LOGE("❌ 创建SwsContext失败: %dx%d %s->RGBA", 
-                 frame->width, frame->height, av_get_pix_fmt_name(input_format));
+        decoder_ctx = avcodec_alloc_context3(codec);
+        if (!decoder_ctx || avcodec_parameters_to_context(decoder_ctx, par) < 0) {
+            return false;
+        }
+        // 与播放不同，转码追求吞吐量：启用帧级+片级多线程
+        decoder_ctx->thread_count = thread_budget;
+        decoder_ctx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+        decoder_ctx->pkt_timebase = input_ctx->streams[video_index]->time_base;
+        int ret = avcodec_open2(decoder_ctx, codec, nullptr);
+        if (ret < 0) {
+            LOGE("❌ 打开解码器失败: %d", ret);
             return false;
         }
-        
-        // 更新缓存参数
-        cached_src_width = frame->width;
-        cached_src_height = frame->height;
-        cached_src_format = input_format;
-        cached_dst_width = dst_width;
-        cached_dst_height = dst_height;
-        
-        LOGI("✅ SwsContext创建成功: %dx%d %s->RGBA", 
-             frame->width, frame->height, av_get_pix_fmt_name(input_format));
-        
         return true;
     }
-};
-
-// 全局渲染器实例
-static UltraLowLatencyRenderer* g_renderer = nullptr;
-static std::mutex g_renderer_mutex;
-
-// FFmpeg管理类
-class FFmpegManager {
-private:
-    static FFmpegManager* instance;
-    static std::mutex mutex_;
-    bool initialized;
-    void* ffmpeg_handle;
-
-    FFmpegManager() : initialized(false), ffmpeg_handle(nullptr) {}
-
-public:
-    static FFmpegManager* getInstance() {
-        std::lock_guard<std::mutex> lock(mutex_);
-        if (instance == nullptr) {
-            instance = new FFmpegManager();
+    
+    bool decodePacket(AVPacket* pkt) {
+        int ret = avcodec_send_packet(decoder_ctx, pkt);
+        if (ret < 0 && ret != AVERROR_EOF) {
+            // 单个损坏的数据包不终止转码
+            LOGW("⚠️ 解码数据包失败: %d", ret);
+            return true;
+        }
+        while ((ret = avcodec_receive_frame(decoder_ctx, frame)) >= 0) {
+            bool ok = writeVideo(frame);
+            av_frame_unref(frame);
+            if (!ok) {
+                return false;
+            }
         }
-        return instance;
+        return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF;
     }
-
-    bool initializeFFmpeg() {
-        if (initialized) {
-            return true;
+    
+    bool writeVideo(AVFrame* decoded) {
+        int64_t pts = decoded->best_effort_timestamp != AV_NOPTS_VALUE ? decoded->best_effort_timestamp : decoded->pts;
+        if (!segment_filter.accept(pts, AV_NOPTS_VALUE)) {
+            return true;    // 起点关键帧之前/终点之后的帧属于相邻分段
+        }
+        if (first_frame_pts == AV_NOPTS_VALUE) {
+            first_frame_pts = pts;
+        }
+        if (!pixel_format.matches(decoded)) {
+            pixel_format = resolvePixelFormatDescriptor(decoded, decoder_ctx);
+        }
+        if (!recorder_started && !startRecorder(decoded)) {
+            return false;
+        }
+        if (recorder->writeFrame(decoded, pixel_format) && !video_written) {
+            video_written = true;
+            flushPendingAudio();
         }
-
-#if FFMPEG_FOUND
-        LOGI("Initializing FFmpeg...");
-
-        // 初始化FFmpeg网络模块
-        avformat_network_init();
-
-        // 注册所有编解码器和格式
-        // 注意：在新版本FFmpeg中，这些函数已经被弃用，因为注册是自动的
-        // av_register_all(); // 已弃用
-        // avcodec_register_all(); // 已弃用
-
-        initialized = true;
-        LOGI("✅ FFmpeg initialized successfully");
         return true;
-#else
-        LOGE("❌ FFmpeg not compiled");
-        return false;
-#endif
     }
-
-    void cleanupFFmpeg() {
-        if (!initialized) {
-            return;
+    
+    // 首帧已确定时间零点，补写之前暂存的音频（早于零点的由录制器丢弃）
+    void flushPendingAudio() {
+        for (size_t i = 0; i < pending_audio.size(); i++) {
+            recorder->writePacket(pending_audio[i]);
+            av_packet_free(&pending_audio[i]);
         }
-
-#if FFMPEG_FOUND
-        LOGI("Cleaning up FFmpeg...");
-        avformat_network_deinit();
-        initialized = false;
-        LOGI("✅ FFmpeg cleanup completed");
-#endif
-    }
-
-    bool isInitialized() const {
-        return initialized;
+        pending_audio.clear();
     }
-
-    std::string getVersion() {
-#if FFMPEG_FOUND
-        if (!initialized) {
-            return "FFmpeg not initialized";
+    
+    // 首帧解码后才启动编码器：此时像素格式已知，可选择免转换的编码格式
+    bool startRecorder(AVFrame* decoded) {
+        AVStream* stream = input_ctx->streams[video_index];
+        RecordingProfile profile;
+        profile.width = target_width > 0 ? target_width : decoded->width;
+        profile.height = target_height > 0 ? target_height : decoded->height;
+        profile.pix_fmt = pixel_format.hasCpuData() ? pixel_format.layout : AV_PIX_FMT_NONE;
+        profile.sample_aspect_ratio = av_guess_sample_aspect_ratio(input_ctx, stream, decoded);
+        AVRational fps = av_guess_frame_rate(input_ctx, stream, decoded);
+        if (fps.num > 0 && fps.den > 0) {
+            profile.framerate = fps;
+        }
+        profile.time_base = stream->time_base;
+        profile.color_range = decoded->color_range;
+        profile.color_space = decoded->colorspace;
+        profile.color_primaries = decoded->color_primaries;
+        profile.color_trc = decoded->color_trc;
+        
+        if (!recorder->start(profile)) {
+            return false;
         }
-        return std::string("FFmpeg ") + av_version_info();
-#else
-        return "FFmpeg not available";
-#endif
+        recorder_started = true;
+        return true;
     }
-};
-
-// 静态成员定义
-FFmpegManager* FFmpegManager::instance = nullptr;
-std::mutex FFmpegManager::mutex_;
-
-// 全局变量 - 移到条件编译块外，确保总是可用
-static bool hardware_decode_enabled = true;
-static bool hardware_decode_available = false;
-static bool rtsp_connected = false;
-static bool rtsp_recording = false;
-static int processed_frame_count = 0;
-static long total_decode_time = 0;
-static int video_stream_index = -1;
-
-// Surface和渲染相关变量
-static ANativeWindow* native_window = nullptr;
-static ANativeWindow_Buffer window_buffer;
-static bool surface_locked = false;  // 跟踪Surface锁定状态
-static bool surface_valid = false;   // 跟踪Surface有效性
-static bool surface_ready = false;   // 跟踪Surface是否准备好渲染
-static std::mutex surface_mutex;     // Surface访问保护
-static std::mutex frame_processing_mutex; // 帧处理保护
-
-// 简化的Surface管理 - 不绑定Activity生命周期
-static std::atomic<bool> surface_being_recreated(false); // Surface正在重建
-static std::condition_variable surface_cv; // Surface状态变化通知
-
-
-#if FFMPEG_FOUND
-// FFmpeg相关的全局变量 - 只有在FFmpeg可用时才声明
-static AVFormatContext* rtsp_input_ctx = nullptr;
-static AVFormatContext* rtsp_output_ctx = nullptr;
-static AVCodecContext* decoder_ctx = nullptr;
-static SwsContext* sws_ctx = nullptr;
-static AVFrame* frame = nullptr;
-static AVFrame* frame_rgba = nullptr;
-static AVRational video_stream_timebase = {1, 1000000}; // 默认微秒时间基准
-#endif
-
-// FFmpeg初始化和清理函数
-static bool initializeFFmpegInternal() {
-    return FFmpegManager::getInstance()->initializeFFmpeg();
-}
-
-// 渲染帧到Surface的辅助函数
-#if FFMPEG_FOUND
-static void renderFrameToSurface(AVFrame* frame) {
-    // 线程安全的Surface有效性检查
-    std::lock_guard<std::mutex> lock(surface_mutex);
-
-    // 检查Surface是否正在重建
-    if (surface_being_recreated.load()) {
-        static int recreating_count = 0;
-        if (recreating_count++ % 50 == 0) {
-            LOGD("🔄 Surface正在重建，跳过渲染 (第%d次)", recreating_count);
+    
+    void writeAudio(AVPacket* pkt) {
+        if (video_written) {
+            recorder->writePacket(pkt);
+            return;
         }
-        return;
-    }
-
-    if (!native_window || !frame || !surface_valid || !surface_ready) {
-        static int invalid_surface_count = 0;
-        if (invalid_surface_count++ % 50 == 0) {
-            LOGW("⚠️ Surface无效或帧为空: native_window=%p, frame=%p, surface_valid=%s, surface_ready=%s (第%d次)",
-                 native_window, frame, surface_valid ? "true" : "false", surface_ready ? "true" : "false", invalid_surface_count);
+        if (pending_audio.size() >= 256) {
+            av_packet_free(&pending_audio.front());
+            pending_audio.erase(pending_audio.begin());
+        }
+        AVPacket* copy = av_packet_clone(pkt);
+        if (copy) {
+            pending_audio.push_back(copy);
         }
-        return;
     }
-
-    // 双重检查Surface有效性
-    if (surface_locked) {
-        static int locked_count = 0;
-        if (locked_count++ % 30 == 0) {
-            LOGW("⚠️ Surface已被锁定，跳过渲染 (第%d次)", locked_count);
+    
+    // 进度按1%或200ms节流
+    void reportProgress(const AVPacket* pkt) {
+        if (pkt->pts == AV_NOPTS_VALUE) {
+            return;
+        }
+        AVStream* stream = input_ctx->streams[video_index];
+        int64_t start = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+        if (segment_mode && segment_start != INT64_MIN) {
+            start = segment_start;
+        }
+        int64_t processed = std::max<int64_t>(0, av_rescale_q(pkt->pts - start, stream->time_base, AVRational{1, 1000}));
+        processed_ms.store(processed);
+        if (!on_progress) {
+            return;
+        }
+        int64_t duration_ms = input_ctx->duration > 0 ? input_ctx->duration / 1000 : 0;
+        if (!progress_throttle.shouldReport(processed, duration_ms, av_gettime_relative())) {
+            return;
+        }
+        if (!on_progress(processed, duration_ms)) {
+            cancelled = true;
         }
-        return;
     }
-
-    // 基本帧数据验证
-    if (frame->width <= 0 || frame->height <= 0 || frame->format < 0) {
-        static int render_invalid_count = 0;
-        if (render_invalid_count++ % 10 == 0) {
-            LOGE("❌ 无效帧尺寸或格式: size=%dx%d, format=%d (渲染函数第%d次)",
-                 frame->width, frame->height, frame->format, render_invalid_count);
+    
+    void cleanup() {
+        for (size_t i = 0; i < pending_audio.size(); i++) {
+            av_packet_free(&pending_audio[i]);
+        }
+        pending_audio.clear();
+        recorder.reset();
+        av_frame_free(&frame);
+        av_packet_free(&packet);
+        avcodec_free_context(&decoder_ctx);
+        if (input_ctx) {
+            avformat_close_input(&input_ctx);
         }
-        return;
     }
+};
 
-    // 调试：记录进入渲染函数的帧信息
-    static int render_entry_count = 0;
-    if (render_entry_count++ % 30 == 0) {
-        LOGD("🎨 进入渲染函数: %dx%d, format=%d, data[0]=%p (第%d次)",
-             frame->width, frame->height, frame->format, frame->data[0], render_entry_count);
+// 分段并行转码：在关键帧处把输入切成N段，各段独立解码/编码到临时文件，
+// 最后按时间偏移无损拼接视频包，音频从源文件直通
+class ParallelTranscoder {
+public:
+    ParallelTranscoder() :
+        target_width(0), target_height(0), worker_count(0), duration_ms(0),
+        video_time_base(AVRational{1, 1}), cancel_flag(false) {}
+    
+    // 判断是否适合并行并寻找切分点，不适合时返回false，由调用方走单链路转码
+    bool prepare(const char* input, int width, int height, int workers) {
+        input_path = input;
+        target_width = width;
+        target_height = height;
+        
+        AVFormatContext* ctx = nullptr;
+        if (avformat_open_input(&ctx, input, nullptr, nullptr) < 0) {
+            return false;
+        }
+        bool ok = false;
+        int video_index = -1;
+        if (avformat_find_stream_info(ctx, nullptr) >= 0 &&
+            (video_index = av_find_best_stream(ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0)) >= 0 &&
+            !StreamingTranscoder::canStreamCopy(ctx->streams[video_index]->codecpar, width, height) &&
+            ctx->duration > 0) {
+            duration_ms = ctx->duration / 1000;
+            workers = SegmentPlanner::workerCount(workers, duration_ms);
+            ok = workers >= 2 && findSplitPoints(ctx, video_index, workers);
+        }
+        avformat_close_input(&ctx);
+        return ok;
     }
-
-    // 对于硬件解码，data[0]可能为空，这是正常的
-    if (!hardware_decode_available && !frame->data[0]) {
-        LOGE("❌ 软件解码帧缺少数据: data[0]=%p", frame->data[0]);
-        return;
+    
+    bool run(const char* output, const StreamingTranscoder::ProgressCallback& progress) {
+        int64_t start_us = av_gettime_relative();
+        size_t segment_count = split_points.size() + 1;
+        std::vector<std::string> parts;
+        std::vector<std::unique_ptr<StreamingTranscoder> > segments;
+        std::vector<std::thread> threads;
+        std::atomic<int> finished(0);
+        std::vector<char> results(segment_count, 0);
+        
+        int threads_per_segment = SegmentPlanner::threadsPerSegment((int)std::thread::hardware_concurrency(),
+                                                                    segment_count);
+        LOGI("🎞️ 并行转码: %zu段, 时长%.1fs, 每段%d线程", segment_count, duration_ms / 1000.0, threads_per_segment);
+        for (size_t i = 0; i < segment_count; i++) {
+            parts.push_back(std::string(output) + ".part" + std::to_string(i) + ".mp4");
+            segments.push_back(std::unique_ptr<StreamingTranscoder>(new StreamingTranscoder()));
+            int64_t segment_start = 0, segment_end = 0;
+            SegmentPlanner::segmentRange(split_points, i, segment_start, segment_end);
+            segments[i]->setSegment(segment_start, segment_end);
+            segments[i]->setCancelFlag(&cancel_flag);
+            segments[i]->setHardwareEncoding(false);
+            segments[i]->setThreadBudget(threads_per_segment);
+        }
+        for (size_t i = 0; i < segment_count; i++) {
+            threads.push_back(std::thread([this, i, &segments, &parts, &results, &finished]() {
+                results[i] = segments[i]->run(input_path.c_str(), parts[i].c_str(), target_width, target_height,
+                                              StreamingTranscoder::ProgressCallback()) ? 1 : 0;
+                finished++;
+            }));
+        }
+        
+        // 调用线程汇总各段进度并负责回调，工作线程不接触JNI
+        while (finished.load() < (int)segment_count) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            if (progress && !cancel_flag.load()) {
+                int64_t processed = 0;
+                for (size_t i = 0; i < segment_count; i++) {
+                    processed += segments[i]->processedMs();
+                }
+                if (!progress(std::min(processed, duration_ms), duration_ms)) {
+                    cancel_flag.store(true);
+                }
+            }
+        }
+        for (size_t i = 0; i < threads.size(); i++) {
+            threads[i].join();
+        }
+        
+        bool ok = !cancel_flag.load();
+        for (size_t i = 0; ok && i < segment_count; i++) {
+            ok = results[i] && segments[i]->firstFramePts() != AV_NOPTS_VALUE;
+        }
+        if (ok) {
+            std::vector<int64_t> first_pts;
+            for (size_t i = 0; i < segment_count; i++) {
+                first_pts.push_back(segments[i]->firstFramePts());
+            }
+            ok = concat(parts, first_pts, output);
+        }
+        for (size_t i = 0; i < parts.size(); i++) {
+            unlink(parts[i].c_str());
+            unlink((parts[i] + ".idx").c_str());
+        }
+        if (!ok) {
+            unlink(output);
+            return false;
+        }
+        
+        int64_t elapsed_us = av_gettime_relative() - start_us;
+        LOGI("✅ 并行转码完成: %zu段, 耗时%.1fs (%.1fx实时)", segment_count, elapsed_us / 1000000.0,
+             realtimeMultiple(duration_ms * 1000, elapsed_us));
+        return true;
     }
-
-    // 减少日志输出频率
-    static int render_debug_count = 0;
-    if (render_debug_count++ % 30 == 0) {
-        LOGD("🎬 渲染帧: %dx%d, format=%d, data[0]=%p, data[1]=%p, data[3]=%p",
-             frame->width, frame->height, frame->format,
-             frame->data[0], frame->data[1], frame->data[3]);
+    
+    bool isCancelled() const {
+        return cancel_flag.load();
     }
-
-    // 检查是否是MediaCodec硬件解码器输出
-    if (frame->format == 23) { // MediaCodec硬件格式
-        // 检查是否有MediaCodec缓冲区引用
-        if (frame->data[3] != nullptr) {
-            // 真正的MediaCodec硬件Surface输出 - 直接渲染到Surface
-            int ret = av_mediacodec_release_buffer((AVMediaCodecBuffer*)frame->data[3], 1);
-            if (ret < 0) {
-                LOGE("❌ MediaCodec缓冲区释放失败: %d", ret);
+    
+private:
+    std::string input_path;
+    int target_width;
+    int target_height;
+    int worker_count;
+    int64_t duration_ms;
+    AVRational video_time_base;
+    std::vector<int64_t> split_points;      // 各分段起始关键帧的pts（源视频流时间基准）
+    std::atomic<bool> cancel_flag;
+    
+    // 在等分时间点向前定位到关键帧，读取其pts作为切分点
+    bool findSplitPoints(AVFormatContext* ctx, int video_index, int workers) {
+        AVStream* stream = ctx->streams[video_index];
+        video_time_base = stream->time_base;
+        int64_t start = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+        int64_t duration = av_rescale_q(ctx->duration, AV_TIME_BASE_Q, stream->time_base);
+        AVPacket* pkt = av_packet_alloc();
+        if (!pkt) {
+            return false;
+        }
+        
+        for (int i = 1; i < workers; i++) {
+            int64_t target = SegmentPlanner::splitTarget(start, duration, i, workers);
+            if (av_seek_frame(ctx, video_index, target, AVSEEK_FLAG_BACKWARD) < 0) {
+                continue;
+            }
+            while (av_read_frame(ctx, pkt) >= 0) {
+                bool found = pkt->stream_index == video_index && (pkt->flags & AV_PKT_FLAG_KEY) &&
+                             pkt->pts != AV_NOPTS_VALUE;
+                int64_t pts = pkt->pts;
+                av_packet_unref(pkt);
+                if (found) {
+                    SegmentPlanner::addSplitPoint(split_points, start, pts);
+                    break;
+                }
             }
-            return;
         }
-        // MediaCodec回退到CPU模式，继续下面的软件渲染
+        av_packet_free(&pkt);
+        worker_count = (int)split_points.size() + 1;
+        return worker_count >= 2;
     }
-
-    // 只在第一次或尺寸变化时设置缓冲区几何
-    static int last_width = 0, last_height = 0;
-    if (last_width != frame->width || last_height != frame->height) {
-        int ret = ANativeWindow_setBuffersGeometry(native_window, frame->width, frame->height, WINDOW_FORMAT_RGBA_8888);
-        if (ret != 0) {
-            LOGE("❌ 设置Surface缓冲区几何失败: %d", ret);
-            return;
+    
+    // 拼接：视频包按各段首帧源时间偏移，音频从源文件按时间交错写入
+    bool concat(const std::vector<std::string>& parts, const std::vector<int64_t>& first_pts, const char* output) {
+        std::vector<AVFormatContext*> inputs(parts.size(), nullptr);
+        AVFormatContext* source = nullptr;
+        AVFormatContext* out = nullptr;
+        AVPacket* pkt = av_packet_alloc();
+        AVPacket* audio_pkt = av_packet_alloc();
+        int audio_index = -1;
+        AVStream* out_video = nullptr;
+        AVStream* out_audio = nullptr;
+        bool ok = pkt && audio_pkt;
+        
+        for (size_t i = 0; ok && i < parts.size(); i++) {
+            ok = avformat_open_input(&inputs[i], parts[i].c_str(), nullptr, nullptr) >= 0 &&
+                 avformat_find_stream_info(inputs[i], nullptr) >= 0 && inputs[i]->nb_streams == 1;
+        }
+        // 各段编码参数相同才能无损拼接（同一编码器同一配置时SPS/PPS一致）
+        for (size_t i = 1; ok && i < parts.size(); i++) {
+            const AVCodecParameters* a = inputs[0]->streams[0]->codecpar;
+            const AVCodecParameters* b = inputs[i]->streams[0]->codecpar;
+            ok = a->codec_id == b->codec_id && a->width == b->width && a->height == b->height &&
+                 a->extradata_size == b->extradata_size &&
+                 (a->extradata_size == 0 || memcmp(a->extradata, b->extradata, a->extradata_size) == 0);
+            if (!ok) {
+                LOGE("❌ 分段%zu编码参数不一致，无法无损拼接", i);
+            }
         }
-        last_width = frame->width;
-        last_height = frame->height;
-        LOGI("✅ 设置Surface缓冲区: %dx%d", frame->width, frame->height);
-    }
-
-    // MediaCodec格式23的特殊处理 - 根据实际数据布局智能检测格式
-    AVPixelFormat input_format;
-
-    if (frame->format == 23) {
-        // 分析MediaCodec格式23的实际数据布局
-        static int format_debug_count = 0;
-        if (format_debug_count++ % 30 == 0) {
-            LOGD("🔍 MediaCodec格式23分析: %dx%d, linesize=[%d,%d,%d], data=[%p,%p,%p]",
-                 frame->width, frame->height,
-                 frame->linesize[0], frame->linesize[1], frame->linesize[2],
-                 frame->data[0], frame->data[1], frame->data[2]);
+        
+        if (ok) {
+            ok = avformat_alloc_output_context2(&out, nullptr, "mp4", output) >= 0;
         }
-
-        // 智能格式检测：基于linesize和data指针的布局
-        if (frame->linesize[1] == frame->linesize[0] && frame->data[1] != nullptr && frame->data[2] == nullptr) {
-            // linesize[1] == linesize[0] 且只有data[0]和data[1]，这是NV12格式
-            input_format = AV_PIX_FMT_NV12;
-            if (format_debug_count % 30 == 0) {
-                LOGI("🎯 检测到NV12格式 (linesize[1]==linesize[0])");
+        if (ok) {
+            out_video = avformat_new_stream(out, nullptr);
+            ok = out_video && avcodec_parameters_copy(out_video->codecpar, inputs[0]->streams[0]->codecpar) >= 0;
+        }
+        if (ok) {
+            out_video->codecpar->codec_tag = 0;
+            out_video->time_base = inputs[0]->streams[0]->time_base;
+            out_video->sample_aspect_ratio = inputs[0]->streams[0]->sample_aspect_ratio;
+            
+            // 源文件音频直通（失败不影响视频）
+            if (avformat_open_input(&source, input_path.c_str(), nullptr, nullptr) >= 0 &&
+                avformat_find_stream_info(source, nullptr) >= 0) {
+                audio_index = av_find_best_stream(source, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
             }
-        } else if (frame->linesize[1] == frame->linesize[0]/2 && frame->data[1] != nullptr && frame->data[2] != nullptr) {
-            // linesize[1] == linesize[0]/2 且有data[0]、data[1]、data[2]，这是YUV420P格式
-            input_format = AV_PIX_FMT_YUV420P;
-            if (format_debug_count % 30 == 0) {
-                LOGI("🎯 检测到YUV420P格式 (linesize[1]==linesize[0]/2)");
+            if (audio_index >= 0 &&
+                avformat_query_codec(out->oformat, source->streams[audio_index]->codecpar->codec_id,
+                                     FF_COMPLIANCE_NORMAL) == 1) {
+                out_audio = avformat_new_stream(out, nullptr);
+                if (out_audio && avcodec_parameters_copy(out_audio->codecpar, source->streams[audio_index]->codecpar) >= 0) {
+                    out_audio->codecpar->codec_tag = 0;
+                    out_audio->time_base = source->streams[audio_index]->time_base;
+                } else {
+                    out_audio = nullptr;
+                }
             }
-        } else if (frame->data[1] != nullptr && frame->data[2] == nullptr) {
-            // 只有data[0]和data[1]，默认NV21（Android常用）
-            input_format = AV_PIX_FMT_NV21;
-            if (format_debug_count % 30 == 0) {
-                LOGI("🎯 默认使用NV21格式 (Android标准)");
+            ok = avio_open(&out->pb, output, AVIO_FLAG_WRITE) >= 0 && avformat_write_header(out, nullptr) >= 0;
+        }
+        
+        int64_t origin_us = av_rescale_q(first_pts.empty() ? 0 : first_pts[0], video_time_base, AV_TIME_BASE_Q);
+        bool audio_pending = false;
+        bool audio_eof = !out_audio;
+        int64_t last_dts = AV_NOPTS_VALUE;
+        
+        for (size_t i = 0; ok && i < parts.size(); i++) {
+            AVRational part_tb = inputs[i]->streams[0]->time_base;
+            int64_t source_offset = av_rescale_q(first_pts[i] - first_pts[0], video_time_base, out_video->time_base);
+            int64_t offset = source_offset;
+            bool first_packet = true;
+            while (ok && av_read_frame(inputs[i], pkt) >= 0) {
+                av_packet_rescale_ts(pkt, part_tb, out_video->time_base);
+                // 按段首包的dts（含本段的编码延迟）确定整段偏移，pts和dts一起移动
+                if (first_packet) {
+                    first_packet = false;
+                    offset = segmentTimestampOffset(source_offset, pkt->dts, last_dts, AV_NOPTS_VALUE);
+                    if (offset != source_offset) {
+                        LOGD("🎞️ 分段%zu编码延迟与上一段不同，整段后移%lld", i, (long long)(offset - source_offset));
+                    }
+                }
+                if (pkt->pts != AV_NOPTS_VALUE) pkt->pts += offset;
+                if (pkt->dts != AV_NOPTS_VALUE) {
+                    pkt->dts += offset;
+                    last_dts = pkt->dts;
+                }
+                
+                // 写入时间不晚于当前视频包的音频
+                int64_t video_us = av_rescale_q(pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts,
+                                                out_video->time_base, AV_TIME_BASE_Q);
+                writeAudioUntil(source, audio_index, out, out_audio, audio_pkt, origin_us, video_us,
+                                audio_pending, audio_eof);
+                
+                pkt->stream_index = out_video->index;
+                pkt->pos = -1;
+                ok = av_interleaved_write_frame(out, pkt) >= 0;
+                av_packet_unref(pkt);
             }
-        } else {
-            // 回退到YUV420P
-            input_format = AV_PIX_FMT_YUV420P;
-            if (format_debug_count % 30 == 0) {
-                LOGI("🎯 回退到YUV420P格式");
+        }
+        if (ok) {
+            writeAudioUntil(source, audio_index, out, out_audio, audio_pkt, origin_us,
+                            INT64_MAX, audio_pending, audio_eof);
+            ok = av_write_trailer(out) >= 0;
+        }
+        
+        if (out) {
+            avio_closep(&out->pb);
+            avformat_free_context(out);
+        }
+        if (source) {
+            avformat_close_input(&source);
+        }
+        for (size_t i = 0; i < inputs.size(); i++) {
+            if (inputs[i]) {
+                avformat_close_input(&inputs[i]);
             }
         }
-    } else {
-        input_format = (AVPixelFormat)frame->format;
+        av_packet_free(&pkt);
+        av_packet_free(&audio_pkt);
+        return ok;
     }
-
-    // 线程安全的SwsContext管理
-    static SwsContext* cached_sws_ctx = nullptr;
-    static int cached_width = 0, cached_height = 0;
-    static AVPixelFormat cached_format = AV_PIX_FMT_NONE;
-    static std::mutex sws_mutex;
-
-    SwsContext* current_sws_ctx = nullptr;
-
-    // 线程安全地获取SwsContext - 添加Surface状态检查
-    {
-        std::lock_guard<std::mutex> sws_lock(sws_mutex);
-
-        // 检查Surface状态，防止在Surface重建期间操作SwsContext
-        if (surface_being_recreated.load() || !surface_valid) {
-            LOGD("🛑 Surface重建中或无效，跳过SwsContext操作");
+    
+    // 写入输出时间线上不晚于until_us的音频；audio_pkt为跨调用暂存的下一个音频包（audio_pending表示其有效）
+    static void writeAudioUntil(AVFormatContext* source, int audio_index, AVFormatContext* out, AVStream* out_audio,
+                                AVPacket* audio_pkt, int64_t origin_us, int64_t until_us,
+                                bool& audio_pending, bool& audio_eof) {
+        if (!out_audio) {
             return;
         }
-
-        // 更新SwsContext（如果需要）
-        if (!cached_sws_ctx || cached_width != frame->width || cached_height != frame->height || cached_format != input_format) {
-
-            // 释放旧的SwsContext
-            if (cached_sws_ctx) {
-                sws_freeContext(cached_sws_ctx);
-                cached_sws_ctx = nullptr;
-            }
-
-            // 按优先级尝试创建SwsContext
-            const AVPixelFormat try_formats[] = {
-                    input_format,        // 首选检测到的格式
-                    AV_PIX_FMT_NV21,    // Android标准格式
-                    AV_PIX_FMT_NV12,    // 通用NV12格式
-                    AV_PIX_FMT_YUV420P  // 通用YUV420P格式
-            };
-
-            bool success = false;
-            for (int i = 0; i < 4; i++) {
-                // 跳过重复的格式
-                if (i > 0 && try_formats[i] == input_format) {
-                    continue;
+        AVRational src_tb = source->streams[audio_index]->time_base;
+        while (!audio_eof) {
+            if (!audio_pending) {
+                if (av_read_frame(source, audio_pkt) < 0) {
+                    audio_eof = true;
+                    return;
                 }
-
-                cached_sws_ctx = sws_getContext(
-                        frame->width, frame->height, try_formats[i],
-                        frame->width, frame->height, AV_PIX_FMT_RGBA,
-                        SWS_BILINEAR, nullptr, nullptr, nullptr);
-
-                if (cached_sws_ctx) {
-                    input_format = try_formats[i]; // 更新实际使用的格式
-                    cached_format = input_format;
-                    success = true;
-                    LOGD("🔄 SwsContext创建成功: %dx%d, %s->RGBA",
-                         frame->width, frame->height, av_get_pix_fmt_name(input_format));
-                    break;
-                } else {
-                    LOGW("⚠️ SwsContext创建失败: %s", av_get_pix_fmt_name(try_formats[i]));
+                if (audio_pkt->stream_index != audio_index || audio_pkt->pts == AV_NOPTS_VALUE) {
+                    av_packet_unref(audio_pkt);
+                    continue;
                 }
+                audio_pending = true;
             }
-
-            if (!success) {
-                LOGE("❌ 所有格式都无法创建SwsContext");
+            int64_t audio_us = av_rescale_q(audio_pkt->pts, src_tb, AV_TIME_BASE_Q) - origin_us;
+            if (audio_us > until_us) {
                 return;
             }
-
-            cached_width = frame->width;
-            cached_height = frame->height;
+            audio_pending = false;
+            if (audio_us < 0) {
+                av_packet_unref(audio_pkt);
+                continue;
+            }
+            int64_t origin = av_rescale_q(origin_us, AV_TIME_BASE_Q, src_tb);
+            audio_pkt->pts -= origin;
+            if (audio_pkt->dts != AV_NOPTS_VALUE) audio_pkt->dts -= origin;
+            av_packet_rescale_ts(audio_pkt, src_tb, out_audio->time_base);
+            audio_pkt->stream_index = out_audio->index;
+            audio_pkt->pos = -1;
+            av_interleaved_write_frame(out, audio_pkt);
+            av_packet_unref(audio_pkt);
         }
-
-        current_sws_ctx = cached_sws_ctx;
     }
+};
 
-    // 检查SwsContext是否有效
-    if (!current_sws_ctx) {
-        LOGE("❌ SwsContext无效，跳过渲染");
-        return;
+// 并行度：0/1表示单链路转码，大于1时对足够长的重编码任务启用分段并行
+static std::atomic<int> g_convert_workers(1);
+
+// 转码入口：优先分段并行，不适用或失败（非取消）时退回单链路
+static bool transcodeFile(const char* input, const char* output, int width, int height,
+                          const StreamingTranscoder::ProgressCallback& progress) {
+    int workers = g_convert_workers.load();
+    if (workers > 1) {
+        ParallelTranscoder parallel;
+        if (parallel.prepare(input, width, height, workers)) {
+            if (parallel.run(output, progress)) {
+                return true;
+            }
+            if (parallel.isCancelled()) {
+                return false;
+            }
+            LOGW("⚠️ 并行转码失败，退回单链路转码");
+        }
     }
+    StreamingTranscoder transcoder;
+    return transcoder.run(input, output, width, height, progress);
+}
+#endif
 
-    // 再次检查Surface状态（SwsContext获取后可能Surface已变化）
-    if (!surface_valid || !native_window) {
-        LOGW("⚠️ Surface在SwsContext获取后变为无效，跳过渲染");
-        return;
+// ============================================================================
+// 缩略图提取 - 只定位到关键帧并只解码关键帧，缩放后直接写入调用方的RGBA缓冲区
+// ============================================================================
+#if FFMPEG_FOUND
+class ThumbnailExtractor {
+public:
+    ThumbnailExtractor() :
+        input_ctx(nullptr), decoder_ctx(nullptr), sws_ctx(nullptr), packet(nullptr), frame(nullptr),
+        video_index(-1) {}
+    
+    ~ThumbnailExtractor() {
+        sws_freeContext(sws_ctx);
+        av_frame_free(&frame);
+        av_packet_free(&packet);
+        avcodec_free_context(&decoder_ctx);
+        if (input_ctx) {
+            avformat_close_input(&input_ctx);
+        }
     }
-
-    // 超低延迟渲染：激进的跳帧策略
-    static auto last_render_time = std::chrono::steady_clock::now();
-    auto current_time = std::chrono::steady_clock::now();
-    auto time_since_last = std::chrono::duration_cast<std::chrono::milliseconds>(
-            current_time - last_render_time).count();
-
-    // 超智能跳帧策略：基于实际性能动态调整
-    static int consecutive_slow_renders = 0;
-    static int consecutive_fast_renders = 0;
-    static int adaptive_threshold = 30; // 动态调整的跳帧阈值
-    static auto last_threshold_update = std::chrono::steady_clock::now();
-
-    // 性能检测和阈值调整
-    if (time_since_last > 50) {
-        // 渲染很慢
-        consecutive_slow_renders++;
-        consecutive_fast_renders = 0;
-
-        if (consecutive_slow_renders > 3) {
-            adaptive_threshold = std::max(15, adaptive_threshold - 2); // 降低阈值，允许更频繁渲染
+    
+    bool open(const char* path) {
+        if (avformat_open_input(&input_ctx, path, nullptr, nullptr) < 0) {
+            LOGE("❌ 缩略图: 无法打开 %s", path);
+            return false;
         }
-    } else if (time_since_last < 20) {
-        // 渲染很快
-        consecutive_fast_renders++;
-        consecutive_slow_renders = 0;
-
-        if (consecutive_fast_renders > 5) {
-            adaptive_threshold = std::min(35, adaptive_threshold + 1); // 提高阈值，减少不必要渲染
+        // MP4/MKV打开后codecpar已完整，只有参数缺失时才做耗时的流信息探测
+        video_index = av_find_best_stream(input_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+        if (video_index < 0 || input_ctx->streams[video_index]->codecpar->width <= 0) {
+            if (avformat_find_stream_info(input_ctx, nullptr) < 0) {
+                return false;
+            }
+            video_index = av_find_best_stream(input_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
         }
-    } else {
-        // 渲染正常
-        consecutive_slow_renders = 0;
-        consecutive_fast_renders = 0;
+        if (video_index < 0) {
+            return false;
+        }
+        
+        AVCodecParameters* par = input_ctx->streams[video_index]->codecpar;
+        const AVCodec* codec = avcodec_find_decoder(par->codec_id);
+        if (!codec) {
+            return false;
+        }
+        decoder_ctx = avcodec_alloc_context3(codec);
+        if (!decoder_ctx || avcodec_parameters_to_context(decoder_ctx, par) < 0) {
+            return false;
+        }
+        // 只解码关键帧；帧级多线程会缓存多帧才输出，单帧解码只用片级多线程
+        decoder_ctx->skip_frame = AVDISCARD_NONKEY;
+        decoder_ctx->thread_count = 0;
+        decoder_ctx->thread_type = FF_THREAD_SLICE;
+        decoder_ctx->flags2 |= AV_CODEC_FLAG2_FAST;
+        if (avcodec_open2(decoder_ctx, codec, nullptr) < 0) {
+            return false;
+        }
+        packet = av_packet_alloc();
+        frame = av_frame_alloc();
+        return packet && frame;
     }
-
-    // 定期重置阈值（避免长期偏移）
-    auto now = std::chrono::steady_clock::now();
-    if (std::chrono::duration_cast<std::chrono::seconds>(now - last_threshold_update).count() > 10) {
-        adaptive_threshold = 30; // 重置为默认值
-        last_threshold_update = now;
+    
+    // 按显示宽高比（含像素宽高比）计算缩略图高度，取偶数
+    int thumbnailHeight(int width) const {
+        AVStream* stream = input_ctx->streams[video_index];
+        AVCodecParameters* par = stream->codecpar;
+        if (par->width <= 0 || par->height <= 0) {
+            return 0;
+        }
+        AVRational sar = av_guess_sample_aspect_ratio(input_ctx, stream, nullptr);
+        if (sar.num <= 0 || sar.den <= 0) {
+            sar = AVRational{1, 1};
+        }
+        int64_t height = av_rescale((int64_t)width * par->height, sar.den, (int64_t)par->width * sar.num);
+        return std::max<int>(2, (int)(height + 1) & ~1);
     }
-
-    // 应用智能跳帧策略
-    if (time_since_last < adaptive_threshold) {
-        static int skip_count = 0;
-        if (skip_count++ % 60 == 0) {
-            LOGD("🧠 智能跳帧: %lldms < %dms (慢渲染:%d, 快渲染:%d)",
-                 time_since_last, adaptive_threshold, consecutive_slow_renders, consecutive_fast_renders);
+    
+    // 在时长内均匀取count个时间点，每个点取其之前最近的关键帧；相邻点落在同一关键帧时直接复制
+    int extract(int count, int width, int height, uint8_t* out) {
+        AVStream* stream = input_ctx->streams[video_index];
+        int64_t start = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+        int64_t duration = stream->duration > 0 ? stream->duration :
+                           av_rescale_q(std::max<int64_t>(input_ctx->duration, 0), AV_TIME_BASE_Q, stream->time_base);
+        size_t thumb_size = (size_t)width * height * 4;
+        int64_t last_key_pts = AV_NOPTS_VALUE;
+        int written = 0;
+        
+        for (int i = 0; i < count; i++) {
+            uint8_t* dst = out + thumb_size * i;
+            int64_t target = start + duration * (2 * i + 1) / (2 * count);
+            int64_t key_pts = AV_NOPTS_VALUE;
+            if (!seekToKeyframe(target, key_pts)) {
+                break;
+            }
+            if (key_pts != AV_NOPTS_VALUE && key_pts == last_key_pts && i > 0) {
+                memcpy(dst, dst - thumb_size, thumb_size);
+                written++;
+                continue;
+            }
+            if (!decodeKeyframe() || !scaleInto(dst, width, height)) {
+                break;
+            }
+            last_key_pts = key_pts;
+            written++;
         }
-        return;
+        return written;
     }
-
-    // 最终Surface安全检查
-    if (surface_locked || !surface_valid || !native_window) {
-        static int final_check_fail_count = 0;
-        if (final_check_fail_count++ % 30 == 0) {
-            LOGW("⚠️ 最终检查失败: locked=%s, valid=%s, window=%p (第%d次)",
-                 surface_locked ? "true" : "false",
-                 surface_valid ? "true" : "false",
-                 native_window, final_check_fail_count);
+    
+private:
+    AVFormatContext* input_ctx;
+    AVCodecContext* decoder_ctx;
+    SwsContext* sws_ctx;
+    AVPacket* packet;
+    AVFrame* frame;
+    int video_index;
+    
+    // 向前定位到关键帧，并读出该关键帧数据包（留在packet中）
+    bool seekToKeyframe(int64_t target, int64_t& key_pts) {
+        if (av_seek_frame(input_ctx, video_index, target, AVSEEK_FLAG_BACKWARD) < 0) {
+            return false;
         }
-        return;
+        avcodec_flush_buffers(decoder_ctx);
+        while (av_read_frame(input_ctx, packet) >= 0) {
+            if (packet->stream_index == video_index && (packet->flags & AV_PKT_FLAG_KEY)) {
+                key_pts = packet->pts;
+                return true;
+            }
+            av_packet_unref(packet);
+        }
+        return false;
     }
-
-    // 尝试非阻塞锁定
-    ANativeWindow_Buffer buffer;
-    int lock_ret = ANativeWindow_lock(native_window, &buffer, nullptr);
-    if (lock_ret != 0) {
-        static int lock_fail_count = 0;
-        if (lock_fail_count++ % 30 == 0) {
-            LOGW("⚠️ ANativeWindow_lock失败: %d，可能Surface已销毁 (第%d次)", lock_ret, lock_fail_count);
+    
+    // 送入关键帧后立即冲刷，避免解码器等待后续数据包（有B帧时会延迟输出）
+    bool decodeKeyframe() {
+        int ret = avcodec_send_packet(decoder_ctx, packet);
+        av_packet_unref(packet);
+        if (ret < 0) {
+            return false;
         }
-        // Surface可能已经无效，标记为无效
-        surface_valid = false;
-        return;
+        avcodec_send_packet(decoder_ctx, nullptr);
+        ret = avcodec_receive_frame(decoder_ctx, frame);
+        return ret >= 0;
     }
-
-    // 成功锁定，标记状态
-    surface_locked = true;
-
-    // 计算目标参数
-    int dst_stride = buffer.stride * 4;
-    uint8_t* dst_data[4] = {(uint8_t*)buffer.bits, nullptr, nullptr, nullptr};
-    int dst_linesize[4] = {dst_stride, 0, 0, 0};
-
-    // 最后一次检查：确保所有指针有效且Surface未被重建
-    if (!current_sws_ctx || !frame->data[0] || !dst_data[0] || !surface_valid || surface_being_recreated.load()) {
-        LOGE("❌ sws_scale前检查失败: sws_ctx=%p, frame_data=%p, dst_data=%p, surface_valid=%s, recreating=%s",
-             current_sws_ctx, frame->data[0], dst_data[0], surface_valid ? "true" : "false",
-             surface_being_recreated.load() ? "true" : "false");
-        ANativeWindow_unlockAndPost(native_window);
-        surface_locked = false;
-        return;
+    
+    // swscale按CPU特性选择NEON/SSE实现，快速双线性对缩略图足够
+    bool scaleInto(uint8_t* dst, int width, int height) {
+        sws_ctx = sws_getCachedContext(sws_ctx, frame->width, frame->height, (AVPixelFormat)frame->format,
+                                       width, height, AV_PIX_FMT_RGBA, SWS_FAST_BILINEAR,
+                                       nullptr, nullptr, nullptr);
+        if (!sws_ctx) {
+            av_frame_unref(frame);
+            return false;
+        }
+        uint8_t* dst_data[4] = {dst, nullptr, nullptr, nullptr};
+        int dst_linesize[4] = {width * 4, 0, 0, 0};
+        int ret = sws_scale(sws_ctx, frame->data, frame->linesize, 0, frame->height, dst_data, dst_linesize);
+        av_frame_unref(frame);
+        return ret > 0;
     }
+};
+#endif
 
-    // 直接转换到window buffer - 使用线程安全的SwsContext
-    // 再次检查Surface状态，这是最后的保护
-    if (surface_being_recreated.load()) {
-        LOGE("❌ sws_scale执行前Surface被重建，中止");
-        ANativeWindow_unlockAndPost(native_window);
-        surface_locked = false;
-        return;
+// ============================================================================
+// 逐帧定位读取 - 借助录制时生成的.idx索引，二分查找关键帧，只在GOP内顺序解码
+// ============================================================================
+#if FFMPEG_FOUND
+class IndexedFrameReader {
+public:
+    IndexedFrameReader() :
+        input_ctx(nullptr), decoder_ctx(nullptr), sws_ctx(nullptr), packet(nullptr),
+        current(nullptr), lookahead(nullptr), video_index(-1), current_keyframe(-1), input_eof(false) {}
+    
+    ~IndexedFrameReader() {
+        sws_freeContext(sws_ctx);
+        av_frame_free(&current);
+        av_frame_free(&lookahead);
+        av_packet_free(&packet);
+        avcodec_free_context(&decoder_ctx);
+        if (input_ctx) {
+            avformat_close_input(&input_ctx);
+        }
     }
-
-    int ret = sws_scale(current_sws_ctx, frame->data, frame->linesize, 0, frame->height,
-                        dst_data, dst_linesize);
-
-    if (ret > 0) {
-        // 成功转换，直接显示
-        if (ANativeWindow_unlockAndPost(native_window) == 0) {
-            surface_locked = false;  // 标记Surface已解锁
-            last_render_time = current_time;
-
-            // 计算实际渲染帧率（每30帧输出一次）
-            static int render_count = 0;
-            static auto fps_start_time = current_time;
-
-            render_count++;
-            if (render_count % 30 == 0) {
-                auto total_time = std::chrono::duration_cast<std::chrono::microseconds>(
-                        current_time - fps_start_time).count();
-
-                if (total_time > 0) {
-                    float render_fps = 30000000.0f / total_time; // fps
-                    LOGD("🎨 实际渲染FPS: %.1f", render_fps);
+    
+    bool open(const char* path) {
+        if (avformat_open_input(&input_ctx, path, nullptr, nullptr) < 0 ||
+            avformat_find_stream_info(input_ctx, nullptr) < 0) {
+            LOGE("❌ 无法打开录制文件: %s", path);
+            return false;
+        }
+        video_index = av_find_best_stream(input_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+        if (video_index < 0) {
+            return false;
+        }
+        AVCodecParameters* par = input_ctx->streams[video_index]->codecpar;
+        const AVCodec* codec = avcodec_find_decoder(par->codec_id);
+        decoder_ctx = codec ? avcodec_alloc_context3(codec) : nullptr;
+        if (!decoder_ctx || avcodec_parameters_to_context(decoder_ctx, par) < 0) {
+            return false;
+        }
+        // 拖动时每次只需要一帧，帧级多线程的缓冲延迟得不偿失
+        decoder_ctx->thread_count = 0;
+        decoder_ctx->thread_type = FF_THREAD_SLICE;
+        decoder_ctx->pkt_timebase = input_ctx->streams[video_index]->time_base;
+        if (avcodec_open2(decoder_ctx, codec, nullptr) < 0) {
+            return false;
+        }
+        packet = av_packet_alloc();
+        current = av_frame_alloc();
+        lookahead = av_frame_alloc();
+        if (!packet || !current || !lookahead) {
+            return false;
+        }
+        
+        if (!loadIndex(std::string(path) + ".idx")) {
+            LOGW("⚠️ 没有可用的定位索引，使用容器自身的定位: %s", path);
+        }
+        return true;
+    }
+    
+    // 读取time_ms处显示的帧（pts不大于目标的最后一帧），缩放为RGBA写入out，返回该帧的时间(ms)，失败返回-1
+    int64_t readFrameAt(int64_t time_ms, int width, int height, uint8_t* out) {
+        AVStream* stream = input_ctx->streams[video_index];
+        int64_t start = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+        int64_t target = start + av_rescale_q(time_ms, AVRational{1, 1000}, stream->time_base);
+        
+        // 目标仍在当前GOP且不早于已解码位置时直接向后解码，否则定位到关键帧
+        int64_t keyframe = findKeyframe(target);
+        bool continue_gop = keyframe >= 0 && keyframe == current_keyframe &&
+                            current->format >= 0 && framePts(current) <= target;
+        if (!continue_gop && !seekTo(keyframe, target)) {
+            return -1;
+        }
+        current_keyframe = keyframe;
+        
+        while (true) {
+            if (lookahead->format >= 0) {
+                if (framePts(lookahead) > target) {
+                    break;
                 }
-                fps_start_time = current_time;
+                av_frame_unref(current);
+                av_frame_move_ref(current, lookahead);
+            }
+            if (!decodeNext(lookahead)) {
+                break;
             }
-        } else {
-            surface_locked = false;  // 即使失败也要标记解锁
-            LOGE("❌ ANativeWindow_unlockAndPost失败");
         }
-    } else {
-        // 转换失败，解锁buffer
-        ANativeWindow_unlockAndPost(native_window);
-        surface_locked = false;  // 标记Surface已解锁
-
-        // 减少错误日志输出频率
-        static int error_count = 0;
-        if (error_count++ % 10 == 0) {
-            LOGE("❌ 颜色空间转换失败: %d (格式:%s)", ret, av_get_pix_fmt_name(input_format));
+        
+        AVFrame* result = current->format >= 0 ? current : lookahead;
+        if (result->format < 0 || !scaleInto(result, width, height, out)) {
+            return -1;
         }
+        return av_rescale_q(framePts(result) - start, stream->time_base, AVRational{1, 1000});
     }
-}
-#endif
-
-static void cleanupFFmpegInternal() {
-    FFmpegManager::getInstance()->cleanupFFmpeg();
-
-#if FFMPEG_FOUND
-    // 清理RTSP相关资源
-    if (rtsp_input_ctx) {
-        avformat_close_input(&rtsp_input_ctx);
-        rtsp_input_ctx = nullptr;
-    }
-
-    if (rtsp_output_ctx) {
-        if (!(rtsp_output_ctx->oformat->flags & AVFMT_NOFILE)) {
-            avio_closep(&rtsp_output_ctx->pb);
+    
+private:
+    MappedFile index_file;
+    RecordingIndexView index;
+    AVFormatContext* input_ctx;
+    AVCodecContext* decoder_ctx;
+    SwsContext* sws_ctx;
+    AVPacket* packet;
+    AVFrame* current;               // 最近一帧pts不大于目标的帧
+    AVFrame* lookahead;             // 已解码但pts超过目标的下一帧，留给后续向前拖动
+    int video_index;
+    int64_t current_keyframe;       // 当前解码位置所在GOP的关键帧记录下标
+    bool input_eof;
+    
+    bool loadIndex(const std::string& index_path) {
+        struct stat st;
+        if (stat(index_path.c_str(), &st) != 0 || (size_t)st.st_size < sizeof(RecordingIndexHeader) ||
+            !index_file.open(index_path.c_str(), (size_t)st.st_size)) {
+            return false;
         }
-        avformat_free_context(rtsp_output_ctx);
-        rtsp_output_ctx = nullptr;
+        if (!index.load(index_file.bytes(), index_file.size())) {
+            LOGW("⚠️ 定位索引版本或格式不匹配: %s", index_path.c_str());
+            return false;
+        }
+        LOGI("🗂️ 已加载定位索引: %zu条", index.size());
+        return true;
     }
-
-    if (decoder_ctx) {
-        avcodec_free_context(&decoder_ctx);
-        decoder_ctx = nullptr;
+    
+    // 返回pts不大于target的最后一个关键帧的记录下标，没有可用索引或索引损坏时返回-1
+    int64_t findKeyframe(int64_t target) const {
+        if (index.size() == 0) {
+            return -1;
+        }
+        AVRational index_time_base = {index.timeBaseNum(), index.timeBaseDen()};
+        return index.findKeyframe(av_rescale_q(target, input_ctx->streams[video_index]->time_base, index_time_base));
     }
-
-    if (sws_ctx) {
-        sws_freeContext(sws_ctx);
-        sws_ctx = nullptr;
+    
+    bool seekTo(int64_t keyframe, int64_t target) {
+        int64_t seek_pts = target;
+        if (keyframe >= 0) {
+            AVRational index_time_base = {index.timeBaseNum(), index.timeBaseDen()};
+            seek_pts = av_rescale_q(index.entry((size_t)keyframe).pts, index_time_base,
+                                    input_ctx->streams[video_index]->time_base);
+        }
+        if (av_seek_frame(input_ctx, video_index, seek_pts, AVSEEK_FLAG_BACKWARD) < 0) {
+            return false;
+        }
+        avcodec_flush_buffers(decoder_ctx);
+        av_frame_unref(current);
+        av_frame_unref(lookahead);
+        input_eof = false;
+        return true;
     }
-
-    if (frame) {
-        av_frame_free(&frame);
-        frame = nullptr;
+    
+    bool decodeNext(AVFrame* out) {
+        while (true) {
+            int ret = avcodec_receive_frame(decoder_ctx, out);
+            if (ret >= 0) {
+                return true;
+            }
+            if (ret != AVERROR(EAGAIN) || input_eof) {
+                return false;
+            }
+            if (av_read_frame(input_ctx, packet) < 0) {
+                input_eof = true;
+                avcodec_send_packet(decoder_ctx, nullptr);
+                continue;
+            }
+            if (packet->stream_index == video_index) {
+                avcodec_send_packet(decoder_ctx, packet);
+            }
+            av_packet_unref(packet);
+        }
     }
-
-    if (frame_rgba) {
-        av_frame_free(&frame_rgba);
-        frame_rgba = nullptr;
+    
+    static int64_t framePts(const AVFrame* frame) {
+        return frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
     }
-#endif
-
-    // 清理native window
-    {
-        std::lock_guard<std::mutex> lock(surface_mutex);
-        surface_valid = false;
-        surface_locked = false;
-        if (native_window) {
-            ANativeWindow_release(native_window);
-            native_window = nullptr;
+    
+    bool scaleInto(const AVFrame* frame, int width, int height, uint8_t* out) {
+        sws_ctx = sws_getCachedContext(sws_ctx, frame->width, frame->height, (AVPixelFormat)frame->format,
+                                       width, height, AV_PIX_FMT_RGBA, SWS_BILINEAR, nullptr, nullptr, nullptr);
+        if (!sws_ctx) {
+            return false;
         }
+        uint8_t* dst_data[4] = {out, nullptr, nullptr, nullptr};
+        int dst_linesize[4] = {width * 4, 0, 0, 0};
+        return sws_scale(sws_ctx, frame->data, frame->linesize, 0, frame->height, dst_data, dst_linesize) > 0;
     }
-
-    // 重置状态 - 这些变量现在总是可用
-    rtsp_connected = false;
-    rtsp_recording = false;
-    processed_frame_count = 0;
-    total_decode_time = 0;
-    video_stream_index = -1;
-}
+};
+#endif
 
 // JNI方法实现
 
@@ -2772,35 +7030,22 @@ Java_com_jxj_CompileFfmpeg_MainActivity_getVideoInfo(JNIEnv *env, jobject /* thi
     std::string info = "Video Info:\n";
     info += "File: " + std::string(path) + "\n";
 
-    // 尝试打开文件获取信息
-    AVFormatContext *fmt_ctx = nullptr;
-    int ret = avformat_open_input(&fmt_ctx, path, nullptr, nullptr);
-
-    if (ret >= 0) {
-        ret = avformat_find_stream_info(fmt_ctx, nullptr);
-        if (ret >= 0) {
-            info += "Duration: " + std::to_string(fmt_ctx->duration / AV_TIME_BASE) + " seconds\n";
-            info += "Bitrate: " + std::to_string(fmt_ctx->bit_rate) + " bps\n";
-            info += "Streams: " + std::to_string(fmt_ctx->nb_streams) + "\n";
-
-            for (unsigned int i = 0; i < fmt_ctx->nb_streams; i++) {
-                AVStream *stream = fmt_ctx->streams[i];
-                AVCodecParameters *codecpar = stream->codecpar;
-
-                if (codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-                    info += "Video: " + std::string(avcodec_get_name(codecpar->codec_id));
-                    info += " " + std::to_string(codecpar->width) + "x" + std::to_string(codecpar->height) + "\n";
-                } else if (codecpar->codec_type == AVMEDIA_TYPE_AUDIO) {
-                    info += "Audio: " + std::string(avcodec_get_name(codecpar->codec_id));
-                    info += " " + std::to_string(codecpar->sample_rate) + "Hz\n";
-                }
-            }
-        } else {
-            info += "Failed to get stream info\n";
+    MediaInfo media;
+    std::string error;
+    if (probeMediaInfo(path, media, error)) {
+        info += "Duration: " + std::to_string(media.duration_ms / 1000) + " seconds\n";
+        info += "Bitrate: " + std::to_string(media.bit_rate) + " bps\n";
+        info += "Streams: " + std::to_string(media.stream_count) + "\n";
+        if (!media.video_codec.empty()) {
+            info += "Video: " + media.video_codec;
+            info += " " + std::to_string(media.width) + "x" + std::to_string(media.height) + "\n";
+        }
+        if (!media.audio_codec.empty()) {
+            info += "Audio: " + media.audio_codec;
+            info += " " + std::to_string(media.sample_rate) + "Hz\n";
         }
-        avformat_close_input(&fmt_ctx);
     } else {
-        info += "Failed to open file\n";
+        info += error + "\n";
     }
 
     env->ReleaseStringUTFChars(jpath, path);
@@ -2810,6 +7055,97 @@ Java_com_jxj_CompileFfmpeg_MainActivity_getVideoInfo(JNIEnv *env, jobject /* thi
 #endif
 }
 
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_jxj_CompileFfmpeg_MainActivity_getVideoInfoDetails(JNIEnv *env, jobject /* thiz */, jstring jpath) {
+#if FFMPEG_FOUND
+    if (!jpath || !initializeFFmpegInternal()) {
+        return nullptr;
+    }
+
+    const char *path = env->GetStringUTFChars(jpath, nullptr);
+    if (!path) {
+        return nullptr;
+    }
+
+    MediaInfo media;
+    std::string error;
+    jobject result = nullptr;
+    if (probeMediaInfo(path, media, error)) {
+        result = newJavaVideoInfo(env, path, media);
+    } else {
+        LOGE("获取视频信息失败: %s (%s)", path, error.c_str());
+    }
+
+    env->ReleaseStringUTFChars(jpath, path);
+    return result;
+#else
+    return nullptr;
+#endif
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_jxj_CompileFfmpeg_MainActivity_scanVideos(JNIEnv *env, jobject /* thiz */,
+                                                   jobjectArray jpaths, jobject callback) {
+#if FFMPEG_FOUND
+    if (!jpaths || !callback || !initializeFFmpegInternal()) {
+        return 0;
+    }
+
+    jclass callback_class = env->GetObjectClass(callback);
+    jmethodID on_scanned = env->GetMethodID(callback_class, "onVideoScanned",
+                                            "(ILcom/jxj/CompileFfmpeg/VideoInfo;)V");
+    env->DeleteLocalRef(callback_class);
+    if (!on_scanned) {
+        LOGE("❌ 扫描回调缺少onVideoScanned方法");
+        return 0;
+    }
+
+    std::vector<std::string> paths(env->GetArrayLength(jpaths));
+    for (size_t i = 0; i < paths.size(); i++) {
+        jstring jpath = static_cast<jstring>(env->GetObjectArrayElement(jpaths, (jsize)i));
+        if (jpath) {
+            const char* path = env->GetStringUTFChars(jpath, nullptr);
+            if (path) {
+                paths[i] = path;
+                env->ReleaseStringUTFChars(jpath, path);
+            }
+            env->DeleteLocalRef(jpath);
+        }
+    }
+
+    auto start_time = std::chrono::steady_clock::now();
+    int succeeded = 0;
+    MediaInfoScanner scanner(paths, probeScannedFile);
+    scanner.start();
+
+    // 回调在调用线程执行，工作线程无需附加到JVM
+    MediaInfoScanner::Result result;
+    while (scanner.next(result)) {
+        jobject info = result.ok ? newJavaVideoInfo(env, paths[result.index].c_str(), result.info) : nullptr;
+        if (info) {
+            succeeded++;
+        }
+        env->CallVoidMethod(callback, on_scanned, (jint)result.index, info);
+        if (info) {
+            env->DeleteLocalRef(info);
+        }
+        if (env->ExceptionCheck()) {
+            // 回调抛出异常即取消扫描，异常留给Java层处理
+            scanner.cancel();
+            break;
+        }
+    }
+
+    auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time).count();
+    LOGI("📂 批量探测完成: %d/%zu 成功, 耗时 %lldms (%.1f 文件/秒)", succeeded, paths.size(),
+         (long long)elapsed_ms, elapsed_ms > 0 ? paths.size() * 1000.0 / elapsed_ms : 0.0);
+    return succeeded;
+#else
+    return 0;
+#endif
+}
+
 extern "C" JNIEXPORT jboolean JNICALL
 Java_com_jxj_CompileFfmpeg_MainActivity_convertVideo(JNIEnv *env, jobject /* thiz */,
                                                      jstring input_path, jstring output_path) {
@@ -2836,8 +7172,7 @@ Java_com_jxj_CompileFfmpeg_MainActivity_convertVideo(JNIEnv *env, jobject /* thi
 
     LOGI("Convert video: %s -> %s", input, output);
 
-    // TODO: Implement actual video conversion using FFmpeg
-    bool success = true; // Placeholder
+    bool success = transcodeFile(input, output, 0, 0, StreamingTranscoder::ProgressCallback());
 
     env->ReleaseStringUTFChars(input_path, input);
     env->ReleaseStringUTFChars(output_path, output);
@@ -2849,6 +7184,151 @@ Java_com_jxj_CompileFfmpeg_MainActivity_convertVideo(JNIEnv *env, jobject /* thi
 #endif
 }
 
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_jxj_CompileFfmpeg_MainActivity_convertVideoWithProgress(JNIEnv *env, jobject /* thiz */,
+                                                                 jstring input_path, jstring output_path,
+                                                                 jint width, jint height, jobject listener) {
+#if FFMPEG_FOUND
+    if (!input_path || !output_path || !initializeFFmpegInternal()) {
+        return JNI_FALSE;
+    }
+
+    jmethodID on_progress = nullptr;
+    if (listener) {
+        jclass listener_class = env->GetObjectClass(listener);
+        on_progress = env->GetMethodID(listener_class, "onProgress", "(JJ)Z");
+        env->DeleteLocalRef(listener_class);
+        if (!on_progress) {
+            return JNI_FALSE;
+        }
+    }
+
+    const char *input = env->GetStringUTFChars(input_path, nullptr);
+    const char *output = env->GetStringUTFChars(output_path, nullptr);
+    if (!input || !output) {
+        if (input) env->ReleaseStringUTFChars(input_path, input);
+        if (output) env->ReleaseStringUTFChars(output_path, output);
+        return JNI_FALSE;
+    }
+
+    // 转码循环运行在调用线程，回调直接使用当前JNIEnv；回调抛出异常等同于取消
+    StreamingTranscoder::ProgressCallback progress;
+    if (listener) {
+        progress = [env, listener, on_progress](int64_t processed_ms, int64_t duration_ms) {
+            jboolean keep_going = env->CallBooleanMethod(listener, on_progress,
+                                                         (jlong)processed_ms, (jlong)duration_ms);
+            return !env->ExceptionCheck() && keep_going == JNI_TRUE;
+        };
+    }
+
+    bool success = transcodeFile(input, output, width, height, progress);
+
+    env->ReleaseStringUTFChars(input_path, input);
+    env->ReleaseStringUTFChars(output_path, output);
+    return success ? JNI_TRUE : JNI_FALSE;
+#else
+    return JNI_FALSE;
+#endif
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_jxj_CompileFfmpeg_MainActivity_setConvertWorkers(JNIEnv *env, jobject /* thiz */, jint workers) {
+#if FFMPEG_FOUND
+    g_convert_workers.store(std::max(1, std::min((int)workers, (int)SegmentPlanner::kMaxWorkers)));
+    LOGI("🔧 转码并行度: %d", g_convert_workers.load());
+#endif
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_jxj_CompileFfmpeg_MainActivity_extractThumbnails(JNIEnv *env, jobject /* thiz */, jstring jpath,
+                                                          jint count, jint width, jobject output) {
+#if FFMPEG_FOUND
+    if (!jpath || count <= 0 || width <= 0 || !initializeFFmpegInternal()) {
+        return 0;
+    }
+    const char *path = env->GetStringUTFChars(jpath, nullptr);
+    if (!path) {
+        return 0;
+    }
+
+    auto start_time = std::chrono::steady_clock::now();
+    ThumbnailExtractor extractor;
+    jint result = 0;
+    if (extractor.open(path)) {
+        int height = extractor.thumbnailHeight(width);
+        uint8_t* buffer = output ? static_cast<uint8_t*>(env->GetDirectBufferAddress(output)) : nullptr;
+        jlong capacity = output ? env->GetDirectBufferCapacity(output) : 0;
+        jlong required = (jlong)count * width * height * 4;
+        if (height <= 0) {
+            result = 0;
+        } else if (!buffer || capacity < required) {
+            // 缓冲区不足：返回负的高度，调用方按count*width*height*4分配后重试
+            result = -height;
+        } else {
+            int written = extractor.extract(count, width, height, buffer);
+            result = written == count ? height : 0;
+            auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start_time).count();
+            LOGI("🖼️ 缩略图: %d/%d张 %dx%d, 耗时%lldms", written, (int)count, (int)width, height,
+                 (long long)elapsed_ms);
+        }
+    }
+
+    env->ReleaseStringUTFChars(jpath, path);
+    return result;
+#else
+    return 0;
+#endif
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_jxj_CompileFfmpeg_MainActivity_openIndexedReader(JNIEnv *env, jobject /* thiz */, jstring jpath) {
+#if FFMPEG_FOUND
+    if (!jpath || !initializeFFmpegInternal()) {
+        return 0;
+    }
+    const char *path = env->GetStringUTFChars(jpath, nullptr);
+    if (!path) {
+        return 0;
+    }
+    IndexedFrameReader* reader = new IndexedFrameReader();
+    if (!reader->open(path)) {
+        delete reader;
+        reader = nullptr;
+    }
+    env->ReleaseStringUTFChars(jpath, path);
+    return reinterpret_cast<jlong>(reader);
+#else
+    return 0;
+#endif
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_jxj_CompileFfmpeg_MainActivity_readIndexedFrame(JNIEnv *env, jobject /* thiz */, jlong handle,
+                                                         jlong time_ms, jint width, jint height, jobject output) {
+#if FFMPEG_FOUND
+    IndexedFrameReader* reader = reinterpret_cast<IndexedFrameReader*>(handle);
+    if (!reader || !output || width <= 0 || height <= 0) {
+        return -1;
+    }
+    uint8_t* buffer = static_cast<uint8_t*>(env->GetDirectBufferAddress(output));
+    if (!buffer || env->GetDirectBufferCapacity(output) < (jlong)width * height * 4) {
+        LOGE("❌ 帧缓冲区无效或容量不足");
+        return -1;
+    }
+    return reader->readFrameAt(time_ms, width, height, buffer);
+#else
+    return -1;
+#endif
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_jxj_CompileFfmpeg_MainActivity_closeIndexedReader(JNIEnv *env, jobject /* thiz */, jlong handle) {
+#if FFMPEG_FOUND
+    delete reinterpret_cast<IndexedFrameReader*>(handle);
+#endif
+}
+
 // RTSP相关方法
 // 超低延迟解码器初始化函数
 #if FFMPEG_FOUND
@@ -3038,40 +7518,231 @@ static int initUltraLowLatencyDecoder(AVStream* stream) {
                     decoder_ctx->strict_std_compliance = FF_COMPLIANCE_UNOFFICIAL;
                     decoder_ctx->workaround_bugs = FF_BUG_AUTODETECT;
 
-                    // 软件解码器额外优化
-                    decoder_ctx->skip_frame = AVDISCARD_NONREF;
-                    decoder_ctx->skip_idct = AVDISCARD_BIDIR;
-                    decoder_ctx->skip_loop_filter = AVDISCARD_BIDIR;
+                    // 软件解码器额外优化
+                    decoder_ctx->skip_frame = AVDISCARD_NONREF;
+                    decoder_ctx->skip_idct = AVDISCARD_BIDIR;
+                    decoder_ctx->skip_loop_filter = AVDISCARD_BIDIR;
+
+                    ret = avcodec_open2(decoder_ctx, decoder, nullptr);
+                    if (ret >= 0) {
+                        LOGI("✅ 软件解码器重新初始化成功: %s", decoder->name);
+                        LOGI("   - 解码器能力: %s", decoder->long_name ? decoder->long_name : "未知");
+                        LOGI("   - 输入格式: %s (%dx%d)", avcodec_get_name(codec_id),
+                             decoder_ctx->width, decoder_ctx->height);
+                    } else {
+                        LOGE("❌ 软件解码器打开失败: %d", ret);
+                        avcodec_free_context(&decoder_ctx);
+                        return -1;
+                    }
+                } else {
+                    LOGE("❌ 软件解码器上下文分配失败");
+                    return -1;
+                }
+            } else {
+                LOGE("❌ 未找到软件解码器");
+                return -1;
+            }
+        }
+    } else if (hardware_decode_available) {
+        LOGW("⚠️ 硬件解码器已打开但Surface未设置，将使用CPU渲染");
+        hardware_decode_available = false;
+    }
+
+    LOGI("✅ 超低延迟解码器初始化成功");
+    return 0;
+}
+#endif
+
+// 按当前播放器的音频流打开音频输出（先在播放器锁内复制参数，再单独获取音频锁）
+#if FFMPEG_FOUND
+static void openAudioOutputFromPlayer() {
+    AVCodecParameters* par = avcodec_parameters_alloc();
+    AVRational time_base = {1, 1};
+    bool has_audio = false;
+    {
+        std::lock_guard<std::mutex> player_lock(g_player_mutex);
+        if (g_player && par) {
+            has_audio = g_player->copyAudioStreamParameters(par, time_base);
+        }
+    }
+    
+    std::lock_guard<std::mutex> audio_lock(g_audio_mutex);
+    delete g_audio_output;
+    g_audio_output = nullptr;
+    if (has_audio) {
+        g_audio_output = new LowLatencyAudioOutput();
+        if (!g_audio_output->open(par, time_base)) {
+            delete g_audio_output;
+            g_audio_output = nullptr;
+        }
+    } else {
+        LOGI("ℹ️ 当前流没有音频，音频输出未开启");
+    }
+    avcodec_parameters_free(&par);
+}
+
+static void closeAudioOutput() {
+    std::lock_guard<std::mutex> audio_lock(g_audio_mutex);
+    delete g_audio_output;
+    g_audio_output = nullptr;
+}
+#endif
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_jxj_CompileFfmpeg_MainActivity_captureSnapshot(JNIEnv *env, jobject /* thiz */, jstring output_path,
+                                                        jint format, jint quality, jobject callback) {
+#if FFMPEG_FOUND
+    if (!output_path || !initializeFFmpegInternal()) {
+        return JNI_FALSE;
+    }
+    SnapshotWorker::Job* job = new SnapshotWorker::Job();
+    job->frame = av_frame_alloc();
+    job->request_us = av_gettime_relative();
+    // 不经过g_player_mutex：读包阻塞时截图也能立即拿到最新帧
+    if (!job->frame || !LatestFrame::getInstance().ref(job->frame, job->format)) {
+        LOGW("⚠️ 截图: 当前没有可用的解码帧");
+        av_frame_free(&job->frame);
+        delete job;
+        return JNI_FALSE;
+    }
+
+    const char* path = env->GetStringUTFChars(output_path, nullptr);
+    job->path = path ? path : "";
+    if (path) {
+        env->ReleaseStringUTFChars(output_path, path);
+    }
+    job->image_format = format;
+    job->quality = quality;
+    job->callback = callback ? env->NewGlobalRef(callback) : nullptr;
+
+    if (job->path.empty() || !SnapshotWorker::getInstance().submit(job)) {
+        LOGW("⚠️ 截图: 上一张截图仍在处理，忽略本次请求");
+        if (job->callback) {
+            env->DeleteGlobalRef(job->callback);
+        }
+        av_frame_free(&job->frame);
+        delete job;
+        return JNI_FALSE;
+    }
+    return JNI_TRUE;
+#else
+    return JNI_FALSE;
+#endif
+}
+
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_jxj_CompileFfmpeg_MainActivity_acquireFrame(JNIEnv *env, jobject /* thiz */) {
+#if FFMPEG_FOUND
+    if (!initializeFFmpegInternal()) {
+        return nullptr;
+    }
+    AVFrame* frame = av_frame_alloc();
+    if (!frame) {
+        return nullptr;
+    }
+    PixelFormatDescriptor format;
+    uint64_t serial = 0;
+    // 与截图相同，只经过最新帧的小锁；复制在锁外进行，不阻塞解码线程
+    bool has_frame = LatestFrame::getInstance().ref(frame, format, &serial);
+    jobject result = has_frame ? FrameExportPool::getInstance().acquire(env, frame, format, serial) : nullptr;
+    av_frame_free(&frame);
+    return result;
+#else
+    return nullptr;
+#endif
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_jxj_CompileFfmpeg_MainActivity_releaseFrame(JNIEnv *env, jobject /* thiz */, jobject frame_buffer) {
+#if FFMPEG_FOUND
+    if (frame_buffer && g_frame_buffer_class) {
+        FrameExportPool::getInstance().release(env, frame_buffer);
+    }
+#endif
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_jxj_CompileFfmpeg_MainActivity_startPipelineTrace(JNIEnv *env, jobject /* thiz */) {
+    PipelineTracer::getInstance().start();
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_jxj_CompileFfmpeg_MainActivity_stopPipelineTrace(JNIEnv *env, jobject /* thiz */, jstring output_path) {
+    if (!output_path) {
+        return JNI_FALSE;
+    }
+    const char* path = env->GetStringUTFChars(output_path, nullptr);
+    if (!path) {
+        return JNI_FALSE;
+    }
+    std::string path_str(path);
+    env->ReleaseStringUTFChars(output_path, path);
+    return PipelineTracer::getInstance().stopAndWrite(path_str) ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_jxj_CompileFfmpeg_MainActivity_setAudioPlaybackEnabled(JNIEnv *env, jobject /* thiz */, jboolean enabled) {
+#if FFMPEG_FOUND
+    g_audio_playback_enabled.store(enabled == JNI_TRUE);
+    LOGI("🎵 音频播放: %s", enabled ? "开启" : "关闭");
+    if (enabled && rtsp_connected) {
+        openAudioOutputFromPlayer();
+    } else if (!enabled) {
+        closeAudioOutput();
+    }
+#endif
+}
+
+// 下次openRtspStream时生效；直通建立失败时自动回退到libavformat
+extern "C" JNIEXPORT void JNICALL
+Java_com_jxj_CompileFfmpeg_MainActivity_setRtpDirectEnabled(JNIEnv *env, jobject /* thiz */, jboolean enabled) {
+#if FFMPEG_FOUND
+    g_rtp_direct_enabled = enabled == JNI_TRUE;
+    LOGI("📡 RTP直通快速路径: %s", enabled ? "启用" : "关闭");
+#endif
+}
 
-                    ret = avcodec_open2(decoder_ctx, decoder, nullptr);
-                    if (ret >= 0) {
-                        LOGI("✅ 软件解码器重新初始化成功: %s", decoder->name);
-                        LOGI("   - 解码器能力: %s", decoder->long_name ? decoder->long_name : "未知");
-                        LOGI("   - 输入格式: %s (%dx%d)", avcodec_get_name(codec_id),
-                             decoder_ctx->width, decoder_ctx->height);
-                    } else {
-                        LOGE("❌ 软件解码器打开失败: %d", ret);
-                        avcodec_free_context(&decoder_ctx);
-                        return -1;
-                    }
-                } else {
-                    LOGE("❌ 软件解码器上下文分配失败");
-                    return -1;
-                }
-            } else {
-                LOGE("❌ 未找到软件解码器");
-                return -1;
-            }
-        }
-    } else if (hardware_decode_available) {
-        LOGW("⚠️ 硬件解码器已打开但Surface未设置，将使用CPU渲染");
-        hardware_decode_available = false;
-    }
+// 下次openRtspStream时生效；UDP/组播建立失败时自动回退到TCP
+extern "C" JNIEXPORT void JNICALL
+Java_com_jxj_CompileFfmpeg_MainActivity_setRtpTransport(JNIEnv *env, jobject /* thiz */, jint transport,
+                                                        jint reorder_packets, jint reorder_ms, jint recv_buffer_kb) {
+#if FFMPEG_FOUND
+    std::lock_guard<std::mutex> lock(g_rtp_transport_mutex);
+    g_rtp_transport.transport = transport >= RTP_TRANSPORT_TCP && transport <= RTP_TRANSPORT_UDP_MULTICAST ?
+        (int)transport : RTP_TRANSPORT_TCP;
+    g_rtp_transport.reorder_packets = std::max(0, std::min((int)reorder_packets, 64));
+    g_rtp_transport.reorder_ms = std::max(0, std::min((int)reorder_ms, 200));
+    g_rtp_transport.recv_buffer_bytes = std::max(64, std::min((int)recv_buffer_kb, 8192)) * 1024;
+    LOGI("📡 RTP传输: %s, 重排窗口%d包/%dms, 接收缓冲%dKB", rtpTransportName(g_rtp_transport.transport),
+         g_rtp_transport.reorder_packets, g_rtp_transport.reorder_ms, g_rtp_transport.recv_buffer_bytes / 1024);
+#endif
+}
 
-    LOGI("✅ 超低延迟解码器初始化成功");
-    return 0;
+// 下次openRtspStream时生效；0表示该阶段不限时（仍可被closeRtspStream中止）
+extern "C" JNIEXPORT void JNICALL
+Java_com_jxj_CompileFfmpeg_MainActivity_setStreamDeadlines(JNIEnv *env, jobject /* thiz */, jint connect_ms,
+                                                           jint first_frame_ms, jint read_stall_ms) {
+#if FFMPEG_FOUND
+    std::lock_guard<std::mutex> lock(g_stream_deadlines_mutex);
+    g_stream_deadlines.connect_ms = std::max(0, std::min((int)connect_ms, 60000));
+    g_stream_deadlines.first_frame_ms = std::max(0, std::min((int)first_frame_ms, 60000));
+    g_stream_deadlines.read_stall_ms = std::max(0, std::min((int)read_stall_ms, 60000));
+    LOGI("⏱️ 读超时期限: 建立%dms, 首帧%dms, 读包%dms", g_stream_deadlines.connect_ms,
+         g_stream_deadlines.first_frame_ms, g_stream_deadlines.read_stall_ms);
+#endif
 }
+
+// processRtspFrame返回false后用于区分卡死（可重连）和其他错误
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_jxj_CompileFfmpeg_MainActivity_isStreamStalled(JNIEnv *env, jobject /* thiz */) {
+#if FFMPEG_FOUND
+    std::lock_guard<std::mutex> lock(g_stream_watchdog_mutex);
+    return g_stream_watchdog && g_stream_watchdog->hasExpired() && !g_stream_watchdog->isAborted() ?
+        JNI_TRUE : JNI_FALSE;
+#else
+    return JNI_FALSE;
 #endif
+}
 
 extern "C" JNIEXPORT jboolean JNICALL
 Java_com_jxj_CompileFfmpeg_MainActivity_openRtspStream(JNIEnv *env, jobject /* thiz */, jstring rtsp_url) {
@@ -3094,6 +7765,9 @@ Java_com_jxj_CompileFfmpeg_MainActivity_openRtspStream(JNIEnv *env, jobject /* t
 
     LOGI("🚀 使用超低延迟播放核心打开RTSP流: %s", url);
 
+    // 旧流可能正阻塞在读包中并持有g_player_mutex，先中止它
+    abortCurrentStream();
+
     // 线程安全地初始化播放器
     {
         std::lock_guard<std::mutex> lock(g_player_mutex);
@@ -3104,8 +7778,9 @@ Java_com_jxj_CompileFfmpeg_MainActivity_openRtspStream(JNIEnv *env, jobject /* t
             g_player = nullptr;
         }
         
-        // 创建新的超低延迟播放器
+        // 创建新的超低延迟播放器；建立期间closeRtspStream也能通过看门狗中止
         g_player = new UltraLowLatencyPlayer();
+        publishStreamWatchdog(g_player->getWatchdog());
         if (!g_player->initialize(url)) {
             LOGE("❌ 超低延迟播放器初始化失败");
             delete g_player;
@@ -3118,6 +7793,10 @@ Java_com_jxj_CompileFfmpeg_MainActivity_openRtspStream(JNIEnv *env, jobject /* t
     rtsp_connected = true;
     LOGI("✅ 超低延迟RTSP播放器启动成功");
     LOGI("📊 硬件解码: %s", g_player->isHardwareDecoding() ? "启用" : "禁用");
+    
+    if (g_audio_playback_enabled.load()) {
+        openAudioOutputFromPlayer();
+    }
 
     env->ReleaseStringUTFChars(rtsp_url, url);
     return JNI_TRUE;
@@ -3164,6 +7843,9 @@ Java_com_jxj_CompileFfmpeg_MainActivity_prepareRecording(JNIEnv *env, jobject /*
         LOGE("🔧 output_path为空");
         return JNI_FALSE;
     }
+    if (!initializeFFmpegInternal()) {
+        return JNI_FALSE;
+    }
 
     const char *path = env->GetStringUTFChars(output_path, nullptr);
     if (!path) {
@@ -3184,10 +7866,12 @@ Java_com_jxj_CompileFfmpeg_MainActivity_prepareRecording(JNIEnv *env, jobject /*
         delete g_recorder;
         g_recorder = nullptr;
     }
+    releasePreEventReaderLocked();
     
     // 创建新录制器并准备
     LOGI("🔧 创建新录制器");
     g_recorder = new ModernRecorder();
+    g_recorder->setThreadPolicy(getPipelinePolicy());
     bool success = g_recorder->prepare(path);
     LOGI("🔧 录制器准备结果: %s", success ? "成功" : "失败");
     
@@ -3208,30 +7892,148 @@ Java_com_jxj_CompileFfmpeg_MainActivity_prepareRecording(JNIEnv *env, jobject /*
 #endif
 }
 
+// 调用方指定的录制输出参数，0表示继承直播流
+#if FFMPEG_FOUND
+struct RecordingOverride {
+    int width;
+    int height;
+    int fps;
+    
+    RecordingOverride() : width(0), height(0), fps(0) {}
+};
+
+// 以下两项受g_recorder_mutex保护
+static RecordingOverride g_record_override;
+static EncoderConfig g_record_encoder_config;
+
+static int evenDimension(int value) {
+    return std::max(2, value & ~1);
+}
+
+// 调用方已持有g_recorder_mutex
+static void applyRecordingOverrideLocked(RecordingProfile& profile) {
+    int src_width = profile.width;
+    int src_height = profile.height;
+    const RecordingOverride& override_params = g_record_override;
+    
+    // YUV420编码要求宽高为偶数：显式指定的尺寸和按比例推算的尺寸一样向下取偶数（至少2）
+    if (override_params.width > 0 && override_params.height > 0) {
+        profile.width = evenDimension(override_params.width);
+        profile.height = evenDimension(override_params.height);
+    } else if (override_params.width > 0 && src_width > 0) {
+        // 只指定宽度：保持源宽高比
+        profile.width = evenDimension(override_params.width);
+        profile.height = evenDimension((int)((int64_t)src_height * profile.width / src_width));
+    } else if (override_params.height > 0 && src_height > 0) {
+        profile.height = evenDimension(override_params.height);
+        profile.width = evenDimension((int)((int64_t)src_width * profile.height / src_height));
+    }
+    if (override_params.fps > 0) {
+        profile.framerate = AVRational{override_params.fps, 1};
+    }
+    
+    // 缩放后源格式不再能直接送入编码器
+    if (profile.width != src_width || profile.height != src_height) {
+        profile.pix_fmt = AV_PIX_FMT_NONE;
+    }
+}
+#endif
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_jxj_CompileFfmpeg_MainActivity_setRecordingOutputProfile(JNIEnv *env, jobject /* thiz */,
+                                                                  jint width, jint height, jint fps) {
+#if FFMPEG_FOUND
+    std::lock_guard<std::mutex> lock(g_recorder_mutex);
+    g_record_override.width = width > 0 ? width : 0;
+    g_record_override.height = height > 0 ? height : 0;
+    g_record_override.fps = fps > 0 ? fps : 0;
+    LOGI("🔧 录制输出参数: %dx%d@%dfps (0=继承直播流，奇数尺寸向下取偶数)", width, height, fps);
+#endif
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_jxj_CompileFfmpeg_MainActivity_setRecordingEncoderConfig(JNIEnv *env, jobject /* thiz */,
+                                                                  jint bitrate_kbps, jint rate_control, jint crf,
+                                                                  jint gop_length, jboolean intra_refresh,
+                                                                  jint slices, jstring preset) {
+#if FFMPEG_FOUND
+    EncoderConfig config;
+    config.bitrate = (int64_t)bitrate_kbps * 1000;
+    config.rate_control = rate_control;
+    config.crf = crf;
+    config.gop_length = gop_length;
+    config.intra_refresh = intra_refresh == JNI_TRUE;
+    config.slices = slices;
+    if (preset) {
+        const char* preset_str = env->GetStringUTFChars(preset, nullptr);
+        if (preset_str) {
+            config.preset = preset_str;
+            env->ReleaseStringUTFChars(preset, preset_str);
+        }
+    }
+    if (!isValidEncoderConfig(config)) {
+        LOGE("❌ 编码参数无效: bitrate=%dkbps mode=%d crf=%d gop=%d slices=%d preset=%s",
+             bitrate_kbps, rate_control, crf, gop_length, slices, config.preset.c_str());
+        return JNI_FALSE;
+    }
+    
+    std::lock_guard<std::mutex> lock(g_recorder_mutex);
+    g_record_encoder_config = config;
+    LOGI("🎛️ 录制编码参数: %dkbps %s CRF=%d GOP=%d intra-refresh=%s slices=%d preset=%s (0=自动)",
+         bitrate_kbps, rateControlName(rate_control), crf, gop_length,
+         config.intra_refresh ? "是" : "否", slices, config.preset.c_str());
+    return JNI_TRUE;
+#else
+    return JNI_FALSE;
+#endif
+}
+
 extern "C" JNIEXPORT jboolean JNICALL
 Java_com_jxj_CompileFfmpeg_MainActivity_startRtspRecording(JNIEnv *env, jobject /* thiz */, jstring output_path) {
 #if FFMPEG_FOUND
     LOGI("🔧 Native startRtspRecording 开始");
+    if (!initializeFFmpegInternal()) {
+        return JNI_FALSE;
+    }
+    
+    // 避免死锁：先在播放器锁内读取流参数，释放后再获取录制器锁
+    RecordingProfile profile;
+    bool has_stream_profile = false;
+    AVCodecParameters* audio_par = avcodec_parameters_alloc();
+    AVRational audio_time_base = {1, 1};
+    bool has_audio = false;
+    {
+        std::lock_guard<std::mutex> player_lock(g_player_mutex);
+        if (g_player) {
+            has_stream_profile = g_player->getStreamProfile(profile);
+            has_audio = audio_par && g_player->copyAudioStreamParameters(audio_par, audio_time_base);
+        }
+    }
+    if (!has_stream_profile) {
+        LOGW("⚠️ 无法获取直播流参数，使用默认1280x720@30fps");
+        profile.width = 1280;
+        profile.height = 720;
+        profile.framerate = AVRational{30, 1};
+    }
     
     // 线程安全地操作录制器
     LOGI("🔧 获取录制器锁");
     std::lock_guard<std::mutex> recorder_lock(g_recorder_mutex);
+    applyRecordingOverrideLocked(profile);
     
     if (!g_recorder) {
         LOGE("🔧 录制器为空");
+        avcodec_parameters_free(&audio_par);
         return JNI_FALSE;
     }
     
-    LOGI("🔧 使用默认视频参数（避免死锁）");
-    // 避免死锁：不在持有recorder锁时获取player锁
-    // 使用标准的1280x720分辨率和30fps
-    int width = 1280, height = 720;
-    AVRational framerate = {30, 1};
-    LOGI("🔧 使用默认尺寸: %dx%d@%dfps", width, height, framerate.num);
-    
     // 启动录制
-    LOGI("🔧 启动录制器");
-    bool success = g_recorder->start(width, height, framerate);
+    LOGI("🔧 启动录制器: %dx%d@%d/%dfps, 音频: %s", profile.width, profile.height,
+         profile.framerate.num, profile.framerate.den, has_audio ? "直通" : "无");
+    g_recorder->setEncoderConfig(g_record_encoder_config);
+    g_recorder->setAudioSource(has_audio ? audio_par : nullptr, audio_time_base);
+    avcodec_parameters_free(&audio_par);
+    bool success = g_recorder->start(profile);
     LOGI("🔧 录制器启动结果: %s", success ? "成功" : "失败");
     
     if (success) {
@@ -3261,12 +8063,16 @@ Java_com_jxj_CompileFfmpeg_MainActivity_stopRtspRecording(JNIEnv *env, jobject /
     }
 
     LOGI("🔧 调用录制器stop方法");
+    if (g_recorder->isStreamCopy()) {
+        drainPreEventRingLocked();
+    }
     g_recorder->stop();
     
     // 清理录制器
     LOGI("🔧 清理录制器");
     delete g_recorder;
     g_recorder = nullptr;
+    releasePreEventReaderLocked();
     
     rtsp_recording = false;
     LOGI("🔧 Native stopRtspRecording 完成");
@@ -3277,11 +8083,121 @@ Java_com_jxj_CompileFfmpeg_MainActivity_stopRtspRecording(JNIEnv *env, jobject /
 #endif
 }
 
+// 锁顺序：g_recorder_mutex -> g_player_mutex（与triggerEventRecording一致），
+// 保证替换缓冲区时没有录制正在读取旧缓冲区，也不会有触发拿到即将被替换的缓冲区
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_jxj_CompileFfmpeg_MainActivity_setPreEventBuffer(JNIEnv *env, jobject /* thiz */,
+                                                          jint max_bytes, jint max_duration_ms) {
+#if FFMPEG_FOUND
+    std::lock_guard<std::mutex> recorder_lock(g_recorder_mutex);
+    if (g_event_ring) {
+        LOGW("⚠️ 预录录制进行中，拒绝修改预录缓冲区");
+        return JNI_FALSE;
+    }
+    g_pre_event_max_bytes = max_bytes > 0 ? (size_t)max_bytes : 0;
+    g_pre_event_max_duration_ms = max_duration_ms > 0 ? max_duration_ms : 0;
+    LOGI("🎞️ 预录配置: %dKB, %dms", max_bytes / 1024, max_duration_ms);
+    
+    // 已打开的流立即生效
+    std::lock_guard<std::mutex> player_lock(g_player_mutex);
+    if (g_player) {
+        g_player->configurePreEventRing(g_pre_event_max_bytes, g_pre_event_max_duration_ms);
+    }
+    return JNI_TRUE;
+#else
+    return JNI_FALSE;
+#endif
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_jxj_CompileFfmpeg_MainActivity_triggerEventRecording(JNIEnv *env, jobject /* thiz */, jstring output_path) {
+#if FFMPEG_FOUND
+    LOGI("🚨 Native triggerEventRecording 开始");
+    
+    if (!output_path) {
+        LOGE("🚨 output_path为空");
+        return JNI_FALSE;
+    }
+    if (!initializeFFmpegInternal()) {
+        return JNI_FALSE;
+    }
+    
+    // 整个触发过程持有录制器锁，取缓冲区时再嵌套播放器锁（顺序同setPreEventBuffer），
+    // 取到的缓冲区在录制开始前不会被替换
+    std::lock_guard<std::mutex> recorder_lock(g_recorder_mutex);
+    std::shared_ptr<PacketRingBuffer> ring;
+    AVCodecParameters* codecpar = avcodec_parameters_alloc();
+    AVRational time_base = {1, 90000};
+    if (!codecpar) {
+        return JNI_FALSE;
+    }
+    {
+        std::lock_guard<std::mutex> player_lock(g_player_mutex);
+        if (g_player) {
+            ring = g_player->getPreEventRing();
+            if (!g_player->copyVideoStreamParameters(codecpar, time_base)) {
+                ring.reset();
+            }
+        }
+    }
+    
+    if (!ring) {
+        LOGE("🚨 预录缓冲区未启用或流未打开");
+        avcodec_parameters_free(&codecpar);
+        return JNI_FALSE;
+    }
+    
+    const char *path = env->GetStringUTFChars(output_path, nullptr);
+    if (!path) {
+        avcodec_parameters_free(&codecpar);
+        return JNI_FALSE;
+    }
+    
+    if (g_recorder) {
+        LOGI("🚨 停止已有录制");
+        g_recorder->stop();
+        delete g_recorder;
+        g_recorder = nullptr;
+    }
+    releasePreEventReaderLocked();
+    
+    g_recorder = new ModernRecorder();
+    g_recorder->setThreadPolicy(getPipelinePolicy());
+    bool success = g_recorder->prepare(path) && g_recorder->startStreamCopy(codecpar, time_base);
+    avcodec_parameters_free(&codecpar);
+    env->ReleaseStringUTFChars(output_path, path);
+    
+    if (!success) {
+        LOGE("🚨 预录录制启动失败");
+        delete g_recorder;
+        g_recorder = nullptr;
+        return JNI_FALSE;
+    }
+    
+    // 从最旧的关键帧开始写出预录GOP，随后processRtspFrame持续写入实时数据包
+    g_event_ring = ring;
+    g_event_packet = av_packet_alloc();
+    g_event_cursor = ring->oldestSequence();
+    int flushed = drainPreEventRingLocked();
+    
+    rtsp_recording = true;
+    LOGI("🚨 预录录制已触发，写出%d个缓冲数据包", flushed);
+    return JNI_TRUE;
+#else
+    LOGE("🚨 FFmpeg不可用");
+    return JNI_FALSE;
+#endif
+}
+
 extern "C" JNIEXPORT jboolean JNICALL
 Java_com_jxj_CompileFfmpeg_MainActivity_processRtspFrame(JNIEnv *env, jobject /* thiz */) {
 #if FFMPEG_FOUND
+    TRACE_SCOPE("process_frame");
     // 先处理播放器帧
     AVFrame* current_frame = nullptr;
+    PixelFormatDescriptor frame_format;
+    std::vector<AVPacket*> audio_packets;
+    int64_t video_clock_us = AV_NOPTS_VALUE;
     bool frame_processed = false;
     
     {
@@ -3295,7 +8211,43 @@ Java_com_jxj_CompileFfmpeg_MainActivity_processRtspFrame(JNIEnv *env, jobject /*
             return JNI_FALSE;
         }
 
-        current_frame = g_player->getCurrentFrame();
+        // 读到音频包时没有新视频帧，不重复渲染/录制上一帧
+        current_frame = g_player->hasNewFrame() ? g_player->getCurrentFrame() : nullptr;
+        frame_format = g_player->getPixelFormatDescriptor();
+        video_clock_us = g_player->getVideoClockUs();
+        g_player->takeAudioPackets(audio_packets);
+    }
+    
+    // 音频：按视频主时钟送入音频输出，并直通写入录制文件
+    if (!audio_packets.empty()) {
+        {
+            std::lock_guard<std::mutex> audio_lock(g_audio_mutex);
+            if (g_audio_output) {
+                for (size_t i = 0; i < audio_packets.size(); i++) {
+                    g_audio_output->submit(audio_packets[i], video_clock_us);
+                }
+            }
+        }
+        {
+            std::lock_guard<std::mutex> recorder_lock(g_recorder_mutex);
+            if (g_recorder && g_recorder->isActive() && !g_recorder->isStreamCopy()) {
+                for (size_t i = 0; i < audio_packets.size(); i++) {
+                    audio_packets[i]->stream_index = 1;
+                    g_recorder->writePacket(audio_packets[i]);
+                }
+            }
+        }
+        for (size_t i = 0; i < audio_packets.size(); i++) {
+            av_packet_free(&audio_packets[i]);
+        }
+    }
+    
+    // 流复制录制（预录触发）：与是否解码出帧无关，持续写入新数据包
+    {
+        std::lock_guard<std::mutex> recorder_lock(g_recorder_mutex);
+        if (g_recorder && g_recorder->isActive() && g_recorder->isStreamCopy()) {
+            drainPreEventRingLocked();
+        }
     }
     
     if (!current_frame) {
@@ -3305,18 +8257,24 @@ Java_com_jxj_CompileFfmpeg_MainActivity_processRtspFrame(JNIEnv *env, jobject /*
     // 渲染帧
     {
         std::lock_guard<std::mutex> renderer_lock(g_renderer_mutex);
-        if (g_renderer) {
-            g_renderer->renderFrame(current_frame);
-            processed_frame_count++;
+        if (!g_renderer) {
+            g_renderer = new UltraLowLatencyRenderer();
         }
+        g_renderer->renderFrame(current_frame, frame_format);
+        processed_frame_count++;
+    }
+    if (!g_first_frame_reported.exchange(true)) {
+        long long first_frame_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - g_library_load_time).count();
+        LOGI("⏱️ 首帧已渲染: 距库加载%lldms", first_frame_ms);
     }
     
     // 录制帧（避免死锁）
     {
         std::lock_guard<std::mutex> recorder_lock(g_recorder_mutex);
         
-        if (g_recorder && g_recorder->isActive()) {
-            g_recorder->writeFrame(current_frame);
+        if (g_recorder && g_recorder->isActive() && !g_recorder->isStreamCopy()) {
+            g_recorder->writeFrame(current_frame, frame_format);
         }
     }
 
@@ -3329,10 +8287,20 @@ Java_com_jxj_CompileFfmpeg_MainActivity_processRtspFrame(JNIEnv *env, jobject /*
 extern "C" JNIEXPORT void JNICALL
 Java_com_jxj_CompileFfmpeg_MainActivity_closeRtspStream(JNIEnv *env, jobject /* thiz */) {
 #if FFMPEG_FOUND
+    // 库未加载时不可能打开过流
+    if (!isFFmpegLoaded()) {
+        return;
+    }
+    // 先中止阻塞中的读包/建立连接，处理线程和g_player_mutex随即释放
+    abortCurrentStream();
+    g_rtsp_pipeline.stop();
+
     if (rtsp_recording) {
         Java_com_jxj_CompileFfmpeg_MainActivity_stopRtspRecording(env, nullptr);
     }
 
+    closeAudioOutput();
+
     {
         std::lock_guard<std::mutex> lock(g_player_mutex);
         if (g_player) {
@@ -3340,6 +8308,8 @@ Java_com_jxj_CompileFfmpeg_MainActivity_closeRtspStream(JNIEnv *env, jobject /*
             g_player = nullptr;
         }
     }
+    publishStreamWatchdog(std::shared_ptr<StreamWatchdog>());
+    FrameExportPool::getInstance().reset(env);
 
     rtsp_connected = false;
     processed_frame_count = 0;
@@ -3347,6 +8317,63 @@ Java_com_jxj_CompileFfmpeg_MainActivity_closeRtspStream(JNIEnv *env, jobject /*
 #endif
 }
 
+// 在native线程中循环处理RTSP帧，线程名称/优先级/绑核按setPipelineThreadPolicy设置
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_jxj_CompileFfmpeg_MainActivity_startNativePipeline(JNIEnv *env, jobject /* thiz */) {
+#if FFMPEG_FOUND
+    {
+        std::lock_guard<std::mutex> lock(g_player_mutex);
+        if (!g_player) {
+            LOGE("❌ 启动处理线程失败: RTSP流未打开");
+            return JNI_FALSE;
+        }
+    }
+    return g_rtsp_pipeline.start("rtsp-pipeline", []() {
+        return Java_com_jxj_CompileFfmpeg_MainActivity_processRtspFrame(nullptr, nullptr) == JNI_TRUE;
+    }) ? JNI_TRUE : JNI_FALSE;
+#else
+    return JNI_FALSE;
+#endif
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_jxj_CompileFfmpeg_MainActivity_stopNativePipeline(JNIEnv *env, jobject /* thiz */) {
+#if FFMPEG_FOUND
+    g_rtsp_pipeline.stop();
+#endif
+}
+
+// 阻塞到native处理线程退出，由Java后台线程调用，返回后按isStreamStalled区分卡死和正常结束
+extern "C" JNIEXPORT void JNICALL
+Java_com_jxj_CompileFfmpeg_MainActivity_waitNativePipeline(JNIEnv *env, jobject /* thiz */) {
+#if FFMPEG_FOUND
+    g_rtsp_pipeline.waitForExit();
+#endif
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_jxj_CompileFfmpeg_MainActivity_isNativePipelineRunning(JNIEnv *env, jobject /* thiz */) {
+#if FFMPEG_FOUND
+    return g_rtsp_pipeline.isRunning() ? JNI_TRUE : JNI_FALSE;
+#else
+    return JNI_FALSE;
+#endif
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_jxj_CompileFfmpeg_MainActivity_setPipelineThreadPolicy(JNIEnv *env, jobject /* thiz */, jint nice_value,
+                                                                jint cpu_mask, jboolean realtime) {
+#if FFMPEG_FOUND
+    {
+        std::lock_guard<std::mutex> lock(g_thread_policy_mutex);
+        g_pipeline_policy.nice = std::max(-20, std::min((int)nice_value, 19));
+        g_pipeline_policy.cpu_mask = (uint32_t)cpu_mask;
+        g_pipeline_policy.realtime = realtime == JNI_TRUE;
+    }
+    g_pipeline_policy_version++;
+#endif
+}
+
 // 硬件解码控制方法
 extern "C" JNIEXPORT void JNICALL
 Java_com_jxj_CompileFfmpeg_MainActivity_setHardwareDecodeEnabled(JNIEnv *env, jobject /* thiz */, jboolean enabled) {
@@ -3375,11 +8402,18 @@ Java_com_jxj_CompileFfmpeg_MainActivity_getDecoderInfo(JNIEnv *env, jobject /* t
         if (g_player) {
             info += "播放器状态: 已初始化\n";
             info += "硬件解码: " + std::string(g_player->isHardwareDecoding() ? "启用" : "禁用") + "\n";
+            info += "RTP直通: " + std::string(g_player->isRtpDirect() ? "是" : "否") + "\n";
+            info += "RTP传输: " + std::string(rtpTransportName(g_player->getRtpTransport())) + "\n";
             
             int dropped_frames, slow_frames;
             g_player->getStats(dropped_frames, slow_frames);
             info += "丢弃帧数: " + std::to_string(dropped_frames) + "\n";
             info += "慢解码次数: " + std::to_string(slow_frames) + "\n";
+            
+            std::shared_ptr<PacketRingBuffer> ring = g_player->getPreEventRing();
+            if (ring) {
+                info += ring->getStats();
+            }
         } else {
             info += "播放器状态: 未初始化\n";
         }
@@ -3462,32 +8496,22 @@ Java_com_jxj_CompileFfmpeg_MainActivity_flushBuffers(JNIEnv *env, jobject /* thi
 
 
 
+// Surface切换只发布给渲染线程，不等待渲染器锁；渲染线程在下一帧接管
 extern "C" JNIEXPORT void JNICALL
 Java_com_jxj_CompileFfmpeg_MainActivity_setSurface(JNIEnv *env, jobject /* thiz */, jobject surface) {
-    std::lock_guard<std::mutex> lock(g_renderer_mutex);
-    
-    if (!g_renderer) {
-        g_renderer = new UltraLowLatencyRenderer();
-    }
-
-    ANativeWindow* native_window = nullptr;
-    if (surface) {
-        native_window = ANativeWindow_fromSurface(env, surface);
-        if (!native_window) {
-            g_surface_valid = false;
-            g_rendering_paused = true;
-            return;
-        }
-    } else {
-        g_surface_valid = false;
-        g_rendering_paused = true;
+    ANativeWindow* native_window = surface ? ANativeWindow_fromSurface(env, surface) : nullptr;
+    if (surface && !native_window) {
+        LOGE("❌ 无法从Surface获取ANativeWindow");
     }
+    SurfaceHandover::getInstance().publish(native_window);
+}
 
-    bool success = g_renderer->setSurface(native_window);
-    if (!success) {
-        g_surface_valid = false;
-        g_rendering_paused = true;
+extern "C" JNIEXPORT void JNICALL
+Java_com_jxj_CompileFfmpeg_MainActivity_setSurfaceSize(JNIEnv *env, jobject /* thiz */, jint width, jint height) {
+    if (width <= 0 || height <= 0) {
+        return;
     }
+    SurfaceHandover::getInstance().setViewSize(width, height);
 }
 
 // JNI库加载和卸载
@@ -3498,15 +8522,50 @@ JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm, void* /* reserved */) {
     }
 
     LOGI("🔧 JNI_OnLoad: 初始化FFmpeg包装器");
-    
-    // 输出编译时配置
+#if FFMPEG_FOUND
+    auto onload_start = std::chrono::steady_clock::now();
+    g_library_load_time = onload_start;
+    g_java_vm = vm;
+#else
     logCompileTimeConfig();
-
-    // 初始化FFmpeg
-    if (!initializeFFmpegInternal()) {
-        LOGE("Failed to initialize FFmpeg in JNI_OnLoad");
-        // 不返回错误，允许应用继续运行，但FFmpeg功能不可用
+#endif
+    
+    // FFmpeg不在此初始化：首次使用时才加载，避免拖慢冷启动
+#if FFMPEG_FOUND
+    
+    // 缓存Java类引用，供后续JNI调用（包括工作线程）直接构造对象
+    jclass video_info_class = env->FindClass("com/jxj/CompileFfmpeg/VideoInfo");
+    if (video_info_class) {
+        g_video_info_class = static_cast<jclass>(env->NewGlobalRef(video_info_class));
+        g_video_info_ctor = env->GetMethodID(g_video_info_class, "<init>",
+            "(Ljava/lang/String;Ljava/lang/String;JJIIDLjava/lang/String;Ljava/lang/String;IIIZ)V");
+        env->DeleteLocalRef(video_info_class);
+    }
+    if (env->ExceptionCheck()) {
+        env->ExceptionClear();
+        LOGE("❌ 无法缓存VideoInfo类");
+    }
+    
+    jclass frame_buffer_class = env->FindClass("com/jxj/CompileFfmpeg/FrameBuffer");
+    if (frame_buffer_class) {
+        g_frame_buffer_class = static_cast<jclass>(env->NewGlobalRef(frame_buffer_class));
+        g_frame_buffer_ctor = env->GetMethodID(g_frame_buffer_class, "<init>",
+            "(IIII[Ljava/nio/ByteBuffer;[I)V");
+        g_frame_buffer_slot = env->GetFieldID(g_frame_buffer_class, "slot", "I");
+        g_frame_buffer_pts = env->GetFieldID(g_frame_buffer_class, "pts", "J");
+        g_frame_buffer_sequence = env->GetFieldID(g_frame_buffer_class, "sequence", "J");
+        env->DeleteLocalRef(frame_buffer_class);
+    }
+    if (env->ExceptionCheck()) {
+        env->ExceptionClear();
+        LOGE("❌ 无法缓存FrameBuffer类");
+        g_frame_buffer_class = nullptr;
     }
+    
+    long long onload_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - onload_start).count();
+    LOGI("⏱️ JNI_OnLoad耗时%lldus", onload_us);
+#endif
 
     return JNI_VERSION_1_6;
 }
@@ -3515,6 +8574,10 @@ JNIEXPORT void JNICALL JNI_OnUnload(JavaVM* vm, void* /* reserved */) {
     LOGI("JNI_OnUnload: 清理超低延迟播放核心...");
     
     // 清理播放器
+#if FFMPEG_FOUND
+    abortCurrentStream();
+    g_rtsp_pipeline.stop();
+#endif
     {
         std::lock_guard<std::mutex> lock(g_player_mutex);
         if (g_player) {
@@ -3523,6 +8586,16 @@ JNIEXPORT void JNICALL JNI_OnUnload(JavaVM* vm, void* /* reserved */) {
         }
     }
     
+    // 等待进行中的截图完成
+    SnapshotWorker::getInstance().shutdown();
+    
+    // 清理音频输出
+    {
+        std::lock_guard<std::mutex> lock(g_audio_mutex);
+        delete g_audio_output;
+        g_audio_output = nullptr;
+    }
+    
     // 清理渲染器
     {
         std::lock_guard<std::mutex> lock(g_renderer_mutex);
@@ -3531,6 +8604,7 @@ JNIEXPORT void JNICALL JNI_OnUnload(JavaVM* vm, void* /* reserved */) {
             g_renderer = nullptr;
         }
     }
+    SurfaceHandover::getInstance().discardPending();
     
     // 清理录制器
     {
@@ -3542,6 +8616,25 @@ JNIEXPORT void JNICALL JNI_OnUnload(JavaVM* vm, void* /* reserved */) {
         }
     }
     
+#if FFMPEG_FOUND
+    JNIEnv* env = nullptr;
+    if (g_video_info_class && vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) == JNI_OK) {
+        env->DeleteGlobalRef(g_video_info_class);
+        g_video_info_class = nullptr;
+        g_video_info_ctor = nullptr;
+    }
+    if (env) {
+        if (isFFmpegLoaded()) {
+            FrameExportPool::getInstance().reset(env);
+        }
+        if (g_frame_buffer_class) {
+            env->DeleteGlobalRef(g_frame_buffer_class);
+            g_frame_buffer_class = nullptr;
+        }
+    }
+#endif
+    
     cleanupFFmpegInternal();
     LOGI("✅ 超低延迟播放核心清理完成");
+    AsyncLogger::getInstance().shutdown();
 } 
\ No newline at end of file
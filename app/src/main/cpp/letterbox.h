@@ -0,0 +1,60 @@
+#ifndef FFW_LETTERBOX_H
+#define FFW_LETTERBOX_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// ============================================================================
+// 保持宽高比的画面位置和黑边 - 只处理尺寸和RGBA缓冲区，不依赖FFmpeg/NDK，主机单元测试直接包含
+// ============================================================================
+
+// 画面在输出缓冲区中的矩形，其余区域为黑边
+struct LetterboxRect {
+    int x, y;
+    int width, height;
+};
+
+// 源帧按显示宽高比（考虑SAR，sar_num/sar_den<=0表示方形像素）缩放到输出区域内的最大矩形并居中；
+// 宽高取偶数（YUV420色度对齐），但不超出输出区域
+inline LetterboxRect fitLetterbox(int src_width, int src_height, int sar_num, int sar_den,
+                                  int out_width, int out_height) {
+    double display_aspect = (double)src_width / src_height;
+    if (sar_num > 0 && sar_den > 0) {
+        display_aspect *= (double)sar_num / sar_den;
+    }
+    int width = out_width;
+    int height = (int)(out_width / display_aspect + 0.5);
+    if (height > out_height) {
+        height = out_height;
+        width = (int)(out_height * display_aspect + 0.5);
+    }
+    LetterboxRect rect;
+    rect.width = std::min(out_width, std::max(2, std::min(width, out_width) & ~1));
+    rect.height = std::min(out_height, std::max(2, std::min(height, out_height) & ~1));
+    rect.x = (out_width - rect.width) / 2;
+    rect.y = (out_height - rect.height) / 2;
+    return rect;
+}
+
+// 黑边只涂画面外区域（RGBA，每像素4字节）；Surface缓冲区轮换使用，每帧都需要涂
+inline void clearLetterbox(uint8_t* bits, size_t row_bytes, int out_width, int out_height,
+                           const LetterboxRect& rect) {
+    int content_bottom = rect.y + rect.height;
+    int right_x = rect.x + rect.width;
+    bool side_bars = rect.x > 0 || right_x < out_width;
+    for (int y = 0; y < out_height; y++) {
+        uint8_t* row = bits + (size_t)y * row_bytes;
+        if (y < rect.y || y >= content_bottom) {
+            memset(row, 0, (size_t)out_width * 4);
+        } else if (side_bars) {
+            memset(row, 0, (size_t)rect.x * 4);
+            memset(row + (size_t)right_x * 4, 0, (size_t)(out_width - right_x) * 4);
+        } else {
+            y = content_bottom - 1;     // 左右无黑边，直接跳到下黑边
+        }
+    }
+}
+
+#endif
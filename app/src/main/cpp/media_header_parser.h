@@ -0,0 +1,504 @@
+#ifndef FFW_MEDIA_HEADER_PARSER_H
+#define FFW_MEDIA_HEADER_PARSER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+// ============================================================================
+// 媒体信息快速探测的容器头部解析 - 只读MP4/Matroska头部，不解码，不依赖FFmpeg
+// ============================================================================
+// 解析结果经NewStringUTF交给Java，未知编解码器的fourcc/CodecID是文件里的原始字节，
+// 非ASCII字节不是合法的modified UTF-8（CheckJNI下直接abort），所以名称只保留可打印ASCII
+
+struct MediaInfo {
+    std::string container;
+    int64_t duration_ms;
+    int64_t bit_rate;
+    int width;                  // 编码尺寸（与codecpar一致），不含显示宽高比校正
+    int height;
+    double frame_rate;
+    std::string video_codec;
+    std::string audio_codec;
+    int sample_rate;
+    int channels;
+    int stream_count;
+    bool header_only;       // true: 仅由容器头部得出；false: 回退到完整探测
+    
+    MediaInfo() : duration_ms(0), bit_rate(0), width(0), height(0), frame_rate(0.0),
+                  sample_rate(0), channels(0), stream_count(0), header_only(false) {}
+    
+    bool hasStreams() const {
+        return !video_codec.empty() || !audio_codec.empty();
+    }
+};
+
+inline uint32_t mediaTag(char a, char b, char c, char d) {
+    return (uint32_t)(uint8_t)a | ((uint32_t)(uint8_t)b << 8) | ((uint32_t)(uint8_t)c << 16) |
+           ((uint32_t)(uint8_t)d << 24);
+}
+
+inline uint32_t readLE32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+inline uint16_t readBE16(const uint8_t* p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+inline uint32_t readBE32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+inline uint64_t readBE64(const uint8_t* p) {
+    return ((uint64_t)readBE32(p) << 32) | readBE32(p + 4);
+}
+
+inline bool isPrintableAscii(char c) {
+    return c >= 0x20 && c <= 0x7E;
+}
+
+// 可打印ASCII原样保留，其余字节转义为\xNN
+inline std::string printableCodecName(const std::string& name) {
+    std::string out;
+    for (size_t i = 0; i < name.size(); i++) {
+        if (isPrintableAscii(name[i])) {
+            out += name[i];
+        } else {
+            char escaped[5];
+            snprintf(escaped, sizeof(escaped), "\\x%02x", (unsigned)(uint8_t)name[i]);
+            out += escaped;
+        }
+    }
+    return out;
+}
+
+// 四个字节都可打印时输出fourcc本身（例如"dvh1"），否则输出0x%08x
+inline std::string fourccName(uint32_t fourcc) {
+    char tag[11];
+    for (int i = 0; i < 4; i++) {
+        tag[i] = (char)((fourcc >> (8 * i)) & 0xFF);
+        if (!isPrintableAscii(tag[i])) {
+            snprintf(tag, sizeof(tag), "0x%08x", (unsigned)fourcc);
+            return tag;
+        }
+    }
+    tag[4] = 0;
+    return tag;
+}
+
+// MP4/MOV：遍历moov下的mvhd/trak(tkhd/mdhd/hdlr/stsd/stts)，不触碰mdat。
+// CodecTags::videoCodec/audioCodec(fourcc)返回编解码器名称，未知时返回nullptr；
+// 设备上查FFmpeg的MOV标签表，主机测试用固定的表
+template <typename CodecTags>
+class BasicMp4HeaderParser {
+public:
+    static bool isCandidate(const uint8_t* data, size_t size) {
+        if (size < 8) {
+            return false;
+        }
+        uint32_t type = readLE32(data + 4);
+        return type == mediaTag('f','t','y','p') || type == mediaTag('m','o','o','v') ||
+               type == mediaTag('m','d','a','t') || type == mediaTag('w','i','d','e') ||
+               type == mediaTag('f','r','e','e');
+    }
+    
+    static bool parse(const uint8_t* data, size_t size, MediaInfo& info) {
+        const uint8_t* p = data;
+        const uint8_t* end = data + size;
+        Box box;
+        info.container = "mp4";
+        while (nextBox(p, end, box)) {
+            if (box.type == mediaTag('f','t','y','p') && box.size >= 4 &&
+                readLE32(box.payload) == mediaTag('q','t',' ',' ')) {
+                info.container = "mov";
+            } else if (box.type == mediaTag('m','o','o','v')) {
+                parseMovie(box, info);
+                if (info.duration_ms > 0) {
+                    info.bit_rate = (int64_t)size * 8 * 1000 / info.duration_ms;
+                }
+                return info.hasStreams();
+            }
+        }
+        // 没有moov（分片MP4或文件被截断）交给完整探测
+        return false;
+    }
+    
+private:
+    struct Box {
+        uint32_t type;
+        const uint8_t* payload;
+        size_t size;
+    };
+    
+    static bool nextBox(const uint8_t*& p, const uint8_t* end, Box& box) {
+        size_t remaining = end - p;
+        if (remaining < 8) {
+            return false;
+        }
+        uint64_t box_size = readBE32(p);
+        size_t header = 8;
+        box.type = readLE32(p + 4);
+        if (box_size == 1) {
+            if (remaining < 16) {
+                return false;
+            }
+            box_size = readBE64(p + 8);
+            header = 16;
+        } else if (box_size == 0) {
+            box_size = remaining;
+        }
+        if (box_size < header || box_size > remaining) {
+            return false;
+        }
+        box.payload = p + header;
+        box.size = box_size - header;
+        p += box_size;
+        return true;
+    }
+    
+    static bool findChild(const Box& parent, uint32_t type, Box& out) {
+        const uint8_t* p = parent.payload;
+        const uint8_t* end = parent.payload + parent.size;
+        while (nextBox(p, end, out)) {
+            if (out.type == type) {
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    // mvhd/mdhd布局相同：version 1为64位时间字段
+    static bool readTimescaleDuration(const Box& box, uint32_t& timescale, uint64_t& duration) {
+        if (box.size < 1) {
+            return false;
+        }
+        if (box.payload[0] == 1) {
+            if (box.size < 32) {
+                return false;
+            }
+            timescale = readBE32(box.payload + 20);
+            duration = readBE64(box.payload + 24);
+        } else {
+            if (box.size < 20) {
+                return false;
+            }
+            timescale = readBE32(box.payload + 12);
+            duration = readBE32(box.payload + 16);
+        }
+        return timescale > 0;
+    }
+    
+    static void parseMovie(const Box& moov, MediaInfo& info) {
+        Box box;
+        uint32_t timescale = 0;
+        uint64_t duration = 0;
+        if (findChild(moov, mediaTag('m','v','h','d'), box) &&
+            readTimescaleDuration(box, timescale, duration)) {
+            info.duration_ms = (int64_t)(duration * 1000 / timescale);
+        }
+        
+        const uint8_t* p = moov.payload;
+        const uint8_t* end = moov.payload + moov.size;
+        while (nextBox(p, end, box)) {
+            if (box.type == mediaTag('t','r','a','k')) {
+                info.stream_count++;
+                parseTrack(box, info);
+            }
+        }
+    }
+    
+    static void parseTrack(const Box& trak, MediaInfo& info) {
+        Box mdia, hdlr, minf, stbl, stsd;
+        if (!findChild(trak, mediaTag('m','d','i','a'), mdia) ||
+            !findChild(mdia, mediaTag('h','d','l','r'), hdlr) || hdlr.size < 12 ||
+            !findChild(mdia, mediaTag('m','i','n','f'), minf) ||
+            !findChild(minf, mediaTag('s','t','b','l'), stbl) ||
+            !findChild(stbl, mediaTag('s','t','s','d'), stsd) || stsd.size < 16) {
+            return;
+        }
+        
+        uint32_t handler = readLE32(hdlr.payload + 8);
+        const uint8_t* entry = stsd.payload + 8;
+        size_t entry_size = stsd.size - 8;
+        uint32_t fourcc = readLE32(entry + 4);
+        
+        if (handler == mediaTag('v','i','d','e') && info.video_codec.empty()) {
+            info.video_codec = codecName(CodecTags::videoCodec(fourcc), fourcc);
+            // 与完整探测的codecpar->width/height一致，使用stsd中的编码尺寸；
+            // tkhd的显示尺寸含像素宽高比校正和旋转，两条路径混用会让同一文件报出不同尺寸
+            if (entry_size >= 36) {
+                info.width = readBE16(entry + 32);
+                info.height = readBE16(entry + 34);
+            }
+            
+            // 帧率 = stts样本总数 / 轨道时长
+            Box mdhd, stts;
+            uint32_t timescale = 0;
+            uint64_t duration = 0;
+            if (findChild(mdia, mediaTag('m','d','h','d'), mdhd) &&
+                readTimescaleDuration(mdhd, timescale, duration) && duration > 0 &&
+                findChild(stbl, mediaTag('s','t','t','s'), stts) && stts.size >= 8) {
+                uint32_t entries = readBE32(stts.payload + 4);
+                uint64_t samples = 0;
+                for (uint32_t i = 0; i < entries && 8 + (size_t)(i + 1) * 8 <= stts.size; i++) {
+                    samples += readBE32(stts.payload + 8 + i * 8);
+                }
+                info.frame_rate = (double)samples * timescale / duration;
+            }
+        } else if (handler == mediaTag('s','o','u','n') && info.audio_codec.empty()) {
+            info.audio_codec = codecName(CodecTags::audioCodec(fourcc), fourcc);
+            if (entry_size >= 36) {
+                info.channels = readBE16(entry + 24);
+                info.sample_rate = readBE32(entry + 32) >> 16;
+            }
+        }
+    }
+    
+    // 已知的样本描述使用FFmpeg编解码器名称，未知的输出fourcc（见fourccName）
+    static std::string codecName(const char* known, uint32_t fourcc) {
+        return known ? known : fourccName(fourcc);
+    }
+};
+
+// Matroska/WebM：EBML头 + Segment下的Info/Tracks，遇到第一个Cluster即停止
+class MatroskaHeaderParser {
+public:
+    static bool isCandidate(const uint8_t* data, size_t size) {
+        return size >= 4 && readBE32(data) == kEbmlHeader;
+    }
+    
+    static bool parse(const uint8_t* data, size_t size, MediaInfo& info) {
+        const uint8_t* p = data;
+        const uint8_t* end = data + size;
+        Element element;
+        if (!nextElement(p, end, element) || element.id != kEbmlHeader) {
+            return false;
+        }
+        info.container = "matroska";
+        Element child;
+        const uint8_t* q = element.payload;
+        while (nextElement(q, element.payload + element.size, child)) {
+            if (child.id == kDocType && std::string((const char*)child.payload, child.size) == "webm") {
+                info.container = "webm";
+            }
+        }
+        
+        if (!nextElement(p, end, element) || element.id != kSegment) {
+            return false;
+        }
+        
+        bool has_info = false;
+        bool has_tracks = false;
+        uint64_t timestamp_scale = 1000000;
+        double duration = 0.0;
+        p = element.payload;
+        end = element.payload + element.size;
+        while (!(has_info && has_tracks) && nextElement(p, end, child)) {
+            if (child.id == kCluster) {
+                break;
+            } else if (child.id == kInfo) {
+                has_info = true;
+                parseInfo(child, timestamp_scale, duration);
+            } else if (child.id == kTracks) {
+                has_tracks = true;
+                parseTracks(child, info);
+            }
+        }
+        
+        // Info/Tracks不在Cluster之前（需要SeekHead跳转）时交给完整探测
+        if (!has_tracks) {
+            return false;
+        }
+        info.duration_ms = (int64_t)(duration * timestamp_scale / 1000000.0);
+        if (info.duration_ms > 0) {
+            info.bit_rate = (int64_t)size * 8 * 1000 / info.duration_ms;
+        }
+        return info.hasStreams();
+    }
+    
+private:
+    static const uint32_t kEbmlHeader = 0x1A45DFA3;
+    static const uint32_t kDocType = 0x4282;
+    static const uint32_t kSegment = 0x18538067;
+    static const uint32_t kCluster = 0x1F43B675;
+    static const uint32_t kInfo = 0x1549A966;
+    static const uint32_t kTimestampScale = 0x2AD7B1;
+    static const uint32_t kDuration = 0x4489;
+    static const uint32_t kTracks = 0x1654AE6B;
+    static const uint32_t kTrackEntry = 0xAE;
+    static const uint32_t kTrackType = 0x83;
+    static const uint32_t kCodecId = 0x86;
+    static const uint32_t kDefaultDuration = 0x23E383;
+    static const uint32_t kVideo = 0xE0;
+    static const uint32_t kPixelWidth = 0xB0;
+    static const uint32_t kPixelHeight = 0xBA;
+    static const uint32_t kAudio = 0xE1;
+    static const uint32_t kSamplingFrequency = 0xB5;
+    static const uint32_t kChannels = 0x9F;
+    
+    struct Element {
+        uint32_t id;
+        const uint8_t* payload;
+        size_t size;
+    };
+    
+    // EBML变长整数：ID保留长度标记位，size去掉标记位；全1表示未知长度
+    static bool readVint(const uint8_t*& p, const uint8_t* end, uint64_t& value,
+                         bool keep_marker, bool& unknown) {
+        if (p >= end || *p == 0) {
+            return false;
+        }
+        int length = 1;
+        while (!(*p & (0x80 >> (length - 1)))) {
+            length++;
+        }
+        if (end - p < length) {
+            return false;
+        }
+        uint64_t marker = 0x80 >> (length - 1);
+        value = keep_marker ? *p : (*p & (marker - 1));
+        bool all_ones = (*p & (marker - 1)) == marker - 1;
+        for (int i = 1; i < length; i++) {
+            value = (value << 8) | p[i];
+            all_ones = all_ones && p[i] == 0xFF;
+        }
+        unknown = !keep_marker && all_ones;
+        p += length;
+        return true;
+    }
+    
+    static bool nextElement(const uint8_t*& p, const uint8_t* end, Element& element) {
+        uint64_t id = 0;
+        uint64_t size = 0;
+        bool unknown = false;
+        if (!readVint(p, end, id, true, unknown) || id > 0xFFFFFFFF ||
+            !readVint(p, end, size, false, unknown)) {
+            return false;
+        }
+        size_t remaining = end - p;
+        if (unknown) {
+            size = remaining;   // 直播/未完成文件的Segment长度未知，延伸到文件末尾
+        } else if (size > remaining) {
+            return false;
+        }
+        element.id = (uint32_t)id;
+        element.payload = p;
+        element.size = (size_t)size;
+        p += size;
+        return true;
+    }
+    
+    static uint64_t readUInt(const Element& element) {
+        uint64_t value = 0;
+        for (size_t i = 0; i < element.size && i < 8; i++) {
+            value = (value << 8) | element.payload[i];
+        }
+        return value;
+    }
+    
+    static double readFloat(const Element& element) {
+        if (element.size == 4) {
+            uint32_t bits = readBE32(element.payload);
+            float value;
+            memcpy(&value, &bits, sizeof(value));
+            return value;
+        } else if (element.size == 8) {
+            uint64_t bits = readBE64(element.payload);
+            double value;
+            memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+        return 0.0;
+    }
+    
+    static void parseInfo(const Element& parent, uint64_t& timestamp_scale, double& duration) {
+        const uint8_t* p = parent.payload;
+        Element child;
+        while (nextElement(p, parent.payload + parent.size, child)) {
+            if (child.id == kTimestampScale) {
+                timestamp_scale = readUInt(child);
+            } else if (child.id == kDuration) {
+                duration = readFloat(child);
+            }
+        }
+    }
+    
+    static void parseTracks(const Element& parent, MediaInfo& info) {
+        const uint8_t* p = parent.payload;
+        Element entry;
+        while (nextElement(p, parent.payload + parent.size, entry)) {
+            if (entry.id != kTrackEntry) {
+                continue;
+            }
+            info.stream_count++;
+            
+            uint64_t type = 0;
+            uint64_t default_duration_ns = 0;
+            std::string codec_id;
+            Element video = {0, nullptr, 0};
+            Element audio = {0, nullptr, 0};
+            const uint8_t* q = entry.payload;
+            Element child;
+            while (nextElement(q, entry.payload + entry.size, child)) {
+                if (child.id == kTrackType) {
+                    type = readUInt(child);
+                } else if (child.id == kCodecId) {
+                    codec_id.assign((const char*)child.payload, strnlen((const char*)child.payload, child.size));
+                } else if (child.id == kDefaultDuration) {
+                    default_duration_ns = readUInt(child);
+                } else if (child.id == kVideo) {
+                    video = child;
+                } else if (child.id == kAudio) {
+                    audio = child;
+                }
+            }
+            
+            if (type == 1 && info.video_codec.empty()) {
+                info.video_codec = codecName(codec_id);
+                if (default_duration_ns > 0) {
+                    info.frame_rate = 1e9 / default_duration_ns;
+                }
+                const uint8_t* v = video.payload;
+                while (video.payload && nextElement(v, video.payload + video.size, child)) {
+                    if (child.id == kPixelWidth) {
+                        info.width = (int)readUInt(child);
+                    } else if (child.id == kPixelHeight) {
+                        info.height = (int)readUInt(child);
+                    }
+                }
+            } else if (type == 2 && info.audio_codec.empty()) {
+                info.audio_codec = codecName(codec_id);
+                info.sample_rate = 8000;    // Matroska默认值
+                info.channels = 1;
+                const uint8_t* a = audio.payload;
+                while (audio.payload && nextElement(a, audio.payload + audio.size, child)) {
+                    if (child.id == kSamplingFrequency) {
+                        info.sample_rate = (int)readFloat(child);
+                    } else if (child.id == kChannels) {
+                        info.channels = (int)readUInt(child);
+                    }
+                }
+            }
+        }
+    }
+    
+    // Matroska CodecID转FFmpeg编解码器名称（前缀匹配，例如A_AAC/MPEG4/LC），未知的原样转义输出
+    static std::string codecName(const std::string& codec_id) {
+        static const struct { const char* prefix; const char* name; } kCodecs[] = {
+            {"V_MPEG4/ISO/AVC", "h264"}, {"V_MPEGH/ISO/HEVC", "hevc"}, {"V_MPEG4/ISO", "mpeg4"},
+            {"V_VP8", "vp8"}, {"V_VP9", "vp9"}, {"V_AV1", "av1"}, {"V_MJPEG", "mjpeg"},
+            {"A_AAC", "aac"}, {"A_OPUS", "opus"}, {"A_VORBIS", "vorbis"}, {"A_MPEG/L3", "mp3"},
+            {"A_AC3", "ac3"}, {"A_EAC3", "eac3"}, {"A_FLAC", "flac"}, {"A_PCM", "pcm"},
+        };
+        for (size_t i = 0; i < sizeof(kCodecs) / sizeof(kCodecs[0]); i++) {
+            if (codec_id.compare(0, strlen(kCodecs[i].prefix), kCodecs[i].prefix) == 0) {
+                return kCodecs[i].name;
+            }
+        }
+        return printableCodecName(codec_id);
+    }
+};
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef FFW_PARALLEL_SCANNER_H
+#define FFW_PARALLEL_SCANNER_H
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "async_logger.h"
+#include "bounded_queue.h"
+
+// ============================================================================
+// 批量探测：固定数量的工作线程按原子下标领取文件，结果经有界队列流回调用线程。
+// 多个线程同时缺页读取头部，一个文件的I/O与另一个文件的解析自然重叠
+// ============================================================================
+// Info为单个文件的探测结果，probe在工作线程中调用（设备上是probeMediaInfo）
+template <typename Info>
+class ParallelScanner {
+public:
+    struct Result {
+        int index;
+        bool ok;
+        Info info;
+    };
+
+    typedef std::function<bool(const std::string& path, Info& info)> ProbeFunction;
+
+    ParallelScanner(const std::vector<std::string>& paths, const ProbeFunction& probe)
+        : paths(paths), probe(probe), next_index(0), active_workers(0), stopping(false),
+          results(kResultQueueCapacity) {}
+
+    ~ParallelScanner() {
+        cancel();
+        for (size_t i = 0; i < workers.size(); i++) {
+            workers[i].join();
+        }
+    }
+
+    // worker_count<=0时按workerCount()选择
+    void start(int worker_count = 0) {
+        int count = worker_count > 0 ? (int)std::min((size_t)worker_count, paths.size()) :
+                                       workerCount(paths.size());
+        if (count == 0) {
+            results.close();
+            return;
+        }
+        active_workers.store(count);
+        for (int i = 0; i < count; i++) {
+            workers.push_back(std::thread(&ParallelScanner::workerLoop, this));
+        }
+        LOGI("📂 批量探测 %zu 个文件, %d 个工作线程", paths.size(), count);
+    }
+
+    // 按完成顺序返回结果，全部完成或取消后返回false；取消时队列中已有的结果一并丢弃
+    bool next(Result& out) {
+        return !stopping.load() && results.pop(out) && !stopping.load();
+    }
+
+    void cancel() {
+        stopping.store(true);
+        results.close();
+    }
+
+    // 闪存(eMMC/UFS)的随机读并发超过4路后吞吐不再提升，反而与解码线程争CPU
+    static int workerCount(size_t file_count, int cores) {
+        int count = std::max(2, std::min(cores / 2, 4));
+        return (int)std::min((size_t)count, file_count);
+    }
+
+    static int workerCount(size_t file_count) {
+        return workerCount(file_count, (int)std::thread::hardware_concurrency());
+    }
+
+private:
+    static const size_t kResultQueueCapacity = 64;
+
+    const std::vector<std::string>& paths;
+    ProbeFunction probe;
+    std::atomic<size_t> next_index;
+    std::atomic<int> active_workers;
+    std::atomic<bool> stopping;
+    BoundedQueue<Result> results;
+    std::vector<std::thread> workers;
+
+    void workerLoop() {
+        while (!stopping.load()) {
+            size_t index = next_index.fetch_add(1);
+            if (index >= paths.size()) {
+                break;
+            }
+            Result result;
+            result.index = (int)index;
+            result.ok = !paths[index].empty() && probe(paths[index], result.info);
+            if (!results.push(result)) {
+                break;
+            }
+        }
+        // 最后一个退出的线程关闭队列，调用线程取完剩余结果后结束
+        if (active_workers.fetch_sub(1) == 1) {
+            results.close();
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,220 @@
+#ifndef FFW_PIPELINE_TRACER_H
+#define FFW_PIPELINE_TRACER_H
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <pthread.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "async_logger.h"
+
+// ============================================================================
+// 流水线时间线追踪 - 按需开启，导出Chrome trace JSON（chrome://tracing、ui.perfetto.dev可直接打开）
+// ============================================================================
+// 每个线程写自己的环形缓冲区（不加锁），每个事件两次时钟读取和一次写入；未开启时只有一次原子读。
+// 写入方在写事件期间置位所在缓冲区的writing标记，start/stopAndWrite先关闭记录，再等所有
+// 缓冲区的writing清零后才重置或读取，读写不会交叠。每次start递增epoch，跨越stop/start的
+// 作用域事件属于上一轮，直接丢弃
+#ifndef FFW_TRACING
+#define FFW_TRACING 1
+#endif
+
+class PipelineTracer {
+public:
+    struct Event {
+        const char* name;       // 必须是字符串字面量
+        int64_t start_us;
+        int64_t duration_us;
+    };
+
+    static PipelineTracer& getInstance() {
+        static PipelineTracer* instance = new PipelineTracer();
+        return *instance;
+    }
+
+    static int64_t nowUs() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    bool isEnabled() const {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    // 作用域开始时记下当前轮次，结束时只有轮次未变才写入
+    uint32_t currentEpoch() const {
+        return epoch.load(std::memory_order_relaxed);
+    }
+
+    // 清空之前的事件并开始记录；已退出线程的缓冲区在此释放
+    void start() {
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        enabled.store(false);
+        waitForWritersLocked();
+        for (size_t i = 0; i < buffers.size();) {
+            if (!buffers[i]->alive.load()) {
+                delete buffers[i];
+                buffers.erase(buffers.begin() + i);
+            } else {
+                buffers[i]->count.store(0, std::memory_order_relaxed);
+                i++;
+            }
+        }
+        epoch.fetch_add(1);
+        enabled.store(true);
+        LOGI("🔬 流水线追踪已开启");
+    }
+
+    // 停止记录并写出Chrome trace JSON；仍未结束的作用域不会写入
+    bool stopAndWrite(const std::string& path) {
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        enabled.store(false);
+        waitForWritersLocked();
+        FILE* file = fopen(path.c_str(), "w");
+        if (!file) {
+            LOGE("❌ 无法写入追踪文件: %s (%s)", path.c_str(), strerror(errno));
+            return false;
+        }
+
+        int pid = (int)getpid();
+        size_t total = 0;
+        fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        bool first = true;
+        for (size_t i = 0; i < buffers.size(); i++) {
+            ThreadBuffer* buffer = buffers[i];
+            fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                    first ? "" : ",\n", pid, buffer->tid, buffer->thread_name);
+            first = false;
+
+            uint32_t count = buffer->count.load(std::memory_order_acquire);
+            uint32_t begin = count > kEventsPerThread ? count - kEventsPerThread : 0;
+            for (uint32_t n = begin; n < count; n++) {
+                const Event& event = buffer->events[n % kEventsPerThread];
+                fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%lld,\"dur\":%lld}",
+                        event.name, pid, buffer->tid, (long long)event.start_us, (long long)event.duration_us);
+            }
+            total += count - begin;
+        }
+        fprintf(file, "\n]}\n");
+        bool ok = fclose(file) == 0;
+        LOGI("🔬 流水线追踪已写出: %s (%zu个事件, %zu个线程)", path.c_str(), total, buffers.size());
+        return ok;
+    }
+
+    void record(const char* name, int64_t start_us, int64_t end_us, uint32_t scope_epoch) {
+        ThreadBuffer* buffer = currentBuffer();
+        if (!buffer) {
+            return;
+        }
+        // 先声明写入再检查开关（都是seq_cst），与start/stopAndWrite的“先关开关再等写入”配对
+        buffer->writing.store(true);
+        if (enabled.load() && epoch.load() == scope_epoch) {
+            uint32_t n = buffer->count.load(std::memory_order_relaxed);
+            Event& event = buffer->events[n % kEventsPerThread];
+            event.name = name;
+            event.start_us = start_us;
+            event.duration_us = end_us - start_us;
+            buffer->count.store(n + 1, std::memory_order_release);
+        }
+        buffer->writing.store(false, std::memory_order_release);
+    }
+
+private:
+    static const uint32_t kEventsPerThread = 16384;     // 满后覆盖最旧的事件
+
+    struct ThreadBuffer {
+        Event events[kEventsPerThread];
+        std::atomic<uint32_t> count;
+        std::atomic<bool> alive;
+        std::atomic<bool> writing;      // 所属线程正在写一个事件
+        int tid;
+        char thread_name[16];
+    };
+
+    // 线程退出时标记缓冲区，事件保留到下一次start
+    struct ThreadBufferHolder {
+        ThreadBuffer* buffer;
+        ThreadBufferHolder() : buffer(nullptr) {}
+        ~ThreadBufferHolder() {
+            if (buffer) {
+                buffer->alive.store(false);
+            }
+        }
+    };
+
+    std::atomic<bool> enabled;
+    std::atomic<uint32_t> epoch;
+    std::mutex buffers_mutex;
+    std::vector<ThreadBuffer*> buffers;
+
+    PipelineTracer() : enabled(false), epoch(0) {}
+
+    // 调用方已关闭enabled并持有buffers_mutex；写入窗口只有几次存储，自旋等待即可
+    void waitForWritersLocked() {
+        for (size_t i = 0; i < buffers.size(); i++) {
+            while (buffers[i]->writing.load()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    ThreadBuffer* currentBuffer() {
+        static thread_local ThreadBufferHolder holder;
+        if (!holder.buffer) {
+            ThreadBuffer* buffer = new ThreadBuffer();
+            buffer->count.store(0);
+            buffer->alive.store(true);
+            buffer->writing.store(false);
+            buffer->tid = (int)gettid();
+            if (pthread_getname_np(pthread_self(), buffer->thread_name, sizeof(buffer->thread_name)) != 0) {
+                snprintf(buffer->thread_name, sizeof(buffer->thread_name), "%d", buffer->tid);
+            }
+            std::lock_guard<std::mutex> lock(buffers_mutex);
+            buffers.push_back(buffer);
+            holder.buffer = buffer;
+        }
+        return holder.buffer;
+    }
+};
+
+// 作用域事件：构造时若追踪已开启则记录开始时间和轮次，析构时写入一个完整事件
+class PipelineTraceScope {
+public:
+    explicit PipelineTraceScope(const char* name) :
+        name(name), start_us(-1), epoch(0) {
+        PipelineTracer& tracer = PipelineTracer::getInstance();
+        if (tracer.isEnabled()) {
+            epoch = tracer.currentEpoch();
+            start_us = PipelineTracer::nowUs();
+        }
+    }
+
+    ~PipelineTraceScope() {
+        if (start_us >= 0) {
+            PipelineTracer::getInstance().record(name, start_us, PipelineTracer::nowUs(), epoch);
+        }
+    }
+
+private:
+    const char* name;
+    int64_t start_us;
+    uint32_t epoch;
+};
+
+#define FFW_TRACE_CONCAT_INNER(a, b) a##b
+#define FFW_TRACE_CONCAT(a, b) FFW_TRACE_CONCAT_INNER(a, b)
+#if FFW_TRACING
+#define TRACE_SCOPE(name) PipelineTraceScope FFW_TRACE_CONCAT(ffw_trace_scope_, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#endif
+
+#endif
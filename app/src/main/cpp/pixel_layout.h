@@ -0,0 +1,50 @@
+#ifndef FFW_PIXEL_LAYOUT_H
+#define FFW_PIXEL_LAYOUT_H
+
+// ============================================================================
+// 解码输出数据布局判定 - 只处理整数格式值，不依赖FFmpeg头文件，主机单元测试直接包含
+// ============================================================================
+// 格式值就是调用方的AVPixelFormat；AV_PIX_FMT_MEDIACODEC/AV_PIX_FMT_NONE的数值随FFmpeg
+// 版本变化，由调用方通过PixelLayoutFormats传入，格式是否有效由is_known回调判断
+
+struct PixelLayoutFormats {
+    int none;           // AV_PIX_FMT_NONE
+    int mediacodec;     // AV_PIX_FMT_MEDIACODEC
+};
+
+struct PixelLayoutInput {
+    int frame_format;       // frame->format
+    bool has_hw_frames;     // frame->hw_frames_ctx != nullptr
+    int hw_sw_format;       // AVHWFramesContext::sw_format，has_hw_frames时有效
+    bool has_decoder;
+    int decoder_sw_format;  // decoder->sw_pix_fmt，has_decoder时有效
+};
+
+struct PixelLayout {
+    int layout;         // CPU可访问数据的实际内存布局，none表示没有可用布局
+    bool hw_surface;    // MediaCodec Surface输出：只有data[3]缓冲引用，没有CPU数据
+};
+
+template <typename IsKnownFormat>
+inline PixelLayout resolvePixelLayout(const PixelLayoutInput& in, const PixelLayoutFormats& fmts,
+                                      IsKnownFormat is_known) {
+    PixelLayout out;
+    if (in.has_hw_frames) {
+        // 硬件帧：真实布局由AVHWFramesContext给出
+        out.layout = in.hw_sw_format;
+        out.hw_surface = in.frame_format == fmts.mediacodec;
+    } else if (in.frame_format == fmts.mediacodec) {
+        out.layout = in.has_decoder ? in.decoder_sw_format : fmts.none;
+        out.hw_surface = true;
+    } else {
+        out.layout = in.frame_format;
+        out.hw_surface = false;
+    }
+
+    if (out.layout != fmts.none && !is_known(out.layout)) {
+        out.layout = fmts.none;
+    }
+    return out;
+}
+
+#endif
@@ -0,0 +1,198 @@
+#ifndef FFW_RECORDING_INDEX_H
+#define FFW_RECORDING_INDEX_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "async_logger.h"
+
+// ============================================================================
+// 录制文件的定位索引（<输出文件>.idx）- 每个视频包一条定长记录，按解码顺序追加。
+// 小端定长布局，可直接mmap读取；录制中断时entry_count为0，读取方按文件长度推算条数。
+// 只记录时间戳：交错写入会缓存数据包，写入前后都拿不到数据包在mdat中的真实偏移，
+// MP4解复用器也不支持按字节定位，读取方按关键帧pts定位。
+// 不依赖FFmpeg：时间戳和时间基准都是整数，主机单元测试直接包含
+// ============================================================================
+static const uint32_t RECORDING_INDEX_MAGIC = 0x58444952;   // "RIDX"
+static const uint32_t RECORDING_INDEX_VERSION = 2;          // v1带有不准确的文件偏移，不再读取
+static const uint32_t RECORDING_INDEX_FLAG_KEY = 1;
+
+struct RecordingIndexHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t entry_size;
+    int32_t time_base_num;              // 时间戳所用的时间基准（输出视频流）
+    int32_t time_base_den;
+    uint64_t entry_count;
+};
+
+struct RecordingIndexEntry {
+    int64_t pts;
+    int64_t dts;
+    uint32_t size;
+    uint32_t flags;
+    uint32_t keyframe_index;            // 所在GOP关键帧的记录下标，定位时O(1)回到关键帧
+    uint32_t reserved;
+};
+
+class RecordingIndexWriter {
+public:
+    RecordingIndexWriter() : file(nullptr), entry_count(0), last_keyframe(0) {}
+
+    ~RecordingIndexWriter() {
+        finish();
+    }
+
+    bool open(const std::string& media_path, int32_t time_base_num, int32_t time_base_den) {
+        finish();
+        path = media_path + ".idx";
+        file = fopen(path.c_str(), "wb");
+        if (!file) {
+            LOGW("⚠️ 无法创建定位索引: %s", path.c_str());
+            return false;
+        }
+        header.magic = RECORDING_INDEX_MAGIC;
+        header.version = RECORDING_INDEX_VERSION;
+        header.header_size = sizeof(RecordingIndexHeader);
+        header.entry_size = sizeof(RecordingIndexEntry);
+        header.time_base_num = time_base_num;
+        header.time_base_den = time_base_den;
+        header.entry_count = 0;
+        entry_count = 0;
+        last_keyframe = 0;
+        return fwrite(&header, sizeof(header), 1, file) == 1;
+    }
+
+    // 在av_interleaved_write_frame之前调用（写入后数据包会被清空），写入失败时不调用commit。
+    // dts未知(no_ts)时按pts记录
+    void stage(int64_t pts, int64_t dts, int size, bool keyframe, int64_t no_ts) {
+        staged.pts = pts;
+        staged.dts = dts != no_ts ? dts : pts;
+        staged.size = (uint32_t)size;
+        staged.flags = keyframe ? RECORDING_INDEX_FLAG_KEY : 0;
+        staged.reserved = 0;
+    }
+
+    void commit() {
+        if (!file) {
+            return;
+        }
+        if (staged.flags & RECORDING_INDEX_FLAG_KEY) {
+            last_keyframe = (uint32_t)entry_count;
+        }
+        staged.keyframe_index = last_keyframe;
+        if (fwrite(&staged, sizeof(staged), 1, file) == 1) {
+            entry_count++;
+        }
+    }
+
+    // 回写条数并关闭
+    void finish() {
+        if (!file) {
+            return;
+        }
+        header.entry_count = entry_count;
+        if (fseek(file, 0, SEEK_SET) == 0) {
+            fwrite(&header, sizeof(header), 1, file);
+        }
+        fclose(file);
+        file = nullptr;
+        LOGI("🗂️ 定位索引: %s (%llu条)", path.c_str(), (unsigned long long)entry_count);
+    }
+
+private:
+    FILE* file;
+    std::string path;
+    RecordingIndexHeader header;
+    RecordingIndexEntry staged;
+    uint64_t entry_count;
+    uint32_t last_keyframe;
+};
+
+// 映射到内存的索引的只读视图。索引文件可能被截断或损坏（录制中断、磁盘错误、外来文件），
+// 头部的每个长度和每条记录的keyframe_index都先校验再使用，不越界读取
+class RecordingIndexView {
+public:
+    RecordingIndexView() : entries(nullptr), entry_count(0), time_base_num(0), time_base_den(1) {}
+
+    // data需按8字节对齐（mmap的起点满足）；返回是否有可用记录
+    bool load(const uint8_t* data, size_t size) {
+        entries = nullptr;
+        entry_count = 0;
+        if (!data || size < sizeof(RecordingIndexHeader)) {
+            return false;
+        }
+        const RecordingIndexHeader* header = reinterpret_cast<const RecordingIndexHeader*>(data);
+        if (header->magic != RECORDING_INDEX_MAGIC || header->version != RECORDING_INDEX_VERSION ||
+            header->entry_size != sizeof(RecordingIndexEntry) || header->header_size < sizeof(RecordingIndexHeader) ||
+            header->header_size > size || header->header_size % sizeof(int64_t) != 0 ||
+            header->time_base_num <= 0 || header->time_base_den <= 0) {
+            return false;
+        }
+        // 录制中断时条数未回写，按文件长度推算；末尾不完整的记录丢弃
+        size_t available = (size - header->header_size) / header->entry_size;
+        entry_count = header->entry_count > 0 && header->entry_count < available ? (size_t)header->entry_count : available;
+        entries = entry_count > 0 ? reinterpret_cast<const RecordingIndexEntry*>(data + header->header_size) : nullptr;
+        time_base_num = header->time_base_num;
+        time_base_den = header->time_base_den;
+        return entry_count > 0;
+    }
+
+    size_t size() const {
+        return entry_count;
+    }
+
+    const RecordingIndexEntry& entry(size_t index) const {
+        return entries[index];
+    }
+
+    int32_t timeBaseNum() const {
+        return time_base_num;
+    }
+
+    int32_t timeBaseDen() const {
+        return time_base_den;
+    }
+
+    // 返回pts不大于target（索引时间基准）的最后一个关键帧的记录下标：按dts二分（dts单调），
+    // 再经keyframe_index回到GOP起点。keyframe_index越界，或退回上一个GOP时下标没有严格减小
+    // （损坏的记录可能成环）时返回-1，由调用方退回容器自身的定位
+    int64_t findKeyframe(int64_t target) const {
+        if (entry_count == 0) {
+            return -1;
+        }
+        size_t lo = 0;
+        size_t hi = entry_count;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (entries[mid].dts <= target) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        size_t key = entries[lo > 0 ? lo - 1 : 0].keyframe_index;
+        if (key >= entry_count) {
+            return -1;
+        }
+        // 关键帧的dts不晚于目标但pts可能晚于目标（B帧重排），退回上一个GOP
+        while (key > 0 && entries[key].pts > target) {
+            size_t previous = entries[key - 1].keyframe_index;
+            if (previous >= key) {
+                return -1;
+            }
+            key = previous;
+        }
+        return (int64_t)key;
+    }
+
+private:
+    const RecordingIndexEntry* entries;
+    size_t entry_count;
+    int32_t time_base_num;
+    int32_t time_base_den;
+};
+
+#endif
@@ -0,0 +1,282 @@
+#ifndef FFW_RTP_DEPACKETIZER_H
+#define FFW_RTP_DEPACKETIZER_H
+
+#include <cstddef>
+#include <cstdint>
+
+// ============================================================================
+// RTP H.264/HEVC解包 - 按RFC 6184/7798把按序到达的RTP包组装成Annex-B访问单元
+// ============================================================================
+// 序号跳变按丢包处理（跨越丢包的访问单元整帧作废），时间戳扩展为64位作为pts。
+// 访问单元的存储由Sink提供（设备上是RtpDirectSource，数据写入AVBufferPool的缓冲区；主机测试写入vector）：
+//   bool appendAccessUnit(const uint8_t* data, size_t len);   追加到当前访问单元，返回false时整帧作废
+//   bool completeAccessUnit(int64_t pts, bool key, bool by_marker);  当前访问单元完整，返回是否已交付
+//   void discardAccessUnit();                                  丢弃当前访问单元已写入的数据
+template <typename Sink>
+class RtpDepacketizer {
+public:
+    enum Codec { CODEC_H264, CODEC_HEVC };
+
+    static const int kSeqResetDistance = 1000;     // 与RtpReorderWindow相同：落后这么多个序号视为发送端重置了序列
+
+    struct Stats {
+        int received;           // 负载类型匹配、交给解包的RTP包
+        int lost_packets;
+        int dropped_aus;        // 因丢包或存储失败整帧作废的访问单元
+        int aus;
+        int64_t bytes;
+
+        Stats() : received(0), lost_packets(0), dropped_aus(0), aus(0), bytes(0) {}
+    };
+
+    explicit RtpDepacketizer(Sink& sink) :
+        sink(sink), codec(CODEC_H264), payload_type(-1), au_size(0), au_started(false), au_corrupt(false),
+        au_key(false), in_fragment(false), au_timestamp(0), au_pts(0), have_seq(false), expected_seq(0),
+        have_ts(false), last_ts(0), ext_ts(0) {}
+
+    void configure(Codec c, int pt) {
+        codec = c;
+        payload_type = pt;
+    }
+
+    const Stats& stats() const {
+        return counters;
+    }
+
+    void handlePacket(const uint8_t* data, size_t len) {
+        if (len < 12 || (data[0] >> 6) != 2) {
+            return;
+        }
+        bool padding = (data[0] & 0x20) != 0;
+        bool extension = (data[0] & 0x10) != 0;
+        int csrc_count = data[0] & 0x0F;
+        bool marker = (data[1] & 0x80) != 0;
+        int pt = data[1] & 0x7F;
+        uint16_t seq = readBe16(data + 2);
+        uint32_t timestamp = readBe32(data + 4);
+        if (pt != payload_type) {
+            return;
+        }
+        counters.received++;
+
+        size_t offset = 12 + 4 * csrc_count;
+        if (extension) {
+            if (offset + 4 > len) {
+                return;
+            }
+            offset += 4 + 4 * (size_t)readBe16(data + offset + 2);
+        }
+        if (offset >= len) {
+            return;
+        }
+        if (padding) {
+            // 填充长度含自身，不能为0，也不能吃进头部
+            size_t pad = data[len - 1];
+            if (pad == 0 || pad > len - offset) {
+                return;
+            }
+            len -= pad;
+            if (offset >= len) {
+                return;
+            }
+        }
+
+        if (have_seq && seq != expected_seq) {
+            int16_t gap = (int16_t)(seq - expected_seq);
+            if (gap < 0 && -gap < kSeqResetDistance) {
+                return;     // 迟到或重复的包
+            }
+            // 序号大幅后退（发送端重启、SSRC切换）时从这个包重新同步，否则之后的包都会被当作迟到丢弃
+            if (gap > 0) {
+                counters.lost_packets += gap;
+            }
+            au_corrupt = au_corrupt || au_started;
+            in_fragment = false;
+        }
+        have_seq = true;
+        expected_seq = seq + 1;
+
+        // 时间戳变化说明上一帧的marker包丢失，先结束上一帧
+        if (au_started && timestamp != au_timestamp) {
+            completeAccessUnit(false);
+        }
+        if (!au_started) {
+            beginAccessUnit(timestamp);
+        }
+
+        if (codec == CODEC_H264) {
+            depacketizeH264(data + offset, len - offset);
+        } else {
+            depacketizeHevc(data + offset, len - offset);
+        }
+
+        if (marker) {
+            completeAccessUnit(true);
+        }
+    }
+
+private:
+    Sink& sink;
+    Codec codec;
+    int payload_type;
+    Stats counters;
+
+    size_t au_size;
+    bool au_started;
+    bool au_corrupt;
+    bool au_key;
+    bool in_fragment;
+    uint32_t au_timestamp;
+    int64_t au_pts;
+    bool have_seq;
+    uint16_t expected_seq;
+    bool have_ts;
+    uint32_t last_ts;
+    int64_t ext_ts;
+
+    static uint16_t readBe16(const uint8_t* p) {
+        return (uint16_t)((p[0] << 8) | p[1]);
+    }
+
+    static uint32_t readBe32(const uint8_t* p) {
+        return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    }
+
+    void beginAccessUnit(uint32_t timestamp) {
+        if (!have_ts) {
+            have_ts = true;
+            ext_ts = 0;
+        } else {
+            ext_ts += (int32_t)(timestamp - last_ts);
+        }
+        last_ts = timestamp;
+        au_timestamp = timestamp;
+        au_pts = ext_ts;
+        au_started = true;
+        au_size = 0;
+        au_key = false;
+        in_fragment = false;
+    }
+
+    void appendBytes(const uint8_t* data, size_t len) {
+        if (au_corrupt) {
+            return;
+        }
+        if (!sink.appendAccessUnit(data, len)) {
+            au_corrupt = true;
+            return;
+        }
+        au_size += len;
+    }
+
+    void beginNal(int nal_type) {
+        static const uint8_t start_code[4] = {0, 0, 0, 1};
+        appendBytes(start_code, 4);
+        if (codec == CODEC_H264) {
+            au_key = au_key || nal_type == 5;
+        } else {
+            au_key = au_key || (nal_type >= 16 && nal_type <= 21);
+        }
+    }
+
+    // RFC 6184：单NAL、STAP-A、FU-A
+    void depacketizeH264(const uint8_t* payload, size_t len) {
+        int type = payload[0] & 0x1F;
+        if (type >= 1 && type <= 23) {
+            beginNal(type);
+            appendBytes(payload, len);
+        } else if (type == 24) {
+            size_t pos = 1;
+            while (pos + 2 <= len) {
+                size_t nal_len = readBe16(payload + pos);
+                pos += 2;
+                if (nal_len == 0 || pos + nal_len > len) {
+                    break;
+                }
+                beginNal(payload[pos] & 0x1F);
+                appendBytes(payload + pos, nal_len);
+                pos += nal_len;
+            }
+        } else if (type == 28 && len > 2) {
+            bool start = (payload[1] & 0x80) != 0;
+            bool end = (payload[1] & 0x40) != 0;
+            int nal_type = payload[1] & 0x1F;
+            if (start) {
+                uint8_t header = (payload[0] & 0xE0) | nal_type;
+                beginNal(nal_type);
+                appendBytes(&header, 1);
+                in_fragment = true;
+            } else if (!in_fragment) {
+                au_corrupt = true;      // 分片起始包丢失
+                return;
+            }
+            appendBytes(payload + 2, len - 2);
+            if (end) {
+                in_fragment = false;
+            }
+        } else {
+            au_corrupt = true;          // STAP-B/MTAP/FU-B只用于交错模式
+        }
+    }
+
+    // RFC 7798：单NAL、AP、FU（不含DONL）
+    void depacketizeHevc(const uint8_t* payload, size_t len) {
+        if (len < 3) {
+            return;
+        }
+        int type = (payload[0] >> 1) & 0x3F;
+        if (type < 48) {
+            beginNal(type);
+            appendBytes(payload, len);
+        } else if (type == 48) {
+            size_t pos = 2;
+            while (pos + 2 <= len) {
+                size_t nal_len = readBe16(payload + pos);
+                pos += 2;
+                if (nal_len < 2 || pos + nal_len > len) {
+                    break;
+                }
+                beginNal((payload[pos] >> 1) & 0x3F);
+                appendBytes(payload + pos, nal_len);
+                pos += nal_len;
+            }
+        } else if (type == 49) {
+            bool start = (payload[2] & 0x80) != 0;
+            bool end = (payload[2] & 0x40) != 0;
+            int nal_type = payload[2] & 0x3F;
+            if (start) {
+                uint8_t header[2] = {(uint8_t)((payload[0] & 0x81) | (nal_type << 1)), payload[1]};
+                beginNal(nal_type);
+                appendBytes(header, 2);
+                in_fragment = true;
+            } else if (!in_fragment) {
+                au_corrupt = true;
+                return;
+            }
+            appendBytes(payload + 3, len - 3);
+            if (end) {
+                in_fragment = false;
+            }
+        }
+        // PACI(50)不携带需要的数据，忽略
+    }
+
+    void completeAccessUnit(bool by_marker) {
+        au_started = false;
+        in_fragment = false;
+        if (au_corrupt || au_size == 0) {
+            if (au_corrupt) {
+                counters.dropped_aus++;
+            }
+            sink.discardAccessUnit();
+            au_corrupt = false;
+            return;
+        }
+        if (sink.completeAccessUnit(au_pts, au_key, by_marker)) {
+            counters.aus++;
+            counters.bytes += (int64_t)au_size;
+        }
+    }
+};
+
+#endif
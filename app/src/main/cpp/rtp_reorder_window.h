@@ -0,0 +1,138 @@
+#ifndef FFW_RTP_REORDER_WINDOW_H
+#define FFW_RTP_REORDER_WINDOW_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+// ============================================================================
+// UDP RTP重排窗口 - 按16位序号扩展后的顺序交付，缺包时最多等待max_packets个包或max_wait_ms
+// ============================================================================
+// 连续的包到达即交付；窗口满或最早暂存的包超时后，缺失的序号按丢包处理（由解包器计入丢包）。
+// 时间由调用方以微秒传入（设备上是av_gettime_relative()，主机测试/模型用模拟时间）。
+// Sink::handlePacket(const uint8_t* data, size_t len)接收按序交付的RTP包
+template <typename Sink>
+class RtpReorderWindow {
+public:
+    static const int64_t kSeqResetDistance = 1000;     // 落后这么多个序号视为发送端重置了序列
+
+    struct Stats {
+        int reordered;          // 乱序到达、经窗口纠正的包
+        int late;               // 窗口已越过才到达或重复的包
+
+        Stats() : reordered(0), late(0) {}
+    };
+
+    explicit RtpReorderWindow(Sink& sink) :
+        sink(sink), payload_type(-1), max_packets(0), max_wait_us(0), have_release_seq(false), release_seq(0) {}
+
+    // max_packets为0时到达即交付
+    void configure(int pt, int packets, int wait_ms) {
+        payload_type = pt;
+        max_packets = packets;
+        max_wait_us = (int64_t)wait_ms * 1000;
+    }
+
+    const Stats& stats() const {
+        return counters;
+    }
+
+    bool empty() const {
+        return held.empty();
+    }
+
+    // 最早暂存的包还要等多久到期，窗口为空时返回-1
+    int64_t waitUs(int64_t now_us) const {
+        if (held.empty()) {
+            return -1;
+        }
+        int64_t remaining = held.front().arrival_us + max_wait_us - now_us;
+        return remaining > 0 ? remaining : 0;
+    }
+
+    void clear() {
+        held.clear();
+    }
+
+    void hold(const uint8_t* data, size_t len, int64_t now_us) {
+        if (len < 12 || (data[0] >> 6) != 2 || (data[1] & 0x7F) != payload_type) {
+            return;
+        }
+        uint16_t seq = (uint16_t)((data[2] << 8) | data[3]);
+        if (!have_release_seq) {
+            have_release_seq = true;
+            release_seq = seq;
+        }
+        int64_t ext_seq = release_seq + (int16_t)(seq - (uint16_t)release_seq);
+        if (ext_seq < release_seq) {
+            if (release_seq - ext_seq < kSeqResetDistance) {
+                counters.late++;
+                return;
+            }
+            release(true, now_us);
+            release_seq = ext_seq;
+        }
+
+        typename std::deque<HeldPacket>::iterator pos = held.end();
+        while (pos != held.begin() && (pos - 1)->ext_seq > ext_seq) {
+            --pos;
+        }
+        if (pos != held.begin() && (pos - 1)->ext_seq == ext_seq) {
+            counters.late++;
+            return;
+        }
+        if (pos != held.end()) {
+            counters.reordered++;
+        }
+
+        HeldPacket packet;
+        packet.ext_seq = ext_seq;
+        packet.arrival_us = now_us;
+        if (!spare_buffers.empty()) {
+            packet.data.swap(spare_buffers.back());
+            spare_buffers.pop_back();
+        }
+        packet.data.assign(data, data + len);
+        held.insert(pos, std::move(packet));
+    }
+
+    // 按序号交付：连续的立即交付；缺包时等到窗口满或最早的包超时，之后按丢包处理。all为true时全部交付
+    void release(bool all, int64_t now_us) {
+        while (!held.empty()) {
+            HeldPacket& front = held.front();
+            bool next_in_order = front.ext_seq == release_seq;
+            bool window_full = (int)held.size() > max_packets;
+            bool expired = now_us - front.arrival_us >= max_wait_us;
+            if (!all && !next_in_order && !window_full && !expired) {
+                break;
+            }
+            sink.handlePacket(front.data.data(), front.data.size());
+            release_seq = front.ext_seq + 1;
+            spare_buffers.push_back(std::vector<uint8_t>());
+            spare_buffers.back().swap(front.data);
+            held.pop_front();
+        }
+    }
+
+private:
+    // 暂存的数据报，按扩展序号升序排列
+    struct HeldPacket {
+        int64_t ext_seq;
+        int64_t arrival_us;
+        std::vector<uint8_t> data;
+    };
+
+    Sink& sink;
+    int payload_type;
+    int max_packets;
+    int64_t max_wait_us;
+    Stats counters;
+    std::deque<HeldPacket> held;
+    std::vector<std::vector<uint8_t> > spare_buffers;   // 已交付数据报的缓冲区，循环使用
+    bool have_release_seq;
+    int64_t release_seq;                                // 下一个应交付的扩展序号
+};
+
+#endif
@@ -0,0 +1,332 @@
+#ifndef FFW_RTSP_MESSAGE_H
+#define FFW_RTSP_MESSAGE_H
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "async_logger.h"
+
+// ============================================================================
+// RTSP控制消息 - 响应头、SDP视频描述和认证头，不依赖FFmpeg和套接字，主机单元测试直接包含。
+// 输入都来自网络：长度和数值先校验再使用，回显到请求头里的字符串不能带引号或换行
+// ============================================================================
+
+inline std::string rtspTrim(const std::string& s) {
+    size_t begin = s.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    size_t end = s.find_last_not_of(" \t\r\n");
+    return s.substr(begin, end - begin + 1);
+}
+
+struct RtspResponse {
+    int status;
+    std::map<std::string, std::string> headers;    // 键为小写
+    std::string body;
+
+    RtspResponse() : status(0) {}
+};
+
+// data中响应头（含结尾空行）的长度，还没有收到空行时返回0
+inline size_t rtspHeaderLength(const uint8_t* data, size_t len) {
+    static const char terminator[] = "\r\n\r\n";
+    const uint8_t* found = std::search(data, data + len, terminator, terminator + 4);
+    return found == data + len ? 0 : (size_t)(found - data) + 4;
+}
+
+// 解析以空行结尾的响应头，content_length返回正文长度。状态行不是"RTSP/x.y 状态码"、
+// Content-Length不是十进制数或超过max_body时返回false（连接不可再用）
+inline bool parseRtspResponseHeader(const std::string& header, size_t max_body, RtspResponse& resp,
+                                    size_t& content_length) {
+    resp.status = 0;
+    resp.headers.clear();
+    resp.body.clear();
+    content_length = 0;
+    size_t line_start = 0;
+    bool first_line = true;
+    while (line_start < header.size()) {
+        size_t line_end = header.find("\r\n", line_start);
+        if (line_end == std::string::npos) {
+            line_end = header.size();
+        }
+        std::string line = header.substr(line_start, line_end - line_start);
+        line_start = line_end + 2;
+        if (first_line) {
+            int status = 0;
+            if (line.compare(0, 5, "RTSP/") != 0 || sscanf(line.c_str(), "RTSP/%*s %d", &status) != 1 ||
+                status < 100 || status > 599) {
+                return false;
+            }
+            resp.status = status;
+            first_line = false;
+            continue;
+        }
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) {
+            continue;
+        }
+        std::string key = rtspTrim(line.substr(0, colon));
+        std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+        std::string value = rtspTrim(line.substr(colon + 1));
+        // 同时提供多种认证方式时优先Digest
+        if (key == "www-authenticate" && resp.headers.count(key) &&
+            resp.headers[key].compare(0, 6, "Digest") == 0) {
+            continue;
+        }
+        resp.headers[key] = value;
+    }
+    if (first_line) {
+        return false;
+    }
+
+    std::map<std::string, std::string>::const_iterator length = resp.headers.find("content-length");
+    if (length == resp.headers.end()) {
+        return true;
+    }
+    const std::string& digits = length->second;
+    if (digits.empty()) {
+        return false;
+    }
+    for (size_t i = 0; i < digits.size(); i++) {
+        if (digits[i] < '0' || digits[i] > '9') {
+            return false;
+        }
+        content_length = content_length * 10 + (size_t)(digits[i] - '0');
+        if (content_length > max_body) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ============================================================================
+// SDP - 只取第一路视频：编码、负载类型、时钟频率、参数集和control
+// ============================================================================
+enum SdpVideoCodec { SDP_CODEC_NONE, SDP_CODEC_H264, SDP_CODEC_HEVC };
+
+struct SdpVideoTrack {
+    SdpVideoCodec codec;
+    int payload_type;
+    int clock_rate;                             // 0表示rtpmap没有给出
+    std::string control;
+    std::vector<std::string> parameter_sets;    // sprop-*参数的值（逗号分隔的base64列表，原样保留）
+
+    SdpVideoTrack() : codec(SDP_CODEC_NONE), payload_type(-1), clock_rate(0) {}
+};
+
+// 不是H.264/HEVC，或使用不支持的打包方式时返回false，由调用方回退到libavformat
+inline bool parseSdpVideo(const std::string& sdp, SdpVideoTrack& track) {
+    track = SdpVideoTrack();
+    bool in_video = false;
+    bool video_found = false;
+    std::string fmtp;
+    size_t line_start = 0;
+    while (line_start < sdp.size()) {
+        size_t line_end = sdp.find('\n', line_start);
+        std::string line = rtspTrim(sdp.substr(line_start, line_end == std::string::npos ? std::string::npos : line_end - line_start));
+        line_start = line_end == std::string::npos ? sdp.size() : line_end + 1;
+
+        if (line.compare(0, 2, "m=") == 0) {
+            if (video_found) {
+                break;
+            }
+            in_video = false;
+            int port = 0;
+            int pt = -1;
+            char proto[32];
+            // 负载类型是7位字段，格式不对的媒体行跳过
+            if (line.compare(0, 8, "m=video ") == 0 &&
+                sscanf(line.c_str(), "m=video %d %31s %d", &port, proto, &pt) == 3 && pt >= 0 && pt <= 127) {
+                in_video = true;
+                video_found = true;
+                track.payload_type = pt;
+            }
+            continue;
+        }
+        if (!in_video) {
+            continue;
+        }
+        if (line.compare(0, 9, "a=rtpmap:") == 0 && atoi(line.c_str() + 9) == track.payload_type) {
+            size_t space = line.find(' ');
+            std::string encoding = space == std::string::npos ? "" : line.substr(space + 1);
+            std::transform(encoding.begin(), encoding.end(), encoding.begin(), ::toupper);
+            if (encoding.compare(0, 5, "H264/") == 0) {
+                track.codec = SDP_CODEC_H264;
+            } else if (encoding.compare(0, 5, "H265/") == 0 || encoding.compare(0, 5, "HEVC/") == 0) {
+                track.codec = SDP_CODEC_HEVC;
+            }
+            size_t slash = encoding.find('/');
+            long rate = slash == std::string::npos ? 0 : strtol(encoding.c_str() + slash + 1, nullptr, 10);
+            if (rate > 0 && rate <= 1000000) {
+                track.clock_rate = (int)rate;
+            }
+        } else if (line.compare(0, 7, "a=fmtp:") == 0 && atoi(line.c_str() + 7) == track.payload_type) {
+            size_t space = line.find(' ');
+            fmtp = space == std::string::npos ? "" : line.substr(space + 1);
+        } else if (line.compare(0, 10, "a=control:") == 0) {
+            track.control = line.substr(10);
+        }
+    }
+
+    if (track.codec == SDP_CODEC_NONE) {
+        LOGW("⚠️ RTP直通只支持H.264/HEVC，回退到libavformat");
+        return false;
+    }
+
+    size_t param_start = 0;
+    while (param_start < fmtp.size()) {
+        size_t semicolon = fmtp.find(';', param_start);
+        std::string param = rtspTrim(fmtp.substr(param_start, semicolon == std::string::npos ? std::string::npos : semicolon - param_start));
+        param_start = semicolon == std::string::npos ? fmtp.size() : semicolon + 1;
+        size_t eq = param.find('=');
+        if (eq == std::string::npos) {
+            continue;
+        }
+        std::string key = param.substr(0, eq);
+        std::string value = param.substr(eq + 1);
+        if (key == "sprop-parameter-sets" || key == "sprop-vps" || key == "sprop-sps" || key == "sprop-pps") {
+            track.parameter_sets.push_back(value);
+        } else if (key == "packetization-mode" && atoi(value.c_str()) > 1) {
+            LOGW("⚠️ RTP直通不支持交错打包模式");
+            return false;
+        } else if (key == "sprop-max-don-diff" && atoi(value.c_str()) > 0) {
+            LOGW("⚠️ RTP直通不支持DONL字段");
+            return false;
+        }
+    }
+    return true;
+}
+
+// SDP里的control相对于Content-Base；为空或"*"时就是Content-Base本身
+inline std::string resolveRtspControl(const std::string& base_url, const std::string& control) {
+    if (control.empty() || control == "*") {
+        return base_url;
+    }
+    if (control.compare(0, 7, "rtsp://") == 0) {
+        return control;
+    }
+    return base_url + (base_url.empty() || base_url[base_url.size() - 1] == '/' ? "" : "/") + control;
+}
+
+// ============================================================================
+// RTSP认证 - 按401质询生成Basic/Digest（RFC 2617）Authorization头
+// ============================================================================
+// Hash提供摘要和编码（设备上是av_md5_sum/av_base64_encode，主机测试用可读的替代）：
+//   static std::string md5Hex(const std::string& s);   32位小写十六进制
+//   static std::string base64(const std::string& s);
+template <typename Hash>
+class BasicRtspAuth {
+public:
+    BasicRtspAuth() : scheme(SCHEME_NONE), qop(false), nc(0) {}
+
+    void setCredentials(const std::string& user, const std::string& pass) {
+        username = user;
+        password = pass;
+    }
+
+    bool hasCredentials() const {
+        return !username.empty();
+    }
+
+    // 返回是否能按这个质询重试
+    bool parseChallenge(const std::string& challenge) {
+        if (challenge.compare(0, 6, "Digest") == 0) {
+            scheme = SCHEME_DIGEST;
+            realm = param(challenge, "realm");
+            nonce = param(challenge, "nonce");
+            opaque = param(challenge, "opaque");
+            qop = param(challenge, "qop").find("auth") != std::string::npos;
+            nc = 0;
+            return !nonce.empty();
+        }
+        if (challenge.compare(0, 5, "Basic") == 0) {
+            scheme = SCHEME_BASIC;
+            return true;
+        }
+        LOGW("⚠️ RTP直通不支持的认证方式: %s", challenge.c_str());
+        return false;
+    }
+
+    // 还没有收到质询，或回显的字符串会破坏请求头时返回空串（不带认证发送）
+    std::string header(const std::string& method, const std::string& uri) {
+        if (scheme == SCHEME_BASIC) {
+            return "Basic " + Hash::base64(username + ":" + password);
+        }
+        if (scheme != SCHEME_DIGEST) {
+            return "";
+        }
+        if (!quotable(username) || !quotable(realm) || !quotable(nonce) || !quotable(opaque) || !quotable(uri)) {
+            LOGW("⚠️ RTP直通认证参数含引号或控制字符，不发送Authorization");
+            return "";
+        }
+        std::string ha1 = Hash::md5Hex(username + ":" + realm + ":" + password);
+        std::string ha2 = Hash::md5Hex(method + ":" + uri);
+        std::string result = "Digest username=\"" + username + "\", realm=\"" + realm +
+                             "\", nonce=\"" + nonce + "\", uri=\"" + uri + "\"";
+        if (qop) {
+            char count[9];
+            snprintf(count, sizeof(count), "%08x", ++nc);
+            std::string cnonce = Hash::md5Hex(std::to_string(
+                std::chrono::steady_clock::now().time_since_epoch().count())).substr(0, 16);
+            result += ", qop=auth, nc=" + std::string(count) + ", cnonce=\"" + cnonce + "\", response=\"" +
+                      Hash::md5Hex(ha1 + ":" + nonce + ":" + count + ":" + cnonce + ":auth:" + ha2) + "\"";
+        } else {
+            result += ", response=\"" + Hash::md5Hex(ha1 + ":" + nonce + ":" + ha2) + "\"";
+        }
+        if (!opaque.empty()) {
+            result += ", opaque=\"" + opaque + "\"";
+        }
+        return result;
+    }
+
+    // 质询/认证头里name=value或name="value"的值，没有时返回空串
+    static std::string param(const std::string& header, const char* name) {
+        std::string key = std::string(name) + "=";
+        size_t pos = header.find(key);
+        while (pos != std::string::npos && pos > 0 && isalnum((unsigned char)header[pos - 1])) {
+            pos = header.find(key, pos + 1);
+        }
+        if (pos == std::string::npos) {
+            return "";
+        }
+        pos += key.size();
+        if (pos < header.size() && header[pos] == '"') {
+            size_t end = header.find('"', pos + 1);
+            return header.substr(pos + 1, end == std::string::npos ? std::string::npos : end - pos - 1);
+        }
+        size_t end = header.find(',', pos);
+        return rtspTrim(header.substr(pos, end == std::string::npos ? std::string::npos : end - pos));
+    }
+
+private:
+    enum Scheme { SCHEME_NONE, SCHEME_BASIC, SCHEME_DIGEST };
+
+    Scheme scheme;
+    std::string username;
+    std::string password;
+    std::string realm;
+    std::string nonce;
+    std::string opaque;
+    bool qop;
+    int nc;
+
+    static bool quotable(const std::string& s) {
+        for (size_t i = 0; i < s.size(); i++) {
+            unsigned char c = (unsigned char)s[i];
+            if (c == '"' || c < 0x20 || c == 0x7F) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef FFW_STREAM_WATCHDOG_H
+#define FFW_STREAM_WATCHDOG_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// ============================================================================
+// 读超时看门狗 - 限制建立连接、等待首帧和视频卡顿的时间
+// ============================================================================
+// 期限是流级别的，不随单次读包重新计时：
+// - 建立连接：每次传输尝试arm(PHASE_CONNECT)单独计时
+// - 建立完成后beginPlayback()开始计首帧期限，只计一次
+// - 之后只有视频包onVideoPacket()推进卡顿期限，音频包照常流动也不能掩盖视频卡死
+// FFmpeg在网络等待循环中调用interruptCheck（作为AVIOInterruptCB），返回非0即以AVERROR_EXIT退出；
+// 数据持续到达时阻塞读不会进入等待循环，所以读包前还要poll()一次。
+// 关闭流时先abort()，阻塞中的读包随即返回。
+// Clock::nowUs()返回单调时钟微秒，主机测试用假时钟驱动
+template <typename Clock>
+class BasicStreamWatchdog {
+public:
+    enum Phase { PHASE_IDLE, PHASE_CONNECT, PHASE_FIRST_FRAME, PHASE_READ };
+
+    BasicStreamWatchdog() : aborted(false), expired(false), phase(PHASE_IDLE), expired_phase(PHASE_IDLE),
+        deadline_us(0), read_stall_ms(0) {}
+
+    // 开始一个受限操作；timeout_ms<=0表示只响应abort
+    void arm(Phase p, int timeout_ms) {
+        phase.store(p);
+        expired.store(false);
+        deadline_us.store(timeout_ms > 0 ? Clock::nowUs() + (int64_t)timeout_ms * 1000 : 0);
+    }
+
+    // 建立完成后调用一次：首帧期限从现在开始计，读到第一个视频包后转入卡顿期限
+    void beginPlayback(int first_frame_ms, int stall_ms) {
+        read_stall_ms.store(stall_ms);
+        arm(PHASE_FIRST_FRAME, first_frame_ms);
+    }
+
+    // 收到一个视频包：卡顿期限从现在重新计；音频等其他包不调用
+    void onVideoPacket() {
+        arm(PHASE_READ, read_stall_ms.load());
+    }
+
+    void disarm() {
+        deadline_us.store(0);
+        phase.store(PHASE_IDLE);
+    }
+
+    // 可在任意线程调用，之后该流的所有阻塞操作立即失败
+    void abort() {
+        aborted.store(true);
+    }
+
+    bool isAborted() const {
+        return aborted.load();
+    }
+
+    // 最近一次受限操作是否因超时被中断
+    bool hasExpired() const {
+        return expired.load();
+    }
+
+    int expiredPhase() const {
+        return expired_phase.load();
+    }
+
+    // 读包前检查：已中止或期限已过返回true，判定与中断回调相同
+    bool poll() {
+        return interruptCheck(this) != 0;
+    }
+
+    // AVIOInterruptCB回调，opaque为看门狗本身
+    static int interruptCheck(void* opaque) {
+        BasicStreamWatchdog* self = static_cast<BasicStreamWatchdog*>(opaque);
+        if (self->aborted.load()) {
+            return 1;
+        }
+        int64_t deadline = self->deadline_us.load();
+        if (deadline > 0 && Clock::nowUs() >= deadline) {
+            self->expired_phase.store(self->phase.load());
+            self->expired.store(true);
+            return 1;
+        }
+        return 0;
+    }
+
+    static const char* phaseName(int p) {
+        switch (p) {
+            case PHASE_CONNECT: return "建立连接";
+            case PHASE_FIRST_FRAME: return "等待首帧";
+            case PHASE_READ: return "视频读包";
+            default: return "空闲";
+        }
+    }
+
+private:
+    std::atomic<bool> aborted;
+    std::atomic<bool> expired;
+    std::atomic<int> phase;
+    std::atomic<int> expired_phase;
+    std::atomic<int64_t> deadline_us;
+    std::atomic<int> read_stall_ms;
+};
+
+struct SteadyWatchdogClock {
+    static int64_t nowUs() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
+
+typedef BasicStreamWatchdog<SteadyWatchdogClock> StreamWatchdog;
+
+#endif
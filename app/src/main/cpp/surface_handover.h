@@ -0,0 +1,102 @@
+#ifndef FFW_SURFACE_HANDOVER_H
+#define FFW_SURFACE_HANDOVER_H
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+// ============================================================================
+// Surface交接 - UI线程只发布新窗口，渲染线程在下一帧开始时接管并释放旧窗口；
+// 发布方不加锁、不固定等待，只有Surface销毁时才等待正在进行的一帧结束
+// ============================================================================
+// Window为窗口类型，WindowOps::release(Window*)释放一次引用（设备上是ANativeWindow_release，
+// 主机测试里是假窗口），交接逻辑本身不依赖NDK
+template <typename Window, typename WindowOps>
+class BasicSurfaceHandover {
+public:
+    static BasicSurfaceHandover& getInstance() {
+        static BasicSurfaceHandover instance;
+        return instance;
+    }
+
+    BasicSurfaceHandover() : pending(nullptr), publish_sequence(0), adopted_sequence(0), rendering(false), view_size(0) {}
+
+    // UI线程调用，接管window的引用；window为nullptr表示Surface已销毁
+    void publish(Window* window) {
+        Handoff* handoff = new Handoff();
+        handoff->window = window;
+        handoff->sequence = ++publish_sequence;
+        uint64_t sequence = handoff->sequence;
+
+        // 渲染线程尚未接管的上一次发布直接作废
+        discard(pending.exchange(handoff));
+
+        if (!window) {
+            // 销毁回调返回后不能再使用旧窗口：若渲染线程正处于一帧中且尚未接管本次发布，等这一帧结束
+            while (rendering.load() && adopted_sequence.load() < sequence) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void setViewSize(int width, int height) {
+        view_size.store(((int64_t)width << 32) | (uint32_t)height);
+    }
+
+    void viewSize(int& width, int& height) const {
+        int64_t packed = view_size.load();
+        width = (int)(packed >> 32);
+        height = (int)(uint32_t)packed;
+    }
+
+    // 渲染线程在每帧开始时调用；有新发布时释放current并替换，返回true
+    bool beginFrame(Window*& current) {
+        rendering.store(true);
+        Handoff* handoff = pending.exchange(nullptr);
+        if (!handoff) {
+            return false;
+        }
+        if (current) {
+            WindowOps::release(current);
+        }
+        current = handoff->window;
+        adopted_sequence.store(handoff->sequence);
+        delete handoff;
+        return true;
+    }
+
+    void endFrame() {
+        rendering.store(false);
+    }
+
+    void discardPending() {
+        discard(pending.exchange(nullptr));
+    }
+
+private:
+    struct Handoff {
+        Window* window;
+        uint64_t sequence;
+    };
+
+    std::atomic<Handoff*> pending;
+    std::atomic<uint64_t> publish_sequence;
+    std::atomic<uint64_t> adopted_sequence;
+    std::atomic<bool> rendering;
+    std::atomic<int64_t> view_size;
+
+    BasicSurfaceHandover(const BasicSurfaceHandover&);
+    BasicSurfaceHandover& operator=(const BasicSurfaceHandover&);
+
+    static void discard(Handoff* handoff) {
+        if (!handoff) {
+            return;
+        }
+        if (handoff->window) {
+            WindowOps::release(handoff->window);
+        }
+        delete handoff;
+    }
+};
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef FFW_THREAD_POLICY_H
+#define FFW_THREAD_POLICY_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "async_logger.h"
+
+// ============================================================================
+// 线程调度策略 - 流水线线程命名、优先级和绑核（由native创建的线程自行设置）
+// ============================================================================
+// 只用Linux系统调用（Android的bionic与glibc一致），主机测试直接在Linux上验证
+struct ThreadPolicy {
+    int nice;               // -20(最高)..19，-8相当于Android的THREAD_PRIORITY_URGENT_DISPLAY
+    uint32_t cpu_mask;      // 第n位表示允许运行在CPU n上，0表示不绑核
+    bool realtime;          // 尝试SCHED_FIFO，无权限时退回nice
+
+    ThreadPolicy() : nice(0), cpu_mask(0), realtime(false) {}
+};
+
+// 掩码转换为CPU集合，只取前cpu_count个CPU（最多32个）；掩码为0表示全部
+inline void threadPolicyCpuSet(uint32_t cpu_mask, int cpu_count, cpu_set_t& cpus) {
+    CPU_ZERO(&cpus);
+    cpu_count = std::min(cpu_count, 32);
+    for (int cpu = 0; cpu < cpu_count; cpu++) {
+        if (cpu_mask == 0 || (cpu_mask & (1u << cpu))) {
+            CPU_SET(cpu, &cpus);
+        }
+    }
+}
+
+// 作用于调用线程；各项独立生效，某项无权限时只记录日志，返回是否全部生效
+inline bool applyThreadPolicy(const char* name, const ThreadPolicy& policy) {
+    bool ok = true;
+    if (name) {
+        pthread_setname_np(pthread_self(), name);   // 名称最长15字节
+    }
+
+    bool realtime_applied = false;
+    if (policy.realtime) {
+        sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = 1;   // 只需高于所有SCHED_OTHER线程，不与系统音频线程竞争
+        if (sched_setscheduler(0, SCHED_FIFO, &param) == 0) {
+            realtime_applied = true;
+        } else {
+            ok = false;
+            LOGW("⚠️ %s: SCHED_FIFO不可用(%s)，改用nice", name ? name : "线程", strerror(errno));
+        }
+    }
+    if (!realtime_applied) {
+        sched_param param;
+        memset(&param, 0, sizeof(param));
+        sched_setscheduler(0, SCHED_OTHER, &param);
+        if (setpriority(PRIO_PROCESS, gettid(), policy.nice) != 0) {
+            ok = false;
+            LOGW("⚠️ %s: 设置nice=%d失败(%s)", name ? name : "线程", policy.nice, strerror(errno));
+        }
+    }
+
+    cpu_set_t cpus;
+    threadPolicyCpuSet(policy.cpu_mask, (int)sysconf(_SC_NPROCESSORS_CONF), cpus);
+    if (sched_setaffinity(0, sizeof(cpus), &cpus) != 0) {
+        ok = false;
+        LOGW("⚠️ %s: 绑核0x%x失败(%s)", name ? name : "线程", policy.cpu_mask, strerror(errno));
+    }
+
+    LOGI("🧵 线程策略 %s: %s, nice=%d, CPU掩码=0x%x", name ? name : "", realtime_applied ? "SCHED_FIFO" : "SCHED_OTHER",
+         policy.nice, policy.cpu_mask);
+    return ok;
+}
+
+// 单步耗时统计：均值、标准差和CPU迁移次数，用于比较不同策略的抖动
+class StepJitterStats {
+public:
+    // initial_cpu为线程当前所在CPU，-1表示从第一步开始计算迁移
+    explicit StepJitterStats(int initial_cpu = -1) :
+        steps(0), sum_ms(0), sum_sq_ms(0), migrations(0), last_cpu(initial_cpu) {}
+
+    void addStep(double step_ms, int cpu) {
+        steps++;
+        sum_ms += step_ms;
+        sum_sq_ms += step_ms * step_ms;
+        if (last_cpu >= 0 && cpu != last_cpu) {
+            migrations++;
+        }
+        last_cpu = cpu;
+    }
+
+    int stepCount() const {
+        return steps;
+    }
+
+    double meanMs() const {
+        return steps > 0 ? sum_ms / steps : 0.0;
+    }
+
+    double stddevMs() const {
+        if (steps == 0) {
+            return 0.0;
+        }
+        double mean = meanMs();
+        return sqrt(std::max(0.0, sum_sq_ms / steps - mean * mean));
+    }
+
+    int migrationCount() const {
+        return migrations;
+    }
+
+    // 开始新的统计窗口，保留最近所在的CPU以便跨窗口计算迁移
+    void resetWindow() {
+        steps = 0;
+        sum_ms = sum_sq_ms = 0;
+        migrations = 0;
+    }
+
+private:
+    int steps;
+    double sum_ms;
+    double sum_sq_ms;
+    int migrations;
+    int last_cpu;
+};
+
+#endif
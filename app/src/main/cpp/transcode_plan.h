@@ -0,0 +1,126 @@
+#ifndef FFW_TRANSCODE_PLAN_H
+#define FFW_TRANSCODE_PLAN_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// ============================================================================
+// 文件转码的决策和统计 - 只处理尺寸、毫秒和微秒，不依赖FFmpeg，主机单元测试直接包含
+// ============================================================================
+
+// 目标尺寸为0表示保持源尺寸；只有尺寸不变才可能流复制
+inline bool keepsSourceSize(int target_width, int target_height, int source_width, int source_height) {
+    return (target_width <= 0 || target_width == source_width) &&
+           (target_height <= 0 || target_height == source_height);
+}
+
+// 吞吐量的实时倍数：媒体时长 / 实际耗时，耗时为0时返回0
+inline double realtimeMultiple(int64_t media_us, int64_t elapsed_us) {
+    return media_us > 0 && elapsed_us > 0 ? (double)media_us / (double)elapsed_us : 0.0;
+}
+
+// 进度回调节流：第一次总是回调，之后每前进1%或距上次回调200ms才回调一次
+class TranscodeProgressThrottle {
+public:
+    static const int64_t kMinIntervalUs = 200000;
+
+    TranscodeProgressThrottle() : last_ms(-1), last_time_us(0) {}
+
+    // duration_ms未知(<=0)时只按时间节流；进度没有前进时不按百分比回调
+    bool shouldReport(int64_t processed_ms, int64_t duration_ms, int64_t now_us) {
+        bool percent_step = duration_ms > 0 && processed_ms > last_ms &&
+                            processed_ms - last_ms >= duration_ms / 100;
+        if (last_ms >= 0 && !percent_step && now_us - last_time_us < kMinIntervalUs) {
+            return false;
+        }
+        last_ms = processed_ms;
+        last_time_us = now_us;
+        return true;
+    }
+
+private:
+    int64_t last_ms;
+    int64_t last_time_us;
+};
+
+// ============================================================================
+// 分段并行转码的切分 - 时间戳都在源视频流时间基准下
+// ============================================================================
+struct SegmentPlanner {
+    static const int kMaxWorkers = 8;
+    static const int kMinSegmentSeconds = 10;   // 分段过短时启动开销大于并行收益
+
+    // 实际分段数上限：不超过请求数、kMaxWorkers和时长允许的段数，小于2表示不值得并行
+    static int workerCount(int requested, int64_t duration_ms) {
+        int64_t by_duration = duration_ms / 1000 / kMinSegmentSeconds;
+        return (int)std::min<int64_t>(std::min(requested, (int)kMaxWorkers), by_duration);
+    }
+
+    // 第index个切分点的目标时间（等分），实际切分点是向前定位到的关键帧
+    static int64_t splitTarget(int64_t start, int64_t duration, int index, int workers) {
+        return start + duration * index / workers;
+    }
+
+    // 记录定位到的关键帧；关键帧间隔大于分段长度时相邻切分点会重合，去重，返回是否采用
+    static bool addSplitPoint(std::vector<int64_t>& split_points, int64_t start, int64_t keyframe_pts) {
+        if (keyframe_pts <= start || (!split_points.empty() && keyframe_pts <= split_points.back())) {
+            return false;
+        }
+        split_points.push_back(keyframe_pts);
+        return true;
+    }
+
+    // 第index段的[start, end)，首段从头开始(INT64_MIN)，末段到结尾(INT64_MAX)
+    static void segmentRange(const std::vector<int64_t>& split_points, size_t index, int64_t& start, int64_t& end) {
+        start = index == 0 ? INT64_MIN : split_points[index - 1];
+        end = index < split_points.size() ? split_points[index] : INT64_MAX;
+    }
+
+    // 各段的解码器/编码器按段数均分核心，避免每段都按全部核心开线程导致过度订阅
+    static int threadsPerSegment(int cores, size_t segment_count) {
+        return std::max(1, std::max(1, cores) / (int)std::max<size_t>(1, segment_count));
+    }
+};
+
+// 分段的解码帧筛选：只写入pts在[start, end)内的帧（start为INT64_MIN/end为INT64_MAX表示不限）。
+// 读到下一分段的起始关键帧时还不能停止送包：开放GOP里解码顺序排在它之后的前置B帧pts小于它，
+// 属于本段，而下一段从这个关键帧开始解码时缺少它们的参考帧。解码器按显示顺序输出，
+// 输出的pts达到end后本段的帧才算全部输出，finished()变为true。pts未知(no_ts)的帧照常写入
+class SegmentFrameFilter {
+public:
+    SegmentFrameFilter(int64_t start, int64_t end) : start(start), end(end), done(false) {}
+
+    bool accept(int64_t pts, int64_t no_ts) {
+        if (pts == no_ts) {
+            return true;
+        }
+        if (pts >= end) {
+            done = true;
+            return false;
+        }
+        return pts >= start;
+    }
+
+    bool finished() const {
+        return done;
+    }
+
+private:
+    int64_t start;
+    int64_t end;
+    bool done;
+};
+
+// 拼接时第i段的时间戳偏移（输出时间基准）。source_offset是该段首帧相对首段首帧的源时间偏移；
+// 各段独立编码，B帧重排使段内第一个包的dts比首帧pts早一个编码延迟（first_dts = pts - delay）。
+// 编码延迟与上一段不同时，按源偏移拼接的dts可能不大于上一段最后的dts：此时整段（pts和dts一起）
+// 后移到紧接上一段，保持段内的重排关系，不改写pts。first_dts/last_dts未知(no_ts)时按源偏移
+inline int64_t segmentTimestampOffset(int64_t source_offset, int64_t first_dts, int64_t last_dts, int64_t no_ts) {
+    if (first_dts == no_ts || last_dts == no_ts || first_dts + source_offset > last_dts) {
+        return source_offset;
+    }
+    return last_dts + 1 - first_dts;
+}
+
+#endif
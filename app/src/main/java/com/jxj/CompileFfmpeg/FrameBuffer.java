@@ -0,0 +1,31 @@
+package com.jxj.CompileFfmpeg;
+
+import java.nio.ByteBuffer;
+
+/**
+ * 导出给Java分析的解码帧 - 平面数据是native缓冲池上的direct ByteBuffer，
+ * 对象和缓冲区随槽位复用；处理完必须调用releaseFrame归还，否则槽位会耗尽
+ */
+public final class FrameBuffer {
+    public static final int FORMAT_I420 = 0;    // planes: Y, U, V
+    public static final int FORMAT_NV12 = 1;    // planes: Y, UV交错
+    public static final int FORMAT_NV21 = 2;    // planes: Y, VU交错
+
+    final int slot;                 // native槽位下标
+    public final int width;
+    public final int height;
+    public final int format;
+    public final ByteBuffer[] planes;
+    public final int[] strides;     // 每个平面的行字节数（紧密排列）
+    public long pts;                // 流时间基下的显示时间戳，未知时为Long.MIN_VALUE
+    public long sequence;           // 帧序号，递增
+
+    FrameBuffer(int slot, int width, int height, int format, ByteBuffer[] planes, int[] strides) {
+        this.slot = slot;
+        this.width = width;
+        this.height = height;
+        this.format = format;
+        this.planes = planes;
+        this.strides = strides;
+    }
+}
@@ -29,6 +29,7 @@ import android.view.Surface;
 import com.jxj.CompileFfmpeg.databinding.ActivityMainBinding;
 
 import java.io.File;
+import java.nio.ByteBuffer;
 import java.util.Date;
 import java.util.concurrent.ExecutorService;
 import java.util.concurrent.Executors;
@@ -65,6 +66,11 @@ public class MainActivity extends AppCompatActivity {
     private ActivityMainBinding binding;
     private static final int PERMISSION_REQUEST_CODE = 1;
     private static final int MANAGE_EXTERNAL_STORAGE_REQUEST_CODE = 2;
+
+    // RTP传输方式（setRtpTransport）
+    public static final int RTP_TRANSPORT_TCP = 0;
+    public static final int RTP_TRANSPORT_UDP = 1;
+    public static final int RTP_TRANSPORT_UDP_MULTICAST = 2;
     
     // UI 组件
     private EditText etRtspUrl;
@@ -336,9 +342,13 @@ public class MainActivity extends AppCompatActivity {
     private void setupUI() {
         TextView tv = binding.sampleText;
         
-        // 显示基本信息和FFmpeg版本
-        String info = stringFromJNI() + "\n\n" + getFFmpegVersion();
-        tv.setText(info);
+        // 显示基本信息；FFmpeg在后台加载，完成后再补上版本号
+        String basicInfo = stringFromJNI();
+        tv.setText(basicInfo);
+        executorService.execute(() -> {
+            String version = getFFmpegVersion();
+            runOnUiThread(() -> tv.setText(basicInfo + "\n\n" + version));
+        });
         
         // 设置按钮点击事件
         btnConnect.setOnClickListener(v -> connectToRtsp());
@@ -496,6 +506,15 @@ public class MainActivity extends AppCompatActivity {
                 } else {
                     failedFrames++;
                     
+                    // 读超时看门狗判定卡死时不再重试
+                    if (rtspPlayer.isStreamStalled()) {
+                        runOnUiThread(() -> {
+                            logMessage("⏱️ 流已卡死（读超时），停止测试");
+                            stopLatencyTest();
+                        });
+                        break;
+                    }
+                    
                     // 连续失败处理
                     if (failedFrames > 10) {
                         runOnUiThread(() -> {
@@ -896,10 +915,77 @@ public class MainActivity extends AppCompatActivity {
     public native String getVideoInfo(String path);
     
     /**
-     * 转换视频文件
+     * 获取结构化的视频文件信息（只解析容器头部，结果按路径+修改时间+大小缓存）
+     * @return 视频信息，文件无法识别时返回null
+     */
+    public native VideoInfo getVideoInfoDetails(String path);
+    
+    /**
+     * 并行批量获取视频信息（有界工作线程池），阻塞直到全部完成，结果逐个通过回调返回
+     * 回调抛出异常会取消剩余扫描，请在后台线程调用
+     * @return 成功识别的文件数
+     */
+    public native int scanVideos(String[] paths, VideoInfo.ScanCallback callback);
+    
+    /**
+     * 转换视频文件为MP4（保持源尺寸，能流复制时不重编码）
      */
     public native boolean convertVideo(String inputPath, String outputPath);
     
+    /**
+     * 转码进度回调，在调用转码的线程上执行
+     */
+    public interface ConvertProgressListener {
+        /**
+         * @param processedMs 已处理的媒体时长
+         * @param durationMs 媒体总时长，未知时为0
+         * @return 返回false取消转码（不完整的输出文件会被删除）
+         */
+        boolean onProgress(long processedMs, long durationMs);
+    }
+    
+    /**
+     * 转码视频文件为MP4：尺寸不变且源编码为H.264/HEVC时直接流复制，否则解码-缩放-编码
+     * @param width 输出宽度，0表示保持源尺寸
+     * @param height 输出高度，0表示保持源尺寸
+     * @param listener 进度回调，可为null
+     * @return 是否成功（取消也返回false）
+     */
+    public native boolean convertVideoWithProgress(String inputPath, String outputPath, int width, int height,
+                                                   ConvertProgressListener listener);
+    
+    /**
+     * 设置转码并行度：大于1时，需要重编码且足够长（每段至少10秒）的文件按关键帧分段并行转码后无损拼接
+     * @param workers 并行段数，1表示单链路转码，最大8
+     */
+    public native void setConvertWorkers(int workers);
+    
+    /**
+     * 提取预览缩略图条：在时长内均匀取count个点，只定位并解码关键帧，RGBA依次写入output
+     * @param width 缩略图宽度，高度按视频显示宽高比计算(偶数)
+     * @param output 调用方预分配的direct ByteBuffer，容量至少count*width*高度*4
+     * @return 成功时返回缩略图高度；缓冲区为null或容量不足时返回负的高度（按该高度分配后重试）；失败返回0
+     */
+    public native int extractThumbnails(String path, int count, int width, ByteBuffer output);
+    
+    /**
+     * 打开录制文件用于逐帧拖动，自动加载录制时生成的<文件>.idx定位索引（没有索引时使用容器自身的定位）
+     * @return 读取器句柄，失败返回0；使用完毕必须调用closeIndexedReader
+     */
+    public native long openIndexedReader(String path);
+    
+    /**
+     * 读取指定时间显示的帧（帧级精确），目标在当前GOP内且向后拖动时不重新定位
+     * @param output direct ByteBuffer，容量至少width*height*4，写入RGBA
+     * @return 实际帧的时间(ms)，失败返回-1
+     */
+    public native long readIndexedFrame(long handle, long timeMs, int width, int height, ByteBuffer output);
+    
+    /**
+     * 关闭逐帧读取器
+     */
+    public native void closeIndexedReader(long handle);
+    
     // RTSP相关的native方法
     /**
      * 打开RTSP视频流
@@ -928,18 +1014,167 @@ public class MainActivity extends AppCompatActivity {
      */
     public native boolean startRtspRecording(String outputPath);
     
+    /**
+     * 指定录制输出参数，默认（全部为0）继承直播流的尺寸、宽高比、帧率和颜色属性
+     * @param width 输出宽度，0表示继承（仅指定一边时保持宽高比）
+     * @param height 输出高度，0表示继承
+     * @param fps 输出帧率，0表示继承
+     */
+    public native void setRecordingOutputProfile(int width, int height, int fps);
+    
+    /**
+     * 设置录制编码参数，0或null表示按分辨率自动选择，下次开始录制时生效
+     * @param bitrateKbps 目标码率(kbps)
+     * @param rateControl 码率控制：0=自动 1=CBR 2=VBR 3=CRF（硬件编码器不支持CRF时降级为VBR）
+     * @param crf CRF质量(0-51)，仅CRF模式使用
+     * @param gopLength 关键帧间隔(帧)
+     * @param intraRefresh 是否使用周期帧内刷新代替IDR
+     * @param slices 每帧slice数
+     * @param preset x264预设（ultrafast..placebo），空字符串表示自动；未知名称返回false
+     * @return 参数是否有效
+     */
+    public native boolean setRecordingEncoderConfig(int bitrateKbps, int rateControl, int crf, int gopLength,
+                                                    boolean intraRefresh, int slices, String preset);
+    
     /**
      * 停止录制RTSP流
      * @return 是否成功停止录制
      */
     public native boolean stopRtspRecording();
     
+    /**
+     * 配置预录（时移）环形缓冲区，需在打开流之前或播放中调用
+     * @param maxBytes 缓冲区最大字节数，0表示禁用
+     * @param maxDurationMs 缓冲的最大时长（毫秒）
+     * @return 预录录制进行中时拒绝修改并返回false
+     */
+    public native boolean setPreEventBuffer(int maxBytes, int maxDurationMs);
+    
+    /**
+     * 告警触发录制：先写出预录缓冲区中的GOP，再继续录制实时流（不重编码）
+     * 使用stopRtspRecording结束
+     * @param outputPath 输出文件路径
+     * @return 是否成功触发
+     */
+    public native boolean triggerEventRecording(String outputPath);
+    
     /**
      * 处理RTSP帧数据（需要循环调用）
      * @return 是否成功处理帧数据
      */
     public native boolean processRtspFrame();
-    
+
+    /**
+     * 开启/关闭音频播放（OpenSL ES低延迟输出，以视频时钟为主时钟，滞后的音频直接丢弃）
+     * @param enabled 是否播放音频
+     */
+    public native void setAudioPlaybackEnabled(boolean enabled);
+
+    /**
+     * 启用RTP直通快速路径：自行完成RTSP会话并解包H.264/HEVC，整帧直接送入解码器
+     * 下次openRtspStream时生效；该路径不含音频，建立失败时自动回退到libavformat
+     */
+    public native void setRtpDirectEnabled(boolean enabled);
+
+    /**
+     * 选择RTP传输方式，下次openRtspStream时生效；UDP/组播建立失败或收不到数据时自动回退到TCP
+     * 组播接收需要应用持有WifiManager.MulticastLock
+     * @param transport RTP_TRANSPORT_TCP / RTP_TRANSPORT_UDP / RTP_TRANSPORT_UDP_MULTICAST
+     * @param reorderPackets UDP重排窗口最多暂存的包数（0-64，0表示到达即交付）
+     * @param reorderMs 缺包时最多等待的毫秒数（0-200）
+     * @param recvBufferKb UDP套接字接收缓冲区大小（64-8192KB）
+     */
+    public native void setRtpTransport(int transport, int reorderPackets, int reorderMs, int recvBufferKb);
+
+    /**
+     * 设置读超时期限（毫秒，0表示不限时），下次openRtspStream时生效
+     * 超时后processRtspFrame返回false且isStreamStalled()为true；closeRtspStream总会立即中止阻塞的读取
+     * @param connectMs 建立会话（含探测流信息），每种传输方式单独计时
+     * @param firstFrameMs 建立后读到第一个视频包
+     * @param readStallMs 之后相邻两个视频包的最大间隔（音频仍在到达也算视频卡死）
+     */
+    public native void setStreamDeadlines(int connectMs, int firstFrameMs, int readStallMs);
+
+    /**
+     * 最近一次读包是否因超时被看门狗中断（流卡死，可重新打开）
+     */
+    public native boolean isStreamStalled();
+
+    /**
+     * 启动native帧处理线程（代替Java线程循环调用processRtspFrame，closeRtspStream时自动停止）
+     * @return 是否启动成功；流未打开或已在运行时返回false
+     */
+    public native boolean startNativePipeline();
+
+    /**
+     * 停止native帧处理线程（等待当前一帧处理完成）
+     */
+    public native void stopNativePipeline();
+
+    /**
+     * 阻塞到native帧处理线程退出（流结束、读超时或stopNativePipeline），不要在UI线程调用
+     */
+    public native void waitNativePipeline();
+
+    /**
+     * @return native帧处理线程是否在运行（流结束或读取失败后自动变为false）
+     */
+    public native boolean isNativePipelineRunning();
+
+    /**
+     * 设置流水线线程的调度策略，运行中的线程在下一帧生效，录制线程使用相同的nice和绑核（不使用实时调度）
+     * @param niceValue -20到19，越小优先级越高；-8相当于THREAD_PRIORITY_URGENT_DISPLAY
+     * @param cpuMask 允许运行的CPU位掩码（第n位对应CPU n），0表示不绑核
+     * @param realtime 是否尝试SCHED_FIFO，无权限时退回niceValue
+     */
+    public native void setPipelineThreadPolicy(int niceValue, int cpuMask, boolean realtime);
+
+    /**
+     * 开始记录流水线时间线（读包、解码送帧/取帧、颜色转换、窗口lock/post、编码、封装写入），会清空上一次的记录
+     */
+    public native void startPipelineTrace();
+
+    /**
+     * 停止记录并写出Chrome trace JSON，可用chrome://tracing或ui.perfetto.dev打开
+     * @param outputPath 输出文件路径
+     * @return 是否写出成功
+     */
+    public native boolean stopPipelineTrace(String outputPath);
+
+    /**
+     * 截图完成回调，在native截图线程上执行
+     */
+    public interface SnapshotCallback {
+        /**
+         * @param path 图片路径
+         * @param success 是否成功写入
+         * @param elapsedMs 从请求到写入文件的耗时
+         */
+        void onSnapshot(String path, boolean success, long elapsedMs);
+    }
+
+    /**
+     * 异步截取当前播放画面（只引用最新解码帧，转换和编码在后台线程完成，不影响播放）
+     * @param outputPath 图片输出路径
+     * @param format 0=JPEG，1=PNG
+     * @param quality JPEG质量1-100，PNG忽略
+     * @param callback 完成回调，可为null
+     * @return 是否已提交；没有可用帧或上一张截图仍在处理时返回false
+     */
+    public native boolean captureSnapshot(String outputPath, int format, int quality, SnapshotCallback callback);
+
+    /**
+     * 取出最新解码帧供Java分析（平面为native缓冲池上的direct ByteBuffer，对象随槽位复用，不产生Java分配）
+     * 只支持软件解码或MediaCodec ByteBuffer输出；Surface输出模式下没有CPU数据，返回null
+     * @return 帧数据；没有新帧或缓冲池槽位都未归还时返回null
+     */
+    public native FrameBuffer acquireFrame();
+
+    /**
+     * 归还acquireFrame取得的帧，归还后不得再访问其planes
+     */
+    public native void releaseFrame(FrameBuffer frame);
+
     /**
      * 关闭RTSP流
      */
@@ -1000,11 +1235,18 @@ public class MainActivity extends AppCompatActivity {
     public native void flushBuffers();
     
     /**
-     * 设置视频输出的Surface
+     * 设置视频输出的Surface（立即返回，渲染线程在下一帧切换；传null时等待正在渲染的一帧结束后返回）
      * @param surface Surface对象，用于显示视频
      */
     public native void setSurface(Surface surface);
     
+    /**
+     * 设置Surface的实际尺寸，软件渲染直接缩放到该尺寸并保持宽高比（黑边填充）
+     * @param width Surface宽度
+     * @param height Surface高度
+     */
+    public native void setSurfaceSize(int width, int height);
+    
     // 移除Activity生命周期native方法 - 改为纯Surface状态管理
 
 }
\ No newline at end of file
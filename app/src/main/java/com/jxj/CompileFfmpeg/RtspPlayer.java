@@ -21,6 +21,7 @@ public class RtspPlayer implements SurfaceHolder.Callback {
     private boolean isPlaying = false;
     private boolean isRecording = false;
     private FrameProcessTask frameTask;
+    private boolean nativePipeline = false;
     private Surface surface;
     private int videoWidth = 0;
     private int videoHeight = 0;
@@ -50,6 +51,14 @@ public class RtspPlayer implements SurfaceHolder.Callback {
     public void setListener(RtspPlayerListener listener) {
         this.listener = listener;
     }
+    
+    /**
+     * 使用native线程处理帧（线程优先级/绑核见MainActivity.setPipelineThreadPolicy），
+     * 该模式下不回调onFrameProcessed；需在openStream之前设置
+     */
+    public void setNativePipelineEnabled(boolean enabled) {
+        this.nativePipeline = enabled;
+    }
 
     public void setSurfaceView(SurfaceView surfaceView) {
         if (surfaceView != null) {
@@ -64,12 +73,9 @@ public class RtspPlayer implements SurfaceHolder.Callback {
     public void surfaceCreated(SurfaceHolder holder) {
         this.surface = holder.getSurface();
         
+        // native层在下一帧开始时接管新Surface，无需延迟设置
         if (mainActivity != null && surface != null && surface.isValid()) {
-            new Handler(Looper.getMainLooper()).postDelayed(() -> {
-                if (surface != null && surface.isValid()) {
-                    mainActivity.setSurface(surface);
-                }
-            }, 50);
+            mainActivity.setSurface(surface);
         }
     }
 
@@ -77,6 +83,11 @@ public class RtspPlayer implements SurfaceHolder.Callback {
     public void surfaceChanged(SurfaceHolder holder, int format, int width, int height) {
         Surface newSurface = holder.getSurface();
         
+        // 渲染按Surface实际尺寸输出，缩放在native颜色转换中一并完成
+        if (mainActivity != null) {
+            mainActivity.setSurfaceSize(width, height);
+        }
+        
         if (newSurface != this.surface) {
             this.surface = newSurface;
             if (mainActivity != null && surface != null && surface.isValid()) {
@@ -217,6 +228,36 @@ public class RtspPlayer implements SurfaceHolder.Callback {
         }).start();
     }
     
+    /**
+     * 告警触发录制 - 保存预录缓冲区中的最近数据并继续录制
+     */
+    public void triggerEventRecording(String outputPath) {
+        if (!isPlaying || isRecording) {
+            return;
+        }
+        
+        java.io.File parentDir = new java.io.File(outputPath).getParentFile();
+        if (parentDir != null && !parentDir.exists()) {
+            parentDir.mkdirs();
+        }
+        
+        new Thread(() -> {
+            boolean success = mainActivity != null && mainActivity.triggerEventRecording(outputPath);
+            Log.i(TAG, "🚨 triggerEventRecording结果: " + success);
+            
+            mainHandler.post(() -> {
+                if (success) {
+                    isRecording = true;
+                    if (listener != null) {
+                        listener.onRecordingStarted();
+                    }
+                } else if (listener != null) {
+                    listener.onError("预录录制触发失败");
+                }
+            });
+        }).start();
+    }
+    
     public void stopRecording() {
         Log.d(TAG, "🔧 stopRecording 被调用，当前状态: " + isRecording);
         
@@ -301,14 +342,22 @@ public class RtspPlayer implements SurfaceHolder.Callback {
             frameTask.cancel(true);
         }
         
-        frameTask = new FrameProcessTask();
-        frameTask.execute();
+        // native线程模式下任务只等待线程退出，结束时同样回调onError
+        boolean nativeRunning = nativePipeline && mainActivity != null && mainActivity.startNativePipeline();
+        frameTask = new FrameProcessTask(nativeRunning);
+        if (nativeRunning) {
+            // 等待期间不能占住串行执行器，否则closeStream的后台任务排在其后，无法停止native线程
+            frameTask.executeOnExecutor(AsyncTask.THREAD_POOL_EXECUTOR);
+        } else {
+            frameTask.execute();
+        }
     }
     
     /**
      * 停止帧处理循环
      */
     private void stopFrameProcessing() {
+        // native处理线程由closeRtspStream在后台线程中停止，避免在UI线程等待网络读取返回
         if (frameTask != null) {
             frameTask.cancel(true);
             frameTask = null;
@@ -319,8 +368,18 @@ public class RtspPlayer implements SurfaceHolder.Callback {
      * 帧处理异步任务
      */
     private class FrameProcessTask extends AsyncTask<Void, Void, Void> {
+        private final boolean waitNative;
+        
+        FrameProcessTask(boolean waitNative) {
+            this.waitNative = waitNative;
+        }
+        
         @Override
         protected Void doInBackground(Void... voids) {
+            if (waitNative) {
+                mainActivity.waitNativePipeline();
+                return null;
+            }
             while (isPlaying && !isCancelled()) {
                 try {
                     boolean success = mainActivity != null ? mainActivity.processRtspFrame() : false;
@@ -349,7 +408,7 @@ public class RtspPlayer implements SurfaceHolder.Callback {
         @Override
         protected void onPostExecute(Void aVoid) {
             if (listener != null && isPlaying) {
-                listener.onError("RTSP流处理结束");
+                listener.onError(isStreamStalled() ? "RTSP流卡死（读超时）" : "RTSP流处理结束");
             }
         }
     }
@@ -377,6 +436,11 @@ public class RtspPlayer implements SurfaceHolder.Callback {
         return mainActivity != null ? mainActivity.processRtspFrame() : false;
     }
     
+    // processRtspFrame返回false后查询：是否因读超时判定为卡死
+    public boolean isStreamStalled() {
+        return mainActivity != null && mainActivity.isStreamStalled();
+    }
+    
     private boolean writeBasicMp4Header(java.io.File file) {
         try (java.io.FileOutputStream fos = new java.io.FileOutputStream(file)) {
             writeFtypBox(fos);
@@ -0,0 +1,59 @@
+package com.jxj.CompileFfmpeg;
+
+/**
+ * 视频文件元数据 - 由native层优先解析容器头部得到（MP4 moov / Matroska Info+Tracks），
+ * 不解码任何帧；结果按路径+修改时间+大小缓存
+ */
+public class VideoInfo {
+    /**
+     * 批量扫描回调，在调用scanVideos的线程上按完成顺序执行
+     */
+    public interface ScanCallback {
+        /**
+         * @param index 文件在输入数组中的下标
+         * @param info 视频信息，无法识别时为null
+         */
+        void onVideoScanned(int index, VideoInfo info);
+    }
+
+    public final String path;
+    public final String container;      // 容器格式，例如mp4、mov、matroska、webm
+    public final long durationMs;
+    public final long bitRate;          // 整体码率(bps)
+    public final int width;
+    public final int height;
+    public final double frameRate;      // 平均帧率，未知时为0
+    public final String videoCodec;     // 无视频流时为空字符串
+    public final String audioCodec;     // 无音频流时为空字符串
+    public final int sampleRate;
+    public final int channels;
+    public final int streamCount;
+    public final boolean headerOnly;    // true表示仅由容器头部得出，false表示回退到完整探测
+
+    public VideoInfo(String path, String container, long durationMs, long bitRate,
+                     int width, int height, double frameRate,
+                     String videoCodec, String audioCodec, int sampleRate, int channels,
+                     int streamCount, boolean headerOnly) {
+        this.path = path;
+        this.container = container;
+        this.durationMs = durationMs;
+        this.bitRate = bitRate;
+        this.width = width;
+        this.height = height;
+        this.frameRate = frameRate;
+        this.videoCodec = videoCodec;
+        this.audioCodec = audioCodec;
+        this.sampleRate = sampleRate;
+        this.channels = channels;
+        this.streamCount = streamCount;
+        this.headerOnly = headerOnly;
+    }
+
+    public boolean hasVideo() {
+        return videoCodec != null && !videoCodec.isEmpty();
+    }
+
+    public boolean hasAudio() {
+        return audioCodec != null && !audioCodec.isEmpty();
+    }
+}
@@ -0,0 +1,84 @@
+// 日志调用线程开销：直接同步写（原先__android_log_print的方式）与异步队列对比。
+// 主机上输出重定向到/dev/null，每次同步写仍是一次write系统调用；设备上写logd套接字更慢，
+// 所以这里的同步基线偏乐观
+#include "async_logger.h"
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+namespace {
+
+const char* const kFormat = "🎬 帧%d解码完成: 耗时%.2fms, pts=%lld, 队列=%d";
+
+void BM_DirectWrite(benchmark::State& state) {
+    int frame = 0;
+    for (auto _ : state) {
+        char text[240];
+        snprintf(text, sizeof(text), kFormat, frame, 3.25, (long long)frame * 3000, 2);
+        fprintf(stderr, "I/%s: %s\n", LOG_TAG, text);
+        frame++;
+    }
+}
+BENCHMARK(BM_DirectWrite);
+
+// 每写半个队列暂停计时让后台线程排空，测的是入队（格式化+发布）而不是队列满时的丢弃
+void BM_AsyncInfo(benchmark::State& state) {
+    int frame = 0;
+    for (auto _ : state) {
+        LOGI(kFormat, frame, 3.25, (long long)frame * 3000, 2);
+        if (++frame % 256 == 0) {
+            state.PauseTiming();
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            state.ResumeTiming();
+        }
+    }
+}
+BENCHMARK(BM_AsyncInfo);
+
+// 持续写入快于后台输出：队列满后调用线程只计数丢弃，不阻塞
+void BM_AsyncInfoSaturated(benchmark::State& state) {
+    int frame = 0;
+    for (auto _ : state) {
+        LOGI(kFormat, frame, 3.25, (long long)frame * 3000, 2);
+        frame++;
+    }
+}
+BENCHMARK(BM_AsyncInfoSaturated);
+
+// 限频调用点被抑制时的开销（每帧日志的常见写法）
+void BM_AsyncInfoRateLimited(benchmark::State& state) {
+    int frame = 0;
+    for (auto _ : state) {
+        LOGI_EVERY(1000, kFormat, frame, 3.25, (long long)frame * 3000, 2);
+        frame++;
+    }
+}
+BENCHMARK(BM_AsyncInfoRateLimited);
+
+// 错误日志同步输出，开销应与直接写相当
+void BM_SyncError(benchmark::State& state) {
+    int frame = 0;
+    for (auto _ : state) {
+        LOGE(kFormat, frame, 3.25, (long long)frame * 3000, 2);
+        frame++;
+    }
+}
+BENCHMARK(BM_SyncError);
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (!freopen("/dev/null", "w", stderr)) {
+        return 1;
+    }
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include "async_logger.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace {
+
+bool isValidUtf8(const std::string& s) {
+    size_t i = 0;
+    while (i < s.size()) {
+        unsigned char c = (unsigned char)s[i];
+        size_t len = c < 0x80 ? 1 : (c & 0xE0) == 0xC0 ? 2 : (c & 0xF0) == 0xE0 ? 3 : (c & 0xF8) == 0xF0 ? 4 : 0;
+        if (len == 0 || i + len > s.size()) {
+            return false;
+        }
+        for (size_t k = 1; k < len; k++) {
+            if (((unsigned char)s[i + k] & 0xC0) != 0x80) {
+                return false;
+            }
+        }
+        i += len;
+    }
+    return true;
+}
+
+// 捕获一次同步输出，去掉"E/TAG: "前缀和换行
+std::string logLine(const std::string& captured) {
+    std::string prefix = std::string("E/") + LOG_TAG + ": ";
+    size_t start = captured.find(prefix);
+    if (start == std::string::npos) {
+        return std::string();
+    }
+    start += prefix.size();
+    size_t end = captured.find('\n', start);
+    return captured.substr(start, end == std::string::npos ? std::string::npos : end - start);
+}
+
+}  // namespace
+
+TEST(Utf8BoundaryTest, AsciiIsUnchanged) {
+    const char* text = "abcdef";
+    EXPECT_EQ(0u, utf8BoundaryLength(text, 0));
+    EXPECT_EQ(3u, utf8BoundaryLength(text, 3));
+    EXPECT_EQ(6u, utf8BoundaryLength(text, 6));
+}
+
+TEST(Utf8BoundaryTest, ThreeByteCharacterIsNotSplit) {
+    const char* text = "a\xE4\xB8\xAD" "b";     // "a中b"
+    EXPECT_EQ(1u, utf8BoundaryLength(text, 1));
+    EXPECT_EQ(1u, utf8BoundaryLength(text, 2));
+    EXPECT_EQ(1u, utf8BoundaryLength(text, 3));
+    EXPECT_EQ(4u, utf8BoundaryLength(text, 4));
+    EXPECT_EQ(5u, utf8BoundaryLength(text, 5));
+}
+
+TEST(Utf8BoundaryTest, FourByteEmojiIsNotSplit) {
+    const char* text = "ab\xF0\x9F\x8E\xAC";    // "ab🎬"
+    EXPECT_EQ(2u, utf8BoundaryLength(text, 3));
+    EXPECT_EQ(2u, utf8BoundaryLength(text, 4));
+    EXPECT_EQ(2u, utf8BoundaryLength(text, 5));
+    EXPECT_EQ(6u, utf8BoundaryLength(text, 6));
+}
+
+TEST(Utf8BoundaryTest, TwoByteCharacterIsNotSplit) {
+    const char* text = "\xC3\xA9\xC3\xA9";      // "éé"
+    EXPECT_EQ(0u, utf8BoundaryLength(text, 1));
+    EXPECT_EQ(2u, utf8BoundaryLength(text, 2));
+    EXPECT_EQ(2u, utf8BoundaryLength(text, 3));
+    EXPECT_EQ(4u, utf8BoundaryLength(text, 4));
+}
+
+TEST(Utf8BoundaryTest, InvalidSequencesAreLeftAlone) {
+    const char* stray = "\x80\x80";                 // 没有首字节
+    EXPECT_EQ(2u, utf8BoundaryLength(stray, 2));
+    const char* too_long = "a\x80\x80\x80\x80";     // 超过3个后续字节
+    EXPECT_EQ(5u, utf8BoundaryLength(too_long, 5));
+}
+
+TEST(AsyncLoggerTest, ErrorIsWrittenBeforeWriteReturns) {
+    testing::internal::CaptureStderr();
+    AsyncLogger::getInstance().write(ANDROID_LOG_ERROR, "解码失败: %d", -11);
+    std::string captured = testing::internal::GetCapturedStderr();
+    EXPECT_EQ("解码失败: -11", logLine(captured));
+}
+
+TEST(AsyncLoggerTest, FatalIsWrittenBeforeWriteReturns) {
+    testing::internal::CaptureStderr();
+    AsyncLogger::getInstance().write(ANDROID_LOG_FATAL, "fatal %s", "abort");
+    std::string captured = testing::internal::GetCapturedStderr();
+    EXPECT_NE(std::string::npos, captured.find("F/" LOG_TAG ": fatal abort"));
+}
+
+TEST(AsyncLoggerTest, LongErrorIsTruncatedOnCharacterBoundary) {
+    std::string message = "a";
+    for (int i = 0; i < 600; i++) {
+        message += "\xE4\xB8\xAD";      // 1 + 3*600字节，截断点落在字符中间
+    }
+    testing::internal::CaptureStderr();
+    AsyncLogger::getInstance().write(ANDROID_LOG_ERROR, "%s", message.c_str());
+    std::string line = logLine(testing::internal::GetCapturedStderr());
+    EXPECT_FALSE(line.empty());
+    EXPECT_LT(line.size(), message.size());
+    EXPECT_EQ(0u, (line.size() - 1) % 3);
+    EXPECT_TRUE(isValidUtf8(line));
+    EXPECT_EQ(0, message.compare(0, line.size(), line));
+}
@@ -0,0 +1,184 @@
+#include "audio_sync.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace {
+
+// HE-AAC（SBR + PS）：容器里的AudioSpecificConfig是22050Hz单声道核心层，
+// 解码输出44100Hz立体声，每帧2048个采样
+const int kContainerRate = 22050;
+const int kContainerChannels = 1;
+const int kDecodedRate = 44100;
+const int kDecodedChannels = 2;
+const int kFrameSamples = 2048;
+const int kVideoFps = 30;
+const int kSeconds = 10;
+const int64_t kMissing = AudioSyncPolicy::kNoTimestamp;
+const int64_t kRoundingUs = 1;      // 采样数换算成整数微秒的舍入
+
+int64_t samplesToUs(int64_t samples, int rate) {
+    return samples * 1000000 / rate;
+}
+
+// 直播场景的音画偏移模拟：第f个音频包在采集后delay(f)微秒到达，视频帧按采集时刻显示
+// （视频是主时钟）。每秒一个同步标记：视频第k*30帧，音频第k*44100个采样。
+// 输出队列按播放器格式的采样率消耗缓冲，缓冲播完时releaseBuffer，与OpenSL回调相同
+class MarkerSimulation {
+public:
+    typedef int64_t (*ArrivalDelay)(int frame);
+
+    // 第k秒标记的音画偏移（音频晚于视频为正），标记所在帧被丢弃时为kNoTimestamp
+    std::vector<int64_t> offsets_us;
+
+    MarkerSimulation(const AudioOutputFormat& player, ArrivalDelay delay) : player(player), delay(delay) {
+        int frames = (int)((int64_t)kSeconds * kDecodedRate / kFrameSamples);
+        std::vector<int64_t> start_us(frames, kMissing);
+        std::deque<int64_t> playing_until;
+        int64_t player_end_us = 0;
+        for (int f = 0; f < frames; f++) {
+            int64_t pts_us = samplesToUs((int64_t)f * kFrameSamples, kDecodedRate);
+            int64_t now_us = pts_us + delay(f);
+            while (!playing_until.empty() && playing_until.front() <= now_us) {
+                playing_until.pop_front();
+                sync.releaseBuffer();
+            }
+            int64_t video_clock_us = now_us / (1000000 / kVideoFps) * (1000000 / kVideoFps);
+            if (!sync.acceptPacket(pts_us, video_clock_us) || !sync.acquireBuffer()) {
+                continue;
+            }
+            start_us[f] = std::max(now_us, player_end_us);
+            // 播放器按自己的采样率消耗这一帧的采样
+            player_end_us = start_us[f] + samplesToUs(kFrameSamples, player.sample_rate);
+            playing_until.push_back(player_end_us);
+        }
+        for (int k = 1; k < kSeconds; k++) {
+            int64_t sample = (int64_t)k * kDecodedRate;
+            int f = (int)(sample / kFrameSamples);
+            if (start_us[f] == kMissing) {
+                offsets_us.push_back(kMissing);
+                continue;
+            }
+            int64_t audio_us = start_us[f] + samplesToUs(sample - (int64_t)f * kFrameSamples, player.sample_rate);
+            offsets_us.push_back(audio_us - k * 1000000);
+        }
+    }
+
+    AudioSyncPolicy sync;
+
+private:
+    AudioOutputFormat player;
+    ArrivalDelay delay;
+};
+
+int64_t noDelay(int) {
+    return 0;
+}
+
+// 网络抖动：包成批到达，每批最多晚40ms
+int64_t burstyDelay(int frame) {
+    return (int64_t)(frame % 4) * 10000 + ((frame * 7919) % 5) * 2000;
+}
+
+// 0.9秒到1.3秒的音频（含第1秒的标记）在1.5秒时才成批到达
+int64_t stalledDelay(int frame) {
+    int64_t pts_us = samplesToUs((int64_t)frame * kFrameSamples, kDecodedRate);
+    if (pts_us >= 900000 && pts_us < 1300000) {
+        return 1500000 - pts_us;
+    }
+    return 0;
+}
+
+// 音频最多超前入队kMaxQueuedBuffers帧，加上到达抖动
+const int64_t kMaxOffsetUs = AudioSyncPolicy::kMaxQueuedBuffers * samplesToUs(kFrameSamples, kDecodedRate) + 40000;
+
+AudioOutputFormat decodedFormat() {
+    return audioOutputFormat(kDecodedRate, kDecodedChannels);
+}
+
+TEST(AudioSyncTest, OutputFormatComesFromDecodedFrame) {
+    AudioOutputFormat container = audioOutputFormat(kContainerRate, kContainerChannels);
+    AudioOutputFormat decoded = decodedFormat();
+    EXPECT_NE(container, decoded);
+    EXPECT_EQ(decoded.sample_rate, kDecodedRate);
+    EXPECT_EQ(decoded.channels, 2);
+    EXPECT_EQ(audioOutputFormat(48000, 6).channels, 2);
+    EXPECT_EQ(audioOutputFormat(48000, 0).channels, 1);
+}
+
+TEST(AudioSyncTest, MarkersStayAlignedWithDecodedFormat) {
+    MarkerSimulation sim(decodedFormat(), noDelay);
+    ASSERT_EQ(sim.offsets_us.size(), (size_t)kSeconds - 1);
+    for (size_t k = 0; k < sim.offsets_us.size(); k++) {
+        EXPECT_NE(sim.offsets_us[k], kMissing) << "marker " << k + 1;
+        EXPECT_GE(sim.offsets_us[k], -kRoundingUs) << "marker " << k + 1;
+        EXPECT_LE(sim.offsets_us[k], 1000) << "marker " << k + 1;
+    }
+    EXPECT_EQ(sim.sync.droppedFull(), 0);
+    EXPECT_EQ(sim.sync.droppedLate(), 0);
+}
+
+TEST(AudioSyncTest, MarkersStayBoundedUnderArrivalJitter) {
+    MarkerSimulation sim(decodedFormat(), burstyDelay);
+    for (size_t k = 0; k < sim.offsets_us.size(); k++) {
+        ASSERT_NE(sim.offsets_us[k], kMissing) << "marker " << k + 1;
+        EXPECT_GE(sim.offsets_us[k], -kRoundingUs) << "marker " << k + 1;
+        EXPECT_LE(sim.offsets_us[k], kMaxOffsetUs) << "marker " << k + 1;
+    }
+    // 不漂移：最后一个标记的偏移不比第一个大出一帧以上
+    EXPECT_LE(sim.offsets_us.back() - sim.offsets_us.front(), samplesToUs(kFrameSamples, kDecodedRate));
+}
+
+TEST(AudioSyncTest, ContainerFormatPlayerDrifts) {
+    // 按容器参数（22050Hz）创建播放器：每帧播放时间加倍，队列堆满后丢帧，标记错开或丢失
+    MarkerSimulation sim(audioOutputFormat(kContainerRate, kContainerChannels), noDelay);
+    EXPECT_GT(sim.sync.droppedFull(), 0);
+    int misaligned = 0;
+    for (size_t k = 0; k < sim.offsets_us.size(); k++) {
+        if (sim.offsets_us[k] == kMissing || sim.offsets_us[k] > kMaxOffsetUs) {
+            misaligned++;
+        }
+    }
+    EXPECT_GT(misaligned, 0);
+}
+
+TEST(AudioSyncTest, StalledAudioIsDroppedInsteadOfDelayed) {
+    MarkerSimulation sim(decodedFormat(), stalledDelay);
+    EXPECT_GT(sim.sync.droppedLate(), 0);
+    // 第1秒的标记随落后的包丢弃，之后的标记立即回到同步
+    EXPECT_EQ(sim.offsets_us[0], kMissing);
+    for (size_t k = 1; k < sim.offsets_us.size(); k++) {
+        ASSERT_NE(sim.offsets_us[k], kMissing) << "marker " << k + 1;
+        EXPECT_LE(sim.offsets_us[k], kMaxOffsetUs) << "marker " << k + 1;
+    }
+}
+
+TEST(AudioSyncTest, PacketWithoutTimestampIsAccepted) {
+    AudioSyncPolicy sync;
+    EXPECT_TRUE(sync.acceptPacket(kMissing, 5000000));
+    EXPECT_TRUE(sync.acceptPacket(0, kMissing));
+    EXPECT_TRUE(sync.acceptPacket(5000000 - 80000, 5000000));
+    EXPECT_FALSE(sync.acceptPacket(5000000 - 80001, 5000000));
+    EXPECT_EQ(sync.droppedLate(), 1);
+}
+
+TEST(AudioSyncTest, QueueHoldsAtMostMaxBuffers) {
+    AudioSyncPolicy sync;
+    for (int i = 0; i < AudioSyncPolicy::kMaxQueuedBuffers; i++) {
+        EXPECT_TRUE(sync.acquireBuffer());
+    }
+    EXPECT_FALSE(sync.acquireBuffer());
+    EXPECT_EQ(sync.droppedFull(), 1);
+    sync.releaseBuffer();
+    EXPECT_TRUE(sync.acquireBuffer());
+    sync.cancelBuffer();
+    EXPECT_EQ(sync.queued(), AudioSyncPolicy::kMaxQueuedBuffers - 1);
+    sync.reset();
+    EXPECT_EQ(sync.queued(), 0);
+}
+
+}  // namespace
@@ -0,0 +1,100 @@
+// 录制流水线模型：转换→编码→封装三级，每级用自旋模拟固定的CPU开销（微秒），
+// 对比单线程串行执行和三个线程经BoundedQueue串联的吞吐。
+// 流水线吞吐上限是最慢一级，需要至少3个空闲核心；单核主机上只能体现队列交接开销。
+// 这是模型，真实的sws + libx264 + MP4封装持续帧率见recording_pipeline_benchmark.cpp
+#include "bounded_queue.h"
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <thread>
+
+namespace {
+
+void spinUs(int us) {
+    auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(us);
+    while (std::chrono::steady_clock::now() < end) {
+    }
+}
+
+// 1080p软件录制的大致比例：转换 < 编码，封装最轻；按1/100缩放以缩短运行时间
+const int kConvertUs = 40;
+const int kEncodeUs = 100;
+const int kMuxUs = 10;
+const int kFrames = 200;
+
+void BM_SerialStages(benchmark::State& state) {
+    for (auto _ : state) {
+        for (int i = 0; i < kFrames; i++) {
+            spinUs(kConvertUs);
+            spinUs(kEncodeUs);
+            spinUs(kMuxUs);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kFrames);
+}
+BENCHMARK(BM_SerialStages)->UseRealTime();
+
+void BM_PipelinedStages(benchmark::State& state) {
+    const size_t capacity = (size_t)state.range(0);
+    for (auto _ : state) {
+        BoundedQueue<int> convert_queue(capacity);
+        BoundedQueue<int> encode_queue(capacity);
+        std::thread encode([&]() {
+            int frame = 0;
+            while (convert_queue.pop(frame)) {
+                spinUs(kEncodeUs);
+                encode_queue.push(frame);
+            }
+            encode_queue.close();
+        });
+        std::thread mux([&]() {
+            int frame = 0;
+            while (encode_queue.pop(frame)) {
+                spinUs(kMuxUs);
+            }
+        });
+        for (int i = 0; i < kFrames; i++) {
+            spinUs(kConvertUs);
+            convert_queue.push(i);
+        }
+        convert_queue.close();
+        encode.join();
+        mux.join();
+    }
+    state.SetItemsProcessed(state.iterations() * kFrames);
+}
+BENCHMARK(BM_PipelinedStages)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+// 单个元素经两级队列的交接开销（无计算）
+void BM_QueueHandoff(benchmark::State& state) {
+    const int kItems = 10000;
+    for (auto _ : state) {
+        BoundedQueue<int> first(8);
+        BoundedQueue<int> second(8);
+        std::thread relay([&]() {
+            int value = 0;
+            while (first.pop(value)) {
+                second.push(value);
+            }
+            second.close();
+        });
+        std::thread sink([&]() {
+            int value = 0;
+            while (second.pop(value)) {
+            }
+        });
+        for (int i = 0; i < kItems; i++) {
+            first.push(i);
+        }
+        first.close();
+        relay.join();
+        sink.join();
+    }
+    state.SetItemsProcessed(state.iterations() * kItems);
+}
+BENCHMARK(BM_QueueHandoff)->UseRealTime();
+
+}  // namespace
+
+BENCHMARK_MAIN();
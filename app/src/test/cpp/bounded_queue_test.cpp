@@ -0,0 +1,134 @@
+#include "bounded_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+TEST(BoundedQueueTest, PopsInFifoOrder) {
+    BoundedQueue<int> queue(4);
+    for (int i = 0; i < 4; i++) {
+        ASSERT_TRUE(queue.push(i));
+    }
+    EXPECT_EQ(4u, queue.size());
+    for (int i = 0; i < 4; i++) {
+        int value = -1;
+        ASSERT_TRUE(queue.pop(value));
+        EXPECT_EQ(i, value);
+    }
+}
+
+TEST(BoundedQueueTest, TryPushRespectsCapacity) {
+    BoundedQueue<int> queue(2);
+    EXPECT_TRUE(queue.tryPush(1));
+    EXPECT_TRUE(queue.tryPush(2));
+    EXPECT_FALSE(queue.tryPush(3));
+    int value = 0;
+    ASSERT_TRUE(queue.pop(value));
+    EXPECT_TRUE(queue.tryPush(3));
+}
+
+TEST(BoundedQueueTest, PushBlocksUntilSpaceIsFreed) {
+    BoundedQueue<int> queue(1);
+    ASSERT_TRUE(queue.push(1));
+    std::atomic<bool> pushed(false);
+    std::thread producer([&]() {
+        queue.push(2);
+        pushed.store(true);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(pushed.load());
+    int value = 0;
+    ASSERT_TRUE(queue.pop(value));
+    producer.join();
+    EXPECT_TRUE(pushed.load());
+    ASSERT_TRUE(queue.pop(value));
+    EXPECT_EQ(2, value);
+}
+
+TEST(BoundedQueueTest, CloseWakesBlockedProducerAndConsumer) {
+    BoundedQueue<int> full(1);
+    ASSERT_TRUE(full.push(1));
+    std::atomic<int> push_result(-1);
+    std::thread producer([&]() { push_result.store(full.push(2) ? 1 : 0); });
+
+    BoundedQueue<int> empty(1);
+    std::atomic<int> pop_result(-1);
+    std::thread consumer([&]() {
+        int value = 0;
+        pop_result.store(empty.pop(value) ? 1 : 0);
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    full.close();
+    empty.close();
+    producer.join();
+    consumer.join();
+    EXPECT_EQ(0, push_result.load());
+    EXPECT_EQ(0, pop_result.load());
+}
+
+TEST(BoundedQueueTest, ClosedQueueStillDrains) {
+    BoundedQueue<int> queue(4);
+    queue.push(1);
+    queue.push(2);
+    queue.close();
+    EXPECT_FALSE(queue.push(3));
+    EXPECT_FALSE(queue.tryPush(3));
+    int value = 0;
+    ASSERT_TRUE(queue.pop(value));
+    EXPECT_EQ(1, value);
+    ASSERT_TRUE(queue.pop(value));
+    EXPECT_EQ(2, value);
+    EXPECT_FALSE(queue.pop(value));
+
+    queue.reopen();
+    EXPECT_TRUE(queue.push(4));
+    ASSERT_TRUE(queue.pop(value));
+    EXPECT_EQ(4, value);
+}
+
+// 录制流水线的形态：多级串联，每级一个线程，关闭沿流水线向下传递
+TEST(BoundedQueueTest, ThreeStagePipelineDeliversEverythingInOrder) {
+    const int kItems = 20000;
+    BoundedQueue<int> convert_queue(4);
+    BoundedQueue<int> encode_queue(4);
+    BoundedQueue<int> mux_queue(4);
+
+    std::thread convert([&]() {
+        int value = 0;
+        while (convert_queue.pop(value)) {
+            encode_queue.push(value * 2);
+        }
+        encode_queue.close();
+    });
+    std::thread encode([&]() {
+        int value = 0;
+        while (encode_queue.pop(value)) {
+            mux_queue.push(value + 1);
+        }
+        mux_queue.close();
+    });
+    std::vector<int> muxed;
+    std::thread mux([&]() {
+        int value = 0;
+        while (mux_queue.pop(value)) {
+            muxed.push_back(value);
+        }
+    });
+
+    for (int i = 0; i < kItems; i++) {
+        ASSERT_TRUE(convert_queue.push(i));
+    }
+    convert_queue.close();
+    convert.join();
+    encode.join();
+    mux.join();
+
+    ASSERT_EQ((size_t)kItems, muxed.size());
+    for (int i = 0; i < kItems; i++) {
+        ASSERT_EQ(i * 2 + 1, muxed[i]);
+    }
+}
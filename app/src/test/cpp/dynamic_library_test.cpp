@@ -0,0 +1,100 @@
+#include "dynamic_library.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+#include "fake_library.h"
+
+// 与ffmpeg_wrapper.cpp的FFmpegApi相同的函数表写法：X宏列出函数，decltype取类型
+#define FAKE_FUNCTIONS(X) \
+    X(fake_add) \
+    X(fake_version_info) \
+    X(fake_init_count)
+
+namespace {
+
+struct FakeApi {
+#define FAKE_DECLARE_FUNCTION(name) decltype(&::name) name;
+    FAKE_FUNCTIONS(FAKE_DECLARE_FUNCTION)
+#undef FAKE_DECLARE_FUNCTION
+};
+
+struct ResolveFakeApi {
+    FakeApi* api;
+    int operator()(void* library) const {
+        int missing = 0;
+#define FAKE_RESOLVE_FUNCTION(name) \
+        missing += resolveDynamicSymbol(library, FFW_FAKE_LIBRARY_PATH, #name, api->name) ? 0 : 1;
+        FAKE_FUNCTIONS(FAKE_RESOLVE_FUNCTION)
+#undef FAKE_RESOLVE_FUNCTION
+        return missing;
+    }
+};
+
+// 多一个库中不存在的符号
+struct ResolveWithMissing {
+    FakeApi* api;
+    int operator()(void* library) const {
+        decltype(&::fake_not_exported) not_exported = nullptr;
+        int missing = ResolveFakeApi{api}(library);
+        missing += resolveDynamicSymbol(library, FFW_FAKE_LIBRARY_PATH, "fake_not_exported", not_exported) ? 0 : 1;
+        return missing;
+    }
+};
+
+bool isLoaded() {
+    void* handle = dlopen(FFW_FAKE_LIBRARY_PATH, RTLD_NOW | RTLD_NOLOAD);
+    if (handle) {
+        dlclose(handle);
+    }
+    return handle != nullptr;
+}
+
+}  // namespace
+
+// 测试程序对库没有链接期依赖：加载前库不在进程中
+TEST(DynamicLibraryTest, LibraryIsNotLoadedUntilRequested) {
+    EXPECT_FALSE(isLoaded());
+}
+
+TEST(DynamicLibraryTest, MissingLibraryFails) {
+    void* handle = reinterpret_cast<void*>(0x1);
+    FakeApi api;
+    memset(&api, 0, sizeof(api));
+    EXPECT_FALSE(loadDynamicLibrary("libffw_does_not_exist.so", handle, ResolveFakeApi{&api}));
+    EXPECT_EQ(nullptr, handle);
+    EXPECT_EQ(nullptr, api.fake_add);
+}
+
+TEST(DynamicLibraryTest, MissingSymbolUnloadsLibrary) {
+    void* handle = nullptr;
+    FakeApi api;
+    memset(&api, 0, sizeof(api));
+    EXPECT_FALSE(loadDynamicLibrary(FFW_FAKE_LIBRARY_PATH, handle, ResolveWithMissing{&api}));
+    EXPECT_EQ(nullptr, handle);
+    EXPECT_FALSE(isLoaded());
+}
+
+TEST(DynamicLibraryTest, ResolvesFunctionTableAndCallsThroughIt) {
+    void* handle = nullptr;
+    FakeApi api;
+    memset(&api, 0, sizeof(api));
+    ASSERT_TRUE(loadDynamicLibrary(FFW_FAKE_LIBRARY_PATH, handle, ResolveFakeApi{&api}));
+    ASSERT_NE(nullptr, handle);
+    EXPECT_TRUE(isLoaded());
+
+    EXPECT_EQ(5, api.fake_add(2, 3));
+    EXPECT_STREQ("fake-1.0", api.fake_version_info());
+    EXPECT_EQ(1, api.fake_init_count());
+
+    // 再次加载得到同一个库实例，初始化不重复
+    void* second = nullptr;
+    FakeApi again;
+    memset(&again, 0, sizeof(again));
+    ASSERT_TRUE(loadDynamicLibrary(FFW_FAKE_LIBRARY_PATH, second, ResolveFakeApi{&again}));
+    EXPECT_EQ(api.fake_add, again.fake_add);
+    EXPECT_EQ(1, again.fake_init_count());
+    dlclose(second);
+    dlclose(handle);
+}
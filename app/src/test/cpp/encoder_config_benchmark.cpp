@@ -0,0 +1,124 @@
+// 录制默认编码配置下软件H.264编码器的编码速度和码率准确度：合成画面（synthetic_video.h）5秒30fps，
+// 编码参数按applyEncoderConfig的软件编码器路径设置（fillDefaults的码率/GOP，level按码率上限选择，
+// ultrafast + zerolatency，无B帧）。fps为编码吞吐，bitrate_ratio为实际码率/目标码率。
+// 链接的FFmpeg没有某个编码器时该组参数报错跳过
+#include "encoder_config.h"
+#include "synthetic_video.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/opt.h>
+}
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+namespace {
+
+const char* const kEncoders[] = {"libx264", "libopenh264"};
+const int kFrameRate = 30;
+const int kFrames = 5 * kFrameRate;
+
+AVCodecContext* openEncoder(const AVCodec* codec, int width, int height, const EncoderConfig& config) {
+    AVCodecContext* ctx = avcodec_alloc_context3(codec);
+    if (!ctx) {
+        return nullptr;
+    }
+    ctx->width = width;
+    ctx->height = height;
+    ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+    ctx->time_base = AVRational{1, kFrameRate};
+    ctx->framerate = AVRational{kFrameRate, 1};
+    ctx->bit_rate = config.bitrate;
+    ctx->gop_size = config.gop_length;
+    ctx->max_b_frames = 0;
+    ctx->level = selectH264Level(width, height, kFrameRate, encoderPeakBitrate(config)).idc;
+    ctx->rc_max_rate = encoderPeakBitrate(config);
+    if (config.rate_control == RATE_CONTROL_CBR) {
+        ctx->rc_min_rate = config.bitrate;
+        ctx->rc_buffer_size = (int)(config.bitrate / 2);
+        av_opt_set(ctx->priv_data, "nal-hrd", "cbr", 0);
+    } else {
+        ctx->rc_buffer_size = (int)config.bitrate;
+    }
+    av_opt_set(ctx->priv_data, "preset", config.preset.c_str(), 0);
+    av_opt_set(ctx->priv_data, "tune", "zerolatency", 0);
+    if (avcodec_open2(ctx, codec, nullptr) < 0) {
+        avcodec_free_context(&ctx);
+    }
+    return ctx;
+}
+
+// 送入一帧（nullptr为冲刷）并累计输出字节数
+bool encode(AVCodecContext* ctx, AVFrame* frame, AVPacket* pkt, int64_t& bytes) {
+    if (avcodec_send_frame(ctx, frame) < 0) {
+        return false;
+    }
+    while (avcodec_receive_packet(ctx, pkt) >= 0) {
+        bytes += pkt->size;
+        av_packet_unref(pkt);
+    }
+    return true;
+}
+
+// 参数：编码器下标，高度（16:9），码率控制模式
+void BM_EncodeDefaultConfig(benchmark::State& state) {
+    const AVCodec* codec = avcodec_find_encoder_by_name(kEncoders[state.range(0)]);
+    if (!codec) {
+        state.SkipWithError("encoder not available in the linked FFmpeg");
+        return;
+    }
+    int height = (int)state.range(1);
+    int width = height * 16 / 9;
+    EncoderConfig config;
+    config.rate_control = (int)state.range(2);
+    config.fillDefaults(width, height, kFrameRate);
+
+    SyntheticVideo video(width, height);
+    AVFrame* frame = av_frame_alloc();
+    AVPacket* pkt = av_packet_alloc();
+    frame->format = AV_PIX_FMT_YUV420P;
+    frame->width = width;
+    frame->height = height;
+    if (av_frame_get_buffer(frame, 0) < 0) {
+        state.SkipWithError("frame allocation failed");
+        av_frame_free(&frame);
+        av_packet_free(&pkt);
+        return;
+    }
+
+    int64_t bytes = 0;
+    for (auto _ : state) {
+        AVCodecContext* ctx = openEncoder(codec, width, height, config);
+        if (!ctx) {
+            state.SkipWithError("avcodec_open2 failed");
+            break;
+        }
+        bytes = 0;
+        for (int i = 0; i < kFrames; i++) {
+            av_frame_make_writable(frame);
+            video.fill(frame, i);
+            frame->pts = i;
+            encode(ctx, frame, pkt, bytes);
+        }
+        encode(ctx, nullptr, pkt, bytes);
+        avcodec_free_context(&ctx);
+    }
+    av_frame_free(&frame);
+    av_packet_free(&pkt);
+
+    double seconds = (double)kFrames / kFrameRate;
+    state.counters["fps"] = benchmark::Counter((double)kFrames * state.iterations(), benchmark::Counter::kIsRate);
+    state.counters["target_mbps"] = config.bitrate / 1e6;
+    state.counters["bitrate_ratio"] = bytes * 8 / seconds / (double)config.bitrate;
+}
+BENCHMARK(BM_EncodeDefaultConfig)
+    ->ArgNames({"encoder", "height", "rc"})
+    ->ArgsProduct({{0, 1}, {720, 1080}, {RATE_CONTROL_CBR, RATE_CONTROL_VBR}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace
+
+BENCHMARK_MAIN();
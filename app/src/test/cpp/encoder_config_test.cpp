@@ -0,0 +1,155 @@
+#include "encoder_config.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace {
+
+EncoderConfig defaultsFor(int width, int height, double fps) {
+    EncoderConfig config;
+    config.fillDefaults(width, height, fps);
+    return config;
+}
+
+}  // namespace
+
+TEST(EncoderConfigTest, BitrateDefaultsFollowResolution) {
+    EXPECT_EQ(1500000, defaultsFor(640, 480, 30).bitrate);
+    EXPECT_EQ(3000000, defaultsFor(1280, 720, 30).bitrate);
+    EXPECT_EQ(6000000, defaultsFor(1920, 1080, 30).bitrate);
+    EXPECT_EQ(12000000, defaultsFor(3840, 2160, 30).bitrate);
+}
+
+TEST(EncoderConfigTest, BitrateScalesWithFrameRateDownToHalf) {
+    EXPECT_EQ(12000000, defaultsFor(1920, 1080, 60).bitrate);
+    EXPECT_EQ(3000000, defaultsFor(1920, 1080, 15).bitrate);
+    EXPECT_EQ(3000000, defaultsFor(1920, 1080, 5).bitrate);     // 不低于30fps基准的一半
+}
+
+TEST(EncoderConfigTest, UnknownFrameRateUsesThirtyFps) {
+    EncoderConfig config = defaultsFor(1920, 1080, 0);
+    EXPECT_EQ(6000000, config.bitrate);
+    EXPECT_EQ(30, config.gop_length);
+}
+
+TEST(EncoderConfigTest, GopDefaultsToOneSecond) {
+    EXPECT_EQ(25, defaultsFor(1280, 720, 25).gop_length);
+    EXPECT_EQ(30, defaultsFor(1280, 720, 29.97).gop_length);
+    EXPECT_EQ(1, defaultsFor(1280, 720, 0.2).gop_length);
+}
+
+TEST(EncoderConfigTest, RemainingDefaults) {
+    EncoderConfig config = defaultsFor(1280, 720, 30);
+    EXPECT_EQ(RATE_CONTROL_VBR, config.rate_control);
+    EXPECT_EQ(23, config.crf);
+    EXPECT_EQ("ultrafast", config.preset);
+    EXPECT_FALSE(config.intra_refresh);
+    EXPECT_EQ(0, config.slices);
+}
+
+TEST(EncoderConfigTest, ExplicitValuesAreKept) {
+    EncoderConfig config;
+    config.bitrate = 800000;
+    config.rate_control = RATE_CONTROL_CBR;
+    config.crf = 30;
+    config.gop_length = 120;
+    config.preset = "veryfast";
+    config.fillDefaults(1920, 1080, 60);
+    EXPECT_EQ(800000, config.bitrate);
+    EXPECT_EQ(RATE_CONTROL_CBR, config.rate_control);
+    EXPECT_EQ(30, config.crf);
+    EXPECT_EQ(120, config.gop_length);
+    EXPECT_EQ("veryfast", config.preset);
+}
+
+TEST(EncoderConfigTest, KnownPresets) {
+    const char* presets[] = {
+        "", "ultrafast", "superfast", "veryfast", "faster", "fast", "medium", "slow", "slower", "veryslow", "placebo"
+    };
+    for (size_t i = 0; i < sizeof(presets) / sizeof(presets[0]); i++) {
+        EXPECT_TRUE(isKnownEncoderPreset(presets[i])) << presets[i];
+    }
+    EXPECT_FALSE(isKnownEncoderPreset("Fast"));
+    EXPECT_FALSE(isKnownEncoderPreset("ultra"));
+    EXPECT_FALSE(isKnownEncoderPreset("zerolatency"));     // tune，不是preset
+}
+
+TEST(EncoderConfigTest, Validation) {
+    EncoderConfig config;
+    EXPECT_TRUE(isValidEncoderConfig(config));
+
+    EncoderConfig bad = config;
+    bad.bitrate = -1;
+    EXPECT_FALSE(isValidEncoderConfig(bad));
+    bad = config;
+    bad.rate_control = RATE_CONTROL_CRF + 1;
+    EXPECT_FALSE(isValidEncoderConfig(bad));
+    bad = config;
+    bad.rate_control = -1;
+    EXPECT_FALSE(isValidEncoderConfig(bad));
+    bad = config;
+    bad.crf = 52;
+    EXPECT_FALSE(isValidEncoderConfig(bad));
+    bad = config;
+    bad.gop_length = -1;
+    EXPECT_FALSE(isValidEncoderConfig(bad));
+    bad = config;
+    bad.slices = -1;
+    EXPECT_FALSE(isValidEncoderConfig(bad));
+    bad = config;
+    bad.preset = "turbo";
+    EXPECT_FALSE(isValidEncoderConfig(bad));
+
+    EncoderConfig edge = config;
+    edge.crf = 51;
+    edge.rate_control = RATE_CONTROL_CRF;
+    EXPECT_TRUE(isValidEncoderConfig(edge));
+}
+
+TEST(EncoderConfigTest, H264LevelFollowsMacroblockThroughput) {
+    EXPECT_STREQ("3.1", selectH264Level(640, 480, 30, 0).name);
+    EXPECT_STREQ("3.1", selectH264Level(1280, 720, 30, 0).name);
+    EXPECT_STREQ("3.2", selectH264Level(1280, 720, 60, 0).name);
+    EXPECT_STREQ("4", selectH264Level(1920, 1080, 30, 0).name);
+    EXPECT_STREQ("4.2", selectH264Level(1920, 1080, 60, 0).name);
+    EXPECT_STREQ("5", selectH264Level(2560, 1440, 30, 0).name);
+    EXPECT_STREQ("5.1", selectH264Level(2560, 1440, 60, 0).name);
+    EXPECT_STREQ("5.1", selectH264Level(3840, 2160, 30, 0).name);
+    EXPECT_STREQ("5.2", selectH264Level(3840, 2160, 60, 0).name);
+    EXPECT_EQ(40, selectH264Level(1920, 1080, 0, 0).idc);         // 帧率未知按30fps
+    EXPECT_EQ(52, selectH264Level(7680, 4320, 30, 0).idc);        // 超出表格用最高level
+}
+
+TEST(EncoderConfigTest, H264LevelRespectsMaxBitrate) {
+    EXPECT_STREQ("3.1", selectH264Level(1280, 720, 30, 14000000).name);
+    EXPECT_STREQ("3.2", selectH264Level(1280, 720, 30, 14000001).name);
+    EXPECT_STREQ("4", selectH264Level(1920, 1080, 30, 20000000).name);
+    EXPECT_STREQ("4.1", selectH264Level(1920, 1080, 30, 30000000).name);
+    EXPECT_STREQ("5", selectH264Level(1920, 1080, 30, 60000000).name);
+    EXPECT_STREQ("5.1", selectH264Level(2560, 1440, 30, 200000000).name);
+}
+
+TEST(EncoderConfigTest, DefaultConfigsPickConformingLevels) {
+    struct { int width; int height; double fps; const char* level; } cases[] = {
+        {1280, 720, 30, "3.1"}, {1920, 1080, 30, "4"}, {1920, 1080, 60, "4.2"}, {2560, 1440, 30, "5"},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        EncoderConfig config;
+        config.fillDefaults(cases[i].width, cases[i].height, cases[i].fps);
+        EXPECT_STREQ(cases[i].level, selectH264Level(cases[i].width, cases[i].height, cases[i].fps,
+                                                     encoderPeakBitrate(config)).name)
+            << cases[i].width << "x" << cases[i].height << "@" << cases[i].fps;
+    }
+}
+
+TEST(EncoderConfigTest, PeakBitrateFollowsRateControl) {
+    EncoderConfig config;
+    config.bitrate = 8000000;
+    config.rate_control = RATE_CONTROL_CBR;
+    EXPECT_EQ(8000000, encoderPeakBitrate(config));
+    config.rate_control = RATE_CONTROL_VBR;
+    EXPECT_EQ(12000000, encoderPeakBitrate(config));
+    config.rate_control = RATE_CONTROL_CRF;
+    EXPECT_EQ(12000000, encoderPeakBitrate(config));
+}
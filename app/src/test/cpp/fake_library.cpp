@@ -0,0 +1,24 @@
+#include "fake_library.h"
+
+// 构造函数在dlopen时运行，用于确认库只在加载时初始化一次
+static int g_init_count = 0;
+
+__attribute__((constructor)) static void fakeLibraryInit() {
+    g_init_count++;
+}
+
+extern "C" {
+
+__attribute__((visibility("default"))) int fake_add(int a, int b) {
+    return a + b;
+}
+
+__attribute__((visibility("default"))) const char* fake_version_info(void) {
+    return "fake-1.0";
+}
+
+__attribute__((visibility("default"))) int fake_init_count(void) {
+    return g_init_count;
+}
+
+}
@@ -0,0 +1,12 @@
+#ifndef FFW_FAKE_LIBRARY_H
+#define FFW_FAKE_LIBRARY_H
+
+// dynamic_library_test用的共享库接口，形式与FFmpeg的C接口相同；测试程序不链接这个库
+extern "C" {
+int fake_add(int a, int b);
+const char* fake_version_info(void);
+int fake_init_count(void);
+int fake_not_exported(void);    // 只有声明，库中没有定义
+}
+
+#endif
@@ -0,0 +1,216 @@
+// 帧导出交付给Java消费者的帧率：与FrameExportPool相同的路径（3个槽位在互斥锁下领取，最新帧按布局
+// 逐平面复制到槽位的紧凑缓冲区，YUV420P/NV12直接复制，其他布局经SWS_FAST_BILINEAR转换为NV12），
+// 消费者线程模拟Java分析：读取Y平面（每64字节取一个）后release。JNI对象只在分辨率变化时创建，不计入。
+// 参数：layout=0为YUV420P，1为NV12，2为YUV422P（走sws转换）；height为720或1080（16:9）
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/mem.h>
+#include <libswscale/swscale.h>
+}
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+const int kSlotCount = 3;
+
+int chromaWidth(int width) { return (width + 1) / 2; }
+int chromaHeight(int height) { return (height + 1) / 2; }
+
+// FrameExportPool的槽位和复制（不含JNI）
+class ExportPool {
+public:
+    ExportPool(int width, int height) : width(width), height(height), sws_ctx(nullptr), exhausted(0) {
+        size_t size = (size_t)width * height + (size_t)chromaWidth(width) * chromaHeight(height) * 2;
+        for (int i = 0; i < kSlotCount; i++) {
+            slots[i] = (uint8_t*)av_malloc(size);
+            in_use[i] = false;
+        }
+    }
+
+    ~ExportPool() {
+        sws_freeContext(sws_ctx);
+        for (int i = 0; i < kSlotCount; i++) {
+            av_free(slots[i]);
+        }
+    }
+
+    // 返回槽位下标，所有槽位都被消费者持有时返回-1
+    int acquire(const AVFrame* frame) {
+        std::lock_guard<std::mutex> lock(mutex);
+        int slot = -1;
+        for (int i = 0; i < kSlotCount && slot < 0; i++) {
+            if (!in_use[i]) {
+                slot = i;
+            }
+        }
+        if (slot < 0) {
+            exhausted++;
+            return -1;
+        }
+        if (!copyFrame(frame, slots[slot])) {
+            return -1;
+        }
+        in_use[slot] = true;
+        return slot;
+    }
+
+    void release(int slot) {
+        std::lock_guard<std::mutex> lock(mutex);
+        in_use[slot] = false;
+    }
+
+    const uint8_t* data(int slot) const {
+        return slots[slot];
+    }
+
+    int exhaustedCount() const {
+        return exhausted;
+    }
+
+private:
+    int width;
+    int height;
+    std::mutex mutex;
+    uint8_t* slots[kSlotCount];
+    bool in_use[kSlotCount];
+    SwsContext* sws_ctx;
+    int exhausted;
+
+    bool copyFrame(const AVFrame* frame, uint8_t* y) {
+        uint8_t* chroma = y + (size_t)width * height;
+        int chroma_w = chromaWidth(width);
+        int chroma_h = chromaHeight(height);
+        switch (frame->format) {
+            case AV_PIX_FMT_YUV420P:
+                av_image_copy_plane(y, width, frame->data[0], frame->linesize[0], width, height);
+                av_image_copy_plane(chroma, chroma_w, frame->data[1], frame->linesize[1], chroma_w, chroma_h);
+                av_image_copy_plane(chroma + (size_t)chroma_w * chroma_h, chroma_w,
+                                    frame->data[2], frame->linesize[2], chroma_w, chroma_h);
+                return true;
+            case AV_PIX_FMT_NV12:
+                av_image_copy_plane(y, width, frame->data[0], frame->linesize[0], width, height);
+                av_image_copy_plane(chroma, chroma_w * 2, frame->data[1], frame->linesize[1], chroma_w * 2, chroma_h);
+                return true;
+            default: {
+                sws_ctx = sws_getCachedContext(sws_ctx, width, height, (AVPixelFormat)frame->format,
+                                               width, height, AV_PIX_FMT_NV12, SWS_FAST_BILINEAR,
+                                               nullptr, nullptr, nullptr);
+                if (!sws_ctx) {
+                    return false;
+                }
+                uint8_t* dst_data[4] = {y, chroma, nullptr, nullptr};
+                int dst_linesize[4] = {width, chroma_w * 2, 0, 0};
+                return sws_scale(sws_ctx, frame->data, frame->linesize, 0, height, dst_data, dst_linesize) > 0;
+            }
+        }
+    }
+};
+
+// 消费者线程：取到的槽位读取Y平面后release，与Java侧acquireFrame/分析/release的顺序相同
+class Consumer {
+public:
+    Consumer(ExportPool& pool, size_t luma_size) :
+        pool(pool), luma_size(luma_size), stopped(false), checksum(0), thread(&Consumer::run, this) {}
+
+    ~Consumer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopped = true;
+        }
+        ready.notify_one();
+        thread.join();
+    }
+
+    void deliver(int slot) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push_back(slot);
+        }
+        ready.notify_one();
+    }
+
+private:
+    ExportPool& pool;
+    size_t luma_size;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<int> pending;
+    bool stopped;
+    std::atomic<uint64_t> checksum;
+    std::thread thread;
+
+    void run() {
+        while (true) {
+            int slot;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                ready.wait(lock, [this]() { return stopped || !pending.empty(); });
+                if (pending.empty()) {
+                    return;
+                }
+                slot = pending.front();
+                pending.pop_front();
+            }
+            const uint8_t* y = pool.data(slot);
+            uint64_t sum = 0;
+            for (size_t i = 0; i < luma_size; i += 64) {
+                sum += y[i];
+            }
+            checksum.fetch_add(sum, std::memory_order_relaxed);
+            pool.release(slot);
+        }
+    }
+};
+
+void BM_FrameExport(benchmark::State& state) {
+    static const AVPixelFormat kLayouts[] = {AV_PIX_FMT_YUV420P, AV_PIX_FMT_NV12, AV_PIX_FMT_YUV422P};
+    int height = (int)state.range(1);
+    int width = height * 16 / 9;
+    AVFrame* frame = av_frame_alloc();
+    frame->format = kLayouts[state.range(0)];
+    frame->width = width;
+    frame->height = height;
+    if (av_frame_get_buffer(frame, 0) < 0) {
+        av_frame_free(&frame);
+        state.SkipWithError("frame allocation failed");
+        return;
+    }
+    for (int plane = 0; plane < 4 && frame->data[plane]; plane++) {
+        int rows = plane == 0 || frame->format == AV_PIX_FMT_YUV422P ? height : chromaHeight(height);
+        memset(frame->data[plane], 0x80 + plane, (size_t)frame->linesize[plane] * rows);
+    }
+
+    int64_t delivered = 0;
+    {
+        ExportPool pool(width, height);
+        Consumer consumer(pool, (size_t)width * height);
+        for (auto _ : state) {
+            int slot = pool.acquire(frame);
+            if (slot >= 0) {
+                consumer.deliver(slot);
+                delivered++;
+            }
+        }
+        state.counters["exhausted"] = pool.exhaustedCount();
+    }
+    av_frame_free(&frame);
+    state.counters["fps"] = benchmark::Counter((double)delivered, benchmark::Counter::kIsRate);
+    state.SetBytesProcessed(delivered * ((int64_t)width * height * 3 / 2));
+}
+BENCHMARK(BM_FrameExport)->ArgNames({"layout", "height"})
+    ->Args({0, 720})->Args({0, 1080})->Args({1, 1080})->Args({2, 1080})
+    ->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+}  // namespace
+
+BENCHMARK_MAIN();
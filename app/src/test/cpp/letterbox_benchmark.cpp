@@ -0,0 +1,56 @@
+// 按Surface尺寸输出后每帧的CPU写入量：sws_scale只写画面矩形，黑边每帧单独涂。
+// 主机上没有libswscale，这里只测涂黑边相对整帧清零的开销，并给出各输出尺寸下sws_scale
+// 需要写入的像素数（converted_pixels）与4K源整帧转换的比例（vs_stream_size）
+#include "letterbox.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const int kSourceWidth = 3840;
+const int kSourceHeight = 2160;
+
+void setCounters(benchmark::State& state, const LetterboxRect& rect) {
+    double converted = (double)rect.width * rect.height;
+    state.counters["converted_pixels"] = converted;
+    state.counters["vs_stream_size"] = converted / ((double)kSourceWidth * kSourceHeight);
+}
+
+void BM_ClearLetterbox(benchmark::State& state) {
+    int out_width = (int)state.range(0);
+    int out_height = (int)state.range(1);
+    LetterboxRect rect = fitLetterbox(kSourceWidth, kSourceHeight, 0, 0, out_width, out_height);
+    std::vector<uint8_t> buffer((size_t)out_width * out_height * 4);
+    for (auto _ : state) {
+        clearLetterbox(buffer.data(), (size_t)out_width * 4, out_width, out_height, rect);
+        benchmark::ClobberMemory();
+    }
+    setCounters(state, rect);
+    int64_t bar_bytes = ((int64_t)out_width * out_height - (int64_t)rect.width * rect.height) * 4;
+    state.SetBytesProcessed(state.iterations() * bar_bytes);
+}
+
+void BM_ClearWholeBuffer(benchmark::State& state) {
+    int out_width = (int)state.range(0);
+    int out_height = (int)state.range(1);
+    std::vector<uint8_t> buffer((size_t)out_width * out_height * 4);
+    for (auto _ : state) {
+        memset(buffer.data(), 0, buffer.size());
+        benchmark::ClobberMemory();
+    }
+    setCounters(state, fitLetterbox(kSourceWidth, kSourceHeight, 0, 0, out_width, out_height));
+    state.SetBytesProcessed(state.iterations() * (int64_t)buffer.size());
+}
+
+// 640x360小窗、1080p、2400x1080全面屏横屏（左右黑边）、1080x2400竖屏（上下黑边）
+#define LETTERBOX_SIZES ->Args({640, 360})->Args({1920, 1080})->Args({2400, 1080})->Args({1080, 2400})
+BENCHMARK(BM_ClearLetterbox) LETTERBOX_SIZES;
+BENCHMARK(BM_ClearWholeBuffer) LETTERBOX_SIZES;
+
+}  // namespace
+
+BENCHMARK_MAIN();
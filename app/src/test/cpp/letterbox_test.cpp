@@ -0,0 +1,83 @@
+#include "letterbox.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+TEST(LetterboxTest, SameAspectFillsOutput) {
+    LetterboxRect rect = fitLetterbox(3840, 2160, 0, 0, 640, 360);
+    EXPECT_EQ(0, rect.x);
+    EXPECT_EQ(0, rect.y);
+    EXPECT_EQ(640, rect.width);
+    EXPECT_EQ(360, rect.height);
+}
+
+TEST(LetterboxTest, WideSurfaceGetsPillarbox) {
+    LetterboxRect rect = fitLetterbox(1920, 1080, 1, 1, 2400, 1080);
+    EXPECT_EQ(1920, rect.width);
+    EXPECT_EQ(1080, rect.height);
+    EXPECT_EQ(240, rect.x);
+    EXPECT_EQ(0, rect.y);
+}
+
+TEST(LetterboxTest, TallSurfaceGetsLetterbox) {
+    LetterboxRect rect = fitLetterbox(1920, 1080, 0, 1, 1080, 2400);
+    EXPECT_EQ(1080, rect.width);
+    EXPECT_EQ(608, rect.height);        // 607.5四舍五入后取偶
+    EXPECT_EQ(0, rect.x);
+    EXPECT_EQ(896, rect.y);
+}
+
+// 720x576 DVD画面SAR 16:15，显示宽高比4:3
+TEST(LetterboxTest, NonSquarePixelsUseDisplayAspect) {
+    LetterboxRect rect = fitLetterbox(720, 576, 16, 15, 1920, 1080);
+    EXPECT_EQ(1080, rect.height);
+    EXPECT_EQ(1440, rect.width);
+    EXPECT_EQ(240, rect.x);
+}
+
+TEST(LetterboxTest, OddSizesStayEvenInsideOutput) {
+    LetterboxRect rect = fitLetterbox(1920, 1080, 0, 0, 641, 361);
+    EXPECT_EQ(0, rect.width % 2);
+    EXPECT_EQ(0, rect.height % 2);
+    EXPECT_LE(rect.x + rect.width, 641);
+    EXPECT_LE(rect.y + rect.height, 361);
+
+    // 输出不足2像素时不能超出缓冲区
+    rect = fitLetterbox(1920, 1080, 0, 0, 1, 1);
+    EXPECT_EQ(1, rect.width);
+    EXPECT_EQ(1, rect.height);
+    EXPECT_EQ(0, rect.x);
+    EXPECT_EQ(0, rect.y);
+}
+
+namespace {
+
+// 缓冲区先填满0xFF，清黑边后检查：画面内保持不变，画面外全为0，行尾padding不被写
+void checkClear(int out_width, int out_height, int stride, const LetterboxRect& rect) {
+    std::vector<uint8_t> buffer((size_t)stride * 4 * out_height, 0xFF);
+    clearLetterbox(buffer.data(), (size_t)stride * 4, out_width, out_height, rect);
+    for (int y = 0; y < out_height; y++) {
+        for (int x = 0; x < stride; x++) {
+            uint8_t expected = 0xFF;
+            if (x < out_width) {
+                bool inside = x >= rect.x && x < rect.x + rect.width && y >= rect.y && y < rect.y + rect.height;
+                expected = inside ? 0xFF : 0;
+            }
+            const uint8_t* pixel = &buffer[((size_t)y * stride + x) * 4];
+            for (int c = 0; c < 4; c++) {
+                ASSERT_EQ(expected, pixel[c]) << "x=" << x << " y=" << y;
+            }
+        }
+    }
+}
+
+}  // namespace
+
+TEST(LetterboxTest, ClearTouchesOnlyBars) {
+    checkClear(64, 48, 72, fitLetterbox(1920, 1080, 0, 0, 64, 48));     // 上下黑边
+    checkClear(96, 36, 96, fitLetterbox(1920, 1080, 0, 0, 96, 36));     // 左右黑边
+    checkClear(64, 36, 80, fitLetterbox(1920, 1080, 0, 0, 64, 36));     // 无黑边
+    checkClear(63, 37, 64, fitLetterbox(1920, 1080, 0, 0, 63, 37));     // 奇数尺寸，四边都有
+}
@@ -0,0 +1,263 @@
+#include "media_header_parser.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+// 代替FFmpeg的MOV标签表
+struct FakeMovTags {
+    static const char* videoCodec(uint32_t fourcc) {
+        if (fourcc == mediaTag('a','v','c','1')) {
+            return "h264";
+        }
+        return fourcc == mediaTag('h','v','c','1') ? "hevc" : nullptr;
+    }
+
+    static const char* audioCodec(uint32_t fourcc) {
+        return fourcc == mediaTag('m','p','4','a') ? "aac" : nullptr;
+    }
+};
+
+typedef BasicMp4HeaderParser<FakeMovTags> Mp4Parser;
+typedef std::vector<uint8_t> Bytes;
+
+void appendBE16(Bytes& out, uint16_t value) {
+    out.push_back((uint8_t)(value >> 8));
+    out.push_back((uint8_t)value);
+}
+
+void appendBE32(Bytes& out, uint32_t value) {
+    appendBE16(out, (uint16_t)(value >> 16));
+    appendBE16(out, (uint16_t)value);
+}
+
+void appendZeros(Bytes& out, size_t count) {
+    out.insert(out.end(), count, 0);
+}
+
+Bytes concat(const std::vector<Bytes>& parts) {
+    Bytes out;
+    for (size_t i = 0; i < parts.size(); i++) {
+        out.insert(out.end(), parts[i].begin(), parts[i].end());
+    }
+    return out;
+}
+
+Bytes box(const char* type, const Bytes& payload) {
+    Bytes out;
+    appendBE32(out, (uint32_t)(8 + payload.size()));
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), payload.begin(), payload.end());
+    return out;
+}
+
+// mvhd/mdhd version 0：timescale在偏移12，duration在偏移16
+Bytes timeBox(const char* type, uint32_t timescale, uint32_t duration) {
+    Bytes payload;
+    appendZeros(payload, 12);
+    appendBE32(payload, timescale);
+    appendBE32(payload, duration);
+    appendZeros(payload, 80);
+    return box(type, payload);
+}
+
+// fourcc按文件中的字节顺序给出
+Bytes mp4Track(const char* handler, const uint8_t fourcc[4], bool video) {
+    Bytes hdlr;
+    appendZeros(hdlr, 8);
+    hdlr.insert(hdlr.end(), handler, handler + 4);
+    appendZeros(hdlr, 12);
+
+    // 样本描述条目（不含8字节的size/fourcc）：偏移相对条目起点
+    Bytes entry;
+    appendZeros(entry, 8);
+    if (video) {
+        appendZeros(entry, 16);
+        appendBE16(entry, 1920);                // width（偏移32）
+        appendBE16(entry, 1080);
+    } else {
+        appendZeros(entry, 8);
+        appendBE16(entry, 2);                   // channels（偏移24）
+        appendZeros(entry, 6);
+        appendBE32(entry, 48000u << 16);        // 16.16定点采样率（偏移32）
+    }
+    appendZeros(entry, 16);
+    Bytes stsd;
+    appendZeros(stsd, 4);
+    appendBE32(stsd, 1);
+    appendBE32(stsd, (uint32_t)(8 + entry.size()));
+    stsd.insert(stsd.end(), fourcc, fourcc + 4);
+    stsd.insert(stsd.end(), entry.begin(), entry.end());
+
+    Bytes stts;
+    appendZeros(stts, 4);
+    appendBE32(stts, 1);
+    appendBE32(stts, 300);                      // 300个样本，10秒
+    appendBE32(stts, 1000);
+
+    Bytes stbl = box("stbl", concat({box("stsd", stsd), box("stts", stts)}));
+    Bytes mdia = box("mdia", concat({timeBox("mdhd", 30000, 300000), box("hdlr", hdlr), box("minf", stbl)}));
+    return box("trak", mdia);
+}
+
+Bytes mp4File(const uint8_t video_fourcc[4], const uint8_t audio_fourcc[4]) {
+    Bytes ftyp;
+    ftyp.insert(ftyp.end(), {'i', 's', 'o', 'm'});
+    appendZeros(ftyp, 4);
+    Bytes moov = box("moov", concat({timeBox("mvhd", 1000, 10000), mp4Track("vide", video_fourcc, true),
+                                     mp4Track("soun", audio_fourcc, false)}));
+    return concat({box("ftyp", ftyp), moov, box("mdat", Bytes(64, 0))});
+}
+
+const uint8_t kAvc1[4] = {'a', 'v', 'c', '1'};
+const uint8_t kMp4a[4] = {'m', 'p', '4', 'a'};
+
+// EBML元素：ID按原样写出（含长度标记位），大小固定用8字节变长整数
+Bytes element(uint32_t id, const Bytes& payload) {
+    Bytes out;
+    bool started = false;
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        uint8_t byte = (uint8_t)(id >> shift);
+        if (started || byte != 0) {
+            out.push_back(byte);
+            started = true;
+        }
+    }
+    out.push_back(0x01);
+    for (int shift = 48; shift >= 0; shift -= 8) {
+        out.push_back((uint8_t)((uint64_t)payload.size() >> shift));
+    }
+    out.insert(out.end(), payload.begin(), payload.end());
+    return out;
+}
+
+Bytes stringElement(uint32_t id, const std::string& value) {
+    return element(id, Bytes(value.begin(), value.end()));
+}
+
+Bytes uintElement(uint32_t id, uint32_t value) {
+    Bytes payload;
+    appendBE32(payload, value);
+    return element(id, payload);
+}
+
+Bytes matroskaFile(const std::string& video_codec_id) {
+    Bytes duration;
+    double seconds_ms = 10000.0;
+    uint64_t bits;
+    memcpy(&bits, &seconds_ms, sizeof(bits));
+    appendBE32(duration, (uint32_t)(bits >> 32));
+    appendBE32(duration, (uint32_t)bits);
+
+    Bytes header = element(0x1A45DFA3, stringElement(0x4282, "webm"));
+    Bytes info = element(0x1549A966, concat({uintElement(0x2AD7B1, 1000000), element(0x4489, duration)}));
+    Bytes video = element(0xE0, concat({uintElement(0xB0, 1280), uintElement(0xBA, 720)}));
+    Bytes track = element(0xAE, concat({uintElement(0x83, 1), stringElement(0x86, video_codec_id), video}));
+    Bytes segment = element(0x18538067, concat({info, element(0x1654AE6B, track)}));
+    return concat({header, segment});
+}
+
+bool allPrintable(const std::string& s) {
+    for (size_t i = 0; i < s.size(); i++) {
+        if (!isPrintableAscii(s[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TEST(MediaHeaderParserTest, FourccNameKeepsPrintableTags) {
+    EXPECT_EQ(fourccName(mediaTag('d','v','h','1')), "dvh1");
+    EXPECT_EQ(fourccName(mediaTag('r','a','w',' ')), "raw ");
+}
+
+TEST(MediaHeaderParserTest, FourccNameHexEscapesRawBytes) {
+    EXPECT_EQ(fourccName(mediaTag('\xff','\xfe','a','\x01')), "0x0161feff");
+    EXPECT_EQ(fourccName(0), "0x00000000");
+}
+
+TEST(MediaHeaderParserTest, PrintableCodecNameEscapesNonAscii) {
+    EXPECT_EQ(printableCodecName("V_QUICKTIME"), "V_QUICKTIME");
+    EXPECT_EQ(printableCodecName("V_\xe4\xb8\xad\x7f"), "V_\\xe4\\xb8\\xad\\x7f");
+    EXPECT_EQ(printableCodecName(std::string("A\0B", 3)), "A\\x00B");
+}
+
+TEST(MediaHeaderParserTest, Mp4KnownCodecs) {
+    Bytes file = mp4File(kAvc1, kMp4a);
+    ASSERT_TRUE(Mp4Parser::isCandidate(file.data(), file.size()));
+    MediaInfo info;
+    ASSERT_TRUE(Mp4Parser::parse(file.data(), file.size(), info));
+    EXPECT_EQ(info.container, "mp4");
+    EXPECT_EQ(info.video_codec, "h264");
+    EXPECT_EQ(info.audio_codec, "aac");
+    EXPECT_EQ(info.width, 1920);
+    EXPECT_EQ(info.height, 1080);
+    EXPECT_DOUBLE_EQ(info.frame_rate, 30.0);
+    EXPECT_EQ(info.duration_ms, 10000);
+    EXPECT_EQ(info.sample_rate, 48000);
+    EXPECT_EQ(info.channels, 2);
+    EXPECT_EQ(info.stream_count, 2);
+}
+
+TEST(MediaHeaderParserTest, Mp4UnknownPrintableFourcc) {
+    const uint8_t dvh1[4] = {'d', 'v', 'h', '1'};
+    const uint8_t alac[4] = {'a', 'l', 'a', 'c'};
+    Bytes file = mp4File(dvh1, alac);
+    MediaInfo info;
+    ASSERT_TRUE(Mp4Parser::parse(file.data(), file.size(), info));
+    EXPECT_EQ(info.video_codec, "dvh1");
+    EXPECT_EQ(info.audio_codec, "alac");
+}
+
+TEST(MediaHeaderParserTest, Mp4UnknownBinaryFourccIsHexEscaped) {
+    const uint8_t video[4] = {0xff, 0xfe, 'a', 0x01};
+    const uint8_t audio[4] = {0xc3, 0xa9, 0x00, 0x80};
+    Bytes file = mp4File(video, audio);
+    MediaInfo info;
+    ASSERT_TRUE(Mp4Parser::parse(file.data(), file.size(), info));
+    EXPECT_EQ(info.video_codec, "0x0161feff");
+    EXPECT_EQ(info.audio_codec, "0x8000a9c3");
+}
+
+TEST(MediaHeaderParserTest, Mp4TruncatedMoovFallsBack) {
+    Bytes file = mp4File(kAvc1, kMp4a);
+    for (size_t size = 0; size < file.size() - 64 - 8; size += 7) {
+        MediaInfo info;
+        // 截断的moov不越界读取；没有完整moov时交给完整探测
+        Mp4Parser::parse(file.data(), size, info);
+        EXPECT_TRUE(allPrintable(info.video_codec));
+    }
+}
+
+TEST(MediaHeaderParserTest, MatroskaKnownCodec) {
+    Bytes file = matroskaFile("V_MPEG4/ISO/AVC");
+    ASSERT_TRUE(MatroskaHeaderParser::isCandidate(file.data(), file.size()));
+    MediaInfo info;
+    ASSERT_TRUE(MatroskaHeaderParser::parse(file.data(), file.size(), info));
+    EXPECT_EQ(info.container, "webm");
+    EXPECT_EQ(info.video_codec, "h264");
+    EXPECT_EQ(info.width, 1280);
+    EXPECT_EQ(info.height, 720);
+    EXPECT_EQ(info.duration_ms, 10000);
+}
+
+TEST(MediaHeaderParserTest, MatroskaUnknownCodecIdIsEscaped) {
+    MediaInfo info;
+    Bytes file = matroskaFile("V_QUICKTIME");
+    ASSERT_TRUE(MatroskaHeaderParser::parse(file.data(), file.size(), info));
+    EXPECT_EQ(info.video_codec, "V_QUICKTIME");
+
+    // 非ASCII和控制字节（modified UTF-8不允许的字节序列）
+    info = MediaInfo();
+    file = matroskaFile("V_\xe4\xb8\xad\xff\x01");
+    ASSERT_TRUE(MatroskaHeaderParser::parse(file.data(), file.size(), info));
+    EXPECT_EQ(info.video_codec, "V_\\xe4\\xb8\\xad\\xff\\x01");
+    EXPECT_TRUE(allPrintable(info.video_codec));
+}
+
+}  // namespace
@@ -0,0 +1,144 @@
+// 批量探测的I/O模型：在临时目录生成一批文件，探测函数只映射文件并读取头部和尾部各4KB
+// （moov在头部或尾部的MP4、Matroska的EBML头都在这个范围内），不含容器解析本身。
+// 冷缓存：每轮开始前用POSIX_FADV_DONTNEED丢弃这些文件的页缓存；热缓存：不丢弃
+#include "parallel_scanner.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+const int kFileCount = 1000;
+const size_t kFileSize = 256 * 1024;
+const size_t kProbeBytes = 4096;
+
+std::vector<std::string>& testFiles() {
+    static std::vector<std::string> files;
+    if (files.empty()) {
+        char dir_template[] = "/tmp/ffw_scan_bench_XXXXXX";
+        const char* dir = mkdtemp(dir_template);
+        if (!dir) {
+            return files;
+        }
+        std::vector<char> data(kFileSize);
+        for (size_t i = 0; i < data.size(); i++) {
+            data[i] = (char)(i * 131);
+        }
+        for (int i = 0; i < kFileCount; i++) {
+            std::string path = std::string(dir) + "/clip_" + std::to_string(i) + (i % 2 ? ".mkv" : ".mp4");
+            int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0) {
+                continue;
+            }
+            bool ok = write(fd, data.data(), data.size()) == (ssize_t)data.size() && fsync(fd) == 0;
+            close(fd);
+            if (ok) {
+                files.push_back(path);
+            }
+        }
+    }
+    return files;
+}
+
+void dropPageCache(const std::vector<std::string>& files) {
+    for (size_t i = 0; i < files.size(); i++) {
+        int fd = open(files[i].c_str(), O_RDONLY);
+        if (fd >= 0) {
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            close(fd);
+        }
+    }
+}
+
+bool probeHeaderAndTail(const std::string& path, int& info) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)(2 * kProbeBytes)) {
+        close(fd);
+        return false;
+    }
+    void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+    madvise(mapped, st.st_size, MADV_RANDOM);
+    const unsigned char* bytes = static_cast<const unsigned char*>(mapped);
+    unsigned sum = 0;
+    for (size_t i = 0; i < kProbeBytes; i += 64) {
+        sum += bytes[i] + bytes[st.st_size - kProbeBytes + i];
+    }
+    munmap(mapped, st.st_size);
+    info = (int)sum;
+    return true;
+}
+
+void runScan(benchmark::State& state, bool cold) {
+    std::vector<std::string>& files = testFiles();
+    if (files.empty()) {
+        state.SkipWithError("cannot create test files");
+        return;
+    }
+    int workers = (int)state.range(0);
+    for (auto _ : state) {
+        if (cold) {
+            state.PauseTiming();
+            dropPageCache(files);
+            state.ResumeTiming();
+        }
+        ParallelScanner<int> scanner(files, probeHeaderAndTail);
+        scanner.start(workers);
+        ParallelScanner<int>::Result result;
+        int ok = 0;
+        while (scanner.next(result)) {
+            ok += result.ok ? 1 : 0;
+        }
+        benchmark::DoNotOptimize(ok);
+    }
+    state.SetItemsProcessed(state.iterations() * files.size());
+}
+
+void BM_ScanCold(benchmark::State& state) {
+    runScan(state, true);
+}
+BENCHMARK(BM_ScanCold)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+void BM_ScanWarm(benchmark::State& state) {
+    runScan(state, false);
+}
+BENCHMARK(BM_ScanWarm)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    // 扫描器每轮打印一条LOGI，结果走stdout
+    if (!freopen("/dev/null", "w", stderr)) {
+        return 1;
+    }
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    // 清理临时文件
+    std::vector<std::string>& files = testFiles();
+    for (size_t i = 0; i < files.size(); i++) {
+        unlink(files[i].c_str());
+    }
+    if (!files.empty()) {
+        std::string dir = files[0].substr(0, files[0].rfind('/'));
+        rmdir(dir.c_str());
+    }
+    return 0;
+}
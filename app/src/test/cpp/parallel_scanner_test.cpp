@@ -0,0 +1,93 @@
+#include "parallel_scanner.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+typedef ParallelScanner<int> Scanner;
+
+// 探测结果为路径长度；以"bad"开头的路径探测失败
+bool fakeProbe(const std::string& path, int& info) {
+    if (path.compare(0, 3, "bad") == 0) {
+        return false;
+    }
+    info = (int)path.size();
+    return true;
+}
+
+}  // namespace
+
+TEST(ParallelScannerTest, WorkerCountIsBoundedForFlashStorage) {
+    EXPECT_EQ(2, Scanner::workerCount(100, 1));
+    EXPECT_EQ(2, Scanner::workerCount(100, 4));
+    EXPECT_EQ(3, Scanner::workerCount(100, 6));
+    EXPECT_EQ(4, Scanner::workerCount(100, 8));
+    EXPECT_EQ(4, Scanner::workerCount(100, 16));
+    EXPECT_EQ(1, Scanner::workerCount(1, 8));
+    EXPECT_EQ(0, Scanner::workerCount(0, 8));
+}
+
+TEST(ParallelScannerTest, EveryPathIsReportedExactlyOnce) {
+    std::vector<std::string> paths;
+    for (int i = 0; i < 500; i++) {
+        paths.push_back(i % 7 == 0 ? "bad/" + std::to_string(i) : "clip_" + std::to_string(i) + ".mp4");
+    }
+    paths.push_back("");        // 空路径不调用probe
+
+    Scanner scanner(paths, fakeProbe);
+    scanner.start(4);
+    std::set<int> seen;
+    Scanner::Result result;
+    while (scanner.next(result)) {
+        ASSERT_TRUE(seen.insert(result.index).second) << "duplicate index " << result.index;
+        const std::string& path = paths[result.index];
+        bool expected_ok = !path.empty() && path.compare(0, 3, "bad") != 0;
+        EXPECT_EQ(expected_ok, result.ok) << path;
+        if (expected_ok) {
+            EXPECT_EQ((int)path.size(), result.info);
+        }
+    }
+    EXPECT_EQ(paths.size(), seen.size());
+}
+
+TEST(ParallelScannerTest, EmptyInputFinishesImmediately) {
+    std::vector<std::string> paths;
+    Scanner scanner(paths, fakeProbe);
+    scanner.start();
+    Scanner::Result result;
+    EXPECT_FALSE(scanner.next(result));
+}
+
+TEST(ParallelScannerTest, CancelStopsWorkersEarly) {
+    std::vector<std::string> paths(1000, "slow.mp4");
+    std::atomic<int> probed(0);
+    Scanner::ProbeFunction slow_probe = [&probed](const std::string&, int& info) {
+        probed.fetch_add(1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        info = 1;
+        return true;
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        Scanner scanner(paths, slow_probe);
+        scanner.start(2);
+        Scanner::Result result;
+        for (int i = 0; i < 3; i++) {
+            ASSERT_TRUE(scanner.next(result));
+        }
+        scanner.cancel();
+        EXPECT_FALSE(scanner.next(result));
+    }   // 析构等待工作线程退出
+    auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    EXPECT_LT(probed.load(), 1000);
+    EXPECT_LT(elapsed_ms, 500);
+}
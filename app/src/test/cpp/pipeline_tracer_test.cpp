@@ -0,0 +1,138 @@
+#include "pipeline_tracer.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct TraceEvent {
+    std::string name;
+    long long ts;
+    long long dur;
+};
+
+// 只解析PipelineTracer自己写出的"ph":"X"行
+std::vector<TraceEvent> readEvents(const std::string& path) {
+    std::vector<TraceEvent> events;
+    std::ifstream in(path.c_str());
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.find("\"ph\":\"X\"") == std::string::npos) {
+            continue;
+        }
+        TraceEvent event;
+        char name[64] = {0};
+        size_t pos = line.find("{\"name\":\"");
+        size_t ts_pos = line.find("\"ts\":");
+        if (pos == std::string::npos || ts_pos == std::string::npos ||
+            sscanf(line.c_str() + pos, "{\"name\":\"%63[^\"]\"", name) != 1 ||
+            sscanf(line.c_str() + ts_pos, "\"ts\":%lld,\"dur\":%lld", &event.ts, &event.dur) != 2) {
+            ADD_FAILURE() << "malformed event: " << line;
+            continue;
+        }
+        event.name = name;
+        events.push_back(event);
+    }
+    return events;
+}
+
+std::string tracePath(const char* name) {
+    return std::string(testing::TempDir()) + name;
+}
+
+}  // namespace
+
+TEST(PipelineTracerTest, RecordsScopesBetweenStartAndStop) {
+    PipelineTracer& tracer = PipelineTracer::getInstance();
+    tracer.start();
+    {
+        TRACE_SCOPE("decode_send");
+    }
+    {
+        TRACE_SCOPE("window_post");
+    }
+    std::string path = tracePath("tracer_basic.json");
+    ASSERT_TRUE(tracer.stopAndWrite(path));
+
+    std::vector<TraceEvent> events = readEvents(path);
+    ASSERT_EQ(2u, events.size());
+    EXPECT_EQ("decode_send", events[0].name);
+    EXPECT_EQ("window_post", events[1].name);
+    EXPECT_GE(events[0].dur, 0);
+
+    // 停止后的作用域不记录
+    {
+        TRACE_SCOPE("after_stop");
+    }
+    ASSERT_TRUE(tracer.stopAndWrite(path));
+    EXPECT_EQ(2u, readEvents(path).size());
+}
+
+TEST(PipelineTracerTest, ScopeSpanningRestartIsDropped) {
+    PipelineTracer& tracer = PipelineTracer::getInstance();
+    std::string path = tracePath("tracer_epoch.json");
+    tracer.start();
+    {
+        PipelineTraceScope stale("stale_scope");
+        ASSERT_TRUE(tracer.stopAndWrite(path));
+        tracer.start();         // 上一轮的作用域在新一轮中结束
+    }
+    {
+        TRACE_SCOPE("fresh_scope");
+    }
+    ASSERT_TRUE(tracer.stopAndWrite(path));
+    std::vector<TraceEvent> events = readEvents(path);
+    ASSERT_EQ(1u, events.size());
+    EXPECT_EQ("fresh_scope", events[0].name);
+}
+
+// 写入线程持续产生事件，主线程反复start/stopAndWrite：
+// 每轮写出的事件都必须完整，并且开始于本轮start之后、结束于stop之前
+TEST(PipelineTracerTest, RestartAndDrainWhileWritersAreActive) {
+    PipelineTracer& tracer = PipelineTracer::getInstance();
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> writers;
+    const char* const kNames[] = {"packet_read", "decode_receive", "convert"};
+    for (int t = 0; t < 3; t++) {
+        const char* name = kNames[t];
+        writers.push_back(std::thread([&stop, name]() {
+            while (!stop.load()) {
+                TRACE_SCOPE(name);
+                std::this_thread::yield();
+            }
+        }));
+    }
+
+    std::string path = tracePath("tracer_stress.json");
+    size_t total = 0;
+    for (int round = 0; round < 50; round++) {
+        int64_t started_us = PipelineTracer::nowUs();
+        tracer.start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        ASSERT_TRUE(tracer.stopAndWrite(path));
+        int64_t stopped_us = PipelineTracer::nowUs();
+
+        std::vector<TraceEvent> events = readEvents(path);
+        for (size_t i = 0; i < events.size(); i++) {
+            const TraceEvent& event = events[i];
+            EXPECT_TRUE(event.name == kNames[0] || event.name == kNames[1] || event.name == kNames[2])
+                << event.name;
+            EXPECT_GE(event.ts, started_us) << "round " << round << ": event from an earlier round";
+            EXPECT_GE(event.dur, 0);
+            EXPECT_LE(event.ts + event.dur, stopped_us);
+        }
+        total += events.size();
+    }
+
+    stop.store(true);
+    for (size_t i = 0; i < writers.size(); i++) {
+        writers[i].join();
+    }
+    EXPECT_GT(total, 0u);
+}
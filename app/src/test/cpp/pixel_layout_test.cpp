@@ -0,0 +1,123 @@
+#include "pixel_layout.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+// 与FFmpeg的取值无关：resolvePixelLayout只比较调用方给出的格式值
+enum FakeFormat {
+    FMT_NONE = -1,
+    FMT_YUV420P = 0,
+    FMT_NV12 = 23,
+    FMT_NV21 = 24,
+    FMT_P010LE = 161,
+    FMT_MEDIACODEC = 165,
+    FMT_VAAPI = 44,
+    FMT_UNKNOWN = 9999,
+};
+
+struct FakeKnownFormat {
+    bool operator()(int fmt) const { return fmt != FMT_UNKNOWN; }
+};
+
+PixelLayoutFormats fakeFormats() {
+    PixelLayoutFormats fmts;
+    fmts.none = FMT_NONE;
+    fmts.mediacodec = FMT_MEDIACODEC;
+    return fmts;
+}
+
+PixelLayoutInput softwareFrame(int format) {
+    PixelLayoutInput in;
+    in.frame_format = format;
+    in.has_hw_frames = false;
+    in.hw_sw_format = FMT_NONE;
+    in.has_decoder = true;
+    in.decoder_sw_format = FMT_NONE;
+    return in;
+}
+
+PixelLayout resolve(const PixelLayoutInput& in) {
+    return resolvePixelLayout(in, fakeFormats(), FakeKnownFormat());
+}
+
+}  // namespace
+
+TEST(PixelLayoutTest, SoftwareYuv420pKeepsFrameFormat) {
+    PixelLayout out = resolve(softwareFrame(FMT_YUV420P));
+    EXPECT_EQ(FMT_YUV420P, out.layout);
+    EXPECT_FALSE(out.hw_surface);
+}
+
+TEST(PixelLayoutTest, SoftwareNv12KeepsFrameFormat) {
+    PixelLayout out = resolve(softwareFrame(FMT_NV12));
+    EXPECT_EQ(FMT_NV12, out.layout);
+    EXPECT_FALSE(out.hw_surface);
+}
+
+TEST(PixelLayoutTest, SoftwareNv21IsNotSwappedToNv12) {
+    PixelLayout out = resolve(softwareFrame(FMT_NV21));
+    EXPECT_EQ(FMT_NV21, out.layout);
+    EXPECT_FALSE(out.hw_surface);
+}
+
+TEST(PixelLayoutTest, SoftwareP010KeepsFrameFormat) {
+    PixelLayout out = resolve(softwareFrame(FMT_P010LE));
+    EXPECT_EQ(FMT_P010LE, out.layout);
+    EXPECT_FALSE(out.hw_surface);
+}
+
+TEST(PixelLayoutTest, MediaCodecBufferOutputUsesDecoderSwFormat) {
+    PixelLayoutInput in = softwareFrame(FMT_MEDIACODEC);
+    in.decoder_sw_format = FMT_NV12;
+    PixelLayout out = resolve(in);
+    EXPECT_EQ(FMT_NV12, out.layout);
+    EXPECT_TRUE(out.hw_surface);
+}
+
+TEST(PixelLayoutTest, MediaCodecWithoutDecoderHasNoLayout) {
+    PixelLayoutInput in = softwareFrame(FMT_MEDIACODEC);
+    in.has_decoder = false;
+    in.decoder_sw_format = FMT_NV12;    // 没有解码器时不能被读取
+    PixelLayout out = resolve(in);
+    EXPECT_EQ(FMT_NONE, out.layout);
+    EXPECT_TRUE(out.hw_surface);
+}
+
+TEST(PixelLayoutTest, MediaCodecHwFramesUseFramesContextSwFormat) {
+    PixelLayoutInput in = softwareFrame(FMT_MEDIACODEC);
+    in.has_hw_frames = true;
+    in.hw_sw_format = FMT_P010LE;
+    in.decoder_sw_format = FMT_NV12;    // hw_frames_ctx优先于解码器
+    PixelLayout out = resolve(in);
+    EXPECT_EQ(FMT_P010LE, out.layout);
+    EXPECT_TRUE(out.hw_surface);
+}
+
+TEST(PixelLayoutTest, OtherHwFramesAreNotSurfaceOutput) {
+    PixelLayoutInput in = softwareFrame(FMT_VAAPI);
+    in.has_hw_frames = true;
+    in.hw_sw_format = FMT_NV12;
+    PixelLayout out = resolve(in);
+    EXPECT_EQ(FMT_NV12, out.layout);
+    EXPECT_FALSE(out.hw_surface);
+}
+
+TEST(PixelLayoutTest, UnknownLayoutIsRejected) {
+    PixelLayout out = resolve(softwareFrame(FMT_UNKNOWN));
+    EXPECT_EQ(FMT_NONE, out.layout);
+    EXPECT_FALSE(out.hw_surface);
+
+    PixelLayoutInput in = softwareFrame(FMT_MEDIACODEC);
+    in.has_hw_frames = true;
+    in.hw_sw_format = FMT_UNKNOWN;
+    out = resolve(in);
+    EXPECT_EQ(FMT_NONE, out.layout);
+    EXPECT_TRUE(out.hw_surface);
+}
+
+TEST(PixelLayoutTest, NoneFrameFormatStaysNone) {
+    PixelLayout out = resolve(softwareFrame(FMT_NONE));
+    EXPECT_EQ(FMT_NONE, out.layout);
+    EXPECT_FALSE(out.hw_surface);
+}
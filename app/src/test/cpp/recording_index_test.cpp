@@ -0,0 +1,270 @@
+#include "recording_index.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+const int64_t kNoTs = INT64_MIN;
+const int64_t kFrame = 3000;        // 90kHz下30fps的帧间隔
+
+// 8字节对齐的文件内容，与mmap的起点一样满足记录的对齐要求
+class IndexBytes {
+public:
+    explicit IndexBytes(const std::vector<uint8_t>& bytes) : words((bytes.size() + 7) / 8) {
+        if (!bytes.empty()) {
+            memcpy(words.data(), bytes.data(), bytes.size());
+        }
+        length = bytes.size();
+    }
+
+    const uint8_t* data() const {
+        return reinterpret_cast<const uint8_t*>(words.data());
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+private:
+    std::vector<uint64_t> words;
+    size_t length;
+};
+
+std::string tempMediaPath() {
+    char path[] = "/tmp/ffw_index_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd >= 0) {
+        close(fd);
+    }
+    return path;
+}
+
+std::vector<uint8_t> readFile(const std::string& path) {
+    std::vector<uint8_t> bytes;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return bytes;
+    }
+    uint8_t buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        bytes.insert(bytes.end(), buffer, buffer + n);
+    }
+    fclose(file);
+    return bytes;
+}
+
+// 录制器写出的索引：frames帧，每gop帧一个关键帧，每个P帧后跟两个B帧（解码顺序I P B B P B B ...），
+// dts比pts早两帧
+std::vector<uint8_t> writeIndex(int frames, int gop) {
+    std::string media = tempMediaPath();
+    {
+        RecordingIndexWriter writer;
+        EXPECT_TRUE(writer.open(media, 1, 90000));
+        for (int i = 0; i < frames; i++) {
+            int in_gop = i % gop;
+            // GOP内的显示顺序号：I=0，之后按P(+3) B(-2) B(-1)的解码顺序
+            int display = in_gop == 0 ? 0 : in_gop + ((in_gop - 1) % 3 == 0 ? 2 : -1);
+            int64_t pts = (int64_t)(i - in_gop + display) * kFrame;
+            int64_t dts = (int64_t)(i - 2) * kFrame;
+            writer.stage(pts, dts, 1000 + i, in_gop == 0, kNoTs);
+            writer.commit();
+        }
+    }
+    std::vector<uint8_t> bytes = readFile(media + ".idx");
+    unlink((media + ".idx").c_str());
+    unlink(media.c_str());
+    return bytes;
+}
+
+RecordingIndexHeader* headerOf(std::vector<uint8_t>& bytes) {
+    return reinterpret_cast<RecordingIndexHeader*>(bytes.data());
+}
+
+RecordingIndexEntry* entryOf(std::vector<uint8_t>& bytes, size_t index) {
+    return reinterpret_cast<RecordingIndexEntry*>(bytes.data() + sizeof(RecordingIndexHeader)) + index;
+}
+
+TEST(RecordingIndexTest, WriterReaderRoundTrip) {
+    IndexBytes file(writeIndex(90, 30));
+    ASSERT_EQ(file.size(), sizeof(RecordingIndexHeader) + 90 * sizeof(RecordingIndexEntry));
+    RecordingIndexView index;
+    ASSERT_TRUE(index.load(file.data(), file.size()));
+    EXPECT_EQ(index.size(), 90u);
+    EXPECT_EQ(index.timeBaseNum(), 1);
+    EXPECT_EQ(index.timeBaseDen(), 90000);
+    for (size_t i = 0; i < index.size(); i++) {
+        EXPECT_EQ(index.entry(i).keyframe_index, i / 30 * 30) << i;
+        EXPECT_EQ(index.entry(i).size, 1000 + i) << i;
+        EXPECT_EQ((index.entry(i).flags & RECORDING_INDEX_FLAG_KEY) != 0, i % 30 == 0) << i;
+    }
+}
+
+TEST(RecordingIndexTest, FindKeyframeReturnsGopStart) {
+    IndexBytes file(writeIndex(90, 30));
+    RecordingIndexView index;
+    ASSERT_TRUE(index.load(file.data(), file.size()));
+    EXPECT_EQ(index.findKeyframe(0), 0);
+    EXPECT_EQ(index.findKeyframe(29 * kFrame), 0);
+    EXPECT_EQ(index.findKeyframe(30 * kFrame), 30);
+    EXPECT_EQ(index.findKeyframe(75 * kFrame), 60);
+    EXPECT_EQ(index.findKeyframe(1000 * kFrame), 60);
+    // 早于第一条记录的dts
+    EXPECT_EQ(index.findKeyframe(-100 * kFrame), 0);
+}
+
+TEST(RecordingIndexTest, KeyframeWithLaterPtsStepsBackOneGop) {
+    IndexBytes file(writeIndex(90, 30));
+    RecordingIndexView index;
+    ASSERT_TRUE(index.load(file.data(), file.size()));
+    // 第30条（关键帧）的dts为28帧，pts为30帧：目标在两者之间时落在上一个GOP
+    EXPECT_EQ(index.findKeyframe(29 * kFrame), 0);
+    EXPECT_EQ(index.findKeyframe(59 * kFrame), 30);
+}
+
+TEST(RecordingIndexTest, MissingDtsFallsBackToPts) {
+    std::string media = tempMediaPath();
+    {
+        RecordingIndexWriter writer;
+        ASSERT_TRUE(writer.open(media, 1, 1000));
+        writer.stage(40, kNoTs, 10, true, kNoTs);
+        writer.commit();
+    }
+    IndexBytes file(readFile(media + ".idx"));
+    unlink((media + ".idx").c_str());
+    unlink(media.c_str());
+    RecordingIndexView index;
+    ASSERT_TRUE(index.load(file.data(), file.size()));
+    EXPECT_EQ(index.entry(0).dts, 40);
+}
+
+TEST(RecordingIndexTest, InterruptedRecordingInfersCountFromLength) {
+    // 录制中断：条数未回写，最后一条只写了一半
+    std::vector<uint8_t> bytes = writeIndex(45, 30);
+    headerOf(bytes)->entry_count = 0;
+    bytes.resize(bytes.size() - sizeof(RecordingIndexEntry) / 2);
+    IndexBytes file(bytes);
+    RecordingIndexView index;
+    ASSERT_TRUE(index.load(file.data(), file.size()));
+    EXPECT_EQ(index.size(), 44u);
+    EXPECT_EQ(index.findKeyframe(40 * kFrame), 30);
+}
+
+TEST(RecordingIndexTest, CountLargerThanFileIsClamped) {
+    std::vector<uint8_t> bytes = writeIndex(60, 30);
+    headerOf(bytes)->entry_count = 1000000;
+    IndexBytes file(bytes);
+    RecordingIndexView index;
+    ASSERT_TRUE(index.load(file.data(), file.size()));
+    EXPECT_EQ(index.size(), 60u);
+}
+
+TEST(RecordingIndexTest, TruncatedFilesAreRejectedOrClamped) {
+    std::vector<uint8_t> bytes = writeIndex(60, 30);
+    for (size_t size = 0; size <= bytes.size(); size++) {
+        IndexBytes file(std::vector<uint8_t>(bytes.begin(), bytes.begin() + size));
+        RecordingIndexView index;
+        bool loaded = index.load(file.data(), file.size());
+        size_t complete = size < sizeof(RecordingIndexHeader) ? 0 :
+                          (size - sizeof(RecordingIndexHeader)) / sizeof(RecordingIndexEntry);
+        EXPECT_EQ(loaded, complete > 0) << size;
+        EXPECT_EQ(index.size(), complete) << size;
+        if (loaded) {
+            int64_t key = index.findKeyframe(59 * kFrame);
+            EXPECT_GE(key, 0) << size;
+            EXPECT_LT((size_t)key, index.size()) << size;
+        }
+    }
+}
+
+TEST(RecordingIndexTest, CorruptHeadersAreRejected) {
+    const std::vector<uint8_t> good = writeIndex(10, 5);
+    std::vector<void (*)(RecordingIndexHeader*)> corruptions = {
+        [](RecordingIndexHeader* h) { h->magic ^= 1; },
+        [](RecordingIndexHeader* h) { h->version = 1; },
+        [](RecordingIndexHeader* h) { h->entry_size = 0; },
+        [](RecordingIndexHeader* h) { h->entry_size = sizeof(RecordingIndexEntry) + 8; },
+        [](RecordingIndexHeader* h) { h->header_size = 0; },
+        [](RecordingIndexHeader* h) { h->header_size = sizeof(RecordingIndexHeader) + 4; },
+        // 头部长度超过文件长度：按长度推算条数时不能下溢
+        [](RecordingIndexHeader* h) { h->header_size = 0x7FFFFFF8; },
+        [](RecordingIndexHeader* h) { h->header_size = 0xFFFFFFF8; },
+        [](RecordingIndexHeader* h) { h->time_base_num = 0; },
+        [](RecordingIndexHeader* h) { h->time_base_den = -1; },
+    };
+    for (size_t i = 0; i < corruptions.size(); i++) {
+        std::vector<uint8_t> bytes = good;
+        corruptions[i](headerOf(bytes));
+        IndexBytes file(bytes);
+        RecordingIndexView index;
+        EXPECT_FALSE(index.load(file.data(), file.size())) << "corruption " << i;
+        EXPECT_EQ(index.size(), 0u) << "corruption " << i;
+        EXPECT_EQ(index.findKeyframe(0), -1) << "corruption " << i;
+    }
+}
+
+TEST(RecordingIndexTest, HeaderSizeEqualToFileSizeHasNoEntries) {
+    std::vector<uint8_t> bytes = writeIndex(10, 5);
+    headerOf(bytes)->header_size = (uint32_t)bytes.size();
+    IndexBytes file(bytes);
+    RecordingIndexView index;
+    EXPECT_FALSE(index.load(file.data(), file.size()));
+    EXPECT_EQ(index.findKeyframe(0), -1);
+}
+
+TEST(RecordingIndexTest, OutOfRangeKeyframeIndexIsRejected) {
+    std::vector<uint8_t> bytes = writeIndex(60, 30);
+    entryOf(bytes, 45)->keyframe_index = 1000;
+    IndexBytes file(bytes);
+    RecordingIndexView index;
+    ASSERT_TRUE(index.load(file.data(), file.size()));
+    // 第45条的dts为43帧
+    EXPECT_EQ(index.findKeyframe(43 * kFrame), -1);
+    EXPECT_EQ(index.findKeyframe(20 * kFrame), 0);
+}
+
+TEST(RecordingIndexTest, OutOfRangeFirstEntryIsRejected) {
+    // 目标早于所有记录时走第一条记录
+    std::vector<uint8_t> bytes = writeIndex(60, 30);
+    entryOf(bytes, 0)->keyframe_index = 0xFFFFFFFF;
+    IndexBytes file(bytes);
+    RecordingIndexView index;
+    ASSERT_TRUE(index.load(file.data(), file.size()));
+    EXPECT_EQ(index.findKeyframe(-100 * kFrame), -1);
+}
+
+TEST(RecordingIndexTest, StepBackMustStrictlyDecrease) {
+    // 关键帧30的pts晚于目标，要退回上一个GOP；前一条记录指回30自己（成环）或指向更后面
+    for (uint32_t bad : {30u, 45u}) {
+        std::vector<uint8_t> bytes = writeIndex(60, 30);
+        entryOf(bytes, 29)->keyframe_index = bad;
+        IndexBytes file(bytes);
+        RecordingIndexView index;
+        ASSERT_TRUE(index.load(file.data(), file.size()));
+        EXPECT_EQ(index.findKeyframe(29 * kFrame), -1) << bad;
+    }
+}
+
+TEST(RecordingIndexTest, StepBackChainsUntilPtsFits) {
+    // 损坏但单调的keyframe_index：每步都严格减小，最终停在0
+    std::vector<uint8_t> bytes = writeIndex(60, 30);
+    for (size_t i = 0; i < 60; i++) {
+        entryOf(bytes, i)->keyframe_index = (uint32_t)i;
+        entryOf(bytes, i)->pts = 1000 * kFrame;
+    }
+    entryOf(bytes, 0)->pts = 0;
+    IndexBytes file(bytes);
+    RecordingIndexView index;
+    ASSERT_TRUE(index.load(file.data(), file.size()));
+    EXPECT_EQ(index.findKeyframe(40 * kFrame), 0);
+}
+
+}  // namespace
@@ -0,0 +1,263 @@
+// 录制流水线的持续帧率：与ModernRecorder相同的转换→编码→封装三级，经BoundedQueue串联
+// （队列容量4/4/64，输入端阻塞入队，即文件转码的blocking_input模式），对比同一线程串行执行。
+// 源帧为1080p NV12（硬件解码器的输出格式），编码器libx264按录制默认配置（ultrafast + zerolatency，
+// 6Mbps VBR，GOP 30，帧级多线程自动），封装为MP4写入临时文件。
+// 参数scale=0时编码器直接接收NV12（与源格式相同，免转换）；scale=1时转换线程用sws缩放到720p YUV420P
+#include "bounded_queue.h"
+#include "encoder_config.h"
+#include "synthetic_video.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/opt.h>
+#include <libswscale/swscale.h>
+}
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+const int kSourceWidth = 1920;
+const int kSourceHeight = 1080;
+const int kFrameRate = 30;
+const int kFrames = 10 * kFrameRate;
+const int kDistinctFrames = 30;
+
+AVFrame* allocFrame(AVPixelFormat format, int width, int height) {
+    AVFrame* frame = av_frame_alloc();
+    frame->format = format;
+    frame->width = width;
+    frame->height = height;
+    if (av_frame_get_buffer(frame, 0) < 0) {
+        av_frame_free(&frame);
+    }
+    return frame;
+}
+
+// 预先生成的NV12源帧，循环使用
+std::vector<AVFrame*> makeSourceFrames() {
+    SyntheticVideo video(kSourceWidth, kSourceHeight);
+    AVFrame* yuv = allocFrame(AV_PIX_FMT_YUV420P, kSourceWidth, kSourceHeight);
+    SwsContext* sws = sws_getContext(kSourceWidth, kSourceHeight, AV_PIX_FMT_YUV420P, kSourceWidth, kSourceHeight,
+                                     AV_PIX_FMT_NV12, SWS_POINT, nullptr, nullptr, nullptr);
+    std::vector<AVFrame*> frames;
+    for (int i = 0; i < kDistinctFrames; i++) {
+        video.fill(yuv, i);
+        AVFrame* nv12 = allocFrame(AV_PIX_FMT_NV12, kSourceWidth, kSourceHeight);
+        sws_scale(sws, yuv->data, yuv->linesize, 0, kSourceHeight, nv12->data, nv12->linesize);
+        frames.push_back(nv12);
+    }
+    sws_freeContext(sws);
+    av_frame_free(&yuv);
+    return frames;
+}
+
+class Recording {
+public:
+    Recording(bool scale) : output(nullptr), stream(nullptr), encoder(nullptr), sws(nullptr), ok(false) {
+        width = scale ? 1280 : kSourceWidth;
+        height = scale ? 720 : kSourceHeight;
+        format = scale ? AV_PIX_FMT_YUV420P : AV_PIX_FMT_NV12;
+        char path_template[] = "/tmp/ffw_recording_XXXXXX";
+        int fd = mkstemp(path_template);
+        if (fd < 0) {
+            return;
+        }
+        close(fd);
+        path = std::string(path_template) + ".mp4";
+        rename(path_template, path.c_str());
+        ok = open();
+    }
+
+    ~Recording() {
+        if (output) {
+            avio_closep(&output->pb);
+            avformat_free_context(output);
+        }
+        avcodec_free_context(&encoder);
+        sws_freeContext(sws);
+        if (!path.empty()) {
+            unlink(path.c_str());
+        }
+    }
+
+    bool isOpen() const {
+        return ok;
+    }
+
+    // 转换阶段：格式和尺寸相同时只引用源帧（与录制器免转换路径相同），否则sws转换
+    AVFrame* convert(const AVFrame* source, int64_t pts) {
+        AVFrame* out;
+        if (!sws) {
+            out = av_frame_alloc();
+            av_frame_ref(out, source);
+        } else {
+            out = allocFrame(format, width, height);
+            sws_scale(sws, source->data, source->linesize, 0, kSourceHeight, out->data, out->linesize);
+        }
+        out->pts = pts;
+        return out;
+    }
+
+    // 编码阶段：frame为nullptr时冲刷；每个输出包交给sink
+    template <typename Sink>
+    void encode(AVFrame* frame, Sink sink) {
+        avcodec_send_frame(encoder, frame);
+        while (true) {
+            AVPacket* pkt = av_packet_alloc();
+            if (avcodec_receive_packet(encoder, pkt) < 0) {
+                av_packet_free(&pkt);
+                break;
+            }
+            av_packet_rescale_ts(pkt, encoder->time_base, stream->time_base);
+            pkt->stream_index = stream->index;
+            sink(pkt);
+        }
+    }
+
+    // 封装阶段
+    void mux(AVPacket* pkt) {
+        av_interleaved_write_frame(output, pkt);
+        av_packet_free(&pkt);
+    }
+
+    void finish() {
+        av_write_trailer(output);
+    }
+
+private:
+    std::string path;
+    int width;
+    int height;
+    AVPixelFormat format;
+    AVFormatContext* output;
+    AVStream* stream;
+    AVCodecContext* encoder;
+    SwsContext* sws;
+    bool ok;
+
+    bool open() {
+        const AVCodec* codec = avcodec_find_encoder_by_name("libx264");
+        if (!codec || avformat_alloc_output_context2(&output, nullptr, "mp4", path.c_str()) < 0) {
+            return false;
+        }
+        encoder = avcodec_alloc_context3(codec);
+        EncoderConfig config;
+        config.fillDefaults(width, height, kFrameRate);
+        encoder->width = width;
+        encoder->height = height;
+        encoder->pix_fmt = format;
+        encoder->time_base = AVRational{1, kFrameRate};
+        encoder->framerate = AVRational{kFrameRate, 1};
+        encoder->bit_rate = config.bitrate;
+        encoder->rc_max_rate = encoderPeakBitrate(config);
+        encoder->rc_buffer_size = (int)config.bitrate;
+        encoder->gop_size = config.gop_length;
+        encoder->max_b_frames = 0;
+        encoder->level = selectH264Level(width, height, kFrameRate, encoderPeakBitrate(config)).idc;
+        encoder->thread_type = FF_THREAD_FRAME;
+        encoder->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+        av_opt_set(encoder->priv_data, "preset", config.preset.c_str(), 0);
+        av_opt_set(encoder->priv_data, "tune", "zerolatency", 0);
+        if (avcodec_open2(encoder, codec, nullptr) < 0) {
+            return false;
+        }
+        if (format != AV_PIX_FMT_NV12 || width != kSourceWidth) {
+            sws = sws_getContext(kSourceWidth, kSourceHeight, AV_PIX_FMT_NV12, width, height, format,
+                                 SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
+        }
+        stream = avformat_new_stream(output, nullptr);
+        if (!stream || avcodec_parameters_from_context(stream->codecpar, encoder) < 0) {
+            return false;
+        }
+        stream->time_base = encoder->time_base;
+        return avio_open(&output->pb, path.c_str(), AVIO_FLAG_WRITE) >= 0 &&
+               avformat_write_header(output, nullptr) >= 0;
+    }
+};
+
+void BM_RecordSerial(benchmark::State& state) {
+    std::vector<AVFrame*> sources = makeSourceFrames();
+    for (auto _ : state) {
+        Recording recording(state.range(0) != 0);
+        if (!recording.isOpen()) {
+            state.SkipWithError("libx264/mp4 output unavailable");
+            break;
+        }
+        for (int i = 0; i < kFrames; i++) {
+            AVFrame* frame = recording.convert(sources[i % kDistinctFrames], i);
+            recording.encode(frame, [&](AVPacket* pkt) { recording.mux(pkt); });
+            av_frame_free(&frame);
+        }
+        recording.encode(nullptr, [&](AVPacket* pkt) { recording.mux(pkt); });
+        recording.finish();
+    }
+    for (size_t i = 0; i < sources.size(); i++) {
+        av_frame_free(&sources[i]);
+    }
+    state.counters["fps"] = benchmark::Counter((double)kFrames * state.iterations(), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_RecordSerial)->ArgName("scale")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// 与ModernRecorder相同的三级流水线：调用线程阻塞入队待转换帧，转换/编码/封装各一个线程
+void BM_RecordPipelined(benchmark::State& state) {
+    std::vector<AVFrame*> sources = makeSourceFrames();
+    for (auto _ : state) {
+        Recording recording(state.range(0) != 0);
+        if (!recording.isOpen()) {
+            state.SkipWithError("libx264/mp4 output unavailable");
+            break;
+        }
+        BoundedQueue<int> convert_queue(4);
+        BoundedQueue<AVFrame*> encode_queue(4);
+        BoundedQueue<AVPacket*> mux_queue(64);
+        std::thread convert_thread([&]() {
+            int index = 0;
+            while (convert_queue.pop(index)) {
+                encode_queue.push(recording.convert(sources[index % kDistinctFrames], index));
+            }
+            encode_queue.close();
+        });
+        std::thread encode_thread([&]() {
+            AVFrame* frame = nullptr;
+            while (encode_queue.pop(frame)) {
+                recording.encode(frame, [&](AVPacket* pkt) { mux_queue.push(pkt); });
+                av_frame_free(&frame);
+            }
+            recording.encode(nullptr, [&](AVPacket* pkt) { mux_queue.push(pkt); });
+            mux_queue.close();
+        });
+        std::thread mux_thread([&]() {
+            AVPacket* pkt = nullptr;
+            while (mux_queue.pop(pkt)) {
+                recording.mux(pkt);
+            }
+        });
+        for (int i = 0; i < kFrames; i++) {
+            convert_queue.push(i);
+        }
+        convert_queue.close();
+        convert_thread.join();
+        encode_thread.join();
+        mux_thread.join();
+        recording.finish();
+    }
+    for (size_t i = 0; i < sources.size(); i++) {
+        av_frame_free(&sources[i]);
+    }
+    state.counters["fps"] = benchmark::Counter((double)kFrames * state.iterations(), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_RecordPipelined)->ArgName("scale")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+}  // namespace
+
+BENCHMARK_MAIN();
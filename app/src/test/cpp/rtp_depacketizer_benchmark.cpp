@@ -0,0 +1,150 @@
+// RTP解包吞吐：按1080p低延迟流的大致码流合成RTP包序列（每30帧一个约120KB的IDR，
+// 其余P帧约15KB，超过1400字节的NAL按FU-A分片，参数集用STAP-A）。
+// Sink把访问单元写入预先分配的缓冲区，与设备上写入AVBufferPool缓冲区的复制量相同
+#include "rtp_depacketizer.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const int kPayloadType = 96;
+const size_t kMaxPayload = 1400;
+
+struct BufferSink {
+    std::vector<uint8_t> buffer;
+    size_t size;
+    int64_t last_pts;
+
+    BufferSink() : buffer(2 * 1024 * 1024), size(0), last_pts(0) {}
+
+    bool appendAccessUnit(const uint8_t* data, size_t len) {
+        if (size + len > buffer.size()) {
+            return false;
+        }
+        memcpy(buffer.data() + size, data, len);
+        size += len;
+        return true;
+    }
+
+    bool completeAccessUnit(int64_t pts, bool, bool) {
+        last_pts = pts;
+        size = 0;
+        return true;
+    }
+
+    void discardAccessUnit() {
+        size = 0;
+    }
+};
+
+void appendRtp(std::vector<std::vector<uint8_t> >& packets, uint16_t& seq, uint32_t timestamp, bool marker,
+               const std::vector<uint8_t>& payload) {
+    std::vector<uint8_t> packet(12);
+    packet[0] = 0x80;
+    packet[1] = (uint8_t)((marker ? 0x80 : 0) | kPayloadType);
+    packet[2] = (uint8_t)(seq >> 8);
+    packet[3] = (uint8_t)seq;
+    packet[4] = (uint8_t)(timestamp >> 24);
+    packet[5] = (uint8_t)(timestamp >> 16);
+    packet[6] = (uint8_t)(timestamp >> 8);
+    packet[7] = (uint8_t)timestamp;
+    packet.insert(packet.end(), payload.begin(), payload.end());
+    packets.push_back(packet);
+    seq++;
+}
+
+// 一个NAL：能放进一个包时单NAL打包，否则FU-A分片
+void packetizeNal(std::vector<std::vector<uint8_t> >& packets, uint16_t& seq, uint32_t timestamp, bool last_nal,
+                  const std::vector<uint8_t>& nal) {
+    if (nal.size() <= kMaxPayload) {
+        appendRtp(packets, seq, timestamp, last_nal, nal);
+        return;
+    }
+    size_t pos = 1;
+    while (pos < nal.size()) {
+        size_t chunk = std::min(kMaxPayload - 2, nal.size() - pos);
+        std::vector<uint8_t> payload;
+        payload.push_back((uint8_t)((nal[0] & 0xE0) | 28));
+        uint8_t fu_header = nal[0] & 0x1F;
+        if (pos == 1) {
+            fu_header |= 0x80;
+        }
+        if (pos + chunk == nal.size()) {
+            fu_header |= 0x40;
+        }
+        payload.push_back(fu_header);
+        payload.insert(payload.end(), nal.begin() + pos, nal.begin() + pos + chunk);
+        pos += chunk;
+        appendRtp(packets, seq, timestamp, last_nal && pos == nal.size(), payload);
+    }
+}
+
+// kGops个GOP的连续RTP包，总量（约4MB）超出缓存，接近实际的内存访问
+const int kGops = 10;
+const int kFramesPerGop = 30;
+
+std::vector<std::vector<uint8_t> > makeStream(size_t& payload_bytes) {
+    std::vector<std::vector<uint8_t> > packets;
+    uint16_t seq = 0;
+    payload_bytes = 0;
+    for (int frame = 0; frame < kGops * kFramesPerGop; frame++) {
+        uint32_t timestamp = (uint32_t)frame * 3000;
+        bool idr = frame % kFramesPerGop == 0;
+        if (idr) {
+            // STAP-A：SPS(12字节) + PPS(4字节)
+            std::vector<uint8_t> stap;
+            stap.push_back(24);
+            stap.push_back(0);
+            stap.push_back(12);
+            stap.push_back(0x67);
+            stap.insert(stap.end(), 11, 0x42);
+            stap.push_back(0);
+            stap.push_back(4);
+            stap.push_back(0x68);
+            stap.insert(stap.end(), 3, 0xCE);
+            appendRtp(packets, seq, timestamp, false, stap);
+        }
+        std::vector<uint8_t> nal(idr ? 120 * 1024 : 15 * 1024);
+        for (size_t i = 0; i < nal.size(); i++) {
+            nal[i] = (uint8_t)(i * 7 + frame);
+        }
+        nal[0] = idr ? 0x65 : 0x41;
+        payload_bytes += nal.size();
+        packetizeNal(packets, seq, timestamp, true, nal);
+    }
+    return packets;
+}
+
+// 每次迭代用新的解包器从头解包整段流（构造只是初始化几个字段）
+void BM_DepacketizeH264(benchmark::State& state) {
+    size_t payload_bytes = 0;
+    std::vector<std::vector<uint8_t> > packets = makeStream(payload_bytes);
+    BufferSink sink;
+    for (auto _ : state) {
+        RtpDepacketizer<BufferSink> depacketizer(sink);
+        depacketizer.configure(RtpDepacketizer<BufferSink>::CODEC_H264, kPayloadType);
+        for (size_t i = 0; i < packets.size(); i++) {
+            depacketizer.handlePacket(packets[i].data(), packets[i].size());
+        }
+        if (depacketizer.stats().aus != kGops * kFramesPerGop) {
+            state.SkipWithError("synthetic stream did not depacketize cleanly");
+            break;
+        }
+        benchmark::DoNotOptimize(sink.last_pts);
+    }
+    state.SetBytesProcessed(state.iterations() * (int64_t)payload_bytes);
+    state.counters["packets"] = benchmark::Counter((double)packets.size() * state.iterations(),
+                                                   benchmark::Counter::kIsRate);
+    state.counters["frames"] = benchmark::Counter((double)kGops * kFramesPerGop * state.iterations(),
+                                                  benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_DepacketizeH264)->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
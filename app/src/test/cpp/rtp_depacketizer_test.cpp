@@ -0,0 +1,300 @@
+#include "rtp_depacketizer.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+struct AccessUnit {
+    std::vector<uint8_t> data;
+    int64_t pts;
+    bool key;
+    bool by_marker;
+};
+
+struct VectorSink {
+    std::vector<uint8_t> current;
+    std::vector<AccessUnit> aus;
+    int discards;
+    size_t fail_after;      // 当前访问单元超过这个大小时追加失败（模拟超出缓冲区上限）
+
+    VectorSink() : discards(0), fail_after(SIZE_MAX) {}
+
+    bool appendAccessUnit(const uint8_t* data, size_t len) {
+        if (current.size() + len > fail_after) {
+            return false;
+        }
+        current.insert(current.end(), data, data + len);
+        return true;
+    }
+
+    bool completeAccessUnit(int64_t pts, bool key, bool by_marker) {
+        AccessUnit au;
+        au.data.swap(current);
+        au.pts = pts;
+        au.key = key;
+        au.by_marker = by_marker;
+        aus.push_back(au);
+        return true;
+    }
+
+    void discardAccessUnit() {
+        current.clear();
+        discards++;
+    }
+};
+
+typedef RtpDepacketizer<VectorSink> Depacketizer;
+
+const int kPayloadType = 96;
+
+std::vector<uint8_t> rtp(uint16_t seq, uint32_t timestamp, bool marker, const std::vector<uint8_t>& payload) {
+    std::vector<uint8_t> packet(12 + payload.size());
+    packet[0] = 0x80;
+    packet[1] = (uint8_t)((marker ? 0x80 : 0) | kPayloadType);
+    packet[2] = (uint8_t)(seq >> 8);
+    packet[3] = (uint8_t)seq;
+    packet[4] = (uint8_t)(timestamp >> 24);
+    packet[5] = (uint8_t)(timestamp >> 16);
+    packet[6] = (uint8_t)(timestamp >> 8);
+    packet[7] = (uint8_t)timestamp;
+    std::copy(payload.begin(), payload.end(), packet.begin() + 12);
+    return packet;
+}
+
+void feed(Depacketizer& depacketizer, const std::vector<uint8_t>& packet) {
+    depacketizer.handlePacket(packet.data(), packet.size());
+}
+
+std::vector<uint8_t> bytes(std::initializer_list<int> values) {
+    std::vector<uint8_t> out;
+    for (int v : values) {
+        out.push_back((uint8_t)v);
+    }
+    return out;
+}
+
+std::vector<uint8_t> annexB(std::initializer_list<std::vector<uint8_t> > nals) {
+    std::vector<uint8_t> out;
+    for (const std::vector<uint8_t>& nal : nals) {
+        out.push_back(0);
+        out.push_back(0);
+        out.push_back(0);
+        out.push_back(1);
+        out.insert(out.end(), nal.begin(), nal.end());
+    }
+    return out;
+}
+
+class RtpDepacketizerTest : public ::testing::Test {
+protected:
+    VectorSink sink;
+    Depacketizer depacketizer;
+
+    RtpDepacketizerTest() : depacketizer(sink) {
+        depacketizer.configure(Depacketizer::CODEC_H264, kPayloadType);
+    }
+};
+
+}  // namespace
+
+TEST_F(RtpDepacketizerTest, H264SingleNalUnits) {
+    feed(depacketizer, rtp(1, 1000, true, bytes({0x65, 0x88, 0x84})));     // IDR
+    feed(depacketizer, rtp(2, 4000, true, bytes({0x41, 0x9A, 0x00})));     // 非IDR
+    ASSERT_EQ(2u, sink.aus.size());
+    EXPECT_EQ(annexB({bytes({0x65, 0x88, 0x84})}), sink.aus[0].data);
+    EXPECT_TRUE(sink.aus[0].key);
+    EXPECT_TRUE(sink.aus[0].by_marker);
+    EXPECT_EQ(0, sink.aus[0].pts);
+    EXPECT_FALSE(sink.aus[1].key);
+    EXPECT_EQ(3000, sink.aus[1].pts);
+    EXPECT_EQ(2, depacketizer.stats().aus);
+    EXPECT_EQ(8 + 6, depacketizer.stats().bytes);
+}
+
+TEST_F(RtpDepacketizerTest, H264StapASplitsAggregatedNals) {
+    std::vector<uint8_t> sps = bytes({0x67, 0x42, 0x00, 0x1F});
+    std::vector<uint8_t> pps = bytes({0x68, 0xCE, 0x3C});
+    std::vector<uint8_t> idr = bytes({0x65, 0x11});
+    std::vector<uint8_t> stap = bytes({0x78, 0x00, 0x04});
+    stap.insert(stap.end(), sps.begin(), sps.end());
+    stap.push_back(0x00);
+    stap.push_back(0x03);
+    stap.insert(stap.end(), pps.begin(), pps.end());
+    stap.push_back(0x00);
+    stap.push_back(0x02);
+    stap.insert(stap.end(), idr.begin(), idr.end());
+    feed(depacketizer, rtp(10, 0, true, stap));
+    ASSERT_EQ(1u, sink.aus.size());
+    EXPECT_EQ(annexB({sps, pps, idr}), sink.aus[0].data);
+    EXPECT_TRUE(sink.aus[0].key);
+}
+
+TEST_F(RtpDepacketizerTest, H264StapAStopsAtTruncatedEntry) {
+    // 第二个NAL声明长度超出包尾
+    feed(depacketizer, rtp(10, 0, true, bytes({0x78, 0x00, 0x02, 0x41, 0x01, 0x00, 0x09, 0x41})));
+    ASSERT_EQ(1u, sink.aus.size());
+    EXPECT_EQ(annexB({bytes({0x41, 0x01})}), sink.aus[0].data);
+}
+
+TEST_F(RtpDepacketizerTest, H264FuAReassemblesFragments) {
+    // FU indicator: F/NRI=0x60, type 28；FU header: S/E + 原NAL类型5
+    feed(depacketizer, rtp(100, 9000, false, bytes({0x7C, 0x85, 0xAA, 0xBB})));
+    feed(depacketizer, rtp(101, 9000, false, bytes({0x7C, 0x05, 0xCC})));
+    feed(depacketizer, rtp(102, 9000, true, bytes({0x7C, 0x45, 0xDD, 0xEE})));
+    ASSERT_EQ(1u, sink.aus.size());
+    EXPECT_EQ(annexB({bytes({0x65, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE})}), sink.aus[0].data);
+    EXPECT_TRUE(sink.aus[0].key);
+    EXPECT_EQ(0, depacketizer.stats().lost_packets);
+}
+
+TEST_F(RtpDepacketizerTest, LossInsideFragmentDropsAccessUnit) {
+    feed(depacketizer, rtp(100, 9000, false, bytes({0x7C, 0x85, 0xAA})));
+    // 101丢失
+    feed(depacketizer, rtp(102, 9000, true, bytes({0x7C, 0x45, 0xDD})));
+    feed(depacketizer, rtp(103, 12000, true, bytes({0x41, 0x01})));
+    ASSERT_EQ(1u, sink.aus.size());
+    EXPECT_EQ(annexB({bytes({0x41, 0x01})}), sink.aus[0].data);
+    EXPECT_EQ(1, depacketizer.stats().lost_packets);
+    EXPECT_EQ(1, depacketizer.stats().dropped_aus);
+    EXPECT_EQ(1, sink.discards);
+}
+
+TEST_F(RtpDepacketizerTest, MissingFragmentStartDropsAccessUnit) {
+    // 新帧从一个非起始分片开始（起始包在序号上未丢失，例如发送端出错）
+    feed(depacketizer, rtp(1, 0, false, bytes({0x7C, 0x05, 0xCC})));
+    feed(depacketizer, rtp(2, 0, true, bytes({0x7C, 0x45, 0xDD})));
+    EXPECT_TRUE(sink.aus.empty());
+    EXPECT_EQ(1, depacketizer.stats().dropped_aus);
+}
+
+TEST_F(RtpDepacketizerTest, LostMarkerEndsFrameOnTimestampChange) {
+    feed(depacketizer, rtp(1, 0, false, bytes({0x41, 0x01})));
+    feed(depacketizer, rtp(2, 3000, true, bytes({0x41, 0x02})));
+    ASSERT_EQ(2u, sink.aus.size());
+    EXPECT_FALSE(sink.aus[0].by_marker);
+    EXPECT_TRUE(sink.aus[1].by_marker);
+    EXPECT_EQ(3000, sink.aus[1].pts);
+}
+
+TEST_F(RtpDepacketizerTest, TimestampAndSequenceWrapAround) {
+    feed(depacketizer, rtp(0xFFFF, 0xFFFFF000u, true, bytes({0x41, 0x01})));
+    feed(depacketizer, rtp(0x0000, 0x00000BB8u, true, bytes({0x41, 0x02})));
+    ASSERT_EQ(2u, sink.aus.size());
+    EXPECT_EQ(0x1000 + 0xBB8, sink.aus[1].pts);
+    EXPECT_EQ(0, depacketizer.stats().lost_packets);
+}
+
+TEST_F(RtpDepacketizerTest, LateAndDuplicatePacketsAreIgnored) {
+    feed(depacketizer, rtp(5, 0, true, bytes({0x41, 0x01})));
+    feed(depacketizer, rtp(5, 0, true, bytes({0x41, 0x01})));
+    feed(depacketizer, rtp(4, 0, true, bytes({0x41, 0x01})));
+    EXPECT_EQ(1u, sink.aus.size());
+    EXPECT_EQ(0, depacketizer.stats().lost_packets);
+}
+
+TEST_F(RtpDepacketizerTest, LargeBackwardJumpResyncs) {
+    // 发送端重启：序号从5000退回到100，之后的包不能全被当作迟到丢弃
+    feed(depacketizer, rtp(5000, 0, true, bytes({0x41, 0x01})));
+    feed(depacketizer, rtp(100, 3000, true, bytes({0x41, 0x02})));
+    feed(depacketizer, rtp(101, 6000, true, bytes({0x41, 0x03})));
+    ASSERT_EQ(3u, sink.aus.size());
+    EXPECT_EQ(annexB({bytes({0x41, 0x03})}), sink.aus[2].data);
+    EXPECT_EQ(0, depacketizer.stats().lost_packets);
+}
+
+TEST_F(RtpDepacketizerTest, BackwardJumpBelowResetDistanceIsLate) {
+    feed(depacketizer, rtp(5000, 0, true, bytes({0x41, 0x01})));
+    feed(depacketizer, rtp((uint16_t)(5001 - 999), 3000, true, bytes({0x41, 0x02})));
+    feed(depacketizer, rtp(5001, 6000, true, bytes({0x41, 0x03})));
+    ASSERT_EQ(2u, sink.aus.size());
+    EXPECT_EQ(annexB({bytes({0x41, 0x03})}), sink.aus[1].data);
+    EXPECT_EQ(0, depacketizer.stats().lost_packets);
+}
+
+TEST_F(RtpDepacketizerTest, ResyncDropsPartialAccessUnit) {
+    // 分片进行中序号重置：已写入的前半帧作废，重置后的新帧正常交付
+    feed(depacketizer, rtp(5000, 0, false, bytes({0x7C, 0x85, 0xAA})));
+    feed(depacketizer, rtp(7, 3000, true, bytes({0x41, 0x02})));
+    ASSERT_EQ(1u, sink.aus.size());
+    EXPECT_EQ(annexB({bytes({0x41, 0x02})}), sink.aus[0].data);
+    EXPECT_EQ(1, depacketizer.stats().dropped_aus);
+}
+
+TEST_F(RtpDepacketizerTest, HeaderExtensionCsrcAndPadding) {
+    std::vector<uint8_t> packet = rtp(1, 0, true, std::vector<uint8_t>());
+    packet[0] = 0x80 | 0x20 | 0x10 | 0x01;      // padding + extension + 1个CSRC
+    packet.insert(packet.end(), {0, 0, 0, 1});                  // CSRC
+    packet.insert(packet.end(), {0xBE, 0xDE, 0x00, 0x01});      // 扩展头，1个字
+    packet.insert(packet.end(), {1, 2, 3, 4});
+    packet.insert(packet.end(), {0x41, 0x07});                  // 负载
+    packet.insert(packet.end(), {0, 0, 3});                     // 3字节填充
+    feed(depacketizer, packet);
+    ASSERT_EQ(1u, sink.aus.size());
+    EXPECT_EQ(annexB({bytes({0x41, 0x07})}), sink.aus[0].data);
+}
+
+TEST_F(RtpDepacketizerTest, MalformedPacketsAreRejected) {
+    std::vector<uint8_t> bad_padding = rtp(1, 0, true, bytes({0x41, 0x07, 0xFF}));
+    bad_padding[0] |= 0x20;     // 填充长度255超过负载
+    feed(depacketizer, bad_padding);
+    std::vector<uint8_t> zero_padding = rtp(1, 0, true, bytes({0x41, 0x07, 0x00}));
+    zero_padding[0] |= 0x20;
+    feed(depacketizer, zero_padding);
+    std::vector<uint8_t> wrong_version = rtp(1, 0, true, bytes({0x41, 0x07}));
+    wrong_version[0] = 0x40;
+    feed(depacketizer, wrong_version);
+    std::vector<uint8_t> wrong_type = rtp(1, 0, true, bytes({0x41, 0x07}));
+    wrong_type[1] = 0x80 | 97;
+    feed(depacketizer, wrong_type);
+    std::vector<uint8_t> short_packet(11, 0x80);
+    feed(depacketizer, short_packet);
+    EXPECT_TRUE(sink.aus.empty());
+    EXPECT_EQ(2, depacketizer.stats().received);    // 只有两个填充错误的包负载类型匹配
+}
+
+TEST_F(RtpDepacketizerTest, InterleavedModesMarkFrameCorrupt) {
+    feed(depacketizer, rtp(1, 0, false, bytes({0x41, 0x01})));
+    feed(depacketizer, rtp(2, 0, true, bytes({0x79, 0x00, 0x00})));     // STAP-B
+    EXPECT_TRUE(sink.aus.empty());
+    EXPECT_EQ(1, depacketizer.stats().dropped_aus);
+}
+
+TEST_F(RtpDepacketizerTest, SinkFailureDropsOnlyThatFrame) {
+    sink.fail_after = 8;
+    feed(depacketizer, rtp(1, 0, true, bytes({0x65, 1, 2, 3, 4, 5})));     // 4+6字节超出
+    sink.fail_after = SIZE_MAX;
+    feed(depacketizer, rtp(2, 3000, true, bytes({0x41, 0x01})));
+    ASSERT_EQ(1u, sink.aus.size());
+    EXPECT_EQ(3000, sink.aus[0].pts);
+    EXPECT_EQ(1, depacketizer.stats().dropped_aus);
+}
+
+TEST_F(RtpDepacketizerTest, HevcSingleAggregationAndFragmentation) {
+    depacketizer.configure(Depacketizer::CODEC_HEVC, kPayloadType);
+    // 单NAL：TRAIL_R(1)，NAL头两字节
+    feed(depacketizer, rtp(1, 0, true, bytes({0x02, 0x01, 0xAA})));
+    // AP(48)：VPS(32) + IDR_W_RADL(19)
+    std::vector<uint8_t> vps = bytes({0x40, 0x01, 0x0C});
+    std::vector<uint8_t> idr = bytes({0x26, 0x01, 0xAF});
+    std::vector<uint8_t> ap = bytes({0x60, 0x01, 0x00, 0x03});
+    ap.insert(ap.end(), vps.begin(), vps.end());
+    ap.push_back(0x00);
+    ap.push_back(0x03);
+    ap.insert(ap.end(), idr.begin(), idr.end());
+    feed(depacketizer, rtp(2, 3000, true, ap));
+    // FU(49)：PayloadHdr 0x62 0x01，FU header S/E + 类型19
+    feed(depacketizer, rtp(3, 6000, false, bytes({0x62, 0x01, 0x93, 0x11})));
+    feed(depacketizer, rtp(4, 6000, true, bytes({0x62, 0x01, 0x53, 0x22})));
+
+    ASSERT_EQ(3u, sink.aus.size());
+    EXPECT_EQ(annexB({bytes({0x02, 0x01, 0xAA})}), sink.aus[0].data);
+    EXPECT_FALSE(sink.aus[0].key);
+    EXPECT_EQ(annexB({vps, idr}), sink.aus[1].data);
+    EXPECT_TRUE(sink.aus[1].key);
+    EXPECT_EQ(annexB({bytes({0x26, 0x01, 0x11, 0x22})}), sink.aus[2].data);
+    EXPECT_TRUE(sink.aus[2].key);
+}
@@ -0,0 +1,267 @@
+// RTP直通UDP（重排窗口）与TCP交织在注入丢包下的帧延迟分布 - 离散事件模型，不是实测：
+// 主机上没有netem（tc报"Specified qdisc kind is unknown"），用户态丢包又触发不了内核TCP重传，
+// 所以两种传输都在模拟时间里推演，UDP一侧跑的是设备上同一份RtpReorderWindow + RtpDepacketizer。
+// 码流：30fps，每30帧一个约120KB的IDR（88包），其余P帧约15KB（11包），每包1400字节负载，
+// 在50Mbps瓶颈上按串行化时间排队发出；路径单向时延15ms，排队抖动0~2ms但保持先后顺序，
+// 另有0.5%的包绕行多出0~3ms（造成乱序）；每个包（含重传）独立以给定概率丢失。
+// 两种传输用同一组丢包/到达时间样本。
+// TCP：按序交付，丢失的包在第3个后续包触发的重复ACK回到发送端时快速重传，
+//      没有足够的后续包时等RTO（最小200ms，重传再丢失时加倍）；不模拟拥塞窗口减半，TCP一侧偏乐观。
+// UDP：丢包的帧整帧作废，同一GOP后续的P帧也无法解码（unusable_pct），延迟只统计交付的帧。
+// 帧延迟 = 访问单元交给播放器的时刻 - 采集时刻（该帧第一个包进入发送队列）
+#include "rtp_depacketizer.h"
+#include "rtp_reorder_window.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+const int kPayloadType = 96;
+const int kFramesPerGop = 30;
+const int64_t kFrameIntervalUs = 1000000 / 30;
+const int kIdrPackets = 88;
+const int kPPackets = 11;
+const size_t kPayload = 1400;
+const int64_t kPacketSpacingUs = 226;          // 1412字节在50Mbps上的串行化时间
+const int64_t kOneWayUs = 15000;
+const int64_t kJitterUs = 2000;
+const double kDetourProbability = 0.005;
+const int64_t kDetourUs = 3000;
+const int64_t kMinRtoUs = 200000;
+const int kSimFrames = 120 * 30;               // 模拟两分钟
+const int kReorderPackets = 8;                 // RtpTransportConfig的默认值
+const int kReorderMs = 20;
+
+enum Transport { TRANSPORT_TCP, TRANSPORT_UDP_WINDOW, TRANSPORT_UDP_NO_WINDOW };
+
+struct Random {
+    uint64_t state;
+
+    explicit Random(uint64_t seed) : state(seed) {}
+
+    double uniform() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return (double)(state >> 11) * (1.0 / 9007199254740992.0);
+    }
+};
+
+struct SimPacket {
+    std::vector<uint8_t> data;
+    int frame;
+    int64_t send_us;
+};
+
+int64_t captureUs(int frame) {
+    return frame * kFrameIntervalUs;
+}
+
+// 每个包一个完整的NAL（多slice），帧的最后一个包带marker
+std::vector<SimPacket> makeStream() {
+    std::vector<SimPacket> packets;
+    uint16_t seq = 0;
+    int64_t link_free_us = 0;
+    for (int frame = 0; frame < kSimFrames; frame++) {
+        bool idr = frame % kFramesPerGop == 0;
+        int count = idr ? kIdrPackets : kPPackets;
+        uint32_t timestamp = (uint32_t)frame * 3000;
+        for (int i = 0; i < count; i++) {
+            SimPacket packet;
+            packet.data.assign(12 + kPayload, (uint8_t)frame);
+            packet.data[0] = 0x80;
+            packet.data[1] = (uint8_t)((i == count - 1 ? 0x80 : 0) | kPayloadType);
+            packet.data[2] = (uint8_t)(seq >> 8);
+            packet.data[3] = (uint8_t)seq;
+            packet.data[4] = (uint8_t)(timestamp >> 24);
+            packet.data[5] = (uint8_t)(timestamp >> 16);
+            packet.data[6] = (uint8_t)(timestamp >> 8);
+            packet.data[7] = (uint8_t)timestamp;
+            packet.data[12] = idr ? 0x65 : 0x41;
+            packet.frame = frame;
+            packet.send_us = std::max(captureUs(frame), link_free_us);
+            link_free_us = packet.send_us + kPacketSpacingUs;
+            packets.push_back(packet);
+            seq++;
+        }
+    }
+    return packets;
+}
+
+// 访问单元交付时记下帧延迟；模拟时钟由事件循环推进
+struct LatencySink {
+    const int64_t* now_us;
+    std::vector<int64_t> latency_us;        // 每帧一项，-1表示没有交付
+
+    explicit LatencySink(const int64_t* now) : now_us(now), latency_us(kSimFrames, -1) {}
+
+    bool appendAccessUnit(const uint8_t*, size_t) {
+        return true;
+    }
+
+    bool completeAccessUnit(int64_t pts, bool, bool) {
+        int frame = (int)(pts / 3000);
+        latency_us[frame] = *now_us - captureUs(frame);
+        return true;
+    }
+
+    void discardAccessUnit() {}
+};
+
+// 路径上每个包首次发送的结果
+struct PathSample {
+    std::vector<bool> lost;
+    std::vector<int64_t> arrival_us;
+};
+
+PathSample samplePath(const std::vector<SimPacket>& packets, double loss, Random& random) {
+    PathSample path;
+    int64_t fifo_us = 0;
+    for (size_t i = 0; i < packets.size(); i++) {
+        fifo_us = std::max(fifo_us, packets[i].send_us + kOneWayUs + (int64_t)(random.uniform() * kJitterUs));
+        int64_t arrival_us = fifo_us;
+        if (random.uniform() < kDetourProbability) {
+            arrival_us += (int64_t)(random.uniform() * kDetourUs);
+        }
+        path.lost.push_back(random.uniform() < loss);
+        path.arrival_us.push_back(arrival_us);
+    }
+    return path;
+}
+
+// TCP：每个包最终到达接收端的时间（含重传），再按序交付
+std::vector<int64_t> simulateTcp(const std::vector<SimPacket>& packets, const PathSample& path, double loss,
+                                 Random& random) {
+    size_t n = packets.size();
+    const std::vector<bool>& lost = path.lost;
+    const std::vector<int64_t>& arrival = path.arrival_us;
+    std::vector<int64_t> latency(kSimFrames, -1);
+    int64_t delivered_us = 0;
+    for (size_t i = 0; i < n; i++) {
+        int64_t arrived_us = arrival[i];
+        if (lost[i]) {
+            int64_t rto_us = kMinRtoUs;
+            int64_t resend_us = packets[i].send_us + rto_us;
+            int later = 0;
+            for (size_t j = i + 1; j < n && later < 3; j++) {
+                if (!lost[j] && ++later == 3) {
+                    resend_us = std::min(resend_us, arrival[j] + kOneWayUs);
+                }
+            }
+            while (random.uniform() < loss) {
+                rto_us *= 2;
+                resend_us += rto_us;
+            }
+            arrived_us = resend_us + kOneWayUs + (int64_t)(random.uniform() * kJitterUs);
+        }
+        delivered_us = std::max(delivered_us, arrived_us);
+        if (i + 1 == n || packets[i + 1].frame != packets[i].frame) {
+            latency[packets[i].frame] = delivered_us - captureUs(packets[i].frame);
+        }
+    }
+    return latency;
+}
+
+// UDP：与readDatagrams相同，包到达时放入窗口并交付，窗口中最早的包到期时再交付一次
+std::vector<int64_t> simulateUdp(const std::vector<SimPacket>& packets, const PathSample& path,
+                                 int reorder_packets) {
+    struct Arrival {
+        int64_t us;
+        size_t index;
+
+        bool operator<(const Arrival& other) const {
+            return us < other.us;
+        }
+    };
+    std::vector<Arrival> arrivals;
+    for (size_t i = 0; i < packets.size(); i++) {
+        if (!path.lost[i]) {
+            Arrival a = {path.arrival_us[i], i};
+            arrivals.push_back(a);
+        }
+    }
+    std::stable_sort(arrivals.begin(), arrivals.end());
+
+    int64_t now_us = 0;
+    LatencySink sink(&now_us);
+    RtpDepacketizer<LatencySink> depacketizer(sink);
+    depacketizer.configure(RtpDepacketizer<LatencySink>::CODEC_H264, kPayloadType);
+    RtpReorderWindow<RtpDepacketizer<LatencySink> > window(depacketizer);
+    window.configure(kPayloadType, reorder_packets, kReorderMs);
+    for (size_t i = 0; i < arrivals.size(); i++) {
+        int64_t wait_us;
+        while ((wait_us = window.waitUs(now_us)) >= 0 && now_us + wait_us < arrivals[i].us) {
+            now_us += wait_us;
+            window.release(false, now_us);
+        }
+        now_us = arrivals[i].us;
+        const std::vector<uint8_t>& data = packets[arrivals[i].index].data;
+        window.hold(data.data(), data.size(), now_us);
+        window.release(false, now_us);
+    }
+    window.release(true, now_us);
+    return sink.latency_us;
+}
+
+double percentileMs(std::vector<int64_t> values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t index = std::min(values.size() - 1, (size_t)(p * (double)values.size()));
+    return values[index] / 1000.0;
+}
+
+// 参数：传输方式，丢包率（万分之一）
+void BM_FrameLatencyUnderLoss(benchmark::State& state) {
+    Transport transport = (Transport)state.range(0);
+    double loss = state.range(1) / 10000.0;
+    std::vector<SimPacket> packets = makeStream();
+    std::vector<int64_t> latency;
+    for (auto _ : state) {
+        Random random(0x9E3779B97F4A7C15ull + (uint64_t)state.range(1));
+        PathSample path = samplePath(packets, loss, random);
+        if (transport == TRANSPORT_TCP) {
+            latency = simulateTcp(packets, path, loss, random);
+        } else {
+            latency = simulateUdp(packets, path, transport == TRANSPORT_UDP_WINDOW ? kReorderPackets : 0);
+        }
+        benchmark::DoNotOptimize(latency.data());
+    }
+
+    std::vector<int64_t> delivered;
+    int dropped = 0;
+    int unusable = 0;
+    bool broken = false;
+    for (int frame = 0; frame < kSimFrames; frame++) {
+        if (frame % kFramesPerGop == 0) {
+            broken = false;
+        }
+        if (latency[frame] < 0) {
+            dropped++;
+            broken = true;
+        } else {
+            delivered.push_back(latency[frame]);
+        }
+        if (broken) {
+            unusable++;
+        }
+    }
+    state.counters["p50_ms"] = percentileMs(delivered, 0.50);
+    state.counters["p99_ms"] = percentileMs(delivered, 0.99);
+    state.counters["max_ms"] = percentileMs(delivered, 1.0);
+    state.counters["dropped_pct"] = 100.0 * dropped / kSimFrames;
+    state.counters["unusable_pct"] = 100.0 * unusable / kSimFrames;
+}
+BENCHMARK(BM_FrameLatencyUnderLoss)
+    ->ArgNames({"transport", "loss_bp"})
+    ->ArgsProduct({{TRANSPORT_TCP, TRANSPORT_UDP_WINDOW, TRANSPORT_UDP_NO_WINDOW}, {0, 50, 100, 200}})
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,172 @@
+#include "rtp_reorder_window.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+// 记录交付顺序（序号）和交付时数据所在的地址
+struct SeqSink {
+    std::vector<uint16_t> seqs;
+    std::vector<const uint8_t*> addresses;
+
+    void handlePacket(const uint8_t* data, size_t len) {
+        ASSERT_GE(len, 12u);
+        seqs.push_back((uint16_t)((data[2] << 8) | data[3]));
+        addresses.push_back(data);
+    }
+};
+
+typedef RtpReorderWindow<SeqSink> Window;
+
+const int kPayloadType = 96;
+const int kWindowPackets = 4;
+const int kWindowMs = 20;
+
+std::vector<uint8_t> rtp(uint16_t seq, int payload_type = kPayloadType) {
+    std::vector<uint8_t> packet(12 + 100, 0xAB);
+    packet[0] = 0x80;
+    packet[1] = (uint8_t)payload_type;
+    packet[2] = (uint8_t)(seq >> 8);
+    packet[3] = (uint8_t)seq;
+    return packet;
+}
+
+class RtpReorderWindowTest : public ::testing::Test {
+protected:
+    SeqSink sink;
+    Window window;
+
+    RtpReorderWindowTest() : window(sink) {
+        window.configure(kPayloadType, kWindowPackets, kWindowMs);
+    }
+
+    // 与readDatagrams相同：收一个包放入窗口，再交付可以交付的部分
+    void receive(uint16_t seq, int64_t now_us) {
+        std::vector<uint8_t> packet = rtp(seq);
+        window.hold(packet.data(), packet.size(), now_us);
+        window.release(false, now_us);
+    }
+};
+
+TEST_F(RtpReorderWindowTest, DeliversInOrderPacketsImmediately) {
+    for (uint16_t seq = 100; seq < 110; seq++) {
+        receive(seq, seq * 1000);
+        EXPECT_TRUE(window.empty());
+    }
+    ASSERT_EQ(sink.seqs.size(), 10u);
+    for (size_t i = 0; i < sink.seqs.size(); i++) {
+        EXPECT_EQ(sink.seqs[i], 100 + i);
+    }
+    EXPECT_EQ(window.stats().reordered, 0);
+    EXPECT_EQ(window.stats().late, 0);
+}
+
+TEST_F(RtpReorderWindowTest, ReordersWithinWindow) {
+    receive(10, 0);
+    receive(12, 100);
+    receive(13, 200);
+    EXPECT_EQ(sink.seqs, std::vector<uint16_t>({10}));
+    receive(11, 300);
+    EXPECT_EQ(sink.seqs, std::vector<uint16_t>({10, 11, 12, 13}));
+    EXPECT_TRUE(window.empty());
+    EXPECT_EQ(window.stats().reordered, 1);
+}
+
+TEST_F(RtpReorderWindowTest, ReleasesGapWhenWindowIsFull) {
+    receive(0, 0);
+    for (uint16_t seq = 2; seq < 2 + kWindowPackets; seq++) {
+        receive(seq, 0);
+    }
+    EXPECT_EQ(sink.seqs, std::vector<uint16_t>({0}));
+    // 第kWindowPackets+1个暂存包到达时放弃等待1号包
+    receive(2 + kWindowPackets, 0);
+    EXPECT_EQ(sink.seqs, std::vector<uint16_t>({0, 2, 3, 4, 5, 6}));
+    EXPECT_TRUE(window.empty());
+}
+
+TEST_F(RtpReorderWindowTest, ReleasesGapAfterTimeout) {
+    receive(0, 0);
+    receive(2, 1000);
+    EXPECT_EQ(window.waitUs(1000), kWindowMs * 1000);
+    EXPECT_EQ(window.waitUs(15000), kWindowMs * 1000 - 14000);
+    window.release(false, 1000 + kWindowMs * 1000 - 1);
+    EXPECT_EQ(sink.seqs, std::vector<uint16_t>({0}));
+    window.release(false, 1000 + kWindowMs * 1000);
+    EXPECT_EQ(sink.seqs, std::vector<uint16_t>({0, 2}));
+    EXPECT_EQ(window.waitUs(1000 + kWindowMs * 1000), -1);
+}
+
+TEST_F(RtpReorderWindowTest, DropsLateAndDuplicatePackets) {
+    receive(0, 0);
+    receive(2, 0);
+    receive(2, 0);                  // 重复（仍在窗口中）
+    window.release(false, kWindowMs * 1000);
+    receive(1, kWindowMs * 1000);   // 窗口已越过
+    receive(2, kWindowMs * 1000);   // 重复（已交付）
+    EXPECT_EQ(sink.seqs, std::vector<uint16_t>({0, 2}));
+    EXPECT_EQ(window.stats().late, 3);
+}
+
+TEST_F(RtpReorderWindowTest, ZeroWindowDeliversOnArrival) {
+    window.configure(kPayloadType, 0, kWindowMs);
+    receive(0, 0);
+    receive(2, 0);
+    receive(1, 0);
+    EXPECT_EQ(sink.seqs, std::vector<uint16_t>({0, 2}));
+    EXPECT_EQ(window.stats().late, 1);
+}
+
+TEST_F(RtpReorderWindowTest, HandlesSequenceWrap) {
+    receive(65534, 0);
+    receive(0, 0);
+    receive(65535, 0);
+    receive(1, 0);
+    EXPECT_EQ(sink.seqs, std::vector<uint16_t>({65534, 65535, 0, 1}));
+    EXPECT_EQ(window.stats().reordered, 1);
+}
+
+TEST_F(RtpReorderWindowTest, ResyncsAfterSequenceReset) {
+    receive(5000, 0);
+    receive(5002, 0);
+    // 落后超过kSeqResetDistance：先交付暂存的包，再从新序号开始
+    receive(5000 - Window::kSeqResetDistance, 0);
+    receive(5001 - Window::kSeqResetDistance, 0);
+    EXPECT_EQ(sink.seqs, std::vector<uint16_t>({5000, 5002, 4000, 4001}));
+    EXPECT_EQ(window.stats().late, 0);
+    EXPECT_TRUE(window.empty());
+}
+
+TEST_F(RtpReorderWindowTest, IgnoresOtherPayloadTypes) {
+    std::vector<uint8_t> packet = rtp(0, kPayloadType + 1);
+    window.hold(packet.data(), packet.size(), 0);
+    window.release(true, 0);
+    std::vector<uint8_t> short_packet(8, 0x80);
+    window.hold(short_packet.data(), short_packet.size(), 0);
+    window.release(true, 0);
+    EXPECT_TRUE(sink.seqs.empty());
+}
+
+TEST_F(RtpReorderWindowTest, ReusesDeliveredBuffers) {
+    receive(0, 0);
+    for (uint16_t seq = 1; seq < 50; seq++) {
+        receive(seq, 0);
+    }
+    ASSERT_EQ(sink.addresses.size(), 50u);
+    for (size_t i = 1; i < sink.addresses.size(); i++) {
+        EXPECT_EQ(sink.addresses[i], sink.addresses[0]);
+    }
+}
+
+TEST_F(RtpReorderWindowTest, ClearDropsHeldPackets) {
+    receive(0, 0);
+    receive(2, 0);
+    window.clear();
+    EXPECT_TRUE(window.empty());
+    window.release(true, 0);
+    EXPECT_EQ(sink.seqs, std::vector<uint16_t>({0}));
+}
+
+}  // namespace
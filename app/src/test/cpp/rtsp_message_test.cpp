@@ -0,0 +1,302 @@
+#include "rtsp_message.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace {
+
+const size_t kMaxBody = 64 * 1024;
+
+// 可读的替代摘要：断言里能直接写出Digest各级摘要的组合
+struct FakeHash {
+    static std::string md5Hex(const std::string& s) {
+        return "H(" + s + ")";
+    }
+
+    static std::string base64(const std::string& s) {
+        return "B(" + s + ")";
+    }
+};
+
+typedef BasicRtspAuth<FakeHash> TestAuth;
+
+bool parseHeader(const std::string& header, RtspResponse& resp, size_t& content_length) {
+    return parseRtspResponseHeader(header, kMaxBody, resp, content_length);
+}
+
+size_t headerLength(const std::string& data) {
+    return rtspHeaderLength(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+}
+
+TEST(RtspResponseTest, HeaderLengthIncludesBlankLine) {
+    EXPECT_EQ(headerLength("RTSP/1.0 200 OK\r\nCSeq: 1\r\n\r\nv=0\r\n"), 28u);
+    EXPECT_EQ(headerLength("RTSP/1.0 200 OK\r\nCSeq: 1\r\n"), 0u);
+    EXPECT_EQ(headerLength("RTSP/1.0 200 OK\r\n\r"), 0u);
+    EXPECT_EQ(headerLength(""), 0u);
+}
+
+TEST(RtspResponseTest, ParsesStatusHeadersAndContentLength) {
+    RtspResponse resp;
+    size_t content_length = 1;
+    ASSERT_TRUE(parseHeader("RTSP/1.0 200 OK\r\nCSeq: 2\r\nContent-Base: rtsp://cam/live/\r\n"
+                            "Content-Length:  120 \r\nX-NoColon\r\n\r\n", resp, content_length));
+    EXPECT_EQ(resp.status, 200);
+    EXPECT_EQ(resp.headers["cseq"], "2");
+    EXPECT_EQ(resp.headers["content-base"], "rtsp://cam/live/");
+    EXPECT_EQ(content_length, 120u);
+    EXPECT_EQ(resp.headers.count("x-nocolon"), 0u);
+}
+
+TEST(RtspResponseTest, MissingContentLengthMeansNoBody) {
+    RtspResponse resp;
+    size_t content_length = 1;
+    ASSERT_TRUE(parseHeader("RTSP/1.0 401 Unauthorized\r\nCSeq: 1\r\n\r\n", resp, content_length));
+    EXPECT_EQ(resp.status, 401);
+    EXPECT_EQ(content_length, 0u);
+}
+
+TEST(RtspResponseTest, MalformedStatusLinesAreRejected) {
+    const char* lines[] = {
+        "",
+        "HTTP/1.1 200 OK",
+        "RTSP/1.0",
+        "RTSP/1.0 OK",
+        "RTSP/1.0 -200 OK",
+        "RTSP/1.0 99 Low",
+        "RTSP/1.0 600 High",
+        " RTSP/1.0 200 OK",
+    };
+    for (size_t i = 0; i < sizeof(lines) / sizeof(lines[0]); i++) {
+        RtspResponse resp;
+        size_t content_length = 0;
+        EXPECT_FALSE(parseHeader(std::string(lines[i]) + "\r\nCSeq: 1\r\n\r\n", resp, content_length)) << lines[i];
+    }
+}
+
+TEST(RtspResponseTest, InvalidContentLengthIsRejected) {
+    const char* values[] = {
+        "",
+        "-1",
+        "+10",
+        "12abc",
+        "0x10",
+        "1 2",
+        "65537",
+        "99999999999999999999999999",
+        "18446744073709551616",
+    };
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        RtspResponse resp;
+        size_t content_length = 0;
+        EXPECT_FALSE(parseHeader("RTSP/1.0 200 OK\r\nContent-Length: " + std::string(values[i]) + "\r\n\r\n",
+                                 resp, content_length)) << values[i];
+    }
+}
+
+TEST(RtspResponseTest, ContentLengthAtLimitIsAccepted) {
+    RtspResponse resp;
+    size_t content_length = 0;
+    ASSERT_TRUE(parseHeader("RTSP/1.0 200 OK\r\nContent-Length: 65536\r\n\r\n", resp, content_length));
+    EXPECT_EQ(content_length, kMaxBody);
+    ASSERT_TRUE(parseHeader("RTSP/1.0 200 OK\r\nContent-Length: 000\r\n\r\n", resp, content_length));
+    EXPECT_EQ(content_length, 0u);
+}
+
+TEST(RtspResponseTest, DigestChallengeIsPreferred) {
+    RtspResponse resp;
+    size_t content_length = 0;
+    ASSERT_TRUE(parseHeader("RTSP/1.0 401 Unauthorized\r\n"
+                            "WWW-Authenticate: Digest realm=\"cam\", nonce=\"n1\"\r\n"
+                            "WWW-Authenticate: Basic realm=\"cam\"\r\n\r\n", resp, content_length));
+    EXPECT_EQ(resp.headers["www-authenticate"], "Digest realm=\"cam\", nonce=\"n1\"");
+
+    ASSERT_TRUE(parseHeader("RTSP/1.0 401 Unauthorized\r\n"
+                            "WWW-Authenticate: Basic realm=\"cam\"\r\n"
+                            "WWW-Authenticate: Digest realm=\"cam\", nonce=\"n2\"\r\n\r\n", resp, content_length));
+    EXPECT_EQ(resp.headers["www-authenticate"], "Digest realm=\"cam\", nonce=\"n2\"");
+}
+
+TEST(RtspResponseTest, PreviousResponseIsCleared) {
+    RtspResponse resp;
+    size_t content_length = 0;
+    ASSERT_TRUE(parseHeader("RTSP/1.0 200 OK\r\nSession: abc\r\n\r\n", resp, content_length));
+    resp.body = "stale";
+    ASSERT_TRUE(parseHeader("RTSP/1.0 200 OK\r\nCSeq: 3\r\n\r\n", resp, content_length));
+    EXPECT_EQ(resp.headers.count("session"), 0u);
+    EXPECT_TRUE(resp.body.empty());
+}
+
+TEST(SdpVideoTest, ParsesH264Track) {
+    SdpVideoTrack track;
+    ASSERT_TRUE(parseSdpVideo("v=0\r\n"
+                              "m=audio 0 RTP/AVP 0\r\n"
+                              "a=control:trackID=0\r\n"
+                              "m=video 0 RTP/AVP 96\r\n"
+                              "a=rtpmap:96 H264/90000\r\n"
+                              "a=fmtp:96 packetization-mode=1; sprop-parameter-sets=Z0IAHg==,aM4G4g==; profile-level-id=42001e\r\n"
+                              "a=control:trackID=1\r\n", track));
+    EXPECT_EQ(track.codec, SDP_CODEC_H264);
+    EXPECT_EQ(track.payload_type, 96);
+    EXPECT_EQ(track.clock_rate, 90000);
+    EXPECT_EQ(track.control, "trackID=1");
+    ASSERT_EQ(track.parameter_sets.size(), 1u);
+    EXPECT_EQ(track.parameter_sets[0], "Z0IAHg==,aM4G4g==");
+}
+
+TEST(SdpVideoTest, ParsesHevcParameterSets) {
+    SdpVideoTrack track;
+    ASSERT_TRUE(parseSdpVideo("m=video 0 RTP/AVP 98\n"
+                              "a=rtpmap:98 h265/90000\n"
+                              "a=fmtp:98 sprop-vps=QAE=; sprop-sps=QgE=; sprop-pps=RAE=\n", track));
+    EXPECT_EQ(track.codec, SDP_CODEC_HEVC);
+    ASSERT_EQ(track.parameter_sets.size(), 3u);
+    EXPECT_EQ(track.parameter_sets[2], "RAE=");
+    EXPECT_TRUE(track.control.empty());
+}
+
+TEST(SdpVideoTest, OnlyFirstVideoTrackIsUsed) {
+    SdpVideoTrack track;
+    ASSERT_TRUE(parseSdpVideo("m=video 0 RTP/AVP 96\r\n"
+                              "a=rtpmap:96 H264/90000\r\n"
+                              "a=control:main\r\n"
+                              "m=video 0 RTP/AVP 97\r\n"
+                              "a=rtpmap:97 H265/90000\r\n"
+                              "a=control:sub\r\n", track));
+    EXPECT_EQ(track.codec, SDP_CODEC_H264);
+    EXPECT_EQ(track.payload_type, 96);
+    EXPECT_EQ(track.control, "main");
+}
+
+TEST(SdpVideoTest, AttributesOfOtherPayloadTypesAreIgnored) {
+    SdpVideoTrack track;
+    ASSERT_TRUE(parseSdpVideo("m=video 0 RTP/AVP 96\r\n"
+                              "a=rtpmap:97 H265/90000\r\n"
+                              "a=fmtp:97 packetization-mode=2\r\n"
+                              "a=rtpmap:96 H264/45000\r\n", track));
+    EXPECT_EQ(track.codec, SDP_CODEC_H264);
+    EXPECT_EQ(track.clock_rate, 45000);
+}
+
+TEST(SdpVideoTest, UnsupportedTracksAreRejected) {
+    const char* sdps[] = {
+        // 没有视频
+        "v=0\r\nm=audio 0 RTP/AVP 0\r\na=rtpmap:0 PCMU/8000\r\n",
+        // 不支持的编码
+        "m=video 0 RTP/AVP 26\r\na=rtpmap:26 JPEG/90000\r\n",
+        // rtpmap没有编码名
+        "m=video 0 RTP/AVP 96\r\na=rtpmap:96\r\n",
+        // 负载类型超出7位或缺失
+        "m=video 0 RTP/AVP 300\r\na=rtpmap:300 H264/90000\r\n",
+        "m=video 0 RTP/AVP -1\r\na=rtpmap:-1 H264/90000\r\n",
+        "m=video 0 RTP/AVP\r\na=rtpmap:0 H264/90000\r\n",
+        // 交错打包和DONL
+        "m=video 0 RTP/AVP 96\r\na=rtpmap:96 H264/90000\r\na=fmtp:96 packetization-mode=2\r\n",
+        "m=video 0 RTP/AVP 96\r\na=rtpmap:96 H265/90000\r\na=fmtp:96 sprop-max-don-diff=2\r\n",
+    };
+    for (size_t i = 0; i < sizeof(sdps) / sizeof(sdps[0]); i++) {
+        SdpVideoTrack track;
+        EXPECT_FALSE(parseSdpVideo(sdps[i], track)) << sdps[i];
+    }
+}
+
+TEST(SdpVideoTest, InvalidClockRateIsLeftUnset) {
+    const char* rates[] = {"0", "-90000", "abc", "99999999999"};
+    for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+        SdpVideoTrack track;
+        ASSERT_TRUE(parseSdpVideo("m=video 0 RTP/AVP 96\r\na=rtpmap:96 H264/" + std::string(rates[i]) + "\r\n",
+                                  track)) << rates[i];
+        EXPECT_EQ(track.clock_rate, 0) << rates[i];
+    }
+}
+
+TEST(SdpVideoTest, ControlUrlResolution) {
+    EXPECT_EQ(resolveRtspControl("rtsp://cam/live/", ""), "rtsp://cam/live/");
+    EXPECT_EQ(resolveRtspControl("rtsp://cam/live/", "*"), "rtsp://cam/live/");
+    EXPECT_EQ(resolveRtspControl("rtsp://cam/live/", "trackID=1"), "rtsp://cam/live/trackID=1");
+    EXPECT_EQ(resolveRtspControl("rtsp://cam/live", "trackID=1"), "rtsp://cam/live/trackID=1");
+    EXPECT_EQ(resolveRtspControl("rtsp://cam/live", "rtsp://other/track"), "rtsp://other/track");
+}
+
+TEST(RtspAuthTest, NoHeaderBeforeChallenge) {
+    TestAuth auth;
+    auth.setCredentials("user", "pass");
+    EXPECT_TRUE(auth.hasCredentials());
+    EXPECT_EQ(auth.header("DESCRIBE", "rtsp://cam/live"), "");
+    EXPECT_FALSE(TestAuth().hasCredentials());
+}
+
+TEST(RtspAuthTest, BasicEncodesCredentials) {
+    TestAuth auth;
+    auth.setCredentials("user", "p:ss");
+    ASSERT_TRUE(auth.parseChallenge("Basic realm=\"cam\""));
+    EXPECT_EQ(auth.header("DESCRIBE", "rtsp://cam/live"), "Basic B(user:p:ss)");
+}
+
+TEST(RtspAuthTest, DigestWithoutQop) {
+    TestAuth auth;
+    auth.setCredentials("user", "pass");
+    ASSERT_TRUE(auth.parseChallenge("Digest realm=\"cam\", nonce=\"abc\", opaque=\"xyz\""));
+    EXPECT_EQ(auth.header("DESCRIBE", "rtsp://cam/live"),
+              "Digest username=\"user\", realm=\"cam\", nonce=\"abc\", uri=\"rtsp://cam/live\", "
+              "response=\"H(H(user:cam:pass):abc:H(DESCRIBE:rtsp://cam/live))\", opaque=\"xyz\"");
+}
+
+TEST(RtspAuthTest, DigestWithQopCountsRequests) {
+    TestAuth auth;
+    auth.setCredentials("user", "pass");
+    ASSERT_TRUE(auth.parseChallenge("Digest realm=\"cam\", qop=\"auth,auth-int\", nonce=\"abc\""));
+    for (int i = 1; i <= 2; i++) {
+        std::string header = auth.header("SETUP", "rtsp://cam/live/track1");
+        std::string nc = i == 1 ? "00000001" : "00000002";
+        std::string cnonce = TestAuth::param(header, "cnonce");
+        EXPECT_EQ(cnonce.size(), 16u);
+        EXPECT_EQ(TestAuth::param(header, "nc"), nc);
+        EXPECT_EQ(TestAuth::param(header, "qop"), "auth");
+        EXPECT_EQ(TestAuth::param(header, "response"),
+                  "H(H(user:cam:pass):abc:" + nc + ":" + cnonce + ":auth:H(SETUP:rtsp://cam/live/track1))");
+        EXPECT_EQ(header.find("opaque"), std::string::npos);
+    }
+    // 新的质询重新计数
+    ASSERT_TRUE(auth.parseChallenge("Digest realm=\"cam\", qop=auth, nonce=\"def\""));
+    EXPECT_EQ(TestAuth::param(auth.header("PLAY", "rtsp://cam/live"), "nc"), "00000001");
+}
+
+TEST(RtspAuthTest, UnsupportedOrIncompleteChallenges) {
+    TestAuth auth;
+    auth.setCredentials("user", "pass");
+    EXPECT_FALSE(auth.parseChallenge("Digest realm=\"cam\""));
+    EXPECT_FALSE(auth.parseChallenge("Bearer token"));
+    EXPECT_FALSE(auth.parseChallenge(""));
+}
+
+TEST(RtspAuthTest, UnquotableValuesAreNotEchoed) {
+    // 用户名来自URL（已解码），realm/nonce来自服务器：引号或换行会注入额外的请求头
+    TestAuth quote;
+    quote.setCredentials("us\"er", "pass");
+    ASSERT_TRUE(quote.parseChallenge("Digest realm=\"cam\", nonce=\"abc\""));
+    EXPECT_EQ(quote.header("DESCRIBE", "rtsp://cam/live"), "");
+
+    TestAuth newline;
+    newline.setCredentials("user\r\nX-Injected: 1", "pass");
+    ASSERT_TRUE(newline.parseChallenge("Digest realm=\"cam\", nonce=\"abc\""));
+    EXPECT_EQ(newline.header("DESCRIBE", "rtsp://cam/live"), "");
+
+    TestAuth server;
+    server.setCredentials("user", "pass");
+    ASSERT_TRUE(server.parseChallenge("Digest realm=\"c\nam\", nonce=\"abc\""));
+    EXPECT_EQ(server.header("DESCRIBE", "rtsp://cam/live"), "");
+}
+
+TEST(RtspAuthTest, ParamLookup) {
+    std::string challenge = "Digest realm=\"a, b\", nonce=n1 , stale=FALSE, xnonce=\"bad\"";
+    EXPECT_EQ(TestAuth::param(challenge, "realm"), "a, b");
+    EXPECT_EQ(TestAuth::param(challenge, "nonce"), "n1");
+    EXPECT_EQ(TestAuth::param(challenge, "stale"), "FALSE");
+    EXPECT_EQ(TestAuth::param(challenge, "opaque"), "");
+    EXPECT_EQ(TestAuth::param("Digest nonce=\"unterminated", "nonce"), "unterminated");
+}
+
+}  // namespace
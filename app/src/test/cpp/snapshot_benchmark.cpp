@@ -0,0 +1,129 @@
+// 截图从取得帧引用到落盘的耗时：与SnapshotWorker::encodeToFile相同的路径（sws转换为YUVJ420P/RGB24，
+// 每张图新建编码器，MJPEG按质量映射qscale、PNG压缩级别3，写入临时文件）。
+// 源为synthetic_video.h的YUV420P画面（软件解码器的输出格式）；帧引用和队列交接的开销在微秒级，不计入。
+// 参数：format=0为JPEG（质量90），1为PNG；height为720或1080（16:9）
+#include "synthetic_video.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/frame.h>
+#include <libswscale/swscale.h>
+}
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+const int kJpegQuality = 90;
+
+std::string tempImagePath(bool png) {
+    char path[] = "/tmp/ffw_snapshot_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return std::string();
+    }
+    close(fd);
+    unlink(path);
+    return std::string(path) + (png ? ".png" : ".jpg");
+}
+
+// 与SnapshotWorker::encodeToFile相同，返回写入的字节数，失败返回-1
+int64_t encodeToFile(const AVFrame* frame, bool png, int quality, const std::string& path) {
+    const AVCodec* codec = avcodec_find_encoder(png ? AV_CODEC_ID_PNG : AV_CODEC_ID_MJPEG);
+    if (!codec) {
+        return -1;
+    }
+    AVPixelFormat dst_format = png ? AV_PIX_FMT_RGB24 : AV_PIX_FMT_YUVJ420P;
+    AVFrame* image = av_frame_alloc();
+    AVCodecContext* ctx = avcodec_alloc_context3(codec);
+    AVPacket* pkt = av_packet_alloc();
+    bool ok = image && ctx && pkt;
+    int64_t written = -1;
+
+    if (ok) {
+        image->format = dst_format;
+        image->width = frame->width;
+        image->height = frame->height;
+        ok = av_frame_get_buffer(image, 32) >= 0;
+    }
+    if (ok) {
+        SwsContext* sws = sws_getContext(frame->width, frame->height, (AVPixelFormat)frame->format,
+                                         image->width, image->height, dst_format,
+                                         SWS_BILINEAR, nullptr, nullptr, nullptr);
+        ok = sws && sws_scale(sws, frame->data, frame->linesize, 0, frame->height,
+                              image->data, image->linesize) > 0;
+        sws_freeContext(sws);
+    }
+    if (ok) {
+        ctx->width = image->width;
+        ctx->height = image->height;
+        ctx->pix_fmt = dst_format;
+        ctx->time_base = AVRational{1, 25};
+        if (png) {
+            ctx->compression_level = 3;
+        } else {
+            int qscale = 2 + (100 - std::max(1, std::min(quality, 100))) * 29 / 99;
+            ctx->flags |= AV_CODEC_FLAG_QSCALE;
+            ctx->global_quality = FF_QP2LAMBDA * qscale;
+            image->quality = ctx->global_quality;
+        }
+        ok = avcodec_open2(ctx, codec, nullptr) >= 0 &&
+             avcodec_send_frame(ctx, image) >= 0 &&
+             avcodec_receive_packet(ctx, pkt) >= 0;
+    }
+    if (ok) {
+        FILE* file = fopen(path.c_str(), "wb");
+        ok = file && fwrite(pkt->data, 1, pkt->size, file) == (size_t)pkt->size;
+        if (file) {
+            ok = fclose(file) == 0 && ok;
+        }
+        written = ok ? pkt->size : -1;
+    }
+
+    av_packet_free(&pkt);
+    avcodec_free_context(&ctx);
+    av_frame_free(&image);
+    return written;
+}
+
+void BM_Snapshot(benchmark::State& state) {
+    bool png = state.range(0) == 1;
+    int height = (int)state.range(1);
+    int width = height * 16 / 9;
+    AVFrame* frame = av_frame_alloc();
+    frame->format = AV_PIX_FMT_YUV420P;
+    frame->width = width;
+    frame->height = height;
+    if (av_frame_get_buffer(frame, 0) < 0) {
+        av_frame_free(&frame);
+        state.SkipWithError("frame allocation failed");
+        return;
+    }
+    SyntheticVideo(width, height).fill(frame, 0);
+    std::string path = tempImagePath(png);
+    int64_t bytes = 0;
+    for (auto _ : state) {
+        bytes = encodeToFile(frame, png, kJpegQuality, path);
+        if (bytes < 0) {
+            state.SkipWithError(png ? "PNG encoder unavailable" : "MJPEG encoder unavailable");
+            break;
+        }
+    }
+    unlink(path.c_str());
+    av_frame_free(&frame);
+    state.counters["file_kb"] = (double)bytes / 1024.0;
+}
+BENCHMARK(BM_Snapshot)->ArgNames({"format", "height"})
+    ->Args({0, 720})->Args({0, 1080})->Args({1, 720})->Args({1, 1080})
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+}  // namespace
+
+BENCHMARK_MAIN();
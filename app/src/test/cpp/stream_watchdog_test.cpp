@@ -0,0 +1,131 @@
+#include "stream_watchdog.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+struct FakeClock {
+    static int64_t now_us;
+    static int64_t nowUs() { return now_us; }
+};
+int64_t FakeClock::now_us = 0;
+
+typedef BasicStreamWatchdog<FakeClock> Watchdog;
+
+// 模拟processFrame：每次读包前poll()，读到的包按时间线交付；返回超时发生的时刻，-1表示未超时
+struct StreamSim {
+    Watchdog watchdog;
+
+    StreamSim() {
+        FakeClock::now_us = 1000000;
+        watchdog.beginPlayback(5000, 2000);
+    }
+
+    // 读一个包：先检查期限，再把时钟推进到包到达的时刻
+    bool readPacket(int64_t arrival_gap_ms, bool video) {
+        if (watchdog.poll()) {
+            return false;
+        }
+        FakeClock::now_us += arrival_gap_ms * 1000;
+        if (video) {
+            watchdog.onVideoPacket();
+        }
+        return true;
+    }
+
+    int64_t elapsedMs(int64_t since_us) const {
+        return (FakeClock::now_us - since_us) / 1000;
+    }
+};
+
+}  // namespace
+
+// 纯音频流（或视频轨从未出包）：音频包每20ms到达，首帧期限照样到期
+TEST(StreamWatchdogTest, AudioOnlyStreamHitsFirstFrameDeadline) {
+    StreamSim sim;
+    int64_t start = FakeClock::now_us;
+    int reads = 0;
+    while (sim.readPacket(20, false)) {
+        ASSERT_LT(++reads, 100000);
+    }
+    EXPECT_TRUE(sim.watchdog.hasExpired());
+    EXPECT_FALSE(sim.watchdog.isAborted());
+    EXPECT_EQ(Watchdog::PHASE_FIRST_FRAME, sim.watchdog.expiredPhase());
+    EXPECT_GE(sim.elapsedMs(start), 5000);
+    EXPECT_LT(sim.elapsedMs(start), 5000 + 20);
+}
+
+// 视频1秒后冻结、音频继续：最后一个视频包之后read_stall_ms到期
+TEST(StreamWatchdogTest, VideoFreezeWithAudioFlowingIsDetected) {
+    StreamSim sim;
+    int64_t last_video = 0;
+    int64_t t0 = FakeClock::now_us;
+    // 30fps视频夹杂音频
+    while (FakeClock::now_us - t0 < 1000000) {
+        ASSERT_TRUE(sim.readPacket(13, true));
+        last_video = FakeClock::now_us;
+        ASSERT_TRUE(sim.readPacket(20, false));
+    }
+    int reads = 0;
+    while (sim.readPacket(20, false)) {
+        ASSERT_LT(++reads, 100000);
+    }
+    EXPECT_TRUE(sim.watchdog.hasExpired());
+    EXPECT_EQ(Watchdog::PHASE_READ, sim.watchdog.expiredPhase());
+    EXPECT_GE(sim.elapsedMs(last_video), 2000);
+    EXPECT_LT(sim.elapsedMs(last_video), 2000 + 20);
+}
+
+// 正常的音视频流长时间播放不触发
+TEST(StreamWatchdogTest, SteadyStreamNeverExpires) {
+    StreamSim sim;
+    for (int i = 0; i < 60 * 30; i++) {     // 60秒
+        ASSERT_TRUE(sim.readPacket(1, false));
+        ASSERT_TRUE(sim.readPacket(32, true));
+    }
+    EXPECT_FALSE(sim.watchdog.hasExpired());
+}
+
+// 首帧晚到但在期限内：转入卡顿期限，不再受首帧期限约束
+TEST(StreamWatchdogTest, FirstVideoPacketSwitchesToStallDeadline) {
+    StreamSim sim;
+    ASSERT_TRUE(sim.readPacket(4900, true));
+    ASSERT_TRUE(sim.readPacket(1900, true));    // 距首帧期限起点已6.8秒，但视频包间隔未超2秒
+    EXPECT_FALSE(sim.watchdog.poll());
+    FakeClock::now_us += 2000 * 1000;
+    EXPECT_TRUE(sim.watchdog.poll());
+    EXPECT_EQ(Watchdog::PHASE_READ, sim.watchdog.expiredPhase());
+}
+
+// 中断回调与poll()判定一致：阻塞中的读包在期限到达时退出
+TEST(StreamWatchdogTest, InterruptCallbackFiresAtDeadline) {
+    FakeClock::now_us = 0;
+    Watchdog watchdog;
+    watchdog.arm(Watchdog::PHASE_CONNECT, 8000);
+    FakeClock::now_us = 7999 * 1000;
+    EXPECT_EQ(0, Watchdog::interruptCheck(&watchdog));
+    FakeClock::now_us = 8000 * 1000;
+    EXPECT_NE(0, Watchdog::interruptCheck(&watchdog));
+    EXPECT_EQ(Watchdog::PHASE_CONNECT, watchdog.expiredPhase());
+
+    // 下一次传输尝试重新计时
+    watchdog.arm(Watchdog::PHASE_CONNECT, 8000);
+    EXPECT_FALSE(watchdog.hasExpired());
+    EXPECT_EQ(0, Watchdog::interruptCheck(&watchdog));
+}
+
+TEST(StreamWatchdogTest, ZeroDeadlinesOnlyRespondToAbort) {
+    FakeClock::now_us = 0;
+    Watchdog watchdog;
+    watchdog.beginPlayback(0, 0);
+    FakeClock::now_us += 3600LL * 1000000;
+    EXPECT_FALSE(watchdog.poll());
+    watchdog.onVideoPacket();
+    FakeClock::now_us += 3600LL * 1000000;
+    EXPECT_FALSE(watchdog.poll());
+
+    watchdog.abort();
+    EXPECT_TRUE(watchdog.poll());
+    EXPECT_TRUE(watchdog.isAborted());
+    EXPECT_FALSE(watchdog.hasExpired());
+}
@@ -0,0 +1,164 @@
+#include "surface_handover.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// 假窗口：记录引用计数和“Surface已销毁”标记，渲染线程每帧检查两次
+struct FakeWindow {
+    std::atomic<int> refs;
+    std::atomic<bool> destroyed;
+    std::atomic<int> frames;
+
+    FakeWindow() : refs(1), destroyed(false), frames(0) {}
+};
+
+std::atomic<int> g_over_release(0);
+
+struct FakeWindowOps {
+    static void release(FakeWindow* window) {
+        if (window->refs.fetch_sub(1) <= 0) {
+            g_over_release.fetch_add(1);
+        }
+    }
+};
+
+typedef BasicSurfaceHandover<FakeWindow, FakeWindowOps> FakeHandover;
+
+// 模拟渲染器：每帧开始时接管，帧内使用窗口，帧结束后才允许销毁回调返回
+struct FakeRenderer {
+    FakeHandover& handover;
+    FakeWindow* current;
+    std::atomic<int> used_after_destroy;
+    std::atomic<int> frames_rendered;
+    std::atomic<int> adoptions;
+
+    explicit FakeRenderer(FakeHandover& h) :
+        handover(h), current(nullptr), used_after_destroy(0), frames_rendered(0), adoptions(0) {}
+
+    void renderOneFrame() {
+        if (handover.beginFrame(current)) {
+            adoptions.fetch_add(1);
+        }
+        if (current) {
+            if (current->destroyed.load()) {
+                used_after_destroy.fetch_add(1);
+            }
+            current->frames.fetch_add(1);
+            std::this_thread::yield();
+            if (current->destroyed.load()) {
+                used_after_destroy.fetch_add(1);
+            }
+            frames_rendered.fetch_add(1);
+        }
+        handover.endFrame();
+    }
+
+    void cleanup() {
+        if (current) {
+            FakeWindowOps::release(current);
+            current = nullptr;
+        }
+    }
+};
+
+}  // namespace
+
+TEST(SurfaceHandoverTest, RenderThreadAdoptsLatestPublish) {
+    g_over_release.store(0);
+    FakeHandover handover;
+    FakeRenderer renderer(handover);
+    FakeWindow a, b;
+
+    handover.publish(&a);
+    handover.publish(&b);       // a尚未被接管，直接作废
+    EXPECT_EQ(0, a.refs.load());
+
+    renderer.renderOneFrame();
+    EXPECT_EQ(&b, renderer.current);
+    EXPECT_EQ(1, b.frames.load());
+
+    handover.publish(nullptr);  // 渲染线程不在帧中，立即返回
+    renderer.renderOneFrame();
+    EXPECT_EQ(nullptr, renderer.current);
+    EXPECT_EQ(0, b.refs.load());
+    EXPECT_EQ(0, g_over_release.load());
+}
+
+TEST(SurfaceHandoverTest, DiscardPendingReleasesUnadoptedWindow) {
+    g_over_release.store(0);
+    FakeHandover handover;
+    FakeWindow a;
+    handover.publish(&a);
+    handover.discardPending();
+    EXPECT_EQ(0, a.refs.load());
+    handover.discardPending();
+    EXPECT_EQ(0, g_over_release.load());
+}
+
+TEST(SurfaceHandoverTest, ViewSizeRoundTrips) {
+    FakeHandover handover;
+    int w = -1, h = -1;
+    handover.viewSize(w, h);
+    EXPECT_EQ(0, w);
+    EXPECT_EQ(0, h);
+    handover.setViewSize(2400, 1080);
+    handover.viewSize(w, h);
+    EXPECT_EQ(2400, w);
+    EXPECT_EQ(1080, h);
+}
+
+// UI线程不停地创建/销毁Surface，渲染线程持续出帧：
+// 销毁回调返回后窗口不能再被使用，每个窗口的引用恰好释放一次
+TEST(SurfaceHandoverTest, StressCreateDestroyWhileRendering) {
+    g_over_release.store(0);
+    FakeHandover handover;
+    FakeRenderer renderer(handover);
+
+    const int kCycles = 2000;
+    std::vector<std::unique_ptr<FakeWindow> > windows;
+    windows.reserve(kCycles);
+
+    std::atomic<bool> stop(false);
+    std::thread render_thread([&]() {
+        while (!stop.load()) {
+            renderer.renderOneFrame();
+        }
+    });
+
+    for (int i = 0; i < kCycles; ++i) {
+        windows.push_back(std::unique_ptr<FakeWindow>(new FakeWindow()));
+        FakeWindow* window = windows.back().get();
+        int adoptions = renderer.adoptions.load();
+        handover.publish(window);
+        if (i % 3 == 0) {
+            // 等渲染线程接管这个窗口，覆盖“窗口正在使用中被销毁”的路径；其余轮次覆盖未接管即作废
+            while (renderer.adoptions.load() == adoptions) {
+                std::this_thread::yield();
+            }
+        }
+        // surfaceDestroyed：publish(nullptr)返回后窗口即视为失效
+        handover.publish(nullptr);
+        window->destroyed.store(true);
+    }
+
+    stop.store(true);
+    render_thread.join();
+    handover.discardPending();
+    renderer.cleanup();
+
+    EXPECT_EQ(0, renderer.used_after_destroy.load());
+    EXPECT_EQ(0, g_over_release.load());
+    int frames = 0;
+    for (size_t i = 0; i < windows.size(); ++i) {
+        EXPECT_EQ(0, windows[i]->refs.load()) << "window " << i;
+        frames += windows[i]->frames.load();
+    }
+    EXPECT_GT(frames, 0);
+}
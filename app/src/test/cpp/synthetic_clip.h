@@ -0,0 +1,139 @@
+#ifndef FFW_SYNTHETIC_CLIP_H
+#define FFW_SYNTHETIC_CLIP_H
+
+// 依赖FFmpeg的主机基准共用的源文件：synthetic_video.h的画面经libx264编码为临时MP4，
+// 以及写MP4输出的辅助函数。生成的文件在对象析构时删除
+#include "synthetic_video.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/opt.h>
+}
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+
+inline std::string tempPath(const char* name) {
+    char path[] = "/tmp/ffw_bench_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return std::string();
+    }
+    close(fd);
+    unlink(path);
+    return std::string(path) + "_" + name + ".mp4";
+}
+
+// 打开MP4输出并添加一路视频流（参数取自编码器或源流）
+inline AVFormatContext* openOutput(const std::string& path, const AVCodecParameters* par, AVRational time_base) {
+    AVFormatContext* out = nullptr;
+    if (avformat_alloc_output_context2(&out, nullptr, "mp4", path.c_str()) < 0) {
+        return nullptr;
+    }
+    AVStream* stream = avformat_new_stream(out, nullptr);
+    if (!stream || avcodec_parameters_copy(stream->codecpar, par) < 0 ||
+        avio_open(&out->pb, path.c_str(), AVIO_FLAG_WRITE) < 0) {
+        avformat_free_context(out);
+        return nullptr;
+    }
+    stream->codecpar->codec_tag = 0;
+    stream->time_base = time_base;
+    if (avformat_write_header(out, nullptr) < 0) {
+        avio_closep(&out->pb);
+        avformat_free_context(out);
+        return nullptr;
+    }
+    return out;
+}
+
+inline void closeOutput(AVFormatContext* out) {
+    if (out) {
+        av_write_trailer(out);
+        avio_closep(&out->pb);
+        avformat_free_context(out);
+    }
+}
+
+// 送入一帧（nullptr为冲刷），输出包写入out
+inline bool encodeTo(AVCodecContext* encoder, AVFrame* frame, AVFormatContext* out) {
+    if (avcodec_send_frame(encoder, frame) < 0) {
+        return false;
+    }
+    AVPacket* pkt = av_packet_alloc();
+    while (avcodec_receive_packet(encoder, pkt) >= 0) {
+        av_packet_rescale_ts(pkt, encoder->time_base, out->streams[0]->time_base);
+        pkt->stream_index = 0;
+        av_interleaved_write_frame(out, pkt);
+    }
+    av_packet_free(&pkt);
+    return true;
+}
+
+// libx264 veryfast、CRF 23编码的H.264 MP4；gop_frames为关键帧间隔，b_frames为B帧数
+class SyntheticClip {
+public:
+    SyntheticClip(int width, int height, int fps, int seconds, int gop_frames, int b_frames) :
+        path(tempPath("source")), ok(false) {
+        const AVCodec* codec = avcodec_find_encoder_by_name("libx264");
+        if (!codec || path.empty()) {
+            return;
+        }
+        AVCodecContext* encoder = avcodec_alloc_context3(codec);
+        encoder->width = width;
+        encoder->height = height;
+        encoder->pix_fmt = AV_PIX_FMT_YUV420P;
+        encoder->time_base = AVRational{1, fps};
+        encoder->framerate = AVRational{fps, 1};
+        encoder->gop_size = gop_frames;
+        encoder->max_b_frames = b_frames;
+        encoder->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+        av_opt_set(encoder->priv_data, "preset", "veryfast", 0);
+        av_opt_set(encoder->priv_data, "crf", "23", 0);
+        AVFrame* frame = av_frame_alloc();
+        frame->format = AV_PIX_FMT_YUV420P;
+        frame->width = width;
+        frame->height = height;
+        AVCodecParameters* par = avcodec_parameters_alloc();
+        AVFormatContext* out = nullptr;
+        if (avcodec_open2(encoder, codec, nullptr) >= 0 && av_frame_get_buffer(frame, 0) >= 0 &&
+            avcodec_parameters_from_context(par, encoder) >= 0 &&
+            (out = openOutput(path, par, encoder->time_base)) != nullptr) {
+            SyntheticVideo video(width, height);
+            for (int i = 0; i < seconds * fps; i++) {
+                av_frame_make_writable(frame);
+                video.fill(frame, i);
+                frame->pts = i;
+                encodeTo(encoder, frame, out);
+            }
+            encodeTo(encoder, nullptr, out);
+            closeOutput(out);
+            ok = true;
+        }
+        avcodec_parameters_free(&par);
+        av_frame_free(&frame);
+        avcodec_free_context(&encoder);
+    }
+
+    ~SyntheticClip() {
+        if (!path.empty()) {
+            unlink(path.c_str());
+        }
+    }
+
+    bool valid() const {
+        return ok;
+    }
+
+    std::string path;
+
+private:
+    bool ok;
+
+    SyntheticClip(const SyntheticClip&);
+    SyntheticClip& operator=(const SyntheticClip&);
+};
+
+#endif
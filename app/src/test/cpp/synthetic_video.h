@@ -0,0 +1,50 @@
+#ifndef FFW_SYNTHETIC_VIDEO_H
+#define FFW_SYNTHETIC_VIDEO_H
+
+// 依赖FFmpeg的主机基准共用的合成画面：平移的渐变纹理加低幅噪声，编码器既不会因静止画面码率塌缩，
+// 也不会被满熵噪声顶到码率上限。纹理按两倍宽度生成一次，第i帧从水平偏移4*i处取，逐行复制
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+class SyntheticVideo {
+public:
+    SyntheticVideo(int width, int height) : width(width), height(height) {
+        luma.resize((size_t)width * 2 * height);
+        uint64_t state = 0x9E3779B97F4A7C15ull;
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width * 2; x++) {
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                int gradient = ((x / 8) * 7 + (y / 8) * 5) & 0xBF;
+                luma[(size_t)y * width * 2 + x] = (uint8_t)(gradient + (state & 0x0F) + 16);
+            }
+        }
+    }
+
+    // frame需已按width x height YUV420P分配
+    void fill(AVFrame* frame, int index) const {
+        int shift = (index * 4) % width;
+        for (int y = 0; y < height; y++) {
+            memcpy(frame->data[0] + (size_t)y * frame->linesize[0], &luma[(size_t)y * width * 2 + shift], width);
+        }
+        for (int plane = 1; plane < 3; plane++) {
+            uint8_t value = (uint8_t)(plane == 1 ? 128 + (index % 32) : 128 - (index % 32));
+            for (int y = 0; y < height / 2; y++) {
+                memset(frame->data[plane] + (size_t)y * frame->linesize[plane], value, width / 2);
+            }
+        }
+    }
+
+private:
+    int width;
+    int height;
+    std::vector<uint8_t> luma;
+};
+
+#endif
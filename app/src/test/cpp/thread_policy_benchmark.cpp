@@ -0,0 +1,123 @@
+// 调度抖动模型：测量线程周期性地睡眠1ms再做约200us计算（模拟一次读包+解码），
+// 同时每个CPU上有两个nice=0的自旋线程（模拟UI和其他应用的CPU负载）。
+// 记录每次唤醒的延迟（实际醒来时间 - 预定时间）和单步总耗时的分位数，比较测量线程
+// 不同策略下的抖动。nice<0和SCHED_FIFO需要CAP_SYS_NICE，无权限时该组报错跳过
+#include "thread_policy.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int kCycles = 300;
+const int kSleepUs = 1000;
+const uint64_t kWorkIterations = 100000;    // 本机约200us
+
+typedef std::chrono::steady_clock Clock;
+
+uint64_t work(uint64_t iterations) {
+    uint64_t x = 88172645463325252ull;
+    for (uint64_t i = 0; i < iterations; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+    }
+    return x;
+}
+
+double percentile(std::vector<double>& values, double p) {
+    size_t n = (size_t)(p * (values.size() - 1) + 0.5);
+    std::nth_element(values.begin(), values.begin() + n, values.end());
+    return values[n];
+}
+
+// state.range(0): nice值；range(1): 1表示SCHED_FIFO；range(2): 每个CPU的干扰线程数
+void BM_WakeupJitter(benchmark::State& state) {
+    ThreadPolicy policy;
+    policy.nice = (int)state.range(0);
+    policy.realtime = state.range(1) != 0;
+    int hogs_per_cpu = (int)state.range(2);
+
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> hogs;
+    int cpus = std::max(1, (int)std::thread::hardware_concurrency());
+    for (int i = 0; i < hogs_per_cpu * cpus; i++) {
+        hogs.push_back(std::thread([&stop]() {
+            while (!stop.load(std::memory_order_relaxed)) {
+                benchmark::DoNotOptimize(work(1000));
+            }
+        }));
+    }
+
+    std::vector<double> wakeup_us;
+    std::vector<double> step_us;
+    bool applied = true;
+    for (auto _ : state) {
+        // 每轮新建测量线程，策略不会留在benchmark主线程上
+        std::thread measured([&]() {
+            applied = applyThreadPolicy("ffw-jitter", policy);
+            for (int i = 0; i < kCycles; i++) {
+                Clock::time_point target = Clock::now() + std::chrono::microseconds(kSleepUs);
+                std::this_thread::sleep_until(target);
+                Clock::time_point woke = Clock::now();
+                benchmark::DoNotOptimize(work(kWorkIterations));
+                Clock::time_point done = Clock::now();
+                wakeup_us.push_back(std::chrono::duration<double, std::micro>(woke - target).count());
+                step_us.push_back(std::chrono::duration<double, std::micro>(done - target).count());
+            }
+        });
+        measured.join();
+        if (!applied) {
+            break;
+        }
+    }
+    stop.store(true);
+    for (size_t i = 0; i < hogs.size(); i++) {
+        hogs[i].join();
+    }
+    if (!applied) {
+        state.SkipWithError("scheduling policy not permitted");
+        return;
+    }
+
+    StepJitterStats stats;
+    for (size_t i = 0; i < step_us.size(); i++) {
+        stats.addStep(step_us[i] / 1000.0, 0);
+    }
+    state.counters["wake_p50_us"] = percentile(wakeup_us, 0.50);
+    state.counters["wake_p99_us"] = percentile(wakeup_us, 0.99);
+    state.counters["step_p50_us"] = percentile(step_us, 0.50);
+    state.counters["step_p99_us"] = percentile(step_us, 0.99);
+    state.counters["step_stddev_us"] = stats.stddevMs() * 1000.0;
+}
+BENCHMARK(BM_WakeupJitter)
+    ->ArgNames({"nice", "fifo", "hogs"})
+    ->Args({0, 0, 0})       // 无干扰基线
+    ->Args({0, 0, 2})       // 默认优先级
+    ->Args({-8, 0, 2})      // URGENT_DISPLAY等价nice
+    ->Args({0, 1, 2})       // SCHED_FIFO
+    ->Iterations(3)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    // applyThreadPolicy每轮打印一条LOGI，结果走stdout
+    if (!freopen("/dev/null", "w", stderr)) {
+        return 1;
+    }
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include "thread_policy.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <thread>
+
+TEST(ThreadPolicyTest, CpuSetFollowsMask) {
+    cpu_set_t cpus;
+    threadPolicyCpuSet(0, 8, cpus);
+    EXPECT_EQ(8, CPU_COUNT(&cpus));
+
+    threadPolicyCpuSet(0xF0, 8, cpus);      // 大核在高位
+    EXPECT_EQ(4, CPU_COUNT(&cpus));
+    EXPECT_FALSE(CPU_ISSET(3, &cpus));
+    EXPECT_TRUE(CPU_ISSET(4, &cpus));
+    EXPECT_TRUE(CPU_ISSET(7, &cpus));
+
+    threadPolicyCpuSet(0x100, 8, cpus);     // 超出CPU数的位被忽略
+    EXPECT_EQ(0, CPU_COUNT(&cpus));
+
+    threadPolicyCpuSet(0, 64, cpus);        // 掩码只有32位
+    EXPECT_EQ(32, CPU_COUNT(&cpus));
+}
+
+// 在新线程上应用，避免改动测试主线程的调度属性；提高nice值不需要特权
+TEST(ThreadPolicyTest, AppliesNameNiceAndAffinityToCallingThread) {
+    std::thread worker([]() {
+        ThreadPolicy policy;
+        policy.nice = 5;
+        policy.cpu_mask = 0x1;
+        EXPECT_TRUE(applyThreadPolicy("ffw-test", policy));
+
+        char name[16] = {0};
+        ASSERT_EQ(0, pthread_getname_np(pthread_self(), name, sizeof(name)));
+        EXPECT_STREQ("ffw-test", name);
+
+        errno = 0;
+        EXPECT_EQ(5, getpriority(PRIO_PROCESS, gettid()));
+        EXPECT_EQ(0, errno);
+
+        cpu_set_t cpus;
+        ASSERT_EQ(0, sched_getaffinity(0, sizeof(cpus), &cpus));
+        EXPECT_EQ(1, CPU_COUNT(&cpus));
+        EXPECT_TRUE(CPU_ISSET(0, &cpus));
+        EXPECT_EQ(0, sched_getcpu());
+        EXPECT_EQ(SCHED_OTHER, sched_getscheduler(0));
+    });
+    worker.join();
+}
+
+TEST(ThreadPolicyTest, PolicyDoesNotLeakToOtherThreads) {
+    int main_nice = getpriority(PRIO_PROCESS, gettid());
+    std::thread worker([]() {
+        ThreadPolicy policy;
+        policy.nice = 10;
+        applyThreadPolicy(nullptr, policy);
+    });
+    worker.join();
+    EXPECT_EQ(main_nice, getpriority(PRIO_PROCESS, gettid()));
+}
+
+TEST(StepJitterStatsTest, MeanStddevAndMigrations) {
+    StepJitterStats stats(0);
+    stats.addStep(2.0, 0);
+    stats.addStep(4.0, 1);
+    stats.addStep(4.0, 1);
+    stats.addStep(6.0, 0);
+    EXPECT_EQ(4, stats.stepCount());
+    EXPECT_DOUBLE_EQ(4.0, stats.meanMs());
+    EXPECT_NEAR(1.41421356, stats.stddevMs(), 1e-6);
+    EXPECT_EQ(2, stats.migrationCount());
+
+    // 新窗口从最近所在的CPU继续计算迁移
+    stats.resetWindow();
+    EXPECT_EQ(0, stats.stepCount());
+    EXPECT_DOUBLE_EQ(0.0, stats.stddevMs());
+    stats.addStep(1.0, 0);
+    EXPECT_EQ(0, stats.migrationCount());
+    stats.addStep(1.0, 3);
+    EXPECT_EQ(1, stats.migrationCount());
+}
+
+TEST(StepJitterStatsTest, UnknownInitialCpuDoesNotCountFirstStep) {
+    StepJitterStats stats;
+    stats.addStep(1.0, 5);
+    EXPECT_EQ(0, stats.migrationCount());
+}
@@ -0,0 +1,207 @@
+// 缩略图条的提取耗时：与ThumbnailExtractor相同的路径（打开时跳过流信息探测，每个采样点
+// AVSEEK_FLAG_BACKWARD定位到关键帧，skip_frame=AVDISCARD_NONKEY只解码该关键帧并立即冲刷，
+// SWS_FAST_BILINEAR缩放为RGBA写入一块预分配的缓冲区）。
+// 源为60秒1080p30 H.264（与录制默认配置相同，每秒一个关键帧，无B帧），启动时生成一次。
+// 每次迭代包含打开文件、创建解码器和缩放器，与一次extractThumbnails调用相同；目标是几十毫秒。
+// 参数为缩略图数量，宽度固定160
+#include "synthetic_clip.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/mathematics.h>
+#include <libswscale/swscale.h>
+}
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const int kClipWidth = 1920;
+const int kClipHeight = 1080;
+const int kClipFps = 30;
+const int kClipSeconds = 60;
+const int kThumbnailWidth = 160;
+
+const SyntheticClip& sourceClip() {
+    static SyntheticClip clip(kClipWidth, kClipHeight, kClipFps, kClipSeconds, kClipFps, 0);
+    return clip;
+}
+
+// 与ThumbnailExtractor相同：打开、只解码关键帧、缩放到调用方缓冲区
+class Extractor {
+public:
+    Extractor() : input_ctx(nullptr), decoder_ctx(nullptr), sws_ctx(nullptr), packet(nullptr), frame(nullptr),
+                  video_index(-1), decoded(0) {}
+
+    ~Extractor() {
+        sws_freeContext(sws_ctx);
+        av_frame_free(&frame);
+        av_packet_free(&packet);
+        avcodec_free_context(&decoder_ctx);
+        if (input_ctx) {
+            avformat_close_input(&input_ctx);
+        }
+    }
+
+    bool open(const char* path) {
+        if (avformat_open_input(&input_ctx, path, nullptr, nullptr) < 0) {
+            return false;
+        }
+        video_index = av_find_best_stream(input_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+        if (video_index < 0 || input_ctx->streams[video_index]->codecpar->width <= 0) {
+            if (avformat_find_stream_info(input_ctx, nullptr) < 0) {
+                return false;
+            }
+            video_index = av_find_best_stream(input_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+        }
+        if (video_index < 0) {
+            return false;
+        }
+        AVCodecParameters* par = input_ctx->streams[video_index]->codecpar;
+        const AVCodec* codec = avcodec_find_decoder(par->codec_id);
+        decoder_ctx = codec ? avcodec_alloc_context3(codec) : nullptr;
+        if (!decoder_ctx || avcodec_parameters_to_context(decoder_ctx, par) < 0) {
+            return false;
+        }
+        decoder_ctx->skip_frame = AVDISCARD_NONKEY;
+        decoder_ctx->thread_count = 0;
+        decoder_ctx->thread_type = FF_THREAD_SLICE;
+        decoder_ctx->flags2 |= AV_CODEC_FLAG2_FAST;
+        if (avcodec_open2(decoder_ctx, codec, nullptr) < 0) {
+            return false;
+        }
+        packet = av_packet_alloc();
+        frame = av_frame_alloc();
+        return packet && frame;
+    }
+
+    int thumbnailHeight(int width) const {
+        AVCodecParameters* par = input_ctx->streams[video_index]->codecpar;
+        return std::max(2, (int)((int64_t)width * par->height / par->width + 1) & ~1);
+    }
+
+    int extract(int count, int width, int height, uint8_t* out) {
+        AVStream* stream = input_ctx->streams[video_index];
+        int64_t start = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+        int64_t duration = stream->duration > 0 ? stream->duration :
+                           av_rescale_q(std::max<int64_t>(input_ctx->duration, 0), AV_TIME_BASE_Q, stream->time_base);
+        size_t thumb_size = (size_t)width * height * 4;
+        int64_t last_key_pts = AV_NOPTS_VALUE;
+        int written = 0;
+        for (int i = 0; i < count; i++) {
+            uint8_t* dst = out + thumb_size * i;
+            int64_t target = start + duration * (2 * i + 1) / (2 * count);
+            int64_t key_pts = AV_NOPTS_VALUE;
+            if (!seekToKeyframe(target, key_pts)) {
+                break;
+            }
+            if (key_pts != AV_NOPTS_VALUE && key_pts == last_key_pts && i > 0) {
+                memcpy(dst, dst - thumb_size, thumb_size);
+                written++;
+                continue;
+            }
+            if (!decodeKeyframe() || !scaleInto(dst, width, height)) {
+                break;
+            }
+            last_key_pts = key_pts;
+            written++;
+        }
+        return written;
+    }
+
+    int decodedKeyframes() const {
+        return decoded;
+    }
+
+private:
+    AVFormatContext* input_ctx;
+    AVCodecContext* decoder_ctx;
+    SwsContext* sws_ctx;
+    AVPacket* packet;
+    AVFrame* frame;
+    int video_index;
+    int decoded;
+
+    bool seekToKeyframe(int64_t target, int64_t& key_pts) {
+        if (av_seek_frame(input_ctx, video_index, target, AVSEEK_FLAG_BACKWARD) < 0) {
+            return false;
+        }
+        avcodec_flush_buffers(decoder_ctx);
+        while (av_read_frame(input_ctx, packet) >= 0) {
+            if (packet->stream_index == video_index && (packet->flags & AV_PKT_FLAG_KEY)) {
+                key_pts = packet->pts;
+                return true;
+            }
+            av_packet_unref(packet);
+        }
+        return false;
+    }
+
+    bool decodeKeyframe() {
+        int ret = avcodec_send_packet(decoder_ctx, packet);
+        av_packet_unref(packet);
+        if (ret < 0) {
+            return false;
+        }
+        avcodec_send_packet(decoder_ctx, nullptr);
+        decoded++;
+        return avcodec_receive_frame(decoder_ctx, frame) >= 0;
+    }
+
+    bool scaleInto(uint8_t* dst, int width, int height) {
+        sws_ctx = sws_getCachedContext(sws_ctx, frame->width, frame->height, (AVPixelFormat)frame->format,
+                                       width, height, AV_PIX_FMT_RGBA, SWS_FAST_BILINEAR,
+                                       nullptr, nullptr, nullptr);
+        if (!sws_ctx) {
+            av_frame_unref(frame);
+            return false;
+        }
+        uint8_t* dst_data[4] = {dst, nullptr, nullptr, nullptr};
+        int dst_linesize[4] = {width * 4, 0, 0, 0};
+        int ret = sws_scale(sws_ctx, frame->data, frame->linesize, 0, frame->height, dst_data, dst_linesize);
+        av_frame_unref(frame);
+        return ret > 0;
+    }
+};
+
+void BM_ExtractThumbnails(benchmark::State& state) {
+    const SyntheticClip& clip = sourceClip();
+    if (!clip.valid()) {
+        state.SkipWithError("libx264 unavailable, cannot generate the source clip");
+        return;
+    }
+    int count = (int)state.range(0);
+    std::vector<uint8_t> strip;
+    int decoded = 0;
+    for (auto _ : state) {
+        Extractor extractor;
+        if (!extractor.open(clip.path.c_str())) {
+            state.SkipWithError("open failed");
+            break;
+        }
+        int height = extractor.thumbnailHeight(kThumbnailWidth);
+        strip.resize((size_t)kThumbnailWidth * height * 4 * count);
+        if (extractor.extract(count, kThumbnailWidth, height, strip.data()) != count) {
+            state.SkipWithError("extract failed");
+            break;
+        }
+        decoded = extractor.decodedKeyframes();
+        benchmark::DoNotOptimize(strip.data());
+    }
+    state.counters["keyframes_decoded"] = decoded;
+    state.counters["ms_per_thumbnail"] = benchmark::Counter((double)count * state.iterations() / 1000.0,
+                                                            benchmark::Counter::kIsRate |
+                                                            benchmark::Counter::kInvert);
+}
+BENCHMARK(BM_ExtractThumbnails)->ArgName("count")->Arg(10)->Arg(20)->Arg(60)
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,327 @@
+// 文件转码的实时倍数：与StreamingTranscoder相同的路径跑在生成的片段上。
+// 片段为20秒1080p30 H.264（libx264 veryfast，2个B帧，GOP 2秒），启动时生成一次。
+// mode=0：重编码到720p - 帧级+片级多线程解码，sws缩放，libx264按录制默认配置（ultrafast，GOP 1秒），MP4封装；
+// mode=1：尺寸不变，流复制（只重新封装）。
+// realtime为媒体时长/实际耗时（realtimeMultiple），与转码完成日志中的倍数相同。
+// BM_SegmentTranscode是ParallelTranscoder的路径：按SegmentPlanner在关键帧处切成1/2/4/8段
+// （片段只有20秒，跳过每段至少10秒的限制），各段在独立线程里重编码到临时文件
+// （SegmentFrameFilter筛选，线程数按threadsPerSegment均分），再按segmentTimestampOffset拼接
+#include "encoder_config.h"
+#include "synthetic_clip.h"
+#include "transcode_plan.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/opt.h>
+#include <libavutil/time.h>
+#include <libswscale/swscale.h>
+}
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+const int kClipWidth = 1920;
+const int kClipHeight = 1080;
+const int kClipFps = 30;
+const int kClipSeconds = 20;
+const int kTargetWidth = 1280;
+const int kTargetHeight = 720;
+
+// 生成的源片段，进程内只生成一次
+const SyntheticClip& sourceClip() {
+    static SyntheticClip clip(kClipWidth, kClipHeight, kClipFps, kClipSeconds, 2 * kClipFps, 2);
+    return clip;
+}
+
+// 重编码：解码 -> 缩放 -> 编码 -> 封装，返回是否成功。只写入源pts在[start, end)内的帧，
+// threads为解码/编码线程数（0为自动）；first_pts返回第一个写入帧的源pts
+bool transcode(const std::string& input, const std::string& output, int64_t start = INT64_MIN,
+               int64_t end = INT64_MAX, int threads = 0, int64_t* first_pts = nullptr) {
+    AVFormatContext* in = nullptr;
+    if (avformat_open_input(&in, input.c_str(), nullptr, nullptr) < 0) {
+        return false;
+    }
+    avformat_find_stream_info(in, nullptr);
+    AVStream* stream = in->streams[0];
+    const AVCodec* decoder_codec = avcodec_find_decoder(stream->codecpar->codec_id);
+    const AVCodec* encoder_codec = avcodec_find_encoder_by_name("libx264");
+    AVCodecContext* decoder = avcodec_alloc_context3(decoder_codec);
+    AVCodecContext* encoder = avcodec_alloc_context3(encoder_codec);
+    AVPacket* pkt = av_packet_alloc();
+    AVFrame* decoded = av_frame_alloc();
+    AVFrame* scaled = av_frame_alloc();
+    AVCodecParameters* par = avcodec_parameters_alloc();
+    SwsContext* sws = nullptr;
+    AVFormatContext* out = nullptr;
+    bool ok = false;
+
+    avcodec_parameters_to_context(decoder, stream->codecpar);
+    decoder->thread_count = threads;
+    decoder->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+    decoder->pkt_timebase = stream->time_base;
+
+    EncoderConfig config;
+    config.fillDefaults(kTargetWidth, kTargetHeight, kClipFps);
+    encoder->width = kTargetWidth;
+    encoder->height = kTargetHeight;
+    encoder->pix_fmt = AV_PIX_FMT_YUV420P;
+    encoder->time_base = stream->time_base;
+    encoder->framerate = AVRational{kClipFps, 1};
+    encoder->bit_rate = config.bitrate;
+    encoder->rc_max_rate = encoderPeakBitrate(config);
+    encoder->rc_buffer_size = (int)config.bitrate;
+    encoder->gop_size = config.gop_length;
+    encoder->thread_count = threads;
+    encoder->thread_type = FF_THREAD_FRAME;
+    encoder->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    av_opt_set(encoder->priv_data, "preset", config.preset.c_str(), 0);
+
+    scaled->format = AV_PIX_FMT_YUV420P;
+    scaled->width = kTargetWidth;
+    scaled->height = kTargetHeight;
+    if (avcodec_open2(decoder, decoder_codec, nullptr) >= 0 && avcodec_open2(encoder, encoder_codec, nullptr) >= 0 &&
+        av_frame_get_buffer(scaled, 0) >= 0 && avcodec_parameters_from_context(par, encoder) >= 0 &&
+        (out = openOutput(output, par, encoder->time_base)) != nullptr) {
+        if (start != INT64_MIN) {
+            av_seek_frame(in, 0, start, AVSEEK_FLAG_BACKWARD);
+        }
+        SegmentFrameFilter filter(start, end);
+        bool eof = false;
+        while (!eof && !filter.finished()) {
+            eof = av_read_frame(in, pkt) < 0;
+            if (!eof && pkt->stream_index != 0) {
+                av_packet_unref(pkt);
+                continue;
+            }
+            avcodec_send_packet(decoder, eof ? nullptr : pkt);
+            av_packet_unref(pkt);
+            while (avcodec_receive_frame(decoder, decoded) >= 0) {
+                if (!filter.accept(decoded->best_effort_timestamp, AV_NOPTS_VALUE)) {
+                    av_frame_unref(decoded);
+                    continue;
+                }
+                if (first_pts && *first_pts == AV_NOPTS_VALUE) {
+                    *first_pts = decoded->best_effort_timestamp;
+                }
+                sws = sws_getCachedContext(sws, decoded->width, decoded->height, (AVPixelFormat)decoded->format,
+                                           kTargetWidth, kTargetHeight, AV_PIX_FMT_YUV420P, SWS_BILINEAR,
+                                           nullptr, nullptr, nullptr);
+                av_frame_make_writable(scaled);
+                sws_scale(sws, decoded->data, decoded->linesize, 0, decoded->height, scaled->data, scaled->linesize);
+                scaled->pts = decoded->best_effort_timestamp;
+                encodeTo(encoder, scaled, out);
+                av_frame_unref(decoded);
+            }
+        }
+        // 冲刷解码器中剩余的本段帧
+        avcodec_send_packet(decoder, nullptr);
+        while (avcodec_receive_frame(decoder, decoded) >= 0) {
+            if (filter.accept(decoded->best_effort_timestamp, AV_NOPTS_VALUE)) {
+                sws_scale(sws, decoded->data, decoded->linesize, 0, decoded->height, scaled->data, scaled->linesize);
+                scaled->pts = decoded->best_effort_timestamp;
+                encodeTo(encoder, scaled, out);
+            }
+            av_frame_unref(decoded);
+        }
+        encodeTo(encoder, nullptr, out);
+        closeOutput(out);
+        ok = true;
+    }
+
+    sws_freeContext(sws);
+    avcodec_parameters_free(&par);
+    av_frame_free(&scaled);
+    av_frame_free(&decoded);
+    av_packet_free(&pkt);
+    avcodec_free_context(&encoder);
+    avcodec_free_context(&decoder);
+    avformat_close_input(&in);
+    return ok;
+}
+
+// 流复制：只重新封装视频包
+bool remux(const std::string& input, const std::string& output) {
+    AVFormatContext* in = nullptr;
+    if (avformat_open_input(&in, input.c_str(), nullptr, nullptr) < 0) {
+        return false;
+    }
+    avformat_find_stream_info(in, nullptr);
+    AVStream* stream = in->streams[0];
+    AVFormatContext* out = openOutput(output, stream->codecpar, stream->time_base);
+    AVPacket* pkt = av_packet_alloc();
+    while (out && av_read_frame(in, pkt) >= 0) {
+        if (pkt->stream_index == 0) {
+            av_packet_rescale_ts(pkt, stream->time_base, out->streams[0]->time_base);
+            pkt->pos = -1;
+            av_interleaved_write_frame(out, pkt);
+        }
+        av_packet_unref(pkt);
+    }
+    closeOutput(out);
+    av_packet_free(&pkt);
+    avformat_close_input(&in);
+    return out != nullptr;
+}
+
+// 与ParallelTranscoder::findSplitPoints相同：等分时间点向前定位到关键帧
+std::vector<int64_t> findSplitPoints(const std::string& input, int workers, AVRational& time_base) {
+    std::vector<int64_t> split_points;
+    AVFormatContext* in = nullptr;
+    if (avformat_open_input(&in, input.c_str(), nullptr, nullptr) < 0) {
+        return split_points;
+    }
+    avformat_find_stream_info(in, nullptr);
+    AVStream* stream = in->streams[0];
+    time_base = stream->time_base;
+    int64_t start = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+    int64_t duration = av_rescale_q(in->duration, AV_TIME_BASE_Q, stream->time_base);
+    AVPacket* pkt = av_packet_alloc();
+    for (int i = 1; i < workers; i++) {
+        if (av_seek_frame(in, 0, SegmentPlanner::splitTarget(start, duration, i, workers), AVSEEK_FLAG_BACKWARD) < 0) {
+            continue;
+        }
+        while (av_read_frame(in, pkt) >= 0) {
+            bool found = (pkt->flags & AV_PKT_FLAG_KEY) && pkt->pts != AV_NOPTS_VALUE;
+            int64_t pts = pkt->pts;
+            av_packet_unref(pkt);
+            if (found) {
+                SegmentPlanner::addSplitPoint(split_points, start, pts);
+                break;
+            }
+        }
+    }
+    av_packet_free(&pkt);
+    avformat_close_input(&in);
+    return split_points;
+}
+
+// 与ParallelTranscoder::concat的视频部分相同：各段按首帧源时间偏移，段首包决定整段偏移
+bool concat(const std::vector<std::string>& parts, const std::vector<int64_t>& first_pts, AVRational source_tb,
+            const std::string& output) {
+    std::vector<AVFormatContext*> inputs(parts.size(), nullptr);
+    bool ok = true;
+    for (size_t i = 0; ok && i < parts.size(); i++) {
+        ok = avformat_open_input(&inputs[i], parts[i].c_str(), nullptr, nullptr) >= 0 &&
+             avformat_find_stream_info(inputs[i], nullptr) >= 0;
+    }
+    AVFormatContext* out = ok ? openOutput(output, inputs[0]->streams[0]->codecpar,
+                                           inputs[0]->streams[0]->time_base) : nullptr;
+    AVPacket* pkt = av_packet_alloc();
+    int64_t last_dts = AV_NOPTS_VALUE;
+    for (size_t i = 0; out && ok && i < parts.size(); i++) {
+        AVRational out_tb = out->streams[0]->time_base;
+        int64_t source_offset = av_rescale_q(first_pts[i] - first_pts[0], source_tb, out_tb);
+        int64_t offset = source_offset;
+        bool first_packet = true;
+        while (ok && av_read_frame(inputs[i], pkt) >= 0) {
+            av_packet_rescale_ts(pkt, inputs[i]->streams[0]->time_base, out_tb);
+            if (first_packet) {
+                first_packet = false;
+                offset = segmentTimestampOffset(source_offset, pkt->dts, last_dts, AV_NOPTS_VALUE);
+            }
+            if (pkt->pts != AV_NOPTS_VALUE) pkt->pts += offset;
+            if (pkt->dts != AV_NOPTS_VALUE) {
+                pkt->dts += offset;
+                last_dts = pkt->dts;
+            }
+            pkt->stream_index = 0;
+            pkt->pos = -1;
+            ok = av_interleaved_write_frame(out, pkt) >= 0;
+        }
+    }
+    closeOutput(out);
+    av_packet_free(&pkt);
+    for (size_t i = 0; i < inputs.size(); i++) {
+        if (inputs[i]) {
+            avformat_close_input(&inputs[i]);
+        }
+    }
+    return ok && out;
+}
+
+void BM_Transcode(benchmark::State& state) {
+    const SyntheticClip& clip = sourceClip();
+    if (!clip.valid()) {
+        state.SkipWithError("libx264 unavailable, cannot generate the source clip");
+        return;
+    }
+    bool copy = state.range(0) == 1;
+    std::string output = tempPath("output");
+    int64_t elapsed_us = 0;
+    for (auto _ : state) {
+        int64_t start_us = av_gettime_relative();
+        if (!(copy ? remux(clip.path, output) : transcode(clip.path, output))) {
+            state.SkipWithError("transcode failed");
+            break;
+        }
+        elapsed_us += av_gettime_relative() - start_us;
+        unlink(output.c_str());
+    }
+    state.counters["realtime"] = realtimeMultiple((int64_t)kClipSeconds * 1000000 * state.iterations(), elapsed_us);
+}
+BENCHMARK(BM_Transcode)->ArgName("mode")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+void BM_SegmentTranscode(benchmark::State& state) {
+    const SyntheticClip& clip = sourceClip();
+    if (!clip.valid()) {
+        state.SkipWithError("libx264 unavailable, cannot generate the source clip");
+        return;
+    }
+    AVRational time_base = {1, 1};
+    std::vector<int64_t> split_points = findSplitPoints(clip.path, (int)state.range(0), time_base);
+    size_t segment_count = split_points.size() + 1;
+    int threads = SegmentPlanner::threadsPerSegment((int)std::thread::hardware_concurrency(), segment_count);
+    std::string output = tempPath("output");
+    int64_t elapsed_us = 0;
+    for (auto _ : state) {
+        int64_t start_us = av_gettime_relative();
+        std::vector<std::string> parts;
+        std::vector<int64_t> first_pts(segment_count, AV_NOPTS_VALUE);
+        std::vector<char> results(segment_count, 0);
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < segment_count; i++) {
+            parts.push_back(output + ".part" + std::to_string(i) + ".mp4");
+        }
+        for (size_t i = 0; i < segment_count; i++) {
+            workers.push_back(std::thread([&, i]() {
+                int64_t start = 0, end = 0;
+                SegmentPlanner::segmentRange(split_points, i, start, end);
+                results[i] = transcode(clip.path, parts[i], start, end, threads, &first_pts[i]) ? 1 : 0;
+            }));
+        }
+        bool ok = true;
+        for (size_t i = 0; i < workers.size(); i++) {
+            workers[i].join();
+            ok = ok && results[i] && first_pts[i] != AV_NOPTS_VALUE;
+        }
+        ok = ok && concat(parts, first_pts, time_base, output);
+        elapsed_us += av_gettime_relative() - start_us;
+        for (size_t i = 0; i < parts.size(); i++) {
+            unlink(parts[i].c_str());
+        }
+        unlink(output.c_str());
+        if (!ok) {
+            state.SkipWithError("segment transcode failed");
+            break;
+        }
+    }
+    state.counters["segments"] = (double)segment_count;
+    state.counters["threads_per_segment"] = threads;
+    state.counters["realtime"] = realtimeMultiple((int64_t)kClipSeconds * 1000000 * state.iterations(), elapsed_us);
+}
+BENCHMARK(BM_SegmentTranscode)->ArgName("workers")->Arg(1)->Arg(2)->Arg(4)->Arg(8)
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+}  // namespace
+
+BENCHMARK_MAIN();
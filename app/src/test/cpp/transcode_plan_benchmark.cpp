@@ -0,0 +1,80 @@
+// 分段并行转码的扩展模型：600秒、每2秒一个关键帧的源，按SegmentPlanner切分，
+// 每段在独立线程里做与分段时长成正比的固定计算量（代替解码+编码），对比1/2/4/8个工作线程的耗时。
+// 计算量按迭代次数而不是按墙钟时间给定，核心不足时线程分时执行，不会虚报并行收益。
+// balance计数器是切分本身允许的加速上限（总时长/最长分段）；实际加速还受主机核心数限制
+// 这只是切分策略的模型，不跑FFmpeg；真实的分段解码+编码+拼接见transcode_benchmark的BM_SegmentTranscode
+#include "transcode_plan.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int64_t kTimeBase = 90000;                // 源视频流时间基准 1/90000
+const int64_t kDuration = 600 * kTimeBase;
+const int64_t kGop = 2 * kTimeBase;
+const uint64_t kWorkPerSecond = 200000;         // 每媒体秒的计算迭代数
+
+uint64_t work(uint64_t iterations) {
+    uint64_t x = 88172645463325252ull;
+    for (uint64_t i = 0; i < iterations; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+    }
+    return x;
+}
+
+// 与findSplitPoints相同：向前定位到目标时间之前最近的关键帧
+std::vector<int64_t> planSplits(int workers) {
+    std::vector<int64_t> split_points;
+    for (int i = 1; i < workers; i++) {
+        int64_t target = SegmentPlanner::splitTarget(0, kDuration, i, workers);
+        SegmentPlanner::addSplitPoint(split_points, 0, target / kGop * kGop);
+    }
+    return split_points;
+}
+
+void BM_SegmentParallel(benchmark::State& state) {
+    int workers = SegmentPlanner::workerCount((int)state.range(0), kDuration * 1000 / kTimeBase);
+    std::vector<int64_t> split_points = planSplits(workers);
+    size_t segment_count = split_points.size() + 1;
+    std::vector<uint64_t> segment_work;
+    int64_t longest = 0;
+    for (size_t i = 0; i < segment_count; i++) {
+        int64_t start = 0, end = 0;
+        SegmentPlanner::segmentRange(split_points, i, start, end);
+        start = start == INT64_MIN ? 0 : start;
+        end = end == INT64_MAX ? kDuration : end;
+        longest = std::max(longest, end - start);
+        segment_work.push_back((uint64_t)(end - start) * kWorkPerSecond / kTimeBase);
+    }
+
+    std::vector<uint64_t> results(segment_count);
+    for (auto _ : state) {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < segment_count; i++) {
+            threads.push_back(std::thread([i, &segment_work, &results]() {
+                results[i] = work(segment_work[i]);
+            }));
+        }
+        for (size_t i = 0; i < threads.size(); i++) {
+            threads[i].join();
+        }
+        benchmark::DoNotOptimize(results.data());
+    }
+    state.counters["segments"] = (double)segment_count;
+    state.counters["balance"] = (double)kDuration / (double)longest;
+    state.counters["threads_per_segment"] =
+        SegmentPlanner::threadsPerSegment((int)std::thread::hardware_concurrency(), segment_count);
+    state.counters["media_seconds"] = benchmark::Counter((double)(kDuration / kTimeBase) * state.iterations(),
+                                                         benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_SegmentParallel)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,163 @@
+#include "transcode_plan.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+TEST(TranscodePlanTest, ZeroTargetKeepsSourceSize) {
+    EXPECT_TRUE(keepsSourceSize(0, 0, 1920, 1080));
+    EXPECT_TRUE(keepsSourceSize(1920, 1080, 1920, 1080));
+    EXPECT_TRUE(keepsSourceSize(1920, 0, 1920, 1080));
+    EXPECT_FALSE(keepsSourceSize(1280, 720, 1920, 1080));
+    EXPECT_FALSE(keepsSourceSize(0, 720, 1920, 1080));
+}
+
+TEST(TranscodePlanTest, RealtimeMultiple) {
+    EXPECT_DOUBLE_EQ(4.0, realtimeMultiple(60000000, 15000000));
+    EXPECT_DOUBLE_EQ(0.5, realtimeMultiple(1000000, 2000000));
+    EXPECT_DOUBLE_EQ(0.0, realtimeMultiple(60000000, 0));
+    EXPECT_DOUBLE_EQ(0.0, realtimeMultiple(0, 1000));
+}
+
+TEST(TranscodePlanTest, ThrottleReportsFirstCallThenPercentSteps) {
+    TranscodeProgressThrottle throttle;
+    const int64_t duration_ms = 100000;     // 1% = 1000ms
+    EXPECT_TRUE(throttle.shouldReport(0, duration_ms, 0));
+    EXPECT_FALSE(throttle.shouldReport(500, duration_ms, 1000));
+    EXPECT_FALSE(throttle.shouldReport(999, duration_ms, 2000));
+    EXPECT_TRUE(throttle.shouldReport(1000, duration_ms, 3000));
+    EXPECT_FALSE(throttle.shouldReport(1500, duration_ms, 4000));
+}
+
+TEST(TranscodePlanTest, ThrottleFallsBackToInterval) {
+    TranscodeProgressThrottle throttle;
+    EXPECT_TRUE(throttle.shouldReport(0, 0, 0));        // 时长未知
+    EXPECT_FALSE(throttle.shouldReport(5000, 0, 199999));
+    EXPECT_TRUE(throttle.shouldReport(5000, 0, 200000));
+    EXPECT_FALSE(throttle.shouldReport(6000, 0, 300000));
+    EXPECT_TRUE(throttle.shouldReport(6000, 0, 400000));
+}
+
+// 时长不足100ms时1%为0，进度不前进的包不能每个都回调
+TEST(TranscodePlanTest, ThrottleIgnoresStalledProgressOnShortMedia) {
+    TranscodeProgressThrottle throttle;
+    EXPECT_TRUE(throttle.shouldReport(10, 50, 0));
+    EXPECT_FALSE(throttle.shouldReport(10, 50, 1000));
+    EXPECT_FALSE(throttle.shouldReport(5, 50, 2000));    // B帧pts回退
+    EXPECT_TRUE(throttle.shouldReport(11, 50, 3000));
+}
+
+TEST(SegmentPlannerTest, WorkerCountNeedsTenSecondsPerSegment) {
+    EXPECT_EQ(1, SegmentPlanner::workerCount(8, 15000));
+    EXPECT_EQ(2, SegmentPlanner::workerCount(8, 20000));
+    EXPECT_EQ(4, SegmentPlanner::workerCount(4, 600000));
+    EXPECT_EQ(8, SegmentPlanner::workerCount(16, 600000));
+    EXPECT_EQ(0, SegmentPlanner::workerCount(8, 5000));
+}
+
+TEST(SegmentPlannerTest, SplitTargetsAreEvenlySpaced) {
+    EXPECT_EQ(1000 + 2500, SegmentPlanner::splitTarget(1000, 10000, 1, 4));
+    EXPECT_EQ(1000 + 5000, SegmentPlanner::splitTarget(1000, 10000, 2, 4));
+    EXPECT_EQ(1000 + 7500, SegmentPlanner::splitTarget(1000, 10000, 3, 4));
+}
+
+TEST(SegmentPlannerTest, SplitPointsAreStrictlyIncreasing) {
+    std::vector<int64_t> split_points;
+    EXPECT_FALSE(SegmentPlanner::addSplitPoint(split_points, 100, 100));    // 定位回到起点
+    EXPECT_TRUE(SegmentPlanner::addSplitPoint(split_points, 100, 500));
+    EXPECT_FALSE(SegmentPlanner::addSplitPoint(split_points, 100, 500));    // 长GOP下与上一个重合
+    EXPECT_FALSE(SegmentPlanner::addSplitPoint(split_points, 100, 400));
+    EXPECT_TRUE(SegmentPlanner::addSplitPoint(split_points, 100, 900));
+    ASSERT_EQ(2u, split_points.size());
+    EXPECT_EQ(500, split_points[0]);
+    EXPECT_EQ(900, split_points[1]);
+}
+
+TEST(SegmentPlannerTest, SegmentRangesCoverTheWholeTimeline) {
+    std::vector<int64_t> split_points;
+    split_points.push_back(500);
+    split_points.push_back(900);
+    int64_t start = 0, end = 0;
+    SegmentPlanner::segmentRange(split_points, 0, start, end);
+    EXPECT_EQ(INT64_MIN, start);
+    EXPECT_EQ(500, end);
+    SegmentPlanner::segmentRange(split_points, 1, start, end);
+    EXPECT_EQ(500, start);
+    EXPECT_EQ(900, end);
+    SegmentPlanner::segmentRange(split_points, 2, start, end);
+    EXPECT_EQ(900, start);
+    EXPECT_EQ(INT64_MAX, end);
+}
+
+TEST(SegmentPlannerTest, ThreadsPerSegmentSplitsCores) {
+    EXPECT_EQ(4, SegmentPlanner::threadsPerSegment(8, 2));
+    EXPECT_EQ(2, SegmentPlanner::threadsPerSegment(8, 3));
+    EXPECT_EQ(1, SegmentPlanner::threadsPerSegment(8, 8));
+    EXPECT_EQ(1, SegmentPlanner::threadsPerSegment(4, 8));
+    EXPECT_EQ(1, SegmentPlanner::threadsPerSegment(0, 2));      // hardware_concurrency未知
+}
+
+TEST(SegmentPlannerTest, SegmentKeepsOpenGopLeadingFrames) {
+    const int64_t no_ts = INT64_MIN;
+    // 开放GOP，解码顺序：... P6 B4 B5 | I9 B7 B8 P12 B10 B11，本段为[0, 9)。
+    // 解码器按显示顺序输出，B7/B8在I9之后才送入，在I9之前输出
+    const int64_t decode_order[] = {0, 3, 1, 2, 6, 4, 5, 9, 7, 8, 12, 10, 11};
+    const int64_t display_order[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+    const size_t kReorderDelay = 2;     // 解码器输出比送入晚两帧
+    SegmentFrameFilter filter(INT64_MIN, 9);
+    std::vector<int64_t> written;
+    size_t sent = 0;
+    size_t output = 0;
+    while (sent < sizeof(decode_order) / sizeof(decode_order[0]) && !filter.finished()) {
+        sent++;
+        while (output + kReorderDelay < sent && !filter.finished()) {
+            int64_t pts = display_order[output++];
+            if (filter.accept(pts, no_ts)) {
+                written.push_back(pts);
+            }
+        }
+    }
+    EXPECT_EQ(written, std::vector<int64_t>({0, 1, 2, 3, 4, 5, 6, 7, 8}));
+    EXPECT_TRUE(filter.finished());
+    // 读到I9（下一段的起始关键帧）之后还送入了B7/B8
+    EXPECT_GT(sent, 8u);
+}
+
+TEST(SegmentPlannerTest, SegmentFilterSkipsFramesBeforeStart) {
+    const int64_t no_ts = INT64_MIN;
+    SegmentFrameFilter filter(9, 18);
+    // 从I9开始解码：开放GOP的前置B帧B7/B8属于上一段
+    EXPECT_FALSE(filter.accept(7, no_ts));
+    EXPECT_FALSE(filter.accept(8, no_ts));
+    EXPECT_TRUE(filter.accept(9, no_ts));
+    EXPECT_TRUE(filter.accept(no_ts, no_ts));
+    EXPECT_FALSE(filter.finished());
+    EXPECT_FALSE(filter.accept(18, no_ts));
+    EXPECT_TRUE(filter.finished());
+}
+
+TEST(SegmentPlannerTest, JoinOffsetFollowsSourceTime) {
+    const int64_t no_ts = INT64_MIN;
+    // 两段编码延迟相同（首包dts = pts - 2）：上一段帧0..9的dts为-2..7，
+    // 本段源偏移10，首包dts -2 + 10 = 8 > 7，按源偏移拼接
+    EXPECT_EQ(10, segmentTimestampOffset(10, -2, 7, no_ts));
+    EXPECT_EQ(10, segmentTimestampOffset(10, no_ts, 7, no_ts));
+    EXPECT_EQ(10, segmentTimestampOffset(10, -2, no_ts, no_ts));
+}
+
+TEST(SegmentPlannerTest, JoinOffsetShiftsWholeSegmentPastEncoderDelay) {
+    const int64_t no_ts = INT64_MIN;
+    // 本段编码延迟更大（首包dts = pts - 4），按源偏移10拼接首包dts为6，与上一段的7重叠
+    int64_t offset = segmentTimestampOffset(10, -4, 7, no_ts);
+    EXPECT_EQ(12, offset);
+    // 整段后移：pts和dts同时移动，段内pts - dts（重排关系）不变
+    const int64_t pts[] = {0, 3, 1, 2};
+    const int64_t dts[] = {-4, -3, -2, -1};
+    int64_t last_dts = 7;
+    for (size_t i = 0; i < 4; i++) {
+        EXPECT_GT(dts[i] + offset, last_dts);
+        EXPECT_GE(pts[i] + offset, dts[i] + offset);
+        last_dts = dts[i] + offset;
+    }
+}